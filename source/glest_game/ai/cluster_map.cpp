@@ -0,0 +1,643 @@
+//
+//      cluster_map.cpp: hierarchical abstraction of the map used by the
+//      pathfinder for long distance queries
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#include "cluster_map.h"
+
+#include <algorithm>
+#include <queue>
+#include <functional>
+
+#include "map.h"
+#include "unit.h"
+#include "unit_type.h"
+#include "util.h"
+#include "leak_dumper.h"
+
+using namespace std;
+using namespace Shared::Util;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		// 	class ClusterMap
+		// =====================================================
+
+		const int ClusterMap::straightCost = 10;
+		const int ClusterMap::diagonalCost = 14;
+
+		// entrances longer than this get a node at each end instead of one
+		// in the middle
+		static const int clusterWideEntranceLength = 6;
+
+		typedef pair<int, int> CostIndex;
+		typedef priority_queue<CostIndex, vector<CostIndex>, greater<CostIndex> > CostIndexQueue;
+
+		ClusterMap::ClusterMap() {
+			map = NULL;
+			clusterSize = Map::passabilityBlockSize;
+			clustersW = 0;
+			clustersH = 0;
+			mutex = new Mutex(CODE_AT_LINE);
+		}
+
+		ClusterMap::~ClusterMap() {
+			clear();
+			delete mutex;
+			mutex = NULL;
+		}
+
+		void ClusterMap::init(const Map *map) {
+			MutexSafeWrapper safeMutex(mutex, CODE_AT_LINE);
+			clear();
+			this->map = map;
+		}
+
+		void ClusterMap::clear() {
+			for (std::map<int, Layer *>::iterator iterMap = layers.begin();
+				iterMap != layers.end(); ++iterMap) {
+				delete iterMap->second;
+			}
+			layers.clear();
+			clustersW = 0;
+			clustersH = 0;
+		}
+
+		int ClusterMap::getOctileCost(const Vec2i &pos1, const Vec2i &pos2) {
+			int dx = abs(pos1.x - pos2.x);
+			int dy = abs(pos1.y - pos2.y);
+			return straightCost * max(dx, dy) + (diagonalCost - straightCost) * min(dx, dy);
+		}
+
+		int ClusterMap::getClusterIndex(const Vec2i &pos) const {
+			return (pos.y / clusterSize) * clustersW + (pos.x / clusterSize);
+		}
+
+		bool ClusterMap::isInsideCluster(int clusterIndex, const Vec2i &pos) const {
+			int x0 = (clusterIndex % clustersW) * clusterSize;
+			int y0 = (clusterIndex / clustersW) * clusterSize;
+			return pos.x >= x0 && pos.y >= y0 &&
+				pos.x < x0 + clusterSize && pos.y < y0 + clusterSize &&
+				map->isInside(pos);
+		}
+
+		ClusterMap::Layer *ClusterMap::getLayer(Field field, int size) {
+			int blocksW = map->getPassabilityBlocksW();
+			int blocksH = map->getPassabilityBlocksH();
+			if (clustersW != blocksW || clustersH != blocksH) {
+				clear();
+				clustersW = blocksW;
+				clustersH = blocksH;
+			}
+
+			int key = size * fieldCount + field;
+			std::map<int, Layer *>::iterator iterFind = layers.find(key);
+			if (iterFind != layers.end()) {
+				return iterFind->second;
+			}
+			Layer *layer = new Layer(field, size);
+			layers[key] = layer;
+			return layer;
+		}
+
+		bool ClusterMap::computePassable(const Layer *layer, int x, int y) const {
+			for (int i = 0; i < layer->size; ++i) {
+				for (int j = 0; j < layer->size; ++j) {
+					Vec2i pos(x + i, y + j);
+					if (map->isInside(pos) == false ||
+						map->isInsideSurface(Map::toSurfCoords(pos)) == false) {
+						return false;
+					}
+					const Cell *cell = map->getCell(pos);
+					const Unit *unit = cell->getUnit(layer->field);
+					if (unit != NULL && unit->getType()->isMobile() == false) {
+						return false;
+					}
+					if (layer->field == fLand) {
+						if (map->getSurfaceCell(Map::toSurfCoords(pos))->isFree() == false ||
+							map->getDeepSubmerged(cell) == true) {
+							return false;
+						}
+					}
+				}
+			}
+			return true;
+		}
+
+		void ClusterMap::syncLayer(Layer *layer) {
+			int w = map->getW();
+			int h = map->getH();
+			int clusterCount = clustersW * clustersH;
+
+			if ((int) layer->clusters.size() != clusterCount) {
+				layer->passable.assign(w * h, 0);
+				for (int y = 0; y < h; ++y) {
+					for (int x = 0; x < w; ++x) {
+						layer->passable[y * w + x] = computePassable(layer, x, y);
+					}
+				}
+				layer->blockRevision.resize(clusterCount);
+				for (int index = 0; index < clusterCount; ++index) {
+					layer->blockRevision[index] =
+						map->getPassabilityRevision(index % clustersW, index / clustersW);
+				}
+				layer->clusters.assign(clusterCount, Cluster());
+				for (int index = 0; index < clusterCount; ++index) {
+					buildEntrances(layer, index);
+				}
+				for (int index = 0; index < clusterCount; ++index) {
+					buildNodes(layer, index);
+				}
+				for (int index = 0; index < clusterCount; ++index) {
+					linkNodes(layer, index);
+				}
+			} else {
+				// clusters whose entrances or nodes have to be rebuilt, and
+				// clusters whose links into those have to be refreshed
+				vector<unsigned char> rebuild(clusterCount, 0);
+				vector<unsigned char> relink(clusterCount, 0);
+				bool changed = false;
+
+				for (int index = 0; index < clusterCount; ++index) {
+					int bx = index % clustersW;
+					int by = index / clustersW;
+					uint32 revision = map->getPassabilityRevision(bx, by);
+					if (layer->blockRevision[index] == revision) {
+						continue;
+					}
+					layer->blockRevision[index] = revision;
+					changed = true;
+
+					// footprints starting up to size - 1 cells before the block
+					// reach into it
+					int minX = max(0, bx * clusterSize - (layer->size - 1));
+					int minY = max(0, by * clusterSize - (layer->size - 1));
+					int maxX = min(w, (bx + 1) * clusterSize);
+					int maxY = min(h, (by + 1) * clusterSize);
+					for (int y = minY; y < maxY; ++y) {
+						for (int x = minX; x < maxX; ++x) {
+							layer->passable[y * w + x] = computePassable(layer, x, y);
+						}
+					}
+
+					int minCX = max(0, minX / clusterSize - 1);
+					int minCY = max(0, minY / clusterSize - 1);
+					int maxCX = min(clustersW - 1, bx + 1);
+					int maxCY = min(clustersH - 1, by + 1);
+					for (int cy = minCY; cy <= maxCY; ++cy) {
+						for (int cx = minCX; cx <= maxCX; ++cx) {
+							rebuild[cy * clustersW + cx] = 1;
+						}
+					}
+					for (int cy = max(0, minCY - 1); cy <= min(clustersH - 1, maxCY + 1); ++cy) {
+						for (int cx = max(0, minCX - 1); cx <= min(clustersW - 1, maxCX + 1); ++cx) {
+							relink[cy * clustersW + cx] = 1;
+						}
+					}
+				}
+
+				if (changed == false) {
+					return;
+				}
+				for (int index = 0; index < clusterCount; ++index) {
+					if (rebuild[index]) {
+						buildEntrances(layer, index);
+					}
+				}
+				for (int index = 0; index < clusterCount; ++index) {
+					if (rebuild[index]) {
+						buildNodes(layer, index);
+					}
+				}
+				for (int index = 0; index < clusterCount; ++index) {
+					if (relink[index]) {
+						linkNodes(layer, index);
+					}
+				}
+			}
+
+			layer->nodeCount = 0;
+			for (int index = 0; index < clusterCount; ++index) {
+				layer->clusters[index].nodeOffset = layer->nodeCount;
+				layer->nodeCount += (int) layer->clusters[index].nodes.size();
+			}
+		}
+
+		void ClusterMap::buildEntrances(Layer *layer, int clusterIndex) {
+			Cluster &cluster = layer->clusters[clusterIndex];
+			cluster.eastEntrances.clear();
+			cluster.southEntrances.clear();
+
+			int w = map->getW();
+			int h = map->getH();
+			int cx = clusterIndex % clustersW;
+			int cy = clusterIndex / clustersW;
+			int x0 = cx * clusterSize;
+			int y0 = cy * clusterSize;
+			int x1 = min(w, x0 + clusterSize);
+			int y1 = min(h, y0 + clusterSize);
+
+			// east border: column x1 - 1 against column x1
+			if (cx + 1 < clustersW) {
+				int x = x1 - 1;
+				int runStart = -1;
+				for (int y = y0; y <= y1; ++y) {
+					bool open = (y < y1 &&
+						layer->passable[y * w + x] &&
+						layer->passable[y * w + x + 1]);
+					if (open == true && runStart < 0) {
+						runStart = y;
+					} else if (open == false && runStart >= 0) {
+						int runLength = y - runStart;
+						if (runLength > clusterWideEntranceLength) {
+							cluster.eastEntrances.push_back(Entrance(Vec2i(x, runStart), Vec2i(x + 1, runStart)));
+							cluster.eastEntrances.push_back(Entrance(Vec2i(x, y - 1), Vec2i(x + 1, y - 1)));
+						} else {
+							int mid = runStart + (runLength - 1) / 2;
+							cluster.eastEntrances.push_back(Entrance(Vec2i(x, mid), Vec2i(x + 1, mid)));
+						}
+						runStart = -1;
+					}
+				}
+			}
+
+			// south border: row y1 - 1 against row y1
+			if (cy + 1 < clustersH) {
+				int y = y1 - 1;
+				int runStart = -1;
+				for (int x = x0; x <= x1; ++x) {
+					bool open = (x < x1 &&
+						layer->passable[y * w + x] &&
+						layer->passable[(y + 1) * w + x]);
+					if (open == true && runStart < 0) {
+						runStart = x;
+					} else if (open == false && runStart >= 0) {
+						int runLength = x - runStart;
+						if (runLength > clusterWideEntranceLength) {
+							cluster.southEntrances.push_back(Entrance(Vec2i(runStart, y), Vec2i(runStart, y + 1)));
+							cluster.southEntrances.push_back(Entrance(Vec2i(x - 1, y), Vec2i(x - 1, y + 1)));
+						} else {
+							int mid = runStart + (runLength - 1) / 2;
+							cluster.southEntrances.push_back(Entrance(Vec2i(mid, y), Vec2i(mid, y + 1)));
+						}
+						runStart = -1;
+					}
+				}
+			}
+		}
+
+		// Node order inside a cluster: entrances shared with the north
+		// neighbour, with the west neighbour, then our own east and south
+		// entrances. linkNodes relies on this order.
+		void ClusterMap::buildNodes(Layer *layer, int clusterIndex) {
+			Cluster &cluster = layer->clusters[clusterIndex];
+			cluster.nodes.clear();
+
+			int cx = clusterIndex % clustersW;
+			int cy = clusterIndex / clustersW;
+			if (cy > 0) {
+				const vector<Entrance> &entrances = layer->clusters[clusterIndex - clustersW].southEntrances;
+				for (unsigned int index = 0; index < entrances.size(); ++index) {
+					cluster.nodes.push_back(ClusterNode());
+					cluster.nodes.back().pos = entrances[index].otherPos;
+				}
+			}
+			if (cx > 0) {
+				const vector<Entrance> &entrances = layer->clusters[clusterIndex - 1].eastEntrances;
+				for (unsigned int index = 0; index < entrances.size(); ++index) {
+					cluster.nodes.push_back(ClusterNode());
+					cluster.nodes.back().pos = entrances[index].otherPos;
+				}
+			}
+			for (unsigned int index = 0; index < cluster.eastEntrances.size(); ++index) {
+				cluster.nodes.push_back(ClusterNode());
+				cluster.nodes.back().pos = cluster.eastEntrances[index].pos;
+			}
+			for (unsigned int index = 0; index < cluster.southEntrances.size(); ++index) {
+				cluster.nodes.push_back(ClusterNode());
+				cluster.nodes.back().pos = cluster.southEntrances[index].pos;
+			}
+
+			int nodeCount = (int) cluster.nodes.size();
+			cluster.distances.assign(nodeCount * nodeCount, -1);
+			vector<int> costs;
+			for (int i = 0; i < nodeCount; ++i) {
+				searchCluster(layer, clusterIndex, cluster.nodes[i].pos, costs);
+				int x0 = (clusterIndex % clustersW) * clusterSize;
+				int y0 = (clusterIndex / clustersW) * clusterSize;
+				for (int j = 0; j < nodeCount; ++j) {
+					const Vec2i &pos = cluster.nodes[j].pos;
+					cluster.distances[i * nodeCount + j] =
+						costs[(pos.y - y0) * clusterSize + (pos.x - x0)];
+				}
+			}
+		}
+
+		// where the entrance groups of a cluster start in its node list
+		void ClusterMap::getNodeGroups(const Layer *layer, int clusterIndex,
+			int &westStart, int &eastStart, int &southStart) const {
+			int cx = clusterIndex % clustersW;
+			int cy = clusterIndex / clustersW;
+			int northCount = (cy > 0 ? (int) layer->clusters[clusterIndex - clustersW].southEntrances.size() : 0);
+			int westCount = (cx > 0 ? (int) layer->clusters[clusterIndex - 1].eastEntrances.size() : 0);
+			westStart = northCount;
+			eastStart = northCount + westCount;
+			southStart = eastStart + (int) layer->clusters[clusterIndex].eastEntrances.size();
+		}
+
+		void ClusterMap::linkNodes(Layer *layer, int clusterIndex) {
+			Cluster &cluster = layer->clusters[clusterIndex];
+			int cx = clusterIndex % clustersW;
+			int cy = clusterIndex / clustersW;
+
+			int nodeIndex = 0;
+			int eastIndex = -1;
+			int eastWest = 0, eastEast = 0, eastSouth = 0;
+			if (cy > 0) {
+				int northIndex = clusterIndex - clustersW;
+				int northWest, northEast, northSouth;
+				getNodeGroups(layer, northIndex, northWest, northEast, northSouth);
+				int count = (int) layer->clusters[northIndex].southEntrances.size();
+				for (int index = 0; index < count; ++index, ++nodeIndex) {
+					cluster.nodes[nodeIndex].linkedCluster = northIndex;
+					cluster.nodes[nodeIndex].linkedNode = northSouth + index;
+				}
+			}
+			if (cx > 0) {
+				int westIndex = clusterIndex - 1;
+				int westWest, westEast, westSouth;
+				getNodeGroups(layer, westIndex, westWest, westEast, westSouth);
+				int count = (int) layer->clusters[westIndex].eastEntrances.size();
+				for (int index = 0; index < count; ++index, ++nodeIndex) {
+					cluster.nodes[nodeIndex].linkedCluster = westIndex;
+					cluster.nodes[nodeIndex].linkedNode = westEast + index;
+				}
+			}
+			if (cluster.eastEntrances.empty() == false) {
+				eastIndex = clusterIndex + 1;
+				getNodeGroups(layer, eastIndex, eastWest, eastEast, eastSouth);
+			}
+			for (int index = 0; index < (int) cluster.eastEntrances.size(); ++index, ++nodeIndex) {
+				cluster.nodes[nodeIndex].linkedCluster = eastIndex;
+				cluster.nodes[nodeIndex].linkedNode = eastWest + index;
+			}
+			for (int index = 0; index < (int) cluster.southEntrances.size(); ++index, ++nodeIndex) {
+				cluster.nodes[nodeIndex].linkedCluster = clusterIndex + clustersW;
+				cluster.nodes[nodeIndex].linkedNode = index;
+			}
+		}
+
+		// Dijkstra restricted to one cluster. Moves and costs follow the unit
+		// pathfinder: 8 directions, no corner cutting past blocked cells.
+		void ClusterMap::searchCluster(const Layer *layer, int clusterIndex, const Vec2i &fromPos,
+			vector<int> &costs) const {
+			static const int directionX[] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+			static const int directionY[] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+
+			int w = map->getW();
+			int x0 = (clusterIndex % clustersW) * clusterSize;
+			int y0 = (clusterIndex / clustersW) * clusterSize;
+
+			costs.assign(clusterSize * clusterSize, -1);
+			if (isInsideCluster(clusterIndex, fromPos) == false ||
+				layer->passable[fromPos.y * w + fromPos.x] == false) {
+				return;
+			}
+
+			CostIndexQueue openQueue;
+			int startIndex = (fromPos.y - y0) * clusterSize + (fromPos.x - x0);
+			costs[startIndex] = 0;
+			openQueue.push(CostIndex(0, startIndex));
+
+			while (openQueue.empty() == false) {
+				CostIndex current = openQueue.top();
+				openQueue.pop();
+				if (current.first != costs[current.second]) {
+					continue;
+				}
+				int x = x0 + current.second % clusterSize;
+				int y = y0 + current.second / clusterSize;
+
+				for (int direction = 0; direction < 8; ++direction) {
+					Vec2i nextPos(x + directionX[direction], y + directionY[direction]);
+					if (isInsideCluster(clusterIndex, nextPos) == false ||
+						layer->passable[nextPos.y * w + nextPos.x] == false) {
+						continue;
+					}
+					int stepCost = straightCost;
+					if (directionX[direction] != 0 && directionY[direction] != 0) {
+						if (layer->passable[y * w + nextPos.x] == false ||
+							layer->passable[nextPos.y * w + x] == false) {
+							continue;
+						}
+						stepCost = diagonalCost;
+					}
+					int nextIndex = (nextPos.y - y0) * clusterSize + (nextPos.x - x0);
+					int nextCost = current.first + stepCost;
+					if (costs[nextIndex] < 0 || nextCost < costs[nextIndex]) {
+						costs[nextIndex] = nextCost;
+						openQueue.push(CostIndex(nextCost, nextIndex));
+					}
+				}
+			}
+		}
+
+		void ClusterMap::getPassable(Field field, int size, const Vec2i &areaMin,
+			const Vec2i &areaMax, vector<unsigned char> &passable) {
+			passable.clear();
+			if (map == NULL) {
+				return;
+			}
+
+			MutexSafeWrapper safeMutex(mutex, CODE_AT_LINE);
+
+			Layer *layer = getLayer(field, size);
+			if (clustersW <= 0 || clustersH <= 0) {
+				return;
+			}
+			syncLayer(layer);
+
+			int w = map->getW();
+			int areaW = areaMax.x - areaMin.x;
+			if (areaW <= 0 || areaMax.y <= areaMin.y) {
+				return;
+			}
+			passable.reserve(areaW * (areaMax.y - areaMin.y));
+			for (int y = areaMin.y; y < areaMax.y; ++y) {
+				passable.insert(passable.end(), layer->passable.begin() + (y * w + areaMin.x),
+					layer->passable.begin() + (y * w + areaMax.x));
+			}
+		}
+
+		bool ClusterMap::findWaypoint(const Vec2i &startPos, const Vec2i &finalPos, Field field,
+			int size, int maxWaypointCost, Vec2i &waypoint) {
+			if (map == NULL || map->isInside(startPos) == false || map->isInside(finalPos) == false) {
+				return false;
+			}
+
+			MutexSafeWrapper safeMutex(mutex, CODE_AT_LINE);
+
+			Layer *layer = getLayer(field, size);
+			if (clustersW <= 0 || clustersH <= 0) {
+				return false;
+			}
+			syncLayer(layer);
+
+			int startCluster = getClusterIndex(startPos);
+			int goalCluster = getClusterIndex(finalPos);
+			if (abs(startCluster % clustersW - goalCluster % clustersW) <= 1 &&
+				abs(startCluster / clustersW - goalCluster / clustersW) <= 1) {
+				return false;
+			}
+
+			int w = map->getW();
+			if (layer->passable[startPos.y * w + startPos.x] == false ||
+				layer->passable[finalPos.y * w + finalPos.x] == false) {
+				return false;
+			}
+
+			vector<int> startCosts;
+			vector<int> goalCosts;
+			searchCluster(layer, startCluster, startPos, startCosts);
+			searchCluster(layer, goalCluster, finalPos, goalCosts);
+
+			// abstract A*, node ids are cluster nodeOffset + local index and
+			// the final position is the extra id nodeCount
+			int goalId = layer->nodeCount;
+			vector<int> costs(goalId + 1, -1);
+			vector<int> parents(goalId + 1, -1);
+			vector<int> nodeClusters(goalId + 1, -1);
+			vector<unsigned char> closed(goalId + 1, 0);
+			CostIndexQueue openQueue;
+
+			for (int index = 0; index < (int) layer->clusters.size(); ++index) {
+				const Cluster &cluster = layer->clusters[index];
+				for (int local = 0; local < (int) cluster.nodes.size(); ++local) {
+					nodeClusters[cluster.nodeOffset + local] = index;
+				}
+			}
+
+			const Cluster &firstCluster = layer->clusters[startCluster];
+			int firstX0 = (startCluster % clustersW) * clusterSize;
+			int firstY0 = (startCluster / clustersW) * clusterSize;
+			for (int local = 0; local < (int) firstCluster.nodes.size(); ++local) {
+				const Vec2i &pos = firstCluster.nodes[local].pos;
+				int cost = startCosts[(pos.y - firstY0) * clusterSize + (pos.x - firstX0)];
+				if (cost >= 0) {
+					int id = firstCluster.nodeOffset + local;
+					costs[id] = cost;
+					openQueue.push(CostIndex(cost + getOctileCost(pos, finalPos), id));
+				}
+			}
+
+			int goalX0 = (goalCluster % clustersW) * clusterSize;
+			int goalY0 = (goalCluster / clustersW) * clusterSize;
+			bool found = false;
+			while (openQueue.empty() == false) {
+				CostIndex current = openQueue.top();
+				openQueue.pop();
+				int id = current.second;
+				if (closed[id]) {
+					continue;
+				}
+				closed[id] = 1;
+				if (id == goalId) {
+					found = true;
+					break;
+				}
+
+				int clusterIndex = nodeClusters[id];
+				const Cluster &cluster = layer->clusters[clusterIndex];
+				int local = id - cluster.nodeOffset;
+				int nodeCount = (int) cluster.nodes.size();
+				const ClusterNode &node = cluster.nodes[local];
+
+				if (clusterIndex == goalCluster) {
+					int goalCost = goalCosts[(node.pos.y - goalY0) * clusterSize + (node.pos.x - goalX0)];
+					if (goalCost >= 0 && (costs[goalId] < 0 || costs[id] + goalCost < costs[goalId])) {
+						costs[goalId] = costs[id] + goalCost;
+						parents[goalId] = id;
+						openQueue.push(CostIndex(costs[goalId], goalId));
+					}
+				}
+
+				for (int other = 0; other < nodeCount; ++other) {
+					int distance = cluster.distances[local * nodeCount + other];
+					int otherId = cluster.nodeOffset + other;
+					if (other == local || distance < 0 || closed[otherId]) {
+						continue;
+					}
+					int cost = costs[id] + distance;
+					if (costs[otherId] < 0 || cost < costs[otherId]) {
+						costs[otherId] = cost;
+						parents[otherId] = id;
+						openQueue.push(CostIndex(cost + getOctileCost(cluster.nodes[other].pos, finalPos), otherId));
+					}
+				}
+
+				if (node.linkedCluster >= 0) {
+					const Cluster &linked = layer->clusters[node.linkedCluster];
+					int otherId = linked.nodeOffset + node.linkedNode;
+					int cost = costs[id] + straightCost;
+					if (closed[otherId] == false && (costs[otherId] < 0 || cost < costs[otherId])) {
+						costs[otherId] = cost;
+						parents[otherId] = id;
+						openQueue.push(CostIndex(cost + getOctileCost(linked.nodes[node.linkedNode].pos, finalPos), otherId));
+					}
+				}
+			}
+
+			if (found == false) {
+				return false;
+			}
+
+			// walk back from the goal and keep the furthest node that is still
+			// within reach of a regular search
+			vector<int> route;
+			for (int id = parents[goalId]; id >= 0; id = parents[id]) {
+				route.push_back(id);
+			}
+			std::reverse(route.begin(), route.end());
+
+			int chosen = -1;
+			for (unsigned int index = 0; index < route.size(); ++index) {
+				if (costs[route[index]] == 0) {
+					// the unit is standing on this entrance
+					continue;
+				}
+				if (costs[route[index]] > maxWaypointCost && chosen >= 0) {
+					break;
+				}
+				chosen = route[index];
+			}
+			if (chosen < 0 || costs[goalId] <= maxWaypointCost) {
+				return false;
+			}
+
+			const Cluster &chosenCluster = layer->clusters[nodeClusters[chosen]];
+			waypoint = chosenCluster.nodes[chosen - chosenCluster.nodeOffset].pos;
+			return true;
+		}
+
+	}
+} //end namespace
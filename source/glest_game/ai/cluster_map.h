@@ -0,0 +1,155 @@
+//
+//      cluster_map.h: hierarchical abstraction of the map used by the
+//      pathfinder for long distance queries
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _GLEST_GAME_CLUSTERMAP_H_
+#define _GLEST_GAME_CLUSTERMAP_H_
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <winsock.h>
+#endif
+
+#include <vector>
+#include <map>
+#include "vec.h"
+#include "skill_type.h"
+#include "data_types.h"
+#include "thread.h"
+#include "leak_dumper.h"
+
+using std::vector;
+using Shared::Graphics::Vec2i;
+using Shared::Platform::Mutex;
+using Shared::Platform::uint32;
+
+namespace Glest {
+	namespace Game {
+
+		class Map;
+
+		// =====================================================
+		//	class ClusterMap
+		//
+		///	HPA* style abstraction of the map: the map is split in
+		///	clusters of Map::passabilityBlockSize cells, entrances
+		///	between clusters become graph nodes and intra cluster
+		///	distances become edges. Only static obstacles (terrain,
+		///	objects and buildings) are considered so the graph only
+		///	changes when Map::markPassabilityChanged is called.
+		// =====================================================
+
+		class ClusterMap {
+		public:
+			static const int straightCost;
+			static const int diagonalCost;
+
+		private:
+			class Entrance {
+			public:
+				Entrance(const Vec2i &pos, const Vec2i &otherPos) : pos(pos), otherPos(otherPos) {
+				}
+				Vec2i pos;		// cell inside this cluster
+				Vec2i otherPos;	// adjacent cell in the east or south neighbour
+			};
+
+			class ClusterNode {
+			public:
+				ClusterNode() : linkedCluster(-1), linkedNode(-1) {
+				}
+				Vec2i pos;
+				int linkedCluster;
+				int linkedNode;
+			};
+
+			class Cluster {
+			public:
+				vector<Entrance> eastEntrances;
+				vector<Entrance> southEntrances;
+				vector<ClusterNode> nodes;
+				vector<int> distances;	// nodes.size() squared, -1 when unreachable
+				int nodeOffset;
+			};
+
+			// one abstraction per movement field and unit size
+			class Layer {
+			public:
+				Layer(Field field, int size) : field(field), size(size), nodeCount(0) {
+				}
+				Field field;
+				int size;
+				vector<unsigned char> passable;
+				vector<uint32> blockRevision;
+				vector<Cluster> clusters;
+				int nodeCount;
+			};
+
+			const Map *map;
+			int clusterSize;
+			int clustersW;
+			int clustersH;
+			std::map<int, Layer *> layers;
+			Mutex *mutex;
+
+		private:
+			ClusterMap(const ClusterMap &obj);
+			ClusterMap &operator=(const ClusterMap &obj);
+
+			Layer *getLayer(Field field, int size);
+			void syncLayer(Layer *layer);
+			bool computePassable(const Layer *layer, int x, int y) const;
+			void buildEntrances(Layer *layer, int clusterIndex);
+			void buildNodes(Layer *layer, int clusterIndex);
+			void linkNodes(Layer *layer, int clusterIndex);
+			void getNodeGroups(const Layer *layer, int clusterIndex,
+				int &westStart, int &eastStart, int &southStart) const;
+			void searchCluster(const Layer *layer, int clusterIndex, const Vec2i &fromPos,
+				vector<int> &costs) const;
+			int getClusterIndex(const Vec2i &pos) const;
+			bool isInsideCluster(int clusterIndex, const Vec2i &pos) const;
+
+		public:
+			ClusterMap();
+			~ClusterMap();
+
+			void init(const Map *map);
+			void clear();
+
+			// Finds an intermediate target on the way from startPos to finalPos.
+			// Returns false when the positions are close enough for a plain
+			// search or when the abstract graph has no route between them.
+			bool findWaypoint(const Vec2i &startPos, const Vec2i &finalPos, Field field,
+				int size, int maxWaypointCost, Vec2i &waypoint);
+
+			// Copies the static passability used by the graph, one byte per
+			// cell for a unit of the given size whose top left corner is there,
+			// of the cells from areaMin up to but not including areaMax
+			void getPassable(Field field, int size, const Vec2i &areaMin,
+				const Vec2i &areaMax, vector<unsigned char> &passable);
+
+			static int getOctileCost(const Vec2i &pos1, const Vec2i &pos2);
+		};
+
+	}
+} //end namespace
+
+#endif
@@ -0,0 +1,333 @@
+//
+//      flow_field.cpp: shared movement fields for large groups of units
+//      sent to the same target
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#include "flow_field.h"
+
+#include <algorithm>
+#include <queue>
+#include <functional>
+
+#include "map.h"
+#include "cluster_map.h"
+#include "path_finder.h"
+#include "game_constants.h"
+#include "util.h"
+#include "leak_dumper.h"
+
+using namespace std;
+using namespace Shared::Util;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		// 	class FlowField
+		// =====================================================
+
+		const int FlowField::unreachable = -1;
+		const int FlowField::noDirection = -1;
+
+		// straight neighbours first so equal costs prefer straight steps
+		static const int flowFieldNeighbourCount = 8;
+		static const int flowFieldNeighbourX[flowFieldNeighbourCount] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+		static const int flowFieldNeighbourY[flowFieldNeighbourCount] = { -1, 0, 1, 0, -1, 1, 1, -1 };
+
+		typedef pair<int, int> FlowCostIndex;
+		typedef priority_queue<FlowCostIndex, vector<FlowCostIndex>, greater<FlowCostIndex> > FlowCostIndexQueue;
+
+		FlowField::FlowField(const Vec2i &target, Field field, int size) :
+			target(target), field(field), size(size) {
+			w = 0;
+			h = 0;
+		}
+
+		Vec2i FlowField::getNeighbour(int direction) {
+			return Vec2i(flowFieldNeighbourX[direction], flowFieldNeighbourY[direction]);
+		}
+
+		int FlowField::getNeighbourCount() {
+			return flowFieldNeighbourCount;
+		}
+
+		void FlowField::build(const Map *map, ClusterMap *clusterMap,
+			const Vec2i &areaMin, const Vec2i &areaMax) {
+			this->areaMin = areaMin;
+			this->areaMax = areaMax;
+			w = areaMax.x - areaMin.x;
+			h = areaMax.y - areaMin.y;
+
+			// the passability of a cell looks at the footprint of size cells
+			// from there, so blocks up to size - 1 cells past the area count
+			blockMin = Vec2i(areaMin.x / Map::passabilityBlockSize,
+				areaMin.y / Map::passabilityBlockSize);
+			blockMax = Vec2i(min(map->getW() - 1, areaMax.x + size - 2) / Map::passabilityBlockSize + 1,
+				min(map->getH() - 1, areaMax.y + size - 2) / Map::passabilityBlockSize + 1);
+			blockRevisions.clear();
+			for (int by = blockMin.y; by < blockMax.y; ++by) {
+				for (int bx = blockMin.x; bx < blockMax.x; ++bx) {
+					blockRevisions.push_back(map->getPassabilityRevision(bx, by));
+				}
+			}
+
+			vector<unsigned char> passable;
+			clusterMap->getPassable(field, size, areaMin, areaMax, passable);
+
+			costs.assign(w * h, unreachable);
+			directions.assign(w * h, (signed char) noDirection);
+			if ((int) passable.size() != w * h || isInArea(target) == false) {
+				return;
+			}
+
+			// integration field: Dijkstra outwards from the target, in
+			// coordinates relative to areaMin
+			Vec2i localTarget = target - areaMin;
+			FlowCostIndexQueue openQueue;
+			if (passable[localTarget.y * w + localTarget.x]) {
+				costs[localTarget.y * w + localTarget.x] = 0;
+				openQueue.push(FlowCostIndex(0, localTarget.y * w + localTarget.x));
+			} else {
+				// the target itself is blocked (a building for example), start
+				// from the free cells around it like computeNearestFreePos does
+				int radius = PathFinder::maxFreeSearchRadius;
+				for (int y = max(0, localTarget.y - radius); y <= min(h - 1, localTarget.y + radius); ++y) {
+					for (int x = max(0, localTarget.x - radius); x <= min(w - 1, localTarget.x + radius); ++x) {
+						if (passable[y * w + x]) {
+							int cost = ClusterMap::getOctileCost(Vec2i(x, y), localTarget);
+							costs[y * w + x] = cost;
+							openQueue.push(FlowCostIndex(cost, y * w + x));
+						}
+					}
+				}
+			}
+
+			while (openQueue.empty() == false) {
+				FlowCostIndex current = openQueue.top();
+				openQueue.pop();
+				int index = current.second;
+				if (current.first > costs[index]) {
+					continue;
+				}
+
+				int x = index % w;
+				int y = index / w;
+				for (int direction = 0; direction < flowFieldNeighbourCount; ++direction) {
+					int nx = x + flowFieldNeighbourX[direction];
+					int ny = y + flowFieldNeighbourY[direction];
+					if (nx < 0 || ny < 0 || nx >= w || ny >= h || !passable[ny * w + nx]) {
+						continue;
+					}
+					bool diagonal = (flowFieldNeighbourX[direction] != 0 && flowFieldNeighbourY[direction] != 0);
+					if (diagonal == true && (!passable[y * w + nx] || !passable[ny * w + x])) {
+						continue;
+					}
+					int cost = current.first + (diagonal ? ClusterMap::diagonalCost : ClusterMap::straightCost);
+					int neighbourIndex = ny * w + nx;
+					if (costs[neighbourIndex] == unreachable || cost < costs[neighbourIndex]) {
+						costs[neighbourIndex] = cost;
+						openQueue.push(FlowCostIndex(cost, neighbourIndex));
+					}
+				}
+			}
+
+			// direction field: cheapest neighbour, first one in neighbour order
+			// on ties so every peer picks the same step
+			for (int y = 0; y < h; ++y) {
+				for (int x = 0; x < w; ++x) {
+					int cost = costs[y * w + x];
+					if (cost <= 0) {
+						continue;
+					}
+					int bestCost = cost;
+					for (int direction = 0; direction < flowFieldNeighbourCount; ++direction) {
+						int nx = x + flowFieldNeighbourX[direction];
+						int ny = y + flowFieldNeighbourY[direction];
+						if (nx < 0 || ny < 0 || nx >= w || ny >= h) {
+							continue;
+						}
+						int neighbourCost = costs[ny * w + nx];
+						if (neighbourCost != unreachable && neighbourCost < bestCost) {
+							bestCost = neighbourCost;
+							directions[y * w + x] = (signed char) direction;
+						}
+					}
+				}
+			}
+		}
+
+		bool FlowField::isCurrent(const Map *map) const {
+			int index = 0;
+			for (int by = blockMin.y; by < blockMax.y; ++by) {
+				for (int bx = blockMin.x; bx < blockMax.x; ++bx) {
+					if (blockRevisions[index++] != map->getPassabilityRevision(bx, by)) {
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		int FlowField::getCost(const Vec2i &pos) const {
+			if (isInArea(pos) == false || costs.empty() == true) {
+				return unreachable;
+			}
+			return costs[(pos.y - areaMin.y) * w + (pos.x - areaMin.x)];
+		}
+
+		int FlowField::getDirection(const Vec2i &pos) const {
+			if (isInArea(pos) == false || directions.empty() == true) {
+				return noDirection;
+			}
+			return directions[(pos.y - areaMin.y) * w + (pos.x - areaMin.x)];
+		}
+
+		// =====================================================
+		// 	class FlowFieldCache
+		// =====================================================
+
+		const int FlowFieldCache::minGroupSize = 10;
+		// fields of groups nobody asked for in this many seconds are dropped
+		const int FlowFieldCache::idleSecondsLimit = 10;
+		// cells around the group and its target the field reaches out to
+		const int FlowFieldCache::areaMargin = 2 * Map::passabilityBlockSize;
+
+		bool FlowFieldCache::Key::operator<(const Key &key) const {
+			if (commandGroupId != key.commandGroupId) {
+				return commandGroupId < key.commandGroupId;
+			}
+			if (target != key.target) {
+				return target < key.target;
+			}
+			if (field != key.field) {
+				return field < key.field;
+			}
+			return size < key.size;
+		}
+
+		FlowFieldCache::FlowFieldCache() {
+			map = NULL;
+			clusterMap = NULL;
+			lastPurgeFrame = 0;
+		}
+
+		FlowFieldCache::~FlowFieldCache() {
+			clear();
+		}
+
+		void FlowFieldCache::init(const Map *map, ClusterMap *clusterMap) {
+			clear();
+			this->map = map;
+			this->clusterMap = clusterMap;
+		}
+
+		void FlowFieldCache::clear() {
+			for (Entries::iterator iterMap = entries.begin();
+				iterMap != entries.end(); ++iterMap) {
+				delete iterMap->second.flowField;
+			}
+			entries.clear();
+			lastPurgeFrame = 0;
+		}
+
+		void FlowFieldCache::purge(int frame) {
+			if (frame - lastPurgeFrame < GameConstants::updateFps) {
+				return;
+			}
+			lastPurgeFrame = frame;
+
+			for (Entries::iterator iterMap = entries.begin(); iterMap != entries.end();) {
+				if (frame - iterMap->second.lastUsedFrame > idleSecondsLimit * GameConstants::updateFps) {
+					delete iterMap->second.flowField;
+					entries.erase(iterMap++);
+				} else {
+					++iterMap;
+				}
+			}
+		}
+
+		void FlowFieldCache::buildFlowField(Entry &entry, const Key &key) {
+			Vec2i areaMin(max(0, entry.boxMin.x - areaMargin), max(0, entry.boxMin.y - areaMargin));
+			Vec2i areaMax(min(map->getW(), entry.boxMax.x + areaMargin + 1),
+				min(map->getH(), entry.boxMax.y + areaMargin + 1));
+			if (entry.flowField == NULL) {
+				entry.flowField = new FlowField(key.target, key.field, key.size);
+			}
+			entry.flowField->build(map, clusterMap, areaMin, areaMax);
+		}
+
+		const FlowField *FlowFieldCache::getFlowField(int commandGroupId, const Vec2i &target,
+			Field field, int size, int unitId, const Vec2i &unitPos, int frame) {
+			if (map == NULL || clusterMap == NULL || commandGroupId < 0) {
+				return NULL;
+			}
+			purge(frame);
+
+			Key key(commandGroupId, target, field, size);
+			Entries::iterator iterFind = entries.find(key);
+			if (iterFind == entries.end()) {
+				Entry newEntry;
+				newEntry.boxMin = target;
+				newEntry.boxMax = target;
+				iterFind = entries.insert(make_pair(key, newEntry)).first;
+			}
+			Entry &entry = iterFind->second;
+			entry.lastUsedFrame = frame;
+
+			bool grown = false;
+			if (unitPos.x < entry.boxMin.x || unitPos.y < entry.boxMin.y ||
+				unitPos.x > entry.boxMax.x || unitPos.y > entry.boxMax.y) {
+				entry.boxMin = Vec2i(min(entry.boxMin.x, unitPos.x), min(entry.boxMin.y, unitPos.y));
+				entry.boxMax = Vec2i(max(entry.boxMax.x, unitPos.x), max(entry.boxMax.y, unitPos.y));
+				grown = true;
+			}
+
+			if (entry.flowField == NULL) {
+				entry.unitIds.insert(unitId);
+				if ((int) entry.unitIds.size() < minGroupSize) {
+					return NULL;
+				}
+				entry.unitIds.clear();
+				buildFlowField(entry, key);
+			} else if ((grown == true && entry.flowField->isInArea(unitPos) == false) ||
+				entry.flowField->isCurrent(map) == false) {
+				// only changes around the group, not anywhere on the map,
+				// make it build the field again
+				buildFlowField(entry, key);
+			}
+			return entry.flowField;
+		}
+
+		const FlowField *FlowFieldCache::findFlowField(int commandGroupId, const Vec2i &target,
+			Field field, int size) const {
+			if (map == NULL || commandGroupId < 0) {
+				return NULL;
+			}
+			Entries::const_iterator iterFind = entries.find(Key(commandGroupId, target, field, size));
+			if (iterFind == entries.end() || iterFind->second.flowField == NULL ||
+				iterFind->second.flowField->isCurrent(map) == false) {
+				return NULL;
+			}
+			return iterFind->second.flowField;
+		}
+
+	}
+} //end namespace
@@ -0,0 +1,193 @@
+//
+//      flow_field.h: shared movement fields for large groups of units
+//      sent to the same target
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _GLEST_GAME_FLOWFIELD_H_
+#define _GLEST_GAME_FLOWFIELD_H_
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <winsock.h>
+#endif
+
+#include <vector>
+#include <map>
+#include <set>
+#include "vec.h"
+#include "skill_type.h"
+#include "data_types.h"
+#include "leak_dumper.h"
+
+using std::vector;
+using Shared::Graphics::Vec2i;
+using Shared::Platform::uint32;
+
+namespace Glest {
+	namespace Game {
+
+		class Map;
+		class ClusterMap;
+
+		// =====================================================
+		//	class FlowField
+		//
+		///	Integration and direction field towards one target cell
+		///	for one movement field and unit size, over the part of the
+		///	map around the group. Only static obstacles are considered,
+		///	units are avoided when a step is taken.
+		// =====================================================
+
+		class FlowField {
+		public:
+			static const int unreachable;
+			static const int noDirection;
+
+		private:
+			Vec2i target;
+			Field field;
+			int size;
+			Vec2i areaMin;					// the cells covered, areaMax excluded
+			Vec2i areaMax;
+			int w;
+			int h;
+			Vec2i blockMin;					// passability blocks the cells depend on
+			Vec2i blockMax;
+			vector<uint32> blockRevisions;
+			vector<int> costs;				// integration field, -1 when unreachable
+			vector<signed char> directions;	// best neighbour per cell, see getDirection
+
+		public:
+			FlowField(const Vec2i &target, Field field, int size);
+
+			void build(const Map *map, ClusterMap *clusterMap,
+				const Vec2i &areaMin, const Vec2i &areaMax);
+
+			inline const Vec2i &getTarget() const {
+				return target;
+			}
+			inline Field getField() const {
+				return field;
+			}
+			inline int getSize() const {
+				return size;
+			}
+			inline const Vec2i &getAreaMin() const {
+				return areaMin;
+			}
+			inline const Vec2i &getAreaMax() const {
+				return areaMax;
+			}
+			inline bool isInArea(const Vec2i &pos) const {
+				return pos.x >= areaMin.x && pos.y >= areaMin.y &&
+					pos.x < areaMax.x && pos.y < areaMax.y;
+			}
+			// false once a building or tree changed within the blocks
+			// the field was built from
+			bool isCurrent(const Map *map) const;
+
+			int getCost(const Vec2i &pos) const;
+			// index into getNeighbour() of the cheapest static step from pos,
+			// noDirection when pos is the target or cannot reach it
+			int getDirection(const Vec2i &pos) const;
+
+			static Vec2i getNeighbour(int direction);
+			static int getNeighbourCount();
+		};
+
+		// =====================================================
+		//	class FlowFieldCache
+		//
+		///	Flow fields of the active command groups. A field is
+		///	only built once enough units of a group asked for it,
+		///	over the box around them and the target, and is rebuilt
+		///	when the passability within it changes or a unit of the
+		///	group asks from outside of it.
+		// =====================================================
+
+		class FlowFieldCache {
+		public:
+			static const int minGroupSize;
+			static const int idleSecondsLimit;
+			static const int areaMargin;
+
+		private:
+			class Entry {
+			public:
+				Entry() : flowField(NULL), lastUsedFrame(0) {
+				}
+				FlowField *flowField;
+				std::set<int> unitIds;
+				// box of the target and the positions the group asked from
+				Vec2i boxMin;
+				Vec2i boxMax;
+				int lastUsedFrame;
+			};
+
+			class Key {
+			public:
+				Key(int commandGroupId, const Vec2i &target, Field field, int size) :
+					commandGroupId(commandGroupId), target(target), field(field), size(size) {
+				}
+				int commandGroupId;
+				Vec2i target;
+				Field field;
+				int size;
+
+				bool operator<(const Key &key) const;
+			};
+
+			typedef std::map<Key, Entry> Entries;
+
+			const Map *map;
+			ClusterMap *clusterMap;
+			Entries entries;
+			int lastPurgeFrame;
+
+		private:
+			FlowFieldCache(const FlowFieldCache &obj);
+			FlowFieldCache &operator=(const FlowFieldCache &obj);
+
+			void purge(int frame);
+			void buildFlowField(Entry &entry, const Key &key);
+
+		public:
+			FlowFieldCache();
+			~FlowFieldCache();
+
+			void init(const Map *map, ClusterMap *clusterMap);
+			void clear();
+
+			// Registers unitId at unitPos as a member of the group and
+			// returns the field once the group is large enough, NULL before
+			// that. Must only be called from the main thread.
+			const FlowField *getFlowField(int commandGroupId, const Vec2i &target,
+				Field field, int size, int unitId, const Vec2i &unitPos, int frame);
+			// Read only lookup of an already built and current field, safe
+			// while the faction threads run
+			const FlowField *findFlowField(int commandGroupId, const Vec2i &target,
+				Field field, int size) const;
+		};
+
+	}
+} //end namespace
+
+#endif
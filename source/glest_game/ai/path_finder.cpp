@@ -19,6 +19,7 @@
 #include "platform_common.h"
 #include "command.h"
 #include "faction.h"
+#include "world.h"
 #include "randomgen.h"
 #include "leak_dumper.h"
 
@@ -58,10 +59,15 @@ namespace
 			PathFinder::pathFindExtendRefreshNodeCountMin = 40;
 		const int
 			PathFinder::pathFindExtendRefreshNodeCountMax = 40;
+		const int
+			PathFinder::pathFindClusterWaypointCost =
+			Map::passabilityBlockSize * 2 * ClusterMap::straightCost;
+		const int
+			PathFinder::pathFindFlowFieldApproachCost =
+			PathFinder::maxFreeSearchRadius * ClusterMap::straightCost;
 
-		PathFinder::PathFinder() {
-			minorDebugPathfinder = false;
-			map = NULL;
+		PathFinder::PathFinder() :pathJobPool(this) {
+			init();
 		}
 
 		int
@@ -71,10 +77,8 @@ namespace
 			return PathFinder::pathFindExtendRefreshNodeCountMin;
 		}
 
-		PathFinder::PathFinder(const Map * map) {
-			minorDebugPathfinder = false;
-
-			map = NULL;
+		PathFinder::PathFinder(const Map * map) :pathJobPool(this) {
+			init();
 			init(map);
 		}
 
@@ -88,15 +92,56 @@ namespace
 				faction.useMaxNodeCount = PathFinder::pathFindNodesMax;
 			}
 			this->map = map;
+			clusterMap.init(map);
+			flowFields.init(map, &clusterMap);
+			startPathJobThreads();
+		}
+
+		void
+			PathFinder::startPathJobThreads() {
+			// the pool threads are stopped before their states go away
+			pathJobPool.stop();
+
+			// The result of a frame does not depend on the worker count, peers
+			// may use different values
+			int
+				threadCount =
+				Config::getInstance().getInt("PathFinderThreadCount", "2");
+			if (threadCount < 0) {
+				threadCount = 0;
+			}
+			while ((int) pathJobStates.size() > threadCount + 1) {
+				delete
+					pathJobStates.back();
+				pathJobStates.pop_back();
+			}
+			while ((int) pathJobStates.size() < threadCount + 1) {
+				pathJobStates.push_back(new FactionState(-1));
+			}
+			for (unsigned int index = 0; index < pathJobStates.size(); ++index) {
+				pathJobStates[index]->nodePool.resize(pathFindNodesAbsoluteMax);
+				pathJobStates[index]->useMaxNodeCount =
+					PathFinder::pathFindNodesMax;
+			}
+			pathJobPool.start(threadCount);
 		}
 
 		void
 			PathFinder::init() {
 			minorDebugPathfinder = false;
 			map = NULL;
+			serialMicros = 0;
 		}
 
 		PathFinder::~PathFinder() {
+			pathJobPool.stop();
+			pathJobs.clear();
+			for (unsigned int index = 0; index < pathJobStates.size(); ++index) {
+				delete
+					pathJobStates[index];
+			}
+			pathJobStates.clear();
+
 			for (int factionIndex = 0; factionIndex < GameConstants::maxPlayers;
 				++factionIndex) {
 				FactionState & faction = factions.getFactionState(factionIndex);
@@ -121,6 +166,7 @@ namespace
 				faction.precachedTravelState.clear();
 				faction.precachedPath.clear();
 			}
+			flowFields.clear();
 		}
 
 		void
@@ -135,11 +181,17 @@ namespace
 				MutexSafeWrapper
 					safeMutex(faction.getMutexPreCache(), mutexOwnerId);
 
-				faction.precachedTravelState[unit->getId()] = tsImpossible;
-				faction.precachedPath[unit->getId()].clear();
+				clearUnitPrecache(unit, faction);
 			}
 		}
 
+		void
+			PathFinder::clearUnitPrecache(Unit * unit, FactionState & faction) {
+			faction.precachedTravelState[unit->getId()] = tsImpossible;
+			faction.precachedPath[unit->getId()].clear();
+			faction.pendingPathJobs.erase(unit->getId());
+		}
+
 		void
 			PathFinder::removeUnitPrecache(Unit * unit) {
 			if (unit != NULL && factions.size() > unit->getFactionIndex()) {
@@ -160,12 +212,233 @@ namespace
 					faction.precachedPath.end()) {
 					faction.precachedPath.erase(unit->getId());
 				}
+				faction.pendingPathJobs.erase(unit->getId());
+			}
+		}
+
+		static bool
+			comparePathJobs(const PathFinder::PathJob & job1,
+				const PathFinder::PathJob & job2) {
+			return job1.unit->getId() < job2.unit->getId();
+		}
+
+		int
+			PathFinder::runPathJobs(int frameIndex) {
+			pathJobs.clear();
+			for (int factionIndex = 0; factionIndex < factions.size();
+				++factionIndex) {
+				FactionState & faction = factions.getFactionState(factionIndex);
+				for (std::map < int, PathJob >::iterator iterMap =
+					faction.pendingPathJobs.begin();
+					iterMap != faction.pendingPathJobs.end(); ++iterMap) {
+					pathJobs.push_back(iterMap->second);
+				}
+				faction.pendingPathJobs.clear();
+			}
+
+			if (pathJobs.empty() == true) {
+				return 0;
+			}
+
+			std::sort(pathJobs.begin(), pathJobs.end(), comparePathJobs);
+
+			// threaded synch logs would be written in a different order on
+			// every run so the jobs stay on this thread while they are enabled
+			bool
+				runThreaded =
+				(SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).
+					enabled == false);
+			pathJobPool.run((int) pathJobs.size(), runThreaded);
+
+			// commit in unit id order, no matter which worker solved which job
+			for (unsigned int index = 0; index < pathJobs.size(); ++index) {
+				PathJob & job = pathJobs[index];
+				FactionState & faction =
+					factions.getFactionState(job.unit->getFactionIndex());
+
+				faction.precachedTravelState[job.unit->getId()] = job.travelState;
+				faction.precachedPath[job.unit->getId()].swap(job.path);
+			}
+
+			int
+				jobCount = (int) pathJobs.size();
+			pathJobs.clear();
+			return jobCount;
+		}
+
+		// Hands back the findPath() time since the last call, the precache of
+		// all factions summed, and starts counting again
+		void
+			PathFinder::takeFindPathMicros(int64 & precacheMicros,
+				int64 & serialMicros) {
+			precacheMicros = 0;
+			for (int factionIndex = 0; factionIndex < factions.size();
+				++factionIndex) {
+				FactionState & faction = factions.getFactionState(factionIndex);
+				precacheMicros += faction.precacheMicros;
+				faction.precacheMicros = 0;
+			}
+			serialMicros = this->serialMicros;
+			this->serialMicros = 0;
+		}
+
+		void
+			PathFinder::runPathJob(int jobIndex, int workerIndex) {
+			runPathJob(pathJobs[jobIndex], *pathJobStates[workerIndex]);
+		}
+
+		void
+			PathFinder::runPathJob(PathJob & job, FactionState & scratchState) {
+			int
+				unitId = job.unit->getId();
+
+			scratchState.precachedTravelState.clear();
+			scratchState.precachedPath.clear();
+			// seeded per job so the directions tried by the search do not
+			// depend on which worker runs it or what it ran before
+			uint32
+				seed = (uint32) job.frameIndex * 10007u + (uint32) unitId;
+			scratchState.random.init((int) (seed % 0x7FFFFFFF));
+			scratchState.useMaxNodeCount = PathFinder::pathFindNodesMax;
+
+			searchPath(job.unit, job.finalPos, NULL, job.frameIndex,
+				scratchState);
+
+			std::map < int, TravelState >::iterator iterFindState =
+				scratchState.precachedTravelState.find(unitId);
+			if (iterFindState != scratchState.precachedTravelState.end()) {
+				job.travelState = iterFindState->second;
+			}
+			std::map < int, std::vector < Vec2i > >::iterator iterFindPath =
+				scratchState.precachedPath.find(unitId);
+			if (iterFindPath != scratchState.precachedPath.end()) {
+				job.path.swap(iterFindPath->second);
+			}
+		}
+
+		// Steers a unit of a group command with the flow field of its group.
+		// Returns false when the unit should use findPath instead: the group is
+		// too small, the unit is close to the target or units block the way.
+		bool
+			PathFinder::findGroupPath(Unit * unit, const Vec2i & finalPos,
+				int commandGroupId, int frameIndex, TravelState & ts) {
+			// called by findPath() on a route cache miss, with the precache
+			// mutex of the unit's faction held
+			if (commandGroupId < 0) {
+				return false;
+			}
+
+			Field
+				field = unit->getCurrField();
+			int
+				size = unit->getType()->getSize();
+			const Vec2i
+				unitPos = unit->getPos();
+
+			if (frameIndex >= 0) {
+				// faction threads may only read the cache, a unit that is
+				// steered by its group field needs no precache search
+				const FlowField *
+					flowField =
+					flowFields.findFlowField(commandGroupId, finalPos, field, size);
+				if (flowField == NULL ||
+					flowField->getCost(unitPos) <= pathFindFlowFieldApproachCost) {
+					return false;
+				}
+
+				ts = tsMoving;
+				return true;
 			}
+
+			const FlowField *
+				flowField =
+				flowFields.getFlowField(commandGroupId, finalPos, field, size,
+					unit->getId(), unitPos,
+					unit->getFaction()->getWorld()->getFrameCount());
+			if (flowField == NULL) {
+				return false;
+			}
+			int
+				cost = flowField->getCost(unitPos);
+			if (cost == FlowField::unreachable
+				|| cost <= pathFindFlowFieldApproachCost) {
+				return false;
+			}
+
+			// take the static direction unless a unit stands there, then any
+			// other neighbour that still gets closer to the target
+			bool
+				foundPos = false;
+			Vec2i
+				nextPos;
+			int
+				direction = flowField->getDirection(unitPos);
+			if (direction != FlowField::noDirection) {
+				Vec2i
+					pos = unitPos + FlowField::getNeighbour(direction);
+				if (map->canMove(unit, unitPos, pos)) {
+					nextPos = pos;
+					foundPos = true;
+				}
+			}
+			if (foundPos == false) {
+				int
+					bestCost = cost;
+				for (int index = 0; index < FlowField::getNeighbourCount(); ++index) {
+					Vec2i
+						pos = unitPos + FlowField::getNeighbour(index);
+					int
+						neighbourCost = flowField->getCost(pos);
+					if (neighbourCost != FlowField::unreachable
+						&& neighbourCost < bestCost
+						&& map->canMove(unit, unitPos, pos)) {
+						bestCost = neighbourCost;
+						nextPos = pos;
+						foundPos = true;
+					}
+				}
+			}
+			if (foundPos == false) {
+				return false;
+			}
+
+			unit->setCurrentPathFinderDesiredFinalPos(finalPos);
+			unit->getPath()->clear();
+			unit->setTargetPos(nextPos, true);
+
+			if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).
+				enabled == true) {
+				char
+					szBuf[8096] = "";
+				snprintf(szBuf, 8096,
+					"[findGroupPath] group [%d] finalPos [%s] nextPos [%s] cost [%d]",
+					commandGroupId, finalPos.getString().c_str(),
+					nextPos.getString().c_str(), cost);
+				unit->logSynchData(extractFileFromDirectoryPath(__FILE__).
+					c_str(), __LINE__, szBuf);
+			}
+
+			ts = tsMoving;
+			return true;
 		}
 
+		// Adds the time of a findPath() call to a counter on every way out
+		class FindPathTimer {
+		private:
+			int64 & total;
+			Chrono chrono;
+
+		public:
+			explicit FindPathTimer(int64 & total) : total(total), chrono(true) {
+			}
+			~FindPathTimer() {
+				total += chrono.getMicros();
+			}
+		};
+
 		TravelState
 			PathFinder::findPath(Unit * unit, const Vec2i & finalPos,
-				bool * wasStuck, int frameIndex) {
+				bool * wasStuck, int frameIndex, int commandGroupId) {
 			TravelState
 				ts = tsImpossible;
 
@@ -174,6 +447,8 @@ namespace
 				int
 					factionIndex = unit->getFactionIndex();
 				FactionState & faction = factions.getFactionState(factionIndex);
+				FindPathTimer
+					timer(frameIndex >= 0 ? faction.precacheMicros : serialMicros);
 				static string
 					mutexOwnerId =
 					string(__FILE__) + string("_") + intToStr(__LINE__);
@@ -189,7 +464,7 @@ namespace
 
 
 				if (frameIndex >= 0) {
-					clearUnitPrecache(unit);
+					clearUnitPrecache(unit, faction);
 				}
 				if (unit->getFaction()->canUnitsPathfind() == true) {
 					unit->getFaction()->addUnitToPathfindingList(unit->getId());
@@ -275,47 +550,13 @@ namespace
 
 						if (map->canMove(unit, unit->getPos(), pos)) {
 							if (frameIndex < 0) {
-								if (SystemFlags::
-									getSystemSettingType(SystemFlags::
-										debugWorldSynch).enabled ==
-									true
-									&& SystemFlags::
-									getSystemSettingType(SystemFlags::
-										debugWorldSynchMax).
-									enabled == true) {
-									char
-										szBuf[8096] = "";
-									snprintf(szBuf, 8096,
-										"#1 map->canMove to pos [%s] from [%s]",
-										pos.getString().c_str(),
-										unit->getPos().getString().c_str());
-									unit->
-										logSynchData(extractFileFromDirectoryPath
-										(__FILE__).c_str(), __LINE__,
-											szBuf);
-								}
+								SYNCH_TRACE(unit->getId(), "#1 route cache canMove(pos.x,pos.y,unitPos.x,unitPos.y)",
+									pos.x, pos.y, unit->getPos().x, unit->getPos().y);
 
 								unit->setTargetPos(pos, frameIndex < 0);
 
-								if (SystemFlags::
-									getSystemSettingType(SystemFlags::
-										debugWorldSynch).enabled ==
-									true
-									&& SystemFlags::
-									getSystemSettingType(SystemFlags::
-										debugWorldSynchMax).
-									enabled == true) {
-									char
-										szBuf[8096] = "";
-									snprintf(szBuf, 8096,
-										"#2 map->canMove to pos [%s] from [%s]",
-										pos.getString().c_str(),
-										unit->getPos().getString().c_str());
-									unit->
-										logSynchData(extractFileFromDirectoryPath
-										(__FILE__).c_str(), __LINE__,
-											szBuf);
-								}
+								SYNCH_TRACE(unit->getId(), "#2 route cache canMove(pos.x,pos.y,unitPos.x,unitPos.y)",
+									pos.x, pos.y, unit->getPos().x, unit->getPos().y);
 
 							}
 
@@ -365,7 +606,65 @@ namespace
 					return tsBlocked;
 				}
 
-				//route cache miss
+				//route cache miss, large groups sent to a position first try
+				//to steer along their shared flow field
+				if (findGroupPath(unit, finalPos, commandGroupId, frameIndex, ts) == true) {
+					return ts;
+				}
+
+				if (frameIndex >= 0) {
+					// precache searches are queued here and solved for all
+					// factions at once by runPathJobs()
+					PathJob & job = faction.pendingPathJobs[unit->getId()];
+					job.unit = unit;
+					job.finalPos = finalPos;
+					job.frameIndex = frameIndex;
+					job.travelState = tsImpossible;
+					job.path.clear();
+
+					return ts;
+				}
+
+				ts = searchPath(unit, finalPos, wasStuck, frameIndex, faction);
+
+			} catch (const exception & ex) {
+				//setRunningStatus(false);
+
+				SystemFlags::OutputDebug(SystemFlags::debugError,
+					"In [%s::%s Line: %d] Error [%s]\n",
+					__FILE__, __FUNCTION__, __LINE__,
+					ex.what());
+				if (SystemFlags::getSystemSettingType(SystemFlags::debugSystem).
+					enabled)
+					SystemFlags::OutputDebug(SystemFlags::debugSystem,
+						"In [%s::%s Line: %d]\n", __FILE__,
+						__FUNCTION__, __LINE__);
+
+				throw
+					megaglest_runtime_error(ex.what());
+			} catch (...) {
+				char
+					szBuf[8096] = "";
+				snprintf(szBuf, 8096, "In [%s::%s %d] UNKNOWN error\n", __FILE__,
+					__FUNCTION__, __LINE__);
+				SystemFlags::OutputDebug(SystemFlags::debugError, szBuf);
+				throw
+					megaglest_runtime_error(szBuf);
+			}
+
+			return ts;
+		}
+
+		TravelState
+			PathFinder::searchPath(Unit * unit, const Vec2i & finalPos,
+				bool * wasStuck, int frameIndex, FactionState & faction) {
+			TravelState
+				ts = tsImpossible;
+
+			try {
+				UnitPathInterface *
+					path = unit->getPath();
+
 				int
 					maxNodeCount = -1;
 				if (unit->getUsePathfinderExtendedMaxNodes() == true) {
@@ -410,7 +709,7 @@ namespace
 				}
 
 				ts =
-					aStar(unit, finalPos, false, frameIndex, maxNodeCount,
+					aStar(unit, finalPos, false, frameIndex, faction, maxNodeCount,
 						&searched_node_count);
 				//post actions
 				switch (ts) {
@@ -474,11 +773,6 @@ namespace
 							unitImmediatelyBlocked = (failureCount == cellCount);
 							if (unitImmediatelyBlocked == false) {
 
-								int
-									factionIndex = unit->getFactionIndex();
-								FactionState & faction =
-									factions.getFactionState(factionIndex);
-
 								//if(Thread::isCurrentThreadMainThread() == false) {
 								//      throw megaglest_runtime_error("#2 Invalid access to FactionState random from outside main thread current id = " +
 								//                      intToStr(Thread::getCurrentThreadId()) + " main = " + intToStr(Thread::getMainThreadId()));
@@ -564,7 +858,7 @@ namespace
 
 												ts =
 													aStar(unit, newFinalPos, true,
-														frameIndex, maxBailoutNodeCount,
+														frameIndex, faction, maxBailoutNodeCount,
 														&searched_node_count);
 											}
 										}
@@ -625,7 +919,7 @@ namespace
 
 												ts =
 													aStar(unit, newFinalPos, true,
-														frameIndex, maxBailoutNodeCount,
+														frameIndex, faction, maxBailoutNodeCount,
 														&searched_node_count);
 											}
 										}
@@ -746,7 +1040,6 @@ namespace
 					("Unit [%d - %s] astar took [%lld] msecs, ts = %d searched_node_count = %d.\n",
 						unit->getId(), unit->getType()->getName(false).c_str(),
 						(long long int) chrono.getMillis(), ts, searched_node_count);
-
 			} catch (const exception & ex) {
 				//setRunningStatus(false);
 
@@ -780,7 +1073,7 @@ namespace
 		//route a unit using A* algorithm
 		TravelState
 			PathFinder::aStar(Unit * unit, const Vec2i & targetPos, bool inBailout,
-				int frameIndex, int maxNodeCount,
+				int frameIndex, FactionState & faction, int maxNodeCount,
 				uint32 * searched_node_count) {
 			TravelState
 				ts = tsImpossible;
@@ -789,9 +1082,6 @@ namespace
 
 				int
 					unitFactionIndex = unit->getFactionIndex();
-				int
-					factionIndex = unit->getFactionIndex();
-				FactionState & faction = factions.getFactionState(factionIndex);
 
 				if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).
 					enabled == true && frameIndex >= 0) {
@@ -814,11 +1104,6 @@ namespace
 
 
 				if (maxNodeCount < 0) {
-
-					int
-						factionIndex = unit->getFactionIndex();
-					FactionState & faction = factions.getFactionState(factionIndex);
-
 					maxNodeCount = faction.useMaxNodeCount;
 				}
 
@@ -830,10 +1115,7 @@ namespace
 				UnitPathInterface *
 					path = unit->getPath();
 
-				faction.nodePoolCount = 0;
-				faction.openNodesList.clear();
-				faction.openPosList.clear();
-				faction.closedNodesList.clear();
+				faction.resetSearch(map->getW(), map->getH());
 
 				// check the pre-cache to see if we can re-use a cached path
 				if (frameIndex < 0) {
@@ -948,7 +1230,7 @@ namespace
 
 								return faction.precachedTravelState[unit->getId()];
 							} else {
-								clearUnitPrecache(unit);
+								clearUnitPrecache(unit, faction);
 							}
 						} else {
 
@@ -972,7 +1254,7 @@ namespace
 						}
 					}
 				} else {
-					clearUnitPrecache(unit);
+					clearUnitPrecache(unit, faction);
 
 					if (SystemFlags::
 						getSystemSettingType(SystemFlags::debugWorldSynch).enabled ==
@@ -995,6 +1277,33 @@ namespace
 
 				faction.useMaxNodeCount = PathFinder::pathFindNodesMax;
 
+				// far away targets are resolved on the cluster graph first, the
+				// search below then only runs up to the next waypoint on that route
+				Vec2i
+					searchPos = finalPos;
+				if (inBailout == false) {
+					Vec2i
+						waypoint;
+					if (clusterMap.findWaypoint(unitPos, finalPos,
+						unit->getCurrField(), unit->getType()->getSize(),
+						PathFinder::pathFindClusterWaypointCost, waypoint) == true) {
+						searchPos = waypoint;
+
+						if (SystemFlags::
+							getSystemSettingType(SystemFlags::debugWorldSynch).
+							enabled == true && frameIndex < 0) {
+							char
+								szBuf[8096] = "";
+							snprintf(szBuf, 8096,
+								"cluster waypoint [%s] for finalPos [%s]",
+								searchPos.getString().c_str(),
+								finalPos.getString().c_str());
+							unit->logSynchData(extractFileFromDirectoryPath(__FILE__).
+								c_str(), __LINE__, szBuf);
+						}
+					}
+				}
+
 				if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).
 					enabled == true && chrono.getMillis() > 4)
 					SystemFlags::OutputDebug(SystemFlags::debugPerformance,
@@ -1007,7 +1316,7 @@ namespace
 
 				//a) push starting pos into openNodes
 				Node *
-					firstNode = newNode(faction, maxNodeCount);
+					firstNode = PathSearch::newNode(faction, maxNodeCount);
 				if (firstNode == NULL) {
 					throw
 						megaglest_runtime_error("firstNode == NULL");
@@ -1016,14 +1325,9 @@ namespace
 				firstNode->next = NULL;
 				firstNode->prev = NULL;
 				firstNode->pos = unitPos;
-				firstNode->heuristic = heuristic(unitPos, finalPos);
+				firstNode->heuristic = PathSearch::heuristic(unitPos, searchPos);
 				firstNode->exploredCell = true;
-				if (faction.openNodesList.find(firstNode->heuristic) ==
-					faction.openNodesList.end()) {
-					faction.openNodesList[firstNode->heuristic].clear();
-				}
-				faction.openNodesList[firstNode->heuristic].push_back(firstNode);
-				faction.openPosList[firstNode->pos] = true;
+				PathSearch::pushOpenNode(firstNode, faction);
 
 				//b) loop
 				bool
@@ -1161,12 +1465,6 @@ namespace
 				}
 				//
 
-				// START
-				std::map < std::pair < Vec2i, Vec2i >, bool > canAddNode;
-				std::map < Vec2i, bool > closedNodes;
-				std::map < Vec2i, Vec2i > cameFrom;
-				cameFrom[unitPos] = Vec2i(-1, -1);
-
 				// Do the a-star base pathfind work if required
 				int
 					whileLoopCount = 0;
@@ -1186,10 +1484,10 @@ namespace
 							c_str(), __LINE__, szBuf);
 					}
 
-					doAStarPathSearch(nodeLimitReached, whileLoopCount,
-						unitFactionIndex, pathFound, node, finalPos,
-						closedNodes, cameFrom, canAddNode, unit,
-						maxNodeCount, frameIndex);
+					UnitSearchCells
+						cells(map, unit);
+					PathSearch::search(cells, faction, searchPos, maxNodeCount,
+						nodeLimitReached, whileLoopCount, pathFound, node);
 
 					if (searched_node_count != NULL) {
 						*searched_node_count = whileLoopCount;
@@ -1237,7 +1535,7 @@ namespace
 									(__FILE__).c_str(), __LINE__, szBuf);
 							}
 
-							return aStar(unit, targetPos, false, frameIndex,
+							return aStar(unit, targetPos, false, frameIndex, faction,
 								pathFindNodesAbsoluteMax);
 						}
 					}
@@ -1261,14 +1559,13 @@ namespace
 				//if consumed all nodes find best node (to avoid strange behaviour)
 				if (nodeLimitReached == true) {
 
-					if (faction.closedNodesList.empty() == false) {
+					if (faction.closedBestNode != NULL) {
 						float
 							bestHeuristic =
 							truncateDecimal <
-							float >(faction.closedNodesList.begin()->first, 6);
+							float >(faction.closedBestNode->heuristic, 6);
 						if (lastNode != NULL && bestHeuristic < lastNode->heuristic) {
-							lastNode =
-								faction.closedNodesList.begin()->second.front();
+							lastNode = faction.closedBestNode;
 						}
 					}
 				}
@@ -1499,9 +1796,8 @@ namespace
 				}
 
 
-				faction.openNodesList.clear();
-				faction.openPosList.clear();
-				faction.closedNodesList.clear();
+				faction.openNodesHeap.clear();
+				faction.closedBestNode = NULL;
 
 				if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).
 					enabled == true && chrono.getMillis() > 4)
@@ -1512,8 +1808,6 @@ namespace
 						chrono.getMillis());
 
 				if (frameIndex >= 0) {
-
-					FactionState & faction = factions.getFactionState(factionIndex);
 					faction.precachedTravelState[unit->getId()] = ts;
 				} else {
 					if (SystemFlags::VERBOSE_MODE_ENABLED && chrono.getMillis() >= 5)
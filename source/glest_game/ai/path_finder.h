@@ -20,10 +20,16 @@
 #   include "vec.h"
 #   include <vector>
 #   include <map>
+#   include <algorithm>
 #   include "game_constants.h"
 #   include "skill_type.h"
 #   include "map.h"
 #   include "unit.h"
+#   include "synch_trace.h"
+#   include "cluster_map.h"
+#   include "flow_field.h"
+#   include "path_search.h"
+#   include "path_job_pool.h"
 //#include "randomc.h"
 #   include "leak_dumper.h"
 
@@ -44,7 +50,9 @@ namespace
 		// =====================================================
 
 		class
-			PathFinder {
+			PathFinder :
+			public
+			PathJobRunner {
 		public:
 			class
 				BadUnitNodeList {
@@ -88,39 +96,39 @@ namespace
 				}
 			};
 
+			typedef
+				PathSearchNode
+				Node;
+			typedef
+				PathSearchState::Nodes
+				Nodes;
+
+			// A precache search requested by a faction thread. The search
+			// itself is run later by runPathJobs() so searches of every
+			// faction can be spread over the path finder worker threads.
 			class
-				Node {
+				PathJob {
 			public:
-				Node() {
-					clear();
-				}
-				void
-					clear() {
-					pos.x = 0;
-					pos.y = 0;
-					next = NULL;
-					prev = NULL;
-					heuristic = 0.0;
-					exploredCell = false;
+				PathJob() {
+					unit = NULL;
+					frameIndex = -1;
+					travelState = tsImpossible;
 				}
+				Unit *
+					unit;
 				Vec2i
-					pos;
-				Node *
-					next;
-				Node *
-					prev;
-				float
-					heuristic;
-				bool
-					exploredCell;
+					finalPos;
+				int
+					frameIndex;
+				TravelState
+					travelState;
+				std::vector < Vec2i > path;
 			};
-			typedef
-				vector <
-				Node * >
-				Nodes;
 
 			class
-				FactionState {
+				FactionState :
+				public
+				PathSearchState {
 			protected:
 				Mutex *
 					factionMutexPrecache;
@@ -130,14 +138,6 @@ namespace
 					//factionMutexPrecache(new Mutex) {
 					factionMutexPrecache(NULL) {                       //, random(factionIndex) {
 
-					openPosList.clear();
-					openNodesList.
-						clear();
-					closedNodesList.
-						clear();
-					nodePool.
-						clear();
-					nodePoolCount = 0;
 					this->
 						factionIndex = factionIndex;
 					useMaxNodeCount = 0;
@@ -146,6 +146,8 @@ namespace
 						clear();
 					precachedPath.
 						clear();
+					pendingPathJobs.clear();
+					precacheMicros = 0;
 				}
 				~
 					FactionState() {
@@ -159,22 +161,8 @@ namespace
 					return factionMutexPrecache;
 				}
 
-				std::map < Vec2i, bool > openPosList;
-				std::map < float,
-					Nodes >
-					openNodesList;
-				std::map < float,
-					Nodes >
-					closedNodesList;
-				std::vector < Node > nodePool;
-
-				int
-					nodePoolCount;
 				int
 					factionIndex;
-				RandomGen
-					random;
-				//CRandomMersenne random;
 				int
 					useMaxNodeCount;
 
@@ -185,6 +173,17 @@ namespace
 					std::vector <
 					Vec2i > >
 					precachedPath;
+
+				// searches queued by this faction's thread during the current
+				// frame, keyed by unit id (a later request replaces an earlier one)
+				std::map < int,
+					PathJob >
+					pendingPathJobs;
+
+				// time spent in findPath() precaching for this faction, only
+				// touched by the thread thinking for it
+				int64
+					precacheMicros;
 			};
 
 			class
@@ -245,6 +244,10 @@ namespace
 				pathFindExtendRefreshNodeCountMin;
 			static const int
 				pathFindExtendRefreshNodeCountMax;
+			static const int
+				pathFindClusterWaypointCost;
+			static const int
+				pathFindFlowFieldApproachCost;
 
 		private:
 
@@ -256,10 +259,25 @@ namespace
 
 			FactionStateManager
 				factions;
+
+			// precache searches of the current frame, sorted by unit id
+			std::vector < PathJob > pathJobs;
+			// scratch search state of each worker of the pool, 0 is the
+			// thread calling runPathJobs()
+			std::vector < FactionState * >pathJobStates;
+			PathJobPool
+				pathJobPool;
+			ClusterMap
+				clusterMap;
+			FlowFieldCache
+				flowFields;
 			const Map *
 				map;
 			bool
 				minorDebugPathfinder;
+			// time spent in findPath() by the serial unit update
+			int64
+				serialMicros;
 
 		public:
 			PathFinder();
@@ -267,13 +285,12 @@ namespace
 				PathFinder(const Map * map);
 			~PathFinder();
 
-			PathFinder(const PathFinder & obj) {
+			PathFinder(const PathFinder & obj) :pathJobPool(this) {
 				init();
 				throw
 					megaglest_runtime_error("class PathFinder is NOT safe to copy!");
 			}
 			PathFinder & operator= (const PathFinder & obj) {
-				init();
 				throw
 					megaglest_runtime_error("class PathFinder is NOT safe to assign!");
 			}
@@ -282,11 +299,18 @@ namespace
 				init(const Map * map);
 			TravelState
 				findPath(Unit * unit, const Vec2i & finalPos, bool * wasStuck =
-					NULL, int frameIndex = -1);
+					NULL, int frameIndex = -1, int commandGroupId = -1);
 			void
 				clearUnitPrecache(Unit * unit);
 			void
 				removeUnitPrecache(Unit * unit);
+
+			int
+				runPathJobs(int frameIndex);
+			void
+				takeFindPathMicros(int64 & precacheMicros, int64 & serialMicros);
+			virtual void
+				runPathJob(int jobIndex, int workerIndex);
 			void
 				clearCaches();
 
@@ -305,145 +329,57 @@ namespace
 		private:
 			void
 				init();
+			void
+				startPathJobThreads();
+			void
+				runPathJob(PathJob & job, FactionState & scratchState);
+			void
+				clearUnitPrecache(Unit * unit, FactionState & faction);
 
+			bool
+				findGroupPath(Unit * unit, const Vec2i & finalPos,
+					int commandGroupId, int frameIndex, TravelState & ts);
+
+			TravelState
+				searchPath(Unit * unit, const Vec2i & finalPos, bool * wasStuck,
+					int frameIndex, FactionState & faction);
 			TravelState
 				aStar(Unit * unit, const Vec2i & finalPos, bool inBailout,
-					int frameIndex, int maxNodeCount =
+					int frameIndex, FactionState & faction, int maxNodeCount =
 					-1, uint32 * searched_node_count = NULL);
-			inline static Node *
-				newNode(FactionState & faction, int maxNodeCount) {
-				if (faction.nodePoolCount < (int) faction.nodePool.size() &&
-					faction.nodePoolCount < maxNodeCount) {
-					Node *
-						node = &(faction.nodePool[faction.nodePoolCount]);
-					node->clear();
-					faction.nodePoolCount++;
-					return node;
-				}
-				return NULL;
-			}
-
 			Vec2i
 				computeNearestFreePos(const Unit * unit, const Vec2i & targetPos);
 
-			inline static float
-				heuristic(const Vec2i & pos, const Vec2i & finalPos) {
-				return pos.dist(finalPos);
-			}
-
-			inline static bool
-				openPos(const Vec2i & sucPos, FactionState & faction) {
-				if (faction.openPosList.find(sucPos) == faction.openPosList.end()) {
-					return false;
-				}
-				return true;
-			}
-
-			inline static Node *
-				minHeuristicFastLookup(FactionState & faction) {
-				if (faction.openNodesList.empty() == true) {
-					throw
-						megaglest_runtime_error("openNodesList.empty() == true");
+			// what the A* search asks about the map, for one unit
+			class
+				UnitSearchCells {
+			public:
+				UnitSearchCells(const Map * map, Unit * unit) {
+					this->map = map;
+					this->unit = unit;
+					teamIndex = unit->getTeam();
 				}
-
-				Node *
-					result = faction.openNodesList.begin()->second.front();
-				faction.openNodesList.begin()->second.erase(faction.openNodesList.
-					begin()->second.
-					begin());
-				if (faction.openNodesList.begin()->second.empty()) {
-					faction.openNodesList.erase(faction.openNodesList.begin());
+				inline bool
+					canMoveSoon(const Vec2i & pos1, const Vec2i & pos2) const {
+					return map->aproxCanMoveSoon(unit, pos1, pos2);
 				}
-				return result;
-			}
-
-			inline bool
-				processNode(Unit * unit, Node * node, const Vec2i finalPos,
-					int x, int y, bool & nodeLimitReached, int maxNodeCount) {
-				bool
-					result = false;
-				Vec2i
-					sucPos = node->pos + Vec2i(x, y);
-
-				int
-					unitFactionIndex = unit->getFactionIndex();
-				FactionState & faction = factions.getFactionState(unitFactionIndex);
-
-				bool
-					foundOpenPosForPos = openPos(sucPos, faction);
-				bool
-					allowUnitMoveSoon = canUnitMoveSoon(unit, node->pos, sucPos);
-				if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).
-					enabled == true
-					&& SystemFlags::getSystemSettingType(SystemFlags::
-						debugWorldSynchMax).
-					enabled == true) {
-					char
-						szBuf[8096] = "";
-					snprintf(szBuf, 8096,
-						"In processNode() nodeLimitReached %d unitFactionIndex %d foundOpenPosForPos %d allowUnitMoveSoon %d maxNodeCount %d node->pos = %s finalPos = %s sucPos = %s faction.openPosList.size() %lu closedNodesList.size() %lu",
-						nodeLimitReached, unitFactionIndex, foundOpenPosForPos,
-						allowUnitMoveSoon, maxNodeCount,
-						node->pos.getString().c_str(),
-						finalPos.getString().c_str(),
-						sucPos.getString().c_str(),
-						faction.openPosList.size(),
-						faction.closedNodesList.size());
-
-					if (Thread::isCurrentThreadMainThread() == false) {
-						unit->logSynchDataThreaded(__FILE__, __LINE__, szBuf);
-					} else {
-						unit->logSynchData(__FILE__, __LINE__, szBuf);
-					}
+				inline bool
+					isExplored(const Vec2i & pos) const {
+					return map->getSurfaceCell(Map::toSurfCoords(pos))->
+						isExplored(teamIndex);
 				}
-
-				if (foundOpenPosForPos == false && allowUnitMoveSoon) {
-					//if node is not open and canMove then generate another node
-					Node *
-						sucNode = newNode(faction, maxNodeCount);
-					if (sucNode != NULL) {
-						sucNode->pos = sucPos;
-						sucNode->heuristic = heuristic(sucNode->pos, finalPos);
-						sucNode->prev = node;
-						sucNode->next = NULL;
-						sucNode->exploredCell =
-							map->getSurfaceCell(Map::toSurfCoords(sucPos))->
-							isExplored(unit->getTeam());
-						if (faction.openNodesList.find(sucNode->heuristic) ==
-							faction.openNodesList.end()) {
-							faction.openNodesList[sucNode->heuristic].clear();
-						}
-						faction.openNodesList[sucNode->heuristic].push_back(sucNode);
-						faction.openPosList[sucNode->pos] = true;
-
-						result = true;
-
-						if (SystemFlags::
-							getSystemSettingType(SystemFlags::debugWorldSynch).
-							enabled == true
-							&& SystemFlags::getSystemSettingType(SystemFlags::
-								debugWorldSynchMax).
-							enabled == true) {
-							char
-								szBuf[8096] = "";
-							snprintf(szBuf, 8096, "In processNode() sucPos = %s",
-								sucPos.getString().c_str());
-
-							if (Thread::isCurrentThreadMainThread() == false) {
-								unit->logSynchDataThreaded(__FILE__, __LINE__,
-									szBuf);
-							} else {
-								unit->logSynchData(__FILE__, __LINE__, szBuf);
-							}
-						}
-
-					} else {
-						nodeLimitReached = true;
-					}
+				inline int
+					getTraceId() const {
+					return unit->getId();
 				}
-
-				return result;
-			}
+			private:
+				const Map *
+					map;
+				Unit *
+					unit;
+				int
+					teamIndex;
+			};
 
 			void
 				processNearestFreePos(const Vec2i & finalPos, int i, int j, int size,
@@ -459,203 +395,6 @@ namespace
 				return result;
 			}
 
-			inline void
-				doAStarPathSearch(bool & nodeLimitReached, int &whileLoopCount,
-					int &unitFactionIndex, bool & pathFound,
-					Node * &node, const Vec2i & finalPos,
-					const std::map < Vec2i, bool > &closedNodes,
-					const std::map < Vec2i, Vec2i > &cameFrom,
-					const std::map < std::pair < Vec2i, Vec2i >,
-					bool > &canAddNode, Unit * &unit, int &maxNodeCount,
-					int curFrameIndex) {
-
-				if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).
-					enabled == true
-					&& SystemFlags::getSystemSettingType(SystemFlags::
-						debugWorldSynchMax).
-					enabled == true) {
-					char
-						szBuf[8096] = "";
-					snprintf(szBuf, 8096,
-						"In doAStarPathSearch() nodeLimitReached %d whileLoopCount %d unitFactionIndex %d pathFound %d maxNodeCount %d",
-						nodeLimitReached, whileLoopCount, unitFactionIndex,
-						pathFound, maxNodeCount);
-
-					if (curFrameIndex >= 0) {
-						unit->logSynchDataThreaded(__FILE__, __LINE__, szBuf);
-					} else {
-						unit->logSynchData(__FILE__, __LINE__, szBuf);
-					}
-				}
-
-				FactionState & faction = factions.getFactionState(unitFactionIndex);
-
-				while (nodeLimitReached == false) {
-					whileLoopCount++;
-					if (faction.openNodesList.empty() == true) {
-						if (SystemFlags::
-							getSystemSettingType(SystemFlags::debugWorldSynch).
-							enabled == true
-							&& SystemFlags::getSystemSettingType(SystemFlags::
-								debugWorldSynchMax).
-							enabled == true) {
-							char
-								szBuf[8096] = "";
-							snprintf(szBuf, 8096,
-								"In doAStarPathSearch() nodeLimitReached %d whileLoopCount %d unitFactionIndex %d pathFound %d maxNodeCount %d",
-								nodeLimitReached, whileLoopCount,
-								unitFactionIndex, pathFound, maxNodeCount);
-
-							if (curFrameIndex >= 0) {
-								unit->logSynchDataThreaded(__FILE__, __LINE__,
-									szBuf);
-							} else {
-								unit->logSynchData(__FILE__, __LINE__, szBuf);
-							}
-						}
-
-						pathFound = false;
-						break;
-					}
-					node = minHeuristicFastLookup(faction);
-
-					if (SystemFlags::
-						getSystemSettingType(SystemFlags::debugWorldSynch).enabled ==
-						true
-						&& SystemFlags::getSystemSettingType(SystemFlags::
-							debugWorldSynchMax).
-						enabled == true) {
-						char
-							szBuf[8096] = "";
-						snprintf(szBuf, 8096,
-							"In doAStarPathSearch() nodeLimitReached %d whileLoopCount %d unitFactionIndex %d pathFound %d maxNodeCount %d node->pos = %s finalPos = %s node->exploredCell = %d",
-							nodeLimitReached, whileLoopCount, unitFactionIndex,
-							pathFound, maxNodeCount,
-							node->pos.getString().c_str(),
-							finalPos.getString().c_str(), node->exploredCell);
-
-						if (curFrameIndex >= 0) {
-							unit->logSynchDataThreaded(__FILE__, __LINE__, szBuf);
-						} else {
-							unit->logSynchData(__FILE__, __LINE__, szBuf);
-						}
-					}
-
-					if (node->pos == finalPos || node->exploredCell == false) {
-						pathFound = true;
-						break;
-					}
-
-					if (faction.closedNodesList.find(node->heuristic) ==
-						faction.closedNodesList.end()) {
-						faction.closedNodesList[node->heuristic].clear();
-					}
-					faction.closedNodesList[node->heuristic].push_back(node);
-					faction.openPosList[node->pos] = true;
-
-					int
-						failureCount = 0;
-					int
-						cellCount = 0;
-
-					//                      if(Thread::isCurrentThreadMainThread() == false) {
-					//                              throw megaglest_runtime_error("#1 Invalid access to FactionState random from outside main thread current id = " +
-					//                                              intToStr(Thread::getCurrentThreadId()) + " main = " + intToStr(Thread::getMainThreadId()));
-					//                      }
-
-								//int tryDirection      = 1;
-								//int tryDirection      = faction.random.IRandomX(1, 4);
-					int
-						tryDirection = faction.random.randRange(1, 4);
-					//int tryDirection      = unit->getRandom(true)->randRange(1, 4);
-
-					if (SystemFlags::
-						getSystemSettingType(SystemFlags::debugWorldSynch).enabled ==
-						true
-						&& SystemFlags::getSystemSettingType(SystemFlags::
-							debugWorldSynchMax).
-						enabled == true) {
-						char
-							szBuf[8096] = "";
-						snprintf(szBuf, 8096,
-							"In doAStarPathSearch() tryDirection %d",
-							tryDirection);
-
-						if (curFrameIndex >= 0) {
-							unit->logSynchDataThreaded(__FILE__, __LINE__, szBuf);
-						} else {
-							unit->logSynchData(__FILE__, __LINE__, szBuf);
-						}
-					}
-
-					if (tryDirection == 4) {
-						for (int i = 1; i >= -1 && nodeLimitReached == false; --i) {
-							for (int j = -1; j <= 1 && nodeLimitReached == false; ++j) {
-								if (processNode
-								(unit, node, finalPos, i, j, nodeLimitReached,
-									maxNodeCount) == false) {
-									failureCount++;
-								}
-								cellCount++;
-							}
-						}
-					} else if (tryDirection == 3) {
-						for (int i = -1; i <= 1 && nodeLimitReached == false; ++i) {
-							for (int j = 1; j >= -1 && nodeLimitReached == false; --j) {
-								if (processNode
-								(unit, node, finalPos, i, j, nodeLimitReached,
-									maxNodeCount) == false) {
-									failureCount++;
-								}
-								cellCount++;
-							}
-						}
-					} else if (tryDirection == 2) {
-						for (int i = -1; i <= 1 && nodeLimitReached == false; ++i) {
-							for (int j = -1; j <= 1 && nodeLimitReached == false; ++j) {
-								if (processNode
-								(unit, node, finalPos, i, j, nodeLimitReached,
-									maxNodeCount) == false) {
-									failureCount++;
-								}
-								cellCount++;
-							}
-						}
-					} else {
-						for (int i = 1; i >= -1 && nodeLimitReached == false; --i) {
-							for (int j = 1; j >= -1 && nodeLimitReached == false; --j) {
-								if (processNode
-								(unit, node, finalPos, i, j, nodeLimitReached,
-									maxNodeCount) == false) {
-									failureCount++;
-								}
-								cellCount++;
-							}
-						}
-					}
-				}
-
-				if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).
-					enabled == true
-					&& SystemFlags::getSystemSettingType(SystemFlags::
-						debugWorldSynchMax).
-					enabled == true) {
-					char
-						szBuf[8096] = "";
-					snprintf(szBuf, 8096,
-						"In doAStarPathSearch() nodeLimitReached %d whileLoopCount %d unitFactionIndex %d pathFound %d maxNodeCount %d",
-						nodeLimitReached, whileLoopCount, unitFactionIndex,
-						pathFound, maxNodeCount);
-
-					if (curFrameIndex >= 0) {
-						unit->logSynchDataThreaded(__FILE__, __LINE__, szBuf);
-					} else {
-						unit->logSynchData(__FILE__, __LINE__, szBuf);
-					}
-				}
-
-			}
-
 		};
 
 	}
@@ -0,0 +1,181 @@
+//
+//      path_job_pool.cpp: worker threads running the precache searches
+//      of a frame
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#include "path_job_pool.h"
+
+#include "platform_common.h"
+#include "platform_util.h"
+#include "conversion.h"
+#include "util.h"
+#include "leak_dumper.h"
+
+using namespace Shared::Util;
+using namespace Shared::PlatformCommon;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		//	class PathJobPool
+		// =====================================================
+
+		PathJobPool::PathJobPool(PathJobRunner *runner) {
+			this->runner = runner;
+			mutex = new Mutex(CODE_AT_LINE);
+			jobCount = 0;
+			nextJob = 0;
+		}
+
+		PathJobPool::~PathJobPool() {
+			stop();
+			runner = NULL;
+			delete mutex;
+			mutex = NULL;
+		}
+
+		void PathJobPool::start(int threadCount) {
+			stop();
+
+			vector<SlaveThreadControllerInterface *> slaveThreadList;
+			for (int index = 0; index < threadCount; ++index) {
+				static string mutexOwnerId = string(extractFileFromDirectoryPath(__FILE__).c_str()) + string("_") + intToStr(__LINE__);
+				PathJobThread *thread = new PathJobThread(this, index + 1);
+				thread->setUniqueID(mutexOwnerId);
+				thread->start();
+
+				threads.push_back(thread);
+				slaveThreadList.push_back(thread);
+			}
+			controller.setSlaves(slaveThreadList);
+		}
+
+		void PathJobPool::stop() {
+			controller.clearSlaves();
+			for (unsigned int index = 0; index < threads.size(); ++index) {
+				PathJobThread *thread = threads[index];
+				thread->signalQuit();
+				if (thread->shutdownAndWait() == true) {
+					delete thread;
+				}
+			}
+			threads.clear();
+		}
+
+		void PathJobPool::run(int jobCount, bool threaded) {
+			this->jobCount = jobCount;
+			nextJob = 0;
+			if (threaded == true && threads.empty() == false && jobCount > 1) {
+				int frameJobCount = jobCount;
+				controller.signalSlaves(&frameJobCount);
+				runPending(0);
+				if (controller.waitTillSlavesTrigger(20000) == false) {
+					throw megaglest_runtime_error("path finder worker threads did not finish in time!");
+				}
+			} else {
+				runPending(0);
+			}
+		}
+
+		void PathJobPool::runPending(int workerIndex) {
+			for (;;) {
+				static string mutexOwnerId = string(__FILE__) + string("_") + intToStr(__LINE__);
+				MutexSafeWrapper safeMutex(mutex, mutexOwnerId);
+				if (nextJob >= jobCount) {
+					break;
+				}
+				int jobIndex = nextJob;
+				nextJob++;
+				safeMutex.ReleaseLock();
+
+				runner->runPathJob(jobIndex, workerIndex);
+			}
+		}
+
+		// =====================================================
+		//	class PathJobThread
+		// =====================================================
+
+		PathJobThread::PathJobThread(PathJobPool *pool, int workerIndex) : BaseThread() {
+			this->pool = pool;
+			this->workerIndex = workerIndex;
+			this->masterController = NULL;
+			uniqueID = "PathJobThread";
+		}
+
+		PathJobThread::~PathJobThread() {
+			this->pool = NULL;
+			this->masterController = NULL;
+		}
+
+		void PathJobThread::setQuitStatus(bool value) {
+			BaseThread::setQuitStatus(value);
+			if (value == true) {
+				semTaskSignalled.signal();
+			}
+		}
+
+		bool PathJobThread::canShutdown(bool deleteSelfIfShutdownDelayed) {
+			bool ret = (getExecutingTask() == false);
+			if (ret == false && deleteSelfIfShutdownDelayed == true) {
+				setDeleteSelfOnExecutionDone(deleteSelfIfShutdownDelayed);
+				deleteSelfIfRequired();
+				signalQuit();
+			}
+
+			return ret;
+		}
+
+		void PathJobThread::execute() {
+			RunningStatusSafeWrapper runningStatus(this);
+			try {
+				for (; this->pool != NULL;) {
+					if (getQuitStatus() == true) {
+						break;
+					}
+
+					semTaskSignalled.waitTillSignalled();
+
+					static string masterSlaveOwnerId = string(__FILE__) + string("_") + intToStr(__LINE__);
+					MasterSlaveThreadControllerSafeWrapper safeMasterController(masterController, 20000, masterSlaveOwnerId);
+
+					if (getQuitStatus() == true) {
+						break;
+					}
+
+					ExecutingTaskSafeWrapper safeExecutingTaskMutex(this);
+					this->pool->runPending(workerIndex);
+				}
+			} catch (const exception &ex) {
+				SystemFlags::OutputDebug(SystemFlags::debugError, "In [%s::%s Line: %d] Error [%s]\n", __FILE__, __FUNCTION__, __LINE__, ex.what());
+
+				throw megaglest_runtime_error(ex.what());
+			} catch (...) {
+				char szBuf[8096] = "";
+				snprintf(szBuf, 8096, "In [%s::%s %d] UNKNOWN error\n", __FILE__, __FUNCTION__, __LINE__);
+				SystemFlags::OutputDebug(SystemFlags::debugError, szBuf);
+				throw megaglest_runtime_error(szBuf);
+			}
+		}
+
+	}
+}
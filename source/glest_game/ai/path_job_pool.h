@@ -0,0 +1,128 @@
+//
+//      path_job_pool.h: worker threads running the precache searches
+//      of a frame
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _GLEST_GAME_PATHJOBPOOL_H_
+#define _GLEST_GAME_PATHJOBPOOL_H_
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <winsock.h>
+#endif
+
+#include <vector>
+#include "base_thread.h"
+#include "leak_dumper.h"
+
+using std::vector;
+using Shared::PlatformCommon::BaseThread;
+using Shared::Platform::Mutex;
+using Shared::Platform::Semaphore;
+using Shared::Platform::MasterSlaveThreadController;
+using Shared::Platform::SlaveThreadControllerInterface;
+
+namespace Glest {
+	namespace Game {
+
+		class PathJobThread;
+
+		// =====================================================
+		//	class PathJobRunner
+		// =====================================================
+
+		class PathJobRunner {
+		public:
+			virtual ~PathJobRunner() {
+			}
+			// worker 0 is the thread calling PathJobPool::run, the pool
+			// threads are 1 to getThreadCount()
+			virtual void runPathJob(int jobIndex, int workerIndex) = 0;
+		};
+
+		// =====================================================
+		//	class PathJobPool
+		//
+		///	Hands the jobs of a frame out, in order, to its threads
+		///	and the calling thread until none are left
+		// =====================================================
+
+		class PathJobPool {
+		private:
+			PathJobRunner *runner;
+			// made by the constructor and deleted by the destructor only,
+			// the threads lock it for as long as the pool exists
+			Mutex *mutex;
+			int jobCount;
+			int nextJob;
+			vector<PathJobThread *> threads;
+			MasterSlaveThreadController controller;
+
+			PathJobPool(const PathJobPool &obj);
+			PathJobPool &operator=(const PathJobPool &obj);
+
+		public:
+			explicit PathJobPool(PathJobRunner *runner);
+			~PathJobPool();
+
+			void start(int threadCount);
+			void stop();
+			int getThreadCount() const {
+				return (int) threads.size();
+			}
+
+			// runs jobs 0 to jobCount - 1, on the threads too when threaded
+			// is true, and returns when all are done
+			void run(int jobCount, bool threaded);
+			void runPending(int workerIndex);
+		};
+
+		// =====================================================
+		//	class PathJobThread
+		// =====================================================
+
+		class PathJobThread : public BaseThread, public SlaveThreadControllerInterface {
+		protected:
+			PathJobPool *pool;
+			int workerIndex;
+			Semaphore semTaskSignalled;
+			MasterSlaveThreadController *masterController;
+
+			virtual void setQuitStatus(bool value);
+			virtual bool canShutdown(bool deleteSelfIfShutdownDelayed = false);
+
+		public:
+			PathJobThread(PathJobPool *pool, int workerIndex);
+			virtual ~PathJobThread();
+			virtual void execute();
+
+			virtual void setMasterController(MasterSlaveThreadController *master) {
+				masterController = master;
+			}
+			virtual void signalSlave(void *userdata) {
+				semTaskSignalled.signal();
+			}
+		};
+
+	}
+}
+
+#endif
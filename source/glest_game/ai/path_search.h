@@ -0,0 +1,327 @@
+//
+//      path_search.h: open and closed lists and main loop of the A* search
+//      run by the path finder
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _GLEST_GAME_PATHSEARCH_H_
+#define _GLEST_GAME_PATHSEARCH_H_
+
+#include <vector>
+#include <algorithm>
+#include "vec.h"
+#include "data_types.h"
+#include "randomgen.h"
+#include "platform_util.h"
+#include "synch_trace.h"
+#include "leak_dumper.h"
+
+using std::vector;
+using Shared::Graphics::Vec2i;
+using Shared::Platform::uint32;
+using Shared::Util::RandomGen;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		//	class PathSearchNode
+		// =====================================================
+
+		class PathSearchNode {
+		public:
+			PathSearchNode() {
+				clear();
+			}
+			void clear() {
+				pos.x = 0;
+				pos.y = 0;
+				next = NULL;
+				prev = NULL;
+				heuristic = 0.0;
+				exploredCell = false;
+				openSequence = 0;
+			}
+
+			Vec2i pos;
+			PathSearchNode *next;
+			PathSearchNode *prev;
+			float heuristic;
+			bool exploredCell;
+			// insertion order, breaks heuristic ties exactly like the old
+			// std::map<float,Nodes> buckets did (first in, first out)
+			uint32 openSequence;
+		};
+
+		// =====================================================
+		//	class PathSearchState
+		//
+		///	Lists of one A* search, kept between searches so their
+		///	memory is reused
+		// =====================================================
+
+		class PathSearchState {
+		public:
+			typedef vector<PathSearchNode *> Nodes;
+
+			// Cells already opened or closed by the current search. A cell is
+			// marked when its stamp equals openPosGeneration so starting a new
+			// search is a counter bump instead of clearing the whole map.
+			vector<uint32> openPosStamp;
+			uint32 openPosGeneration;
+			int openPosWidth;
+
+			// Binary min-heap ordered by (heuristic, openSequence)
+			Nodes openNodesHeap;
+			uint32 openSequence;
+
+			// First closed node with the lowest heuristic (used as the best
+			// partial result when the node limit is reached)
+			PathSearchNode *closedBestNode;
+			int closedNodeCount;
+
+			vector<PathSearchNode> nodePool;
+			int nodePoolCount;
+
+			// picks the order neighbours are tried in, part of the synch state
+			RandomGen random;
+
+			PathSearchState() {
+				openPosGeneration = 0;
+				openPosWidth = 0;
+				openSequence = 0;
+				closedBestNode = NULL;
+				closedNodeCount = 0;
+				nodePoolCount = 0;
+			}
+
+			// starts a search on a w x h map
+			void resetSearch(int w, int h) {
+				nodePoolCount = 0;
+				openNodesHeap.clear();
+				openSequence = 0;
+				closedBestNode = NULL;
+				closedNodeCount = 0;
+
+				size_t cellCount = (size_t) w * h;
+				if (openPosWidth != w || openPosStamp.size() != cellCount) {
+					openPosWidth = w;
+					openPosStamp.assign(cellCount, 0);
+					openPosGeneration = 0;
+				}
+
+				openPosGeneration++;
+				if (openPosGeneration == 0) {
+					// the stamp wrapped around, old marks could look current again
+					std::fill(openPosStamp.begin(), openPosStamp.end(), 0);
+					openPosGeneration = 1;
+				}
+			}
+		};
+
+		// =====================================================
+		//	class PathSearch
+		//
+		///	The A* loop of the path finder. It knows nothing about
+		///	units or the map, it asks a Cells object which has:
+		///	  bool canMoveSoon(const Vec2i &pos1, const Vec2i &pos2)
+		///	  bool isExplored(const Vec2i &pos)
+		///	  int getTraceId()	(unit id of the synch trace events)
+		// =====================================================
+
+		class PathSearch {
+		public:
+			// heap comparator: the top of the heap is the lowest heuristic,
+			// equal heuristics come out in the order they were opened
+			class NodeHeapCompare {
+			public:
+				inline bool operator()(const PathSearchNode *a, const PathSearchNode *b) const {
+					if (a->heuristic != b->heuristic) {
+						return a->heuristic > b->heuristic;
+					}
+					return a->openSequence > b->openSequence;
+				}
+			};
+
+			inline static PathSearchNode *newNode(PathSearchState &state, int maxNodeCount) {
+				if (state.nodePoolCount < (int) state.nodePool.size() &&
+					state.nodePoolCount < maxNodeCount) {
+					PathSearchNode *node = &(state.nodePool[state.nodePoolCount]);
+					node->clear();
+					state.nodePoolCount++;
+					return node;
+				}
+				return NULL;
+			}
+
+			inline static float heuristic(const Vec2i &pos, const Vec2i &finalPos) {
+				return pos.dist(finalPos);
+			}
+
+			inline static bool openPos(const Vec2i &sucPos, const PathSearchState &state) {
+				if (sucPos.x < 0 || sucPos.y < 0 || sucPos.x >= state.openPosWidth) {
+					return false;
+				}
+				size_t index = (size_t) sucPos.y * state.openPosWidth + sucPos.x;
+				if (index >= state.openPosStamp.size()) {
+					return false;
+				}
+				return state.openPosStamp[index] == state.openPosGeneration;
+			}
+
+			inline static void markOpenPos(const Vec2i &pos, PathSearchState &state) {
+				size_t index = (size_t) pos.y * state.openPosWidth + pos.x;
+				state.openPosStamp[index] = state.openPosGeneration;
+			}
+
+			inline static void pushOpenNode(PathSearchNode *node, PathSearchState &state) {
+				node->openSequence = state.openSequence++;
+				state.openNodesHeap.push_back(node);
+				std::push_heap(state.openNodesHeap.begin(), state.openNodesHeap.end(), NodeHeapCompare());
+				markOpenPos(node->pos, state);
+			}
+
+			inline static void addClosedNode(PathSearchNode *node, PathSearchState &state) {
+				if (state.closedBestNode == NULL ||
+					node->heuristic < state.closedBestNode->heuristic) {
+					state.closedBestNode = node;
+				}
+				state.closedNodeCount++;
+				markOpenPos(node->pos, state);
+			}
+
+			inline static PathSearchNode *minHeuristicFastLookup(PathSearchState &state) {
+				if (state.openNodesHeap.empty() == true) {
+					throw megaglest_runtime_error("openNodesHeap.empty() == true");
+				}
+
+				std::pop_heap(state.openNodesHeap.begin(), state.openNodesHeap.end(), NodeHeapCompare());
+				PathSearchNode *result = state.openNodesHeap.back();
+				state.openNodesHeap.pop_back();
+				return result;
+			}
+
+			template <typename Cells>
+			inline static bool processNode(Cells &cells, PathSearchNode *node, const Vec2i &finalPos,
+				int x, int y, bool &nodeLimitReached, int maxNodeCount, PathSearchState &state) {
+				bool result = false;
+				Vec2i sucPos = node->pos + Vec2i(x, y);
+
+				bool foundOpenPosForPos = openPos(sucPos, state);
+				bool allowUnitMoveSoon = cells.canMoveSoon(node->pos, sucPos);
+				SYNCH_TRACE(cells.getTraceId(), "processNode(sucPos.x,sucPos.y,foundOpenPosForPos,allowUnitMoveSoon)",
+					sucPos.x, sucPos.y, foundOpenPosForPos, allowUnitMoveSoon);
+				SYNCH_TRACE(cells.getTraceId(), "processNode(nodeLimitReached,maxNodeCount,nodePoolCount,closedNodeCount)",
+					nodeLimitReached, maxNodeCount, state.nodePoolCount, state.closedNodeCount);
+
+				if (foundOpenPosForPos == false && allowUnitMoveSoon) {
+					//if node is not open and canMove then generate another node
+					PathSearchNode *sucNode = newNode(state, maxNodeCount);
+					if (sucNode != NULL) {
+						sucNode->pos = sucPos;
+						sucNode->heuristic = heuristic(sucNode->pos, finalPos);
+						sucNode->prev = node;
+						sucNode->next = NULL;
+						sucNode->exploredCell = cells.isExplored(sucPos);
+						pushOpenNode(sucNode, state);
+
+						result = true;
+
+						SYNCH_TRACE(cells.getTraceId(), "processNode open(sucPos.x,sucPos.y)", sucPos.x, sucPos.y);
+					} else {
+						nodeLimitReached = true;
+					}
+				}
+
+				return result;
+			}
+
+			// Runs the search from the nodes already opened until finalPos or
+			// an unexplored cell comes out of the open list (pathFound), the
+			// open list runs dry or the node pool is used up (nodeLimitReached).
+			// node is the last node taken from the open list.
+			template <typename Cells>
+			static void search(Cells &cells, PathSearchState &state, const Vec2i &finalPos,
+				int maxNodeCount, bool &nodeLimitReached, int &whileLoopCount,
+				bool &pathFound, PathSearchNode *&node) {
+
+				SYNCH_TRACE(cells.getTraceId(), "doAStarPathSearch(nodeLimitReached,whileLoopCount,pathFound,maxNodeCount)",
+					nodeLimitReached, whileLoopCount, pathFound, maxNodeCount);
+
+				while (nodeLimitReached == false) {
+					whileLoopCount++;
+					if (state.openNodesHeap.empty() == true) {
+						SYNCH_TRACE(cells.getTraceId(), "doAStarPathSearch no open nodes(whileLoopCount)", whileLoopCount);
+
+						pathFound = false;
+						break;
+					}
+					node = minHeuristicFastLookup(state);
+
+					SYNCH_TRACE(cells.getTraceId(), "doAStarPathSearch node(pos.x,pos.y,exploredCell,whileLoopCount)",
+						node->pos.x, node->pos.y, node->exploredCell, whileLoopCount);
+
+					if (node->pos == finalPos || node->exploredCell == false) {
+						pathFound = true;
+						break;
+					}
+
+					addClosedNode(node, state);
+
+					int tryDirection = state.random.randRange(1, 4);
+
+					SYNCH_TRACE(cells.getTraceId(), "doAStarPathSearch(tryDirection)", tryDirection);
+
+					if (tryDirection == 4) {
+						for (int i = 1; i >= -1 && nodeLimitReached == false; --i) {
+							for (int j = -1; j <= 1 && nodeLimitReached == false; ++j) {
+								processNode(cells, node, finalPos, i, j, nodeLimitReached, maxNodeCount, state);
+							}
+						}
+					} else if (tryDirection == 3) {
+						for (int i = -1; i <= 1 && nodeLimitReached == false; ++i) {
+							for (int j = 1; j >= -1 && nodeLimitReached == false; --j) {
+								processNode(cells, node, finalPos, i, j, nodeLimitReached, maxNodeCount, state);
+							}
+						}
+					} else if (tryDirection == 2) {
+						for (int i = -1; i <= 1 && nodeLimitReached == false; ++i) {
+							for (int j = -1; j <= 1 && nodeLimitReached == false; ++j) {
+								processNode(cells, node, finalPos, i, j, nodeLimitReached, maxNodeCount, state);
+							}
+						}
+					} else {
+						for (int i = 1; i >= -1 && nodeLimitReached == false; --i) {
+							for (int j = 1; j >= -1 && nodeLimitReached == false; --j) {
+								processNode(cells, node, finalPos, i, j, nodeLimitReached, maxNodeCount, state);
+							}
+						}
+					}
+				}
+
+				SYNCH_TRACE(cells.getTraceId(), "doAStarPathSearch(nodeLimitReached,whileLoopCount,pathFound,maxNodeCount)",
+					nodeLimitReached, whileLoopCount, pathFound, maxNodeCount);
+			}
+		};
+
+	}
+}
+
+#endif
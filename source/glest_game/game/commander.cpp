@@ -24,6 +24,7 @@
 #include "platform_util.h"
 #include "game.h"
 #include "game_settings.h"
+#include "replay_file.h"
 #include "game.h"
 
 using namespace
@@ -45,10 +46,21 @@ namespace
 			this->world = NULL;
 			this->
 				pauseNetworkCommands = false;
+			replayCommandListIndex = 0;
+			replayReader = NULL;
+			replayStopFrame = -1;
 		}
 
 		Commander::~
 			Commander() {
+			delete replayReader;
+			replayReader = NULL;
+		}
+
+		void
+			Commander::setReplayReader(ReplayReader * replayReader) {
+			delete this->replayReader;
+			this->replayReader = replayReader;
 		}
 
 		void
@@ -707,27 +719,32 @@ namespace
 			Commander::getReplayCommandListForFrame(int worldFrameCount) {
 			bool
 				haveReplyCommands = false;
-			if (replayCommandList.empty() == false) {
+			if (hasReplayCommandListForFrame() == true) {
 				if (SystemFlags::VERBOSE_MODE_ENABLED)
-					printf("worldFrameCount = %d replayCommandList.size() = "
-						MG_SIZE_T_SPECIFIER "\n", worldFrameCount,
-						replayCommandList.size());
+					printf("worldFrameCount = %d replay commands left = %d\n",
+						worldFrameCount, getReplayCommandListForFrameCount());
 
+				int
+					lastFrame = worldFrameCount;
+				if (replayStopFrame >= 0 && replayStopFrame < lastFrame) {
+					lastFrame = replayStopFrame;
+				}
+
+				// Both lists are in frame order, only the front is due
 				std::vector < NetworkCommand > replayList;
-				for (unsigned int i = 0; i < replayCommandList.size(); ++i) {
-					std::pair < int,
-						NetworkCommand > &
-						cmd = replayCommandList[i];
-					if (cmd.first <= worldFrameCount) {
-						replayList.push_back(cmd.second);
-						haveReplyCommands = true;
+				for (; replayCommandListIndex < replayCommandList.size() &&
+					replayCommandList[replayCommandListIndex].first <= lastFrame;
+					++replayCommandListIndex) {
+					replayList.push_back(replayCommandList[replayCommandListIndex].second);
+				}
+				if (replayReader != NULL) {
+					for (int frame = 0; replayReader->getNextFrame() >= 0 &&
+						replayReader->getNextFrame() <= lastFrame;) {
+						replayReader->readFrame(frame, replayList);
 					}
 				}
+				haveReplyCommands = (replayList.empty() == false);
 				if (haveReplyCommands == true) {
-					replayCommandList.erase(replayCommandList.begin(),
-						replayCommandList.begin() +
-						replayList.size());
-
 					if (SystemFlags::VERBOSE_MODE_ENABLED)
 						printf
 						("worldFrameCount = %d GIVING COMMANDS replayList.size() = "
@@ -747,14 +764,26 @@ namespace
 
 		bool
 			Commander::hasReplayCommandListForFrame() const {
-			return (replayCommandList.empty() == false);
+			int
+				nextFrame = -1;
+			if (replayCommandListIndex < replayCommandList.size()) {
+				nextFrame = replayCommandList[replayCommandListIndex].first;
+			} else if (replayReader != NULL) {
+				nextFrame = replayReader->getNextFrame();
+			}
+			return (nextFrame >= 0 &&
+				(replayStopFrame < 0 || nextFrame <= replayStopFrame));
 		}
 
 		int
 			Commander::getReplayCommandListForFrameCount() const {
-			return (int)
-				replayCommandList.
-				size();
+			int
+				result = (int) (replayCommandList.size() - replayCommandListIndex);
+			if (replayReader != NULL) {
+				result += (int) (replayReader->getCommandCount() -
+					replayReader->getCommandsRead());
+			}
+			return result;
 		}
 
 		void
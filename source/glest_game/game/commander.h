@@ -52,6 +52,8 @@ namespace
 			Game;
 		class
 			SwitchTeamVote;
+		class
+			ReplayReader;
 
 		// =====================================================
 		//      class Commander
@@ -78,6 +80,15 @@ namespace
 				std::pair < int,
 				NetworkCommand > >
 				replayCommandList;
+			// next entry of replayCommandList to give
+			unsigned int
+				replayCommandListIndex;
+			// streams the commands of a binary replay instead
+			ReplayReader *
+				replayReader;
+			// commands after this frame are not replayed, -1 for all
+			int
+				replayStopFrame;
 
 			bool
 				pauseNetworkCommands;
@@ -107,6 +118,12 @@ namespace
 
 			void
 				addToReplayCommandList(NetworkCommand & command, int worldFrameCount);
+			void
+				setReplayReader(ReplayReader * replayReader);
+			void
+				setReplayStopFrame(int frame) {
+				this->replayStopFrame = frame;
+			}
 			bool
 				getReplayCommandListForFrame(int worldFrameCount);
 			bool
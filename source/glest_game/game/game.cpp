@@ -41,6 +41,7 @@
 #include "cache_manager.h"
 #include "conversion.h"
 #include "steam.h"
+#include "replay_file.h"
 
 #include "leak_dumper.h"
 
@@ -93,6 +94,7 @@ namespace Glest {
 			avgUpdateFps = 0;
 			framesToCatchUpAsClient = 0;
 			framesToSlowDownAsClient = 0;
+			adaptiveClientFrames = false;
 			totalRenderFps = 0;
 			renderFps = 0;
 			lastRenderFps = 0;
@@ -182,6 +184,10 @@ namespace Glest {
 
 			loadGameNode = NULL;
 			lastworldFrameCountForReplay = -1;
+			saveGameWriter = NULL;
+			replayWriter = NULL;
+			replayBenchmark = NULL;
+			replayBenchmarkExpectedCRC = -1;
 			lastNetworkPlayerConnectionCheck = time(NULL);
 			inJoinGameLoading = false;
 			quitGameCalled = false;
@@ -278,6 +284,8 @@ namespace Glest {
 			lastUpdateFps = 0;
 			framesToCatchUpAsClient = 0;
 			framesToSlowDownAsClient = 0;
+			adaptiveClientFrames =
+				Config::getInstance().getBool("NetworkAdaptiveClientFrames", "true");
 			lastRenderFps = -1;
 			avgUpdateFps = -1;
 			avgRenderFps = -1;
@@ -352,6 +360,10 @@ namespace Glest {
 
 			this->masterserverMode = masterserverMode;
 			videoPlayer = NULL;
+			saveGameWriter = NULL;
+			replayWriter = NULL;
+			replayBenchmark = NULL;
+			replayBenchmarkExpectedCRC = -1;
 			playingStaticVideo = false;
 			highlightCellTexture = NULL;
 			playerIndexDisconnect = 0;
@@ -536,6 +548,20 @@ namespace Glest {
 
 			quitGame();
 
+			// Saves still being written must reach the disk
+			delete saveGameWriter;
+			saveGameWriter = NULL;
+			// The streamed replay only lives on in the copies saved
+			// with the game
+			if (replayWriter != NULL) {
+				string replayStreamFile = replayWriter->getPath();
+				delete replayWriter;
+				replayWriter = NULL;
+				removeFile(replayStreamFile);
+			}
+			delete replayBenchmark;
+			replayBenchmark = NULL;
+
 			Object::setStateCallback(NULL);
 			thisGamePtr = NULL;
 			if (originalDisplayMsgCallback != NULL) {
@@ -2299,6 +2325,9 @@ namespace Glest {
 				this->gameSettings.getGameUUID().c_str());
 
 			gameStarted = true;
+			if (replayBenchmark != NULL) {
+				replayBenchmark->start(world.getFrameCount());
+			}
 
 			if (this->masterserverMode == true) {
 				world.getStats()->setIsMasterserverMode(true);
@@ -2569,6 +2598,8 @@ namespace Glest {
 					currentUIState->update();
 				}
 
+				processFinishedSaves();
+
 				bool
 					showPerfStats =
 					Config::getInstance().getBool("ShowPerfStats", "false");
@@ -2688,7 +2719,19 @@ namespace Glest {
 					enableServerControlledAI =
 					this->gameSettings.getEnableServerControlledAI();
 
-				if (role == nrClient && updateLoops == 1
+				if (role == nrClient && adaptiveClientFrames == true) {
+					ClientInterface *clientInterface =
+						dynamic_cast <
+						ClientInterface *>(networkManager.getClientInterface());
+					if (clientInterface != NULL) {
+						updateLoops =
+							clientInterface->getAdaptiveUpdateLoops(updateLoops,
+								world.getFrameCount());
+					}
+				}
+
+				if (role == nrClient && adaptiveClientFrames == false
+					&& updateLoops == 1
 					&& world.getFrameCount() >=
 					(gameSettings.getNetworkFramePeriod() * 2)) {
 					ClientInterface *clientInterface =
@@ -2921,7 +2964,7 @@ namespace Glest {
 							}
 
 							//AiInterface
-							if (commander.hasReplayCommandListForFrame() == false) {
+							if (isReplayFastForward() == false) {
 								chronoGamePerformanceCounts.start();
 
 								processNetworkSynchChecksIfRequired();
@@ -3033,7 +3076,7 @@ namespace Glest {
 									perfList.push_back(perfBuf);
 								}
 
-							} else {
+							} else if (replayBenchmark == NULL) {
 								// Simply show a progress message while replaying commands
 								if (lastReplaySecond < chronoReplay.getSeconds()) {
 									lastReplaySecond = chronoReplay.getSeconds();
@@ -3112,6 +3155,12 @@ namespace Glest {
 							addPerformanceCount("ProcessWorldUpdate",
 								chronoGamePerformanceCounts.getMillis());
 
+							if (replayBenchmark != NULL &&
+								ReplayBenchmark::getThinkMode() != "") {
+								replayBenchmark->addFrameCRC(world.getFrameCount(),
+									getWorldCRC());
+							}
+
 							if (SystemFlags::getSystemSettingType
 							(SystemFlags::debugPerformance).enabled
 								&& chrono.getMillis() > 0)
@@ -3289,7 +3338,9 @@ namespace Glest {
 
 							//good_fpu_control_registers(NULL,extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 						}
-					} while (commander.hasReplayCommandListForFrame() == true);
+					} while (isReplayFastForward() == true);
+
+					checkReplayBenchmarkFinished();
 				}
 				//else if(role == nrClient) {
 				else {
@@ -3628,11 +3679,6 @@ namespace Glest {
 							if (saveNetworkGame == true) {
 								//printf("Saved network game to disk\n");
 
-								string
-									file =
-									this->saveGame(GameConstants::saveNetworkGameFileServer,
-										"temp/");
-
 								string saveGameFilePath = "temp/";
 								string
 									saveGameFileCompressed =
@@ -3662,47 +3708,10 @@ namespace Glest {
 										(GameConstants::saveNetworkGameFileServerCompressed);
 								}
 
-								bool
-									compressed_result =
-									compressFileToZIPFile(file, saveGameFileCompressed);
-								if (SystemFlags::VERBOSE_MODE_ENABLED)
-									printf
-									("Saved game [%s] compressed to [%s] returned: %d\n",
-										file.c_str(), saveGameFileCompressed.c_str(),
-										compressed_result);
-
-								char szBuf[8096] = "";
-								Lang & lang = Lang::getInstance();
-								snprintf(szBuf, 8096,
-									lang.getString("GameSaved", "").c_str(), file.c_str());
-								console.addLine(szBuf);
-
-								for (int i = 0; i < world.getFactionCount(); ++i) {
-									Faction *faction = world.getFaction(i);
-
-									MutexSafeWrapper
-										safeMutex(server->getSlotMutex
-										(faction->getStartLocationIndex()),
-											CODE_AT_LINE);
-									ConnectionSlot *slot =
-										server->getSlot(faction->getStartLocationIndex(),
-											false);
-									if (slot != NULL
-										&& slot->getJoinGameInProgress() == true
-										&& slot->getSentSavedGameInfo() == false) {
-
-										safeMutex.ReleaseLock();
-										NetworkMessageReady networkMessageReady(0);
-										slot->sendMessage(&networkMessageReady);
-
-										slot =
-											server->getSlot(faction->getStartLocationIndex(),
-												false);
-										if (slot != NULL) {
-											slot->setSentSavedGameInfo(true);
-										}
-									}
-								}
+								// The joining clients are told once it is written
+								// and compressed, see processFinishedSaves
+								this->saveGame(GameConstants::saveNetworkGameFileServer,
+									"temp/", true, saveGameFileCompressed);
 							}
 						}
 					}
@@ -3969,6 +3978,9 @@ namespace Glest {
 
 		void Game::addPerformanceCount(string key, int64 value) {
 			gamePerformanceCounts[key] = value + gamePerformanceCounts[key] / 2;
+			if (replayBenchmark != NULL) {
+				replayBenchmark->addPerformanceCount(key, value);
+			}
 		}
 
 		string Game::getGamePerformanceCounts(bool displayWarnings) const {
@@ -7463,8 +7475,8 @@ namespace Glest {
 			}
 
 			str +=
-				"UnitRangeCellsLookupItemCache: " +
-				world.getUnitUpdater()->getUnitRangeCellsLookupItemCacheStats() +
+				"UnitGrid: " +
+				world.getUnitUpdater()->getUnitGridStats() +
 				"\n";
 			str +=
 				"ExploredCellsLookupItemCache: " +
@@ -8429,7 +8441,7 @@ namespace Glest {
 		}
 
 		int Game::getUpdateLoops() {
-			if (commander.hasReplayCommandListForFrame() == true) {
+			if (isReplayFastForward() == true) {
 				return 1;
 			}
 
@@ -8441,6 +8453,34 @@ namespace Glest {
 				return this->speed;
 		}
 
+		bool Game::isReplayFastForward() const {
+			if (commander.hasReplayCommandListForFrame() == true) {
+				return true;
+			}
+			// The benchmark runs on past the last command to the frame
+			// the replay was saved at
+			return replayBenchmark != NULL &&
+				world.getFrameCount() < lastworldFrameCountForReplay;
+		}
+
+		uint32 Game::getWorldCRC() {
+			Checksum checksum;
+			for (int index = 0; index < world.getFactionCount(); ++index) {
+				checksum.addUInt(world.getFaction(index)->getCRC().getSum());
+			}
+			return checksum.getSum();
+		}
+
+		void Game::checkReplayBenchmarkFinished() {
+			if (replayBenchmark == NULL || quitTriggeredIndicator == true ||
+				world.getFrameCount() < lastworldFrameCountForReplay) {
+				return;
+			}
+			replayBenchmark->report(replayBenchmarkFile, world.getFrameCount(),
+				getWorldCRC(), replayBenchmarkExpectedCRC);
+			quitTriggeredIndicator = true;
+		}
+
 		void Game::showLoseMessageBox() {
 			Lang & lang = Lang::getInstance();
 
@@ -8532,9 +8572,54 @@ namespace Glest {
 				int worldFrameCount) {
 			Config & config = Config::getInstance();
 			if (config.getBool("SaveCommandsForReplay", "false") == true) {
-				replayCommandList.push_back(make_pair
-				(worldFrameCount, *networkCommand));
+				if (config.getBool("SaveBinaryReplays", "true") == true) {
+					getReplayWriter()->addCommand(worldFrameCount, *networkCommand);
+				} else {
+					replayCommandList.push_back(make_pair
+					(worldFrameCount, *networkCommand));
+				}
+			}
+		}
+
+		ReplayWriter *Game::getReplayWriter() {
+			if (replayWriter != NULL) {
+				return replayWriter;
+			}
+
+			Config & config = Config::getInstance();
+			string replayStreamFile =
+				config.getString("ReplayStreamFile", "replay_in_progress.replay");
+			if (getGameReadWritePath(GameConstants::path_logs_CacheLookupKey) != "") {
+				replayStreamFile =
+					getGameReadWritePath(GameConstants::path_logs_CacheLookupKey) +
+					replayStreamFile;
+			} else {
+				string userData = config.getString("UserData_Root", "");
+				if (userData != "") {
+					endPathWithSlash(userData);
+				}
+				replayStreamFile = userData + replayStreamFile;
 			}
+
+			std::map < string, string > mapTagReplacements;
+			XmlTree xmlTreeReplay(XML_RAPIDXML_ENGINE);
+			xmlTreeReplay.init("zetaglest-saved-game");
+			XmlNode *gameNodeReplay = xmlTreeReplay.getRootNode()->addChild("Game");
+			gameSettings.saveGame(gameNodeReplay);
+
+			struct tm loctime = threadsafe_localtime(systemtime_now());
+			char szBuf[4096] = "";
+			strftime(szBuf, 4095, "%Y-%m-%d %H:%M:%S", &loctime);
+
+			if (SystemFlags::VERBOSE_MODE_ENABLED)
+				printf("Streaming game replay commands to [%s]\n",
+					replayStreamFile.c_str());
+
+			auto_ptr < ReplayWriter > newReplayWriter(new ReplayWriter());
+			newReplayWriter->open(replayStreamFile, glestVersionString, szBuf,
+				gameNodeReplay);
+			replayWriter = newReplayWriter.release();
+			return replayWriter;
 		}
 
 		void Game::renderVideoPlayer() {
@@ -8668,20 +8753,82 @@ namespace Glest {
 			return true;
 		}
 
+		void Game::processFinishedSaves() {
+			if (saveGameWriter == NULL) {
+				return;
+			}
+			vector < SaveGameWriter::Result > results =
+				saveGameWriter->getFinishedJobs();
+			for (unsigned int i = 0; i < results.size(); ++i) {
+				const SaveGameWriter::Result & result = results[i];
+				Lang & lang = Lang::getInstance();
+				if (result.error != "") {
+					console.addLine("Error saving [" + result.file + "]: " +
+						result.error, true);
+					continue;
+				}
+				// the saved game it goes with tells the player
+				if (result.replay == true) {
+					continue;
+				}
+
+				char szBuf[8096] = "";
+				snprintf(szBuf, 8096,
+					lang.getString("GameSaved", "").c_str(), result.file.c_str());
+				console.addLine(szBuf);
+
+				if (result.compressedFile != "") {
+					sendSavedGameToJoiningClients();
+				}
+			}
+		}
+
+		void Game::sendSavedGameToJoiningClients() {
+			NetworkManager & networkManager = NetworkManager::getInstance();
+			if (networkManager.getNetworkRole() != nrServer) {
+				return;
+			}
+			ServerInterface *server = networkManager.getServerInterface();
+			for (int i = 0; i < world.getFactionCount(); ++i) {
+				Faction *faction = world.getFaction(i);
+
+				MutexSafeWrapper
+					safeMutex(server->getSlotMutex
+					(faction->getStartLocationIndex()),
+						CODE_AT_LINE);
+				ConnectionSlot *slot =
+					server->getSlot(faction->getStartLocationIndex(),
+						false);
+				if (slot != NULL
+					&& slot->getJoinGameInProgress() == true
+					&& slot->getSentSavedGameInfo() == false) {
+
+					safeMutex.ReleaseLock();
+					NetworkMessageReady networkMessageReady(0);
+					slot->sendMessage(&networkMessageReady);
+
+					slot =
+						server->getSlot(faction->getStartLocationIndex(),
+							false);
+					if (slot != NULL) {
+						slot->setSentSavedGameInfo(true);
+					}
+				}
+			}
+		}
+
 		void Game::saveGame() {
-			string file = this->saveGame(GameConstants::saveGameFilePattern);
-			char szBuf[8096] = "";
-			Lang & lang = Lang::getInstance();
-			snprintf(szBuf, 8096, lang.getString("GameSaved", "").c_str(),
-				file.c_str());
-			console.addLine(szBuf);
+			// GameSaved is shown once it is written, see processFinishedSaves
+			string file =
+				this->saveGame(GameConstants::saveGameFilePattern, "saved/", true);
 
 			Config & config = Config::getInstance();
 			config.setString("LastSavedGame", file);
 			config.save();
 		}
 
-		string Game::saveGame(string name, const string & path) {
+		string Game::saveGame(string name, const string & path,
+			bool inBackground, const string & compressedFile) {
 			Config & config = Config::getInstance();
 			// auto name file if using saved file pattern string
 			if (name == GameConstants::saveGameFilePattern) {
@@ -8728,6 +8875,7 @@ namespace Glest {
 			if (config.getBool("SaveCommandsForReplay", "false") == true) {
 				std::map < string, string > mapTagReplacements;
 				XmlTree xmlTreeSaveGame(XML_RAPIDXML_ENGINE);
+				bool binaryReplay = config.getBool("SaveBinaryReplays", "true");
 
 				xmlTreeSaveGame.init("zetaglest-saved-game");
 				XmlNode *rootNodeReplay = xmlTreeSaveGame.getRootNode();
@@ -8746,28 +8894,49 @@ namespace Glest {
 				XmlNode *gameNodeReplay = rootNodeReplay->addChild("Game");
 				gameSettings.saveGame(gameNodeReplay);
 
-				gameNodeReplay->addAttribute("LastWorldFrameCount",
-					intToStr(world.getFrameCount()),
-					mapTagReplacements);
-
-				for (unsigned int i = 0; i < replayCommandList.size(); ++i) {
-					std::pair < int, NetworkCommand > & cmd = replayCommandList[i];
-					XmlNode *networkCommandNode = cmd.second.saveGame(gameNodeReplay);
-					networkCommandNode->addAttribute("worldFrameCount",
-						intToStr(cmd.first),
-						mapTagReplacements);
-				}
-
 				string replayFile = saveGameFile + ".replay";
 				if (SystemFlags::VERBOSE_MODE_ENABLED)
 					printf("Saving game replay commands to [%s]\n",
 						replayFile.c_str());
-				xmlTreeSaveGame.save(replayFile);
+
+				if (binaryReplay == true) {
+					// The commands are already on disk, the save copies
+					// them and adds the footer, on the writer thread
+					// along with the saved game when that is
+					if (inBackground == true) {
+						if (saveGameWriter == NULL) {
+							saveGameWriter = new SaveGameWriter();
+						}
+						saveGameWriter->addReplayJob(getReplayWriter()->getCopy(replayFile,
+							world.getFrameCount(), getWorldCRC()));
+					} else {
+						getReplayWriter()->saveCopy(replayFile, world.getFrameCount(),
+							getWorldCRC());
+					}
+				} else {
+					gameNodeReplay->addAttribute("LastWorldFrameCount",
+						intToStr(world.getFrameCount()),
+						mapTagReplacements);
+					gameNodeReplay->addAttribute("LastWorldCRC",
+						uIntToStr(getWorldCRC()),
+						mapTagReplacements);
+
+					for (unsigned int i = 0; i < replayCommandList.size(); ++i) {
+						std::pair < int, NetworkCommand > & cmd = replayCommandList[i];
+						XmlNode *networkCommandNode = cmd.second.saveGame(gameNodeReplay);
+						networkCommandNode->addAttribute("worldFrameCount",
+							intToStr(cmd.first),
+							mapTagReplacements);
+					}
+
+					xmlTreeSaveGame.save(replayFile);
+				}
 			}
 
-			XmlTree xmlTree;
-			xmlTree.init("zetaglest-saved-game");
-			XmlNode *rootNode = xmlTree.getRootNode();
+			Chrono chronoSave(true);
+			auto_ptr < XmlTree > xmlTree(new XmlTree());
+			xmlTree->init("zetaglest-saved-game");
+			XmlNode *rootNode = xmlTree->getRootNode();
 
 			std::map < string, string > mapTagReplacements;
 			//time_t now = time(NULL);
@@ -8967,7 +9136,36 @@ namespace Glest {
 				intToStr(disableSpeedChange),
 				mapTagReplacements);
 
-			xmlTree.save(saveGameFile);
+			// what the game loop pays for a background save
+			int64 buildMillis = chronoSave.getMillis();
+
+			// The binary form keeps the file name, loading tells them apart
+			bool binary = (config.getBool("SaveGamesAsXml", "false") == false);
+			if (inBackground == true) {
+				// The tree is all the game state the file needs, writing and
+				// compressing it is left to the writer thread
+				if (saveGameWriter == NULL) {
+					saveGameWriter = new SaveGameWriter();
+				}
+				saveGameWriter->addJob(xmlTree.release(), saveGameFile, binary,
+					compressedFile);
+			} else {
+				if (binary == true) {
+					xmlTree->saveBinary(saveGameFile);
+				} else {
+					xmlTree->save(saveGameFile);
+				}
+				if (compressedFile != "") {
+					compressFileToZIPFile(saveGameFile, compressedFile);
+				}
+			}
+			if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled)
+				SystemFlags::OutputDebug(SystemFlags::debugPerformance,
+					"In [%s::%s Line: %d] saving [%s] inBackground = %d took msecs: "
+					MG_I64_SPECIFIER ", building the tree: " MG_I64_SPECIFIER "\n",
+					extractFileFromDirectoryPath(__FILE__).c_str(),
+					__FUNCTION__, __LINE__, saveGameFile.c_str(), inBackground,
+					chronoSave.getMillis(), buildMillis);
 
 			if (masterserverMode == false) {
 				// take Screenshot
@@ -8995,24 +9193,46 @@ namespace Glest {
 			// This condition will re-play all the commands from a replay file
 			// INSTEAD of saving from a saved game.
 			if (joinGameSettings == NULL
-				&& config.getBool("SaveCommandsForReplay", "false") == true) {
+				&& (config.getBool("SaveCommandsForReplay", "false") == true ||
+					ReplayBenchmark::isEnabled() == true)) {
+				string replayFile = name + ".replay";
 				XmlTree xmlTreeReplay(XML_RAPIDXML_ENGINE);
-				std::map < string, string > mapExtraTagReplacementValues;
-				xmlTreeReplay.load(name + ".replay",
-					Properties::getTagReplacementValues
-					(&mapExtraTagReplacementValues), true);
+				// The binary replay only has its header read here, the
+				// commander streams the commands while replaying
+				ReplayReader *replayReader = NULL;
+				const XmlNode *gameNode = NULL;
+				string gameVer = "";
+				if (ReplayFile::isBinaryReplay(replayFile) == true) {
+					replayReader = new ReplayReader();
+					try {
+						replayReader->open(replayFile);
+					} catch (...) {
+						delete replayReader;
+						throw;
+					}
+					gameNode = replayReader->getGameNode();
+					gameVer = replayReader->getGlestVersion();
+				} else {
+					std::map < string, string > mapExtraTagReplacementValues;
+					xmlTreeReplay.load(replayFile,
+						Properties::getTagReplacementValues
+						(&mapExtraTagReplacementValues), true);
 
-				const XmlNode *rootNode = xmlTreeReplay.getRootNode();
+					const XmlNode *rootNode = xmlTreeReplay.getRootNode();
 
-				if (rootNode->hasChild("zetaglest-saved-game") == true) {
-					rootNode = rootNode->getChild("zetaglest-saved-game");
-				}
+					if (rootNode->hasChild("zetaglest-saved-game") == true) {
+						rootNode = rootNode->getChild("zetaglest-saved-game");
+					}
 
-				//const XmlNode *versionNode= rootNode->getChild("zetaglest-saved-game");
-				const XmlNode *versionNode = rootNode;
+					//const XmlNode *versionNode= rootNode->getChild("zetaglest-saved-game");
+					const XmlNode *versionNode = rootNode;
+					gameVer = versionNode->getAttribute("version")->getValue();
+					gameNode = rootNode->getChild("Game");
+				}
+				// Owned by the game's commander from here on
+				auto_ptr < ReplayReader > replayReaderOwner(replayReader);
 
 				Lang & lang = Lang::getInstance();
-				string gameVer = versionNode->getAttribute("version")->getValue();
 				if (gameVer != glestVersionString
 					&& checkVersionComptability(gameVer,
 						glestVersionString) == false) {
@@ -9028,8 +9248,6 @@ namespace Glest {
 					("Found saved game version that matches your application version: [%s] --> [%s]\n",
 						gameVer.c_str(), glestVersionString.c_str());
 
-				XmlNode *gameNode = rootNode->getChild("Game");
-
 				GameSettings newGameSettingsReplay;
 				newGameSettingsReplay.loadGame(gameNode);
 				//printf("Loading scenario [%s]\n",newGameSettingsReplay.getScenarioDir().c_str());
@@ -9056,23 +9274,51 @@ namespace Glest {
 
 				Game *newGame =
 					new Game(programPtr, &newGameSettingsReplay, isMasterserverMode);
-				newGame->lastworldFrameCountForReplay =
-					gameNode->getAttribute("LastWorldFrameCount")->getIntValue();
+				int64 lastWorldCRC = -1;
+				if (replayReader != NULL) {
+					newGame->lastworldFrameCountForReplay =
+						replayReader->getLastWorldFrameCount();
+					lastWorldCRC = replayReader->getLastWorldCRC();
+					newGame->commander.setReplayReader(replayReaderOwner.release());
+				} else {
+					newGame->lastworldFrameCountForReplay =
+						gameNode->getAttribute("LastWorldFrameCount")->getIntValue();
+					if (gameNode->hasAttribute("LastWorldCRC") == true) {
+						lastWorldCRC = (uint32)
+							strToUInt(gameNode->getAttribute("LastWorldCRC")->getValue());
+					}
+
+					vector < XmlNode * >networkCommandNodeList =
+						gameNode->getChildList("NetworkCommand");
+					if (SystemFlags::VERBOSE_MODE_ENABLED)
+						printf("networkCommandNodeList.size() = " MG_SIZE_T_SPECIFIER
+							"\n", networkCommandNodeList.size());
+					for (unsigned int i = 0; i < networkCommandNodeList.size(); ++i) {
+						XmlNode *node = networkCommandNodeList[i];
+						int
+							worldFrameCount =
+							node->getAttribute("worldFrameCount")->getIntValue();
+						NetworkCommand command;
+						command.loadGame(node);
+						newGame->commander.addToReplayCommandList(command,
+							worldFrameCount);
+					}
+				}
 
-				vector < XmlNode * >networkCommandNodeList =
-					gameNode->getChildList("NetworkCommand");
-				if (SystemFlags::VERBOSE_MODE_ENABLED)
-					printf("networkCommandNodeList.size() = " MG_SIZE_T_SPECIFIER
-						"\n", networkCommandNodeList.size());
-				for (unsigned int i = 0; i < networkCommandNodeList.size(); ++i) {
-					XmlNode *node = networkCommandNodeList[i];
-					int
-						worldFrameCount =
-						node->getAttribute("worldFrameCount")->getIntValue();
-					NetworkCommand command;
-					command.loadGame(node);
-					newGame->commander.addToReplayCommandList(command,
-						worldFrameCount);
+				if (ReplayBenchmark::isEnabled() == true) {
+					newGame->replayBenchmark = new ReplayBenchmark();
+					newGame->replayBenchmarkFile = replayFile;
+					newGame->replayBenchmarkExpectedCRC = lastWorldCRC;
+				}
+
+				// Stop giving the replay's commands at the given minute and
+				// play on from there, the world is still simulated up to it
+				int
+					stopCommandsAtMinute =
+					config.getInt("ReplayStopCommandsAtMinute", "0");
+				if (stopCommandsAtMinute > 0 && newGame->replayBenchmark == NULL) {
+					newGame->commander.setReplayStopFrame(stopCommandsAtMinute * 60 *
+						GameConstants::updateFps);
 				}
 
 				programPtr->setState(newGame);
@@ -9083,12 +9329,20 @@ namespace Glest {
 
 			if (SystemFlags::VERBOSE_MODE_ENABLED)
 				printf("Before load of XML\n");
+			Chrono chronoLoad(true);
 			std::map < string, string > mapExtraTagReplacementValues;
 			xmlTree.load(name,
 				Properties::getTagReplacementValues
 				(&mapExtraTagReplacementValues), true);
 			if (SystemFlags::VERBOSE_MODE_ENABLED)
 				printf("After load of XML\n");
+			if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled)
+				SystemFlags::OutputDebug(SystemFlags::debugPerformance,
+					"In [%s::%s Line: %d] reading [%s] took msecs: "
+					MG_I64_SPECIFIER "\n",
+					extractFileFromDirectoryPath(__FILE__).c_str(),
+					__FUNCTION__, __LINE__, name.c_str(),
+					chronoLoad.getMillis());
 
 			const XmlNode *rootNode = xmlTree.getRootNode();
 			if (rootNode->hasChild("zetaglest-saved-game") == true) {
@@ -44,6 +44,8 @@
 #   include "network_interface.h"
 #   include "data_types.h"
 #   include "selection.h"
+#   include "save_game_writer.h"
+#   include "replay_benchmark.h"
 #   include "leak_dumper.h"
 
 using std::vector;
@@ -61,6 +63,7 @@ namespace Glest {
 
 		class GraphicMessageBox;
 		class ServerInterface;
+		class ReplayWriter;
 
 		enum LoadGameItem {
 			lgt_FactionPreview = 0x01,
@@ -114,6 +117,8 @@ namespace Glest {
 			int updateFps, lastUpdateFps, avgUpdateFps;
 			int framesToCatchUpAsClient;
 			int framesToSlowDownAsClient;
+			// Client pacing by ClientFrameScheduler instead of the above
+			bool adaptiveClientFrames;
 			int receivedTooEarlyInFrames[GameConstants::networkSmoothInterval];
 			int
 				framesNeededToWaitForServerMessage[GameConstants::
@@ -223,7 +228,17 @@ namespace Glest {
 
 			XmlNode *loadGameNode;
 			int lastworldFrameCountForReplay;
+			// Commands kept for an xml replay, binary replays are
+			// streamed to replayWriter as they are given
 			std::vector < std::pair < int, NetworkCommand > > replayCommandList;
+			ReplayWriter *replayWriter;
+
+			SaveGameWriter *saveGameWriter;
+
+			// Set when the replay runs for --benchmark-replay
+			ReplayBenchmark *replayBenchmark;
+			string replayBenchmarkFile;
+			int64 replayBenchmarkExpectedCRC;
 
 			std::vector < string > streamingVideos;
 			::Shared::Graphics::VideoPlayer * videoPlayer;
@@ -444,7 +459,11 @@ namespace Glest {
 			void stopStreamingVideo(const string & playVideo);
 			void stopAllVideo();
 
-			string saveGame(string name, const string & path = "saved/");
+			// In the background only the node tree is built before it
+			// returns, compressedFile is a zip of it for joining clients
+			string saveGame(string name, const string & path = "saved/",
+				bool inBackground = false,
+				const string & compressedFile = "");
 			static void
 				loadGame(string name, Program * programPtr, bool isMasterserverMode,
 					const GameSettings * joinGameSettings = NULL);
@@ -452,6 +471,7 @@ namespace Glest {
 			void
 				addNetworkCommandToReplayList(NetworkCommand * networkCommand,
 					int worldFrameCount);
+			ReplayWriter *getReplayWriter();
 
 			bool factionLostGame(int factionIndex);
 
@@ -497,6 +517,9 @@ namespace Glest {
 			void incSpeed();
 			void decSpeed();
 			int getUpdateLoops();
+			bool isReplayFastForward() const;
+			uint32 getWorldCRC();
+			void checkReplayBenchmarkFinished();
 
 			void showLoseMessageBox();
 			void showWinMessageBox();
@@ -534,6 +557,9 @@ namespace Glest {
 			void startMarkCell();
 			void startCameraFollowUnit();
 
+			void processFinishedSaves();
+			void sendSavedGameToJoiningClients();
+
 			bool
 				switchSetupForSlots(ServerInterface * &serverInterface,
 					int startIndex, int endIndex,
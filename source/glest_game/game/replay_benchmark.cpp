@@ -0,0 +1,192 @@
+//
+//      replay_benchmark.cpp: timings of a replay run headless as fast as it
+//                            can go
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#include "replay_benchmark.h"
+
+#include <stdio.h>
+#include "util.h"
+#include "platform_util.h"
+#include "leak_dumper.h"
+
+using namespace Shared::Util;
+
+namespace Glest {
+	namespace Game {
+
+		static string jsonString(const string &value) {
+			string result = "\"";
+			for (unsigned int i = 0; i < value.size(); ++i) {
+				if (value[i] == '"' || value[i] == '\\') {
+					result += '\\';
+				}
+				result += value[i];
+			}
+			return result + "\"";
+		}
+
+		// =====================================================
+		//	class ReplayBenchmark
+		// =====================================================
+
+		string ReplayBenchmark::output = "";
+		string ReplayBenchmark::thinkMode = "";
+		bool ReplayBenchmark::failed = false;
+
+		ReplayBenchmark::ReplayBenchmark() {
+			startFrame = 0;
+		}
+
+		void ReplayBenchmark::start(int startFrame) {
+			this->startFrame = startFrame;
+			counts.clear();
+			frameCRCs.clear();
+			chrono.start();
+		}
+
+		void ReplayBenchmark::addPerformanceCount(const string &key, int64 value) {
+			Count &count = counts[key];
+			count.total += value;
+			if (value > count.max) {
+				count.max = value;
+			}
+			count.samples++;
+		}
+
+		void ReplayBenchmark::addFrameCRC(int frame, uint32 worldCRC) {
+			frameCRCs.push_back(std::make_pair(frame, worldCRC));
+		}
+
+		bool ReplayBenchmark::compareFrameCRCs(const string &replayFile) {
+			string traceFile = replayFile + "." + thinkMode + ".crc";
+			FILE *file = fopen(traceFile.c_str(), "w");
+			if (file == NULL) {
+				printf("Can not open checksum trace file [%s]\n", traceFile.c_str());
+				return false;
+			}
+			for (unsigned int i = 0; i < frameCRCs.size(); ++i) {
+				fprintf(file, "%d %u\n", frameCRCs[i].first, frameCRCs[i].second);
+			}
+			fclose(file);
+
+			string otherTraceFile = replayFile + "." +
+				(thinkMode == "serial" ? "threaded" : "serial") + ".crc";
+			file = fopen(otherTraceFile.c_str(), "r");
+			if (file == NULL) {
+				printf("Frame checksums written to [%s], run the other think mode to compare\n",
+					traceFile.c_str());
+				return true;
+			}
+
+			bool result = true;
+			unsigned int index = 0;
+			int frame = 0;
+			uint32 worldCRC = 0;
+			for (; fscanf(file, "%d %u", &frame, &worldCRC) == 2; ++index) {
+				if (index >= frameCRCs.size() || frameCRCs[index].first != frame ||
+					frameCRCs[index].second != worldCRC) {
+					printf("Frame checksums differ from [%s] at frame %d\n",
+						otherTraceFile.c_str(), frame);
+					result = false;
+					break;
+				}
+			}
+			fclose(file);
+			if (result == true && index != frameCRCs.size()) {
+				printf("Frame checksums of [%s] end at frame %d, this run went on\n",
+					otherTraceFile.c_str(), frame);
+				result = false;
+			}
+			if (result == true) {
+				printf("Frame checksums of %u frames match [%s]\n", index,
+					otherTraceFile.c_str());
+			}
+			return result;
+		}
+
+		void ReplayBenchmark::report(const string &replayFile, int lastFrame, uint32 worldCRC, int64 expectedCRC) {
+			int64 elapsedMillis = chrono.getMillis();
+			int frames = lastFrame - startFrame;
+			double framesPerSecond = (elapsedMillis > 0 ? frames * 1000.0 / elapsedMillis : 0.0);
+			bool crcMatches = (expectedCRC < 0 || (uint32) expectedCRC == worldCRC);
+			failed = (crcMatches == false);
+
+			bool csv = (output == "csv" || EndsWith(output, ".csv") == true);
+			FILE *file = stdout;
+			if (output != "csv" && output != "json") {
+				file = fopen(output.c_str(), "w");
+				if (file == NULL) {
+					printf("Can not open benchmark output file [%s]\n", output.c_str());
+					file = stdout;
+				}
+			}
+
+			if (csv == true) {
+				fprintf(file, "name,value,max,samples\n");
+				fprintf(file, "frames,%d,,\n", frames);
+				fprintf(file, "wall_ms," MG_I64_SPECIFIER ",,\n", elapsedMillis);
+				fprintf(file, "frames_per_second,%.1f,,\n", framesPerSecond);
+				fprintf(file, "world_crc,%u,,\n", worldCRC);
+				if (expectedCRC >= 0) {
+					fprintf(file, "expected_crc,%u,,\n", (uint32) expectedCRC);
+				}
+				for (std::map<string, Count>::const_iterator iterMap = counts.begin();
+					iterMap != counts.end(); ++iterMap) {
+					fprintf(file, "%s," MG_I64_SPECIFIER "," MG_I64_SPECIFIER "," MG_I64_SPECIFIER "\n",
+						iterMap->first.c_str(), iterMap->second.total, iterMap->second.max,
+						iterMap->second.samples);
+				}
+			} else {
+				fprintf(file, "{\n");
+				fprintf(file, "  \"replay\": %s,\n", jsonString(replayFile).c_str());
+				fprintf(file, "  \"frames\": %d,\n", frames);
+				fprintf(file, "  \"wallMs\": " MG_I64_SPECIFIER ",\n", elapsedMillis);
+				fprintf(file, "  \"framesPerSecond\": %.1f,\n", framesPerSecond);
+				fprintf(file, "  \"worldCRC\": %u,\n", worldCRC);
+				if (expectedCRC >= 0) {
+					fprintf(file, "  \"expectedCRC\": %u,\n", (uint32) expectedCRC);
+					fprintf(file, "  \"crcMatches\": %s,\n", (crcMatches == true ? "true" : "false"));
+				}
+				fprintf(file, "  \"phases\": {");
+				for (std::map<string, Count>::const_iterator iterMap = counts.begin();
+					iterMap != counts.end(); ++iterMap) {
+					fprintf(file, "%s\n    %s: { \"totalMs\": " MG_I64_SPECIFIER ", \"maxMs\": " MG_I64_SPECIFIER ", \"samples\": " MG_I64_SPECIFIER " }",
+						(iterMap == counts.begin() ? "" : ","), jsonString(iterMap->first).c_str(),
+						iterMap->second.total, iterMap->second.max, iterMap->second.samples);
+				}
+				fprintf(file, "\n  }\n}\n");
+			}
+
+			if (file != stdout) {
+				fclose(file);
+			}
+			if (crcMatches == false) {
+				printf("Replay benchmark world checksum %u doesn't match the recorded %u\n",
+					worldCRC, (uint32) expectedCRC);
+			}
+			if (thinkMode != "" && compareFrameCRCs(replayFile) == false) {
+				failed = true;
+			}
+		}
+
+	}
+} //end namespace
@@ -0,0 +1,115 @@
+//
+//      replay_benchmark.h: timings of a replay run headless as fast as it
+//                          can go
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _GLEST_GAME_REPLAYBENCHMARK_H_
+#define _GLEST_GAME_REPLAYBENCHMARK_H_
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <winsock.h>
+#endif
+
+#include <map>
+#include <string>
+#include <vector>
+#include "platform_common.h"
+#include "data_types.h"
+#include "leak_dumper.h"
+
+using std::string;
+using Shared::Platform::int64;
+using Shared::Platform::uint32;
+using Shared::PlatformCommon::Chrono;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		//	class ReplayBenchmark
+		//
+		///	Sums the game's performance counts while a replay runs
+		///	for --benchmark-replay and reports them with the world
+		///	checksum reached at the replay's last frame. With a think
+		///	mode it also keeps the world checksum of every frame, so
+		///	a serial and a threaded run can be compared.
+		// =====================================================
+
+		class ReplayBenchmark {
+		private:
+			class Count {
+			public:
+				Count() : total(0), max(0), samples(0) {
+				}
+
+				int64 total;
+				int64 max;
+				int64 samples;
+			};
+
+			static string output;
+			static string thinkMode;
+			static bool failed;
+
+			std::map<string, Count> counts;
+			Chrono chrono;
+			int startFrame;
+			std::vector<std::pair<int, uint32> > frameCRCs;
+
+			// Writes this run's checksums, returns false when the other
+			// think mode's trace of the same replay differs from them
+			bool compareFrameCRCs(const string &replayFile);
+
+		public:
+			// "json" or "csv" for stdout, or a file ending in .json or .csv
+			static void setOutput(const string &value) {
+				output = value;
+			}
+			static bool isEnabled() {
+				return output != "";
+			}
+			// "serial" or "threaded", empty to not keep frame checksums
+			static void setThinkMode(const string &value) {
+				thinkMode = value;
+			}
+			static const string &getThinkMode() {
+				return thinkMode;
+			}
+			// The checksum didn't match the recorded one
+			static bool getFailed() {
+				return failed;
+			}
+
+			ReplayBenchmark();
+
+			// Once the game is loaded, the timings start from here
+			void start(int startFrame);
+			void addPerformanceCount(const string &key, int64 value);
+			void addFrameCRC(int frame, uint32 worldCRC);
+			// expectedCRC is -1 when the replay didn't record it
+			void report(const string &replayFile, int lastFrame, uint32 worldCRC, int64 expectedCRC);
+		};
+
+	}
+} //end namespace
+
+#endif
@@ -0,0 +1,516 @@
+//
+//      replay_file.cpp: binary replay container, written and streamed frame
+//                       by frame
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#include "replay_file.h"
+
+#include <cstring>
+#include <map>
+#include "platform_util.h"
+#include "util.h"
+#include "conversion.h"
+#include "leak_dumper.h"
+
+using namespace Shared::Util;
+using namespace Shared::Platform;
+
+namespace Glest {
+	namespace Game {
+
+		namespace {
+			const char replayMagic[4] = { 'Z', 'G', 'R', 'P' };
+			const char trailerMagic[4] = { 'Z', 'G', 'R', 'I' };
+			// game settings are a node with a few levels of children
+			const int maxNodeDepth = 16;
+			// fields of a NetworkCommand in the order they are stored
+			const int commandFieldCount = 14;
+
+			FILE *openReplayFile(const string &path, bool write) {
+#ifdef WIN32
+				return _wfopen(utf8_decode(path).c_str(), (write == true ? L"wb" : L"rb"));
+#else
+				return fopen(path.c_str(), (write == true ? "wb" : "rb"));
+#endif
+			}
+
+			void getCommandFields(const NetworkCommand &command, int64 *fields) {
+				fields[0] = command.networkCommandType;
+				fields[1] = command.unitId;
+				fields[2] = command.unitTypeId;
+				fields[3] = command.commandTypeId;
+				fields[4] = command.positionX;
+				fields[5] = command.positionY;
+				fields[6] = command.targetId;
+				fields[7] = command.wantQueue;
+				fields[8] = command.fromFactionIndex;
+				fields[9] = command.unitFactionUnitCount;
+				fields[10] = command.unitFactionIndex;
+				fields[11] = command.commandStateType;
+				fields[12] = command.commandStateValue;
+				fields[13] = command.unitCommandGroupId;
+			}
+
+			void setCommandFields(NetworkCommand &command, const int64 *fields) {
+				command.networkCommandType = (int16) fields[0];
+				command.unitId = (int32) fields[1];
+				command.unitTypeId = (int16) fields[2];
+				command.commandTypeId = (int16) fields[3];
+				command.positionX = (int16) fields[4];
+				command.positionY = (int16) fields[5];
+				command.targetId = (int32) fields[6];
+				command.wantQueue = (int8) fields[7];
+				command.fromFactionIndex = (int8) fields[8];
+				command.unitFactionUnitCount = (uint16) fields[9];
+				command.unitFactionIndex = (int8) fields[10];
+				command.commandStateType = (int8) fields[11];
+				command.commandStateValue = (int32) fields[12];
+				command.unitCommandGroupId = (int32) fields[13];
+			}
+		}
+
+		// =====================================================
+		//	class ReplayFile
+		// =====================================================
+
+		bool ReplayFile::isBinaryReplay(const string &path) {
+			FILE *file = openReplayFile(path, false);
+			if (file == NULL) {
+				return false;
+			}
+			char magic[4];
+			bool result = (fread(magic, 1, 4, file) == 4 && memcmp(magic, replayMagic, 4) == 0);
+			fclose(file);
+			return result;
+		}
+
+		// =====================================================
+		//	class ReplayWriter
+		// =====================================================
+
+		ReplayWriter::ReplayWriter() {
+			file = NULL;
+			blockFrame = -1;
+			lastIndexedFrame = -1;
+			commandCount = 0;
+		}
+
+		ReplayWriter::~ReplayWriter() {
+			if (file != NULL) {
+				fclose(file);
+				file = NULL;
+			}
+		}
+
+		void ReplayWriter::writeByte(unsigned char value) {
+			fputc(value, file);
+		}
+
+		void ReplayWriter::writeVarUInt(uint64 value) {
+			for (; value >= 0x80; value >>= 7) {
+				writeByte((unsigned char) (value | 0x80));
+			}
+			writeByte((unsigned char) value);
+		}
+
+		void ReplayWriter::writeVarInt(int64 value) {
+			writeVarUInt(((uint64) value << 1) ^ (uint64) (value >> 63));
+		}
+
+		void ReplayWriter::writeString(const string &value) {
+			writeVarUInt(value.size());
+			if (value.empty() == false) {
+				fwrite(value.data(), 1, value.size(), file);
+			}
+		}
+
+		void ReplayWriter::writeNode(const XmlNode *node) {
+			writeString(node->getName());
+			writeString(node->getText());
+			writeVarUInt(node->getAttributeCount());
+			for (unsigned int index = 0; index < node->getAttributeCount(); ++index) {
+				const XmlAttribute *attribute = node->getAttribute(index);
+				writeString(attribute->getName());
+				writeString(attribute->getValue("", false));
+			}
+			writeVarUInt(node->getChildCount());
+			for (unsigned int index = 0; index < node->getChildCount(); ++index) {
+				writeNode(node->getChild(index));
+			}
+		}
+
+		void ReplayWriter::open(const string &path, const string &glestVersion,
+			const string &timestamp, const XmlNode *gameNode) {
+			this->path = path;
+			file = openReplayFile(path, true);
+			if (file == NULL) {
+				throw megaglest_runtime_error("Can not open file: [" + path + "]", true);
+			}
+
+			fwrite(replayMagic, 1, 4, file);
+			writeVarUInt(ReplayFile::version);
+			writeString(glestVersion);
+			writeString(timestamp);
+			writeNode(gameNode);
+		}
+
+		void ReplayWriter::writeBlock() {
+			if (blockCommands.empty() == true) {
+				return;
+			}
+
+			if (lastIndexedFrame < 0 || blockFrame - lastIndexedFrame >= ReplayFile::seekIndexFrames) {
+				seekIndex.push_back(blockFrame);
+				seekIndex.push_back((int64) ftell(file));
+				seekIndex.push_back(commandCount);
+				lastIndexedFrame = blockFrame;
+			}
+
+			writeVarUInt(blockFrame);
+			writeVarUInt(blockCommands.size());
+			int64 fields[commandFieldCount];
+			for (unsigned int index = 0; index < blockCommands.size(); ++index) {
+				getCommandFields(blockCommands[index], fields);
+				for (int field = 0; field < commandFieldCount; ++field) {
+					writeVarInt(fields[field]);
+				}
+			}
+			commandCount += blockCommands.size();
+			blockCommands.clear();
+		}
+
+		void ReplayWriter::addCommand(int frame, const NetworkCommand &command) {
+			if (frame != blockFrame) {
+				if (frame < blockFrame) {
+					throw megaglest_runtime_error("Replay commands out of frame order, frame " +
+						intToStr(frame) + " after " + intToStr(blockFrame));
+				}
+				writeBlock();
+				blockFrame = frame;
+			}
+			blockCommands.push_back(command);
+		}
+
+		void ReplayWriter::close(int lastWorldFrameCount, int64 lastWorldCRC) {
+			if (file == NULL) {
+				return;
+			}
+			writeBlock();
+
+			int64 footerOffset = (int64) ftell(file);
+			writeVarUInt(lastWorldFrameCount);
+			writeVarUInt(commandCount);
+			writeVarUInt(seekIndex.size() / 3);
+			for (unsigned int index = 0; index < seekIndex.size(); ++index) {
+				writeVarUInt(seekIndex[index]);
+			}
+			// 0 when the checksum is unknown
+			writeVarUInt(lastWorldCRC + 1);
+
+			for (int byteIndex = 0; byteIndex < 8; ++byteIndex) {
+				writeByte((unsigned char) (footerOffset >> (8 * byteIndex)));
+			}
+			fwrite(trailerMagic, 1, 4, file);
+
+			bool writeFailed = (ferror(file) != 0);
+			fclose(file);
+			file = NULL;
+			if (writeFailed == true) {
+				throw megaglest_runtime_error("Error writing replay file: [" + path + "]");
+			}
+		}
+
+		ReplayCopy *ReplayWriter::getCopy(const string &copyPath, int lastWorldFrameCount,
+			int64 lastWorldCRC) {
+			if (file == NULL) {
+				throw megaglest_runtime_error("Replay is not open: [" + path + "]");
+			}
+			// the block of the current frame is left pending, more
+			// commands may still be given in it
+			fflush(file);
+
+			ReplayCopy *copy = new ReplayCopy();
+			copy->sourcePath = path;
+			copy->sourceSize = (int64) ftell(file);
+			copy->path = copyPath;
+			copy->blockFrame = blockFrame;
+			copy->blockCommands = blockCommands;
+			copy->lastIndexedFrame = lastIndexedFrame;
+			copy->commandCount = commandCount;
+			copy->seekIndex = seekIndex;
+			copy->lastWorldFrameCount = lastWorldFrameCount;
+			copy->lastWorldCRC = lastWorldCRC;
+			return copy;
+		}
+
+		void ReplayWriter::saveCopy(const string &copyPath, int lastWorldFrameCount,
+			int64 lastWorldCRC) {
+			ReplayCopy *copy = getCopy(copyPath, lastWorldFrameCount, lastWorldCRC);
+			try {
+				copy->write();
+			} catch (...) {
+				delete copy;
+				throw;
+			}
+			delete copy;
+		}
+
+		// =====================================================
+		//	class ReplayCopy
+		// =====================================================
+
+		ReplayCopy::ReplayCopy() {
+			sourceSize = 0;
+			blockFrame = -1;
+			lastIndexedFrame = -1;
+			commandCount = 0;
+			lastWorldFrameCount = 0;
+			lastWorldCRC = -1;
+		}
+
+		void ReplayCopy::write() {
+			FILE *source = openReplayFile(sourcePath, false);
+			if (source == NULL) {
+				throw megaglest_runtime_error("Can not open file: [" + sourcePath + "]", true);
+			}
+			ReplayWriter copy;
+			copy.path = path;
+			copy.file = openReplayFile(path, true);
+			if (copy.file == NULL) {
+				fclose(source);
+				throw megaglest_runtime_error("Can not open file: [" + path + "]", true);
+			}
+
+			char buffer[16384];
+			for (int64 copied = 0; copied < sourceSize;) {
+				int64 chunkSize = sourceSize - copied;
+				if (chunkSize > (int64) sizeof(buffer)) {
+					chunkSize = sizeof(buffer);
+				}
+				size_t readSize = fread(buffer, 1, (size_t) chunkSize, source);
+				if (readSize == 0) {
+					break;
+				}
+				fwrite(buffer, 1, readSize, copy.file);
+				copied += readSize;
+			}
+			bool readFailed = (ferror(source) != 0 || (int64) ftell(source) != sourceSize);
+			fclose(source);
+			if (readFailed == true) {
+				throw megaglest_runtime_error("Error reading replay file: [" + sourcePath + "]");
+			}
+
+			// the copy starts with the same bytes, so the offsets of
+			// the seek index hold for it
+			copy.blockFrame = blockFrame;
+			copy.blockCommands = blockCommands;
+			copy.lastIndexedFrame = lastIndexedFrame;
+			copy.commandCount = commandCount;
+			copy.seekIndex = seekIndex;
+			copy.close(lastWorldFrameCount, lastWorldCRC);
+		}
+
+		// =====================================================
+		//	class ReplayReader
+		// =====================================================
+
+		ReplayReader::ReplayReader() {
+			file = NULL;
+			gameNode = NULL;
+			lastWorldFrameCount = 0;
+			lastWorldCRC = -1;
+			commandCount = 0;
+			commandsRead = 0;
+			blocksEnd = 0;
+			nextFrame = -1;
+		}
+
+		ReplayReader::~ReplayReader() {
+			close();
+		}
+
+		void ReplayReader::close() {
+			if (file != NULL) {
+				fclose(file);
+				file = NULL;
+			}
+			delete gameNode;
+			gameNode = NULL;
+			nextFrame = -1;
+		}
+
+		void ReplayReader::throwError(const string &message) const {
+			throw megaglest_runtime_error("Invalid replay file: [" + path + "] " + message, true);
+		}
+
+		int ReplayReader::readByte() {
+			int value = fgetc(file);
+			if (value == EOF) {
+				throwError("unexpected end of file");
+			}
+			return value;
+		}
+
+		uint64 ReplayReader::readVarUInt() {
+			uint64 value = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				int byte = readByte();
+				value |= (uint64) (byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0) {
+					return value;
+				}
+			}
+			throwError("bad varint");
+			return 0;
+		}
+
+		int64 ReplayReader::readVarInt() {
+			uint64 value = readVarUInt();
+			return (int64) (value >> 1) ^ -(int64) (value & 1);
+		}
+
+		string ReplayReader::readString() {
+			uint64 length = readVarUInt();
+			if (length > 0x1000000) {
+				throwError("bad string length");
+			}
+			string value((size_t) length, '\0');
+			if (length > 0 && fread(&value[0], 1, (size_t) length, file) != length) {
+				throwError("unexpected end of file");
+			}
+			return value;
+		}
+
+		void ReplayReader::readNode(XmlNode *node, int depth) {
+			if (depth > maxNodeDepth) {
+				throwError("game settings nested too deep");
+			}
+			std::map<string, string> mapTagReplacements;
+			uint64 attributeCount = readVarUInt();
+			for (uint64 index = 0; index < attributeCount; ++index) {
+				string name = readString();
+				string value = readString();
+				node->addAttribute(name, value, mapTagReplacements);
+			}
+			uint64 childCount = readVarUInt();
+			for (uint64 index = 0; index < childCount; ++index) {
+				string name = readString();
+				string text = readString();
+				readNode(node->addChild(name, text), depth + 1);
+			}
+		}
+
+		void ReplayReader::open(const string &path) {
+			close();
+			this->path = path;
+			file = openReplayFile(path, false);
+			if (file == NULL) {
+				throw megaglest_runtime_error("Can not open file: [" + path + "]", true);
+			}
+
+			// The footer first, it says where the blocks end
+			if (fseek(file, -ReplayFile::trailerSize, SEEK_END) != 0) {
+				throwError("file too short");
+			}
+			int64 fileSize = (int64) ftell(file) + ReplayFile::trailerSize;
+			unsigned char trailer[ReplayFile::trailerSize];
+			if (fread(trailer, 1, ReplayFile::trailerSize, file) != (size_t) ReplayFile::trailerSize ||
+				memcmp(&trailer[8], trailerMagic, 4) != 0) {
+				throwError("the replay was not closed");
+			}
+			blocksEnd = 0;
+			for (int byteIndex = 0; byteIndex < 8; ++byteIndex) {
+				blocksEnd |= (int64) trailer[byteIndex] << (8 * byteIndex);
+			}
+			if (blocksEnd <= 0 || fseek(file, (long) blocksEnd, SEEK_SET) != 0) {
+				throwError("bad footer offset");
+			}
+			lastWorldFrameCount = (int) readVarUInt();
+			commandCount = (int64) readVarUInt();
+			uint64 indexCount = readVarUInt();
+			if (indexCount > (uint64) commandCount + 1) {
+				throwError("bad seek index");
+			}
+			// the seek index isn't needed to play from the start
+			for (uint64 index = 0; index < indexCount * 3; ++index) {
+				readVarUInt();
+			}
+			// Replays written before the checksum was added end here
+			lastWorldCRC = -1;
+			if ((int64) ftell(file) < fileSize - ReplayFile::trailerSize) {
+				lastWorldCRC = (int64) readVarUInt() - 1;
+			}
+
+			fseek(file, 0, SEEK_SET);
+			char magic[4];
+			if (fread(magic, 1, 4, file) != 4 || memcmp(magic, replayMagic, 4) != 0) {
+				throwError("not a binary replay");
+			}
+			int fileVersion = (int) readVarUInt();
+			if (fileVersion != ReplayFile::version) {
+				throwError("unsupported version " + intToStr(fileVersion));
+			}
+			glestVersion = readString();
+			timestamp = readString();
+			string name = readString();
+			gameNode = new XmlNode(name);
+			readString();
+			readNode(gameNode, 0);
+
+			commandsRead = 0;
+			readNextFrame();
+		}
+
+		void ReplayReader::readNextFrame() {
+			if ((int64) ftell(file) >= blocksEnd) {
+				nextFrame = -1;
+			} else {
+				nextFrame = (int) readVarUInt();
+			}
+		}
+
+		bool ReplayReader::readFrame(int &frame, vector<NetworkCommand> &commands) {
+			if (nextFrame < 0) {
+				return false;
+			}
+			frame = nextFrame;
+
+			uint64 count = readVarUInt();
+			if ((int64) count > commandCount - commandsRead) {
+				throwError("bad command count");
+			}
+			int64 fields[commandFieldCount];
+			for (uint64 index = 0; index < count; ++index) {
+				for (int field = 0; field < commandFieldCount; ++field) {
+					fields[field] = readVarInt();
+				}
+				NetworkCommand command;
+				setCommandFields(command, fields);
+				commands.push_back(command);
+			}
+			commandsRead += count;
+
+			readNextFrame();
+			return true;
+		}
+
+	}
+} //end namespace
@@ -0,0 +1,234 @@
+//
+//      replay_file.h: binary replay container, written and streamed frame
+//                     by frame
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _GLEST_GAME_REPLAYFILE_H_
+#define _GLEST_GAME_REPLAYFILE_H_
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <winsock.h>
+#endif
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include "network_types.h"
+#include "xml_parser.h"
+#include "data_types.h"
+#include "leak_dumper.h"
+
+using std::vector;
+using std::string;
+using Shared::Xml::XmlNode;
+using Shared::Platform::int64;
+using Shared::Platform::uint64;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		//	Binary replay layout, all integers are varints
+		//	(signed ones zigzag encoded):
+		//
+		//	header	"ZGRP", version, glest version, timestamp and
+		//			the game settings node of the xml replay
+		//	blocks	frame, command count and the fields of each
+		//			command given in that frame, in frame order
+		//	footer	last frame, command count and the seek index:
+		//			frame, file offset and commands before it for
+		//			the first block of every seekIndexFrames frames
+		//			(for tools, the game plays replays from the
+		//			start), then the world checksum at the last
+		//			frame plus one (0 if unknown)
+		//	trailer	footer offset (8 bytes little endian), "ZGRI"
+		//
+		//	Blocks are only ever appended, the footer is written
+		//	when the replay is closed. A game streams its commands
+		//	to a replay kept open while it runs, saving copies it
+		//	and writes the footer on the copy.
+		// =====================================================
+
+		class ReplayFile {
+		public:
+			static const int version = 1;
+			static const int seekIndexFrames = 1200;
+			static const int trailerSize = 12;
+
+			static bool isBinaryReplay(const string &path);
+		};
+
+		// =====================================================
+		//	class ReplayCopy
+		//
+		///	What a closed copy of an open replay needs, taken by
+		///	ReplayWriter::getCopy. write() only reads the bytes the
+		///	replay had then, so it can run on another thread while
+		///	the game keeps adding commands.
+		// =====================================================
+
+		class ReplayCopy {
+		private:
+			friend class ReplayWriter;
+
+			string sourcePath;
+			int64 sourceSize;
+			string path;
+			int blockFrame;
+			vector<NetworkCommand> blockCommands;
+			int lastIndexedFrame;
+			int64 commandCount;
+			vector<int64> seekIndex;
+			int lastWorldFrameCount;
+			int64 lastWorldCRC;
+
+			ReplayCopy();
+
+		public:
+			const string &getPath() const {
+				return path;
+			}
+			void write();
+		};
+
+		// =====================================================
+		//	class ReplayWriter
+		// =====================================================
+
+		class ReplayWriter {
+		private:
+			friend class ReplayCopy;
+
+			FILE *file;
+			string path;
+
+			int blockFrame;
+			vector<NetworkCommand> blockCommands;
+			int lastIndexedFrame;
+			int64 commandCount;
+
+			// frame, offset, commands before
+			vector<int64> seekIndex;
+
+			void writeByte(unsigned char value);
+			void writeVarUInt(uint64 value);
+			void writeVarInt(int64 value);
+			void writeString(const string &value);
+			void writeNode(const XmlNode *node);
+			void writeBlock();
+
+		public:
+			ReplayWriter();
+			~ReplayWriter();
+
+			void open(const string &path, const string &glestVersion,
+				const string &timestamp, const XmlNode *gameNode);
+			// Commands must be added in frame order
+			void addCommand(int frame, const NetworkCommand &command);
+			void close(int lastWorldFrameCount, int64 lastWorldCRC = -1);
+			// A closed replay of everything added so far for copyPath,
+			// written by its write(), this writer stays open. The
+			// caller deletes it
+			ReplayCopy *getCopy(const string &copyPath, int lastWorldFrameCount,
+				int64 lastWorldCRC = -1);
+			// getCopy written right away
+			void saveCopy(const string &copyPath, int lastWorldFrameCount,
+				int64 lastWorldCRC = -1);
+
+			const string &getPath() const {
+				return path;
+			}
+		};
+
+		// =====================================================
+		//	class ReplayReader
+		//
+		///	Reads the header and the seek index when opened, the
+		///	command blocks one at a time as they are asked for.
+		// =====================================================
+
+		class ReplayReader {
+		private:
+			FILE *file;
+			string path;
+
+			string glestVersion;
+			string timestamp;
+			XmlNode *gameNode;
+			int lastWorldFrameCount;
+			int64 lastWorldCRC;
+			int64 commandCount;
+			int64 commandsRead;
+			int64 blocksEnd;
+
+			int nextFrame;
+
+			int readByte();
+			uint64 readVarUInt();
+			int64 readVarInt();
+			string readString();
+			void readNode(XmlNode *node, int depth);
+			void readNextFrame();
+			void throwError(const string &message) const;
+
+		public:
+			ReplayReader();
+			~ReplayReader();
+
+			void open(const string &path);
+			void close();
+
+			const string &getGlestVersion() const {
+				return glestVersion;
+			}
+			const string &getTimestamp() const {
+				return timestamp;
+			}
+			const XmlNode *getGameNode() const {
+				return gameNode;
+			}
+			int getLastWorldFrameCount() const {
+				return lastWorldFrameCount;
+			}
+			// -1 when the replay didn't record it
+			int64 getLastWorldCRC() const {
+				return lastWorldCRC;
+			}
+			int64 getCommandCount() const {
+				return commandCount;
+			}
+			int64 getCommandsRead() const {
+				return commandsRead;
+			}
+
+			// Frame of the next block, -1 at the end of the replay
+			int getNextFrame() const {
+				return nextFrame;
+			}
+			// Appends the commands of the next block to commands
+			bool readFrame(int &frame, vector<NetworkCommand> &commands);
+		};
+
+	}
+} //end namespace
+
+#endif
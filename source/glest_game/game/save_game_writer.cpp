@@ -0,0 +1,173 @@
+//
+//      save_game_writer.cpp: writes saved games to disk on a worker thread
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#include "save_game_writer.h"
+
+#include "compression_utils.h"
+#include "platform_util.h"
+#include "util.h"
+#include "leak_dumper.h"
+
+using namespace Shared::Util;
+using namespace Shared::PlatformCommon;
+using namespace Shared::CompressionUtil;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		//	class SaveGameWriter
+		// =====================================================
+
+		SaveGameWriter::SaveGameWriter() : mutexJobs(CODE_AT_LINE) {
+			writing = false;
+			writerThread = new SimpleTaskThread(this, 0, 25, true);
+			writerThread->setUniqueID(CODE_AT_LINE);
+			writerThread->start();
+		}
+
+		SaveGameWriter::~SaveGameWriter() {
+			// Whatever the thread hasn't started on is written here, then
+			// the one it is writing is waited for
+			for (Job *job = takePendingJob(); job != NULL; job = takePendingJob()) {
+				writeJob(job);
+			}
+			for (;;) {
+				MutexSafeWrapper safeMutex(&mutexJobs, CODE_AT_LINE);
+				if (writing == false) {
+					break;
+				}
+				safeMutex.ReleaseLock();
+				sleep(10);
+			}
+
+			writerThread->setSimpleTaskInterfaceValid(false);
+			writerThread->signalQuit();
+			if (writerThread->shutdownAndWait() == true) {
+				delete writerThread;
+			}
+			writerThread = NULL;
+		}
+
+		void SaveGameWriter::addJob(XmlTree *xmlTree, const string &file, bool binary,
+			const string &compressedFile) {
+			Job *job = new Job();
+			job->xmlTree = xmlTree;
+			job->file = file;
+			job->binary = binary;
+			job->compressedFile = compressedFile;
+
+			MutexSafeWrapper safeMutex(&mutexJobs, CODE_AT_LINE);
+			pendingJobs.push_back(job);
+			safeMutex.ReleaseLock();
+
+			writerThread->setTaskSignalled(true);
+		}
+
+		void SaveGameWriter::addReplayJob(ReplayCopy *replayCopy) {
+			Job *job = new Job();
+			job->replayCopy = replayCopy;
+			job->file = replayCopy->getPath();
+
+			MutexSafeWrapper safeMutex(&mutexJobs, CODE_AT_LINE);
+			pendingJobs.push_back(job);
+			safeMutex.ReleaseLock();
+
+			writerThread->setTaskSignalled(true);
+		}
+
+		bool SaveGameWriter::hasPendingJobs() {
+			MutexSafeWrapper safeMutex(&mutexJobs, CODE_AT_LINE);
+			return pendingJobs.empty() == false || writing == true;
+		}
+
+		vector<SaveGameWriter::Result> SaveGameWriter::getFinishedJobs() {
+			vector<Result> result;
+			MutexSafeWrapper safeMutex(&mutexJobs, CODE_AT_LINE);
+			result.swap(finishedJobs);
+			return result;
+		}
+
+		SaveGameWriter::Job *SaveGameWriter::takePendingJob() {
+			MutexSafeWrapper safeMutex(&mutexJobs, CODE_AT_LINE);
+			if (pendingJobs.empty() == true) {
+				return NULL;
+			}
+			Job *job = pendingJobs.front();
+			pendingJobs.pop_front();
+			return job;
+		}
+
+		void SaveGameWriter::writeJob(Job *job) {
+			Result result;
+			result.file = job->file;
+			result.compressedFile = job->compressedFile;
+			result.replay = (job->replayCopy != NULL);
+
+			Chrono chrono(true);
+			try {
+				if (job->replayCopy != NULL) {
+					job->replayCopy->write();
+				} else if (job->binary == true) {
+					job->xmlTree->saveBinary(job->file);
+				} else {
+					job->xmlTree->save(job->file);
+				}
+
+				if (job->compressedFile != "") {
+					bool compressed_result = compressFileToZIPFile(job->file, job->compressedFile);
+					if (SystemFlags::VERBOSE_MODE_ENABLED) printf("Saved game [%s] compressed to [%s] returned: %d\n", job->file.c_str(), job->compressedFile.c_str(), compressed_result);
+				}
+			} catch (const exception &ex) {
+				SystemFlags::OutputDebug(SystemFlags::debugError, "In [%s::%s Line: %d] Error saving [%s]: %s\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, job->file.c_str(), ex.what());
+				result.error = ex.what();
+			}
+			if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled) SystemFlags::OutputDebug(SystemFlags::debugPerformance, "In [%s::%s Line: %d] writing [%s] took msecs: " MG_I64_SPECIFIER "\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, job->file.c_str(), chrono.getMillis());
+
+			delete job->xmlTree;
+			delete job->replayCopy;
+			delete job;
+
+			MutexSafeWrapper safeMutex(&mutexJobs, CODE_AT_LINE);
+			finishedJobs.push_back(result);
+		}
+
+		void SaveGameWriter::simpleTask(BaseThread *callingThread, void *userdata) {
+			for (;;) {
+				MutexSafeWrapper safeMutex(&mutexJobs, CODE_AT_LINE);
+				if (pendingJobs.empty() == true) {
+					break;
+				}
+				Job *job = pendingJobs.front();
+				pendingJobs.pop_front();
+				writing = true;
+				safeMutex.ReleaseLock();
+
+				writeJob(job);
+
+				safeMutex.Lock();
+				writing = false;
+			}
+		}
+
+	}
+} //end namespace
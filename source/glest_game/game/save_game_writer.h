@@ -0,0 +1,115 @@
+//
+//      save_game_writer.h: writes saved games to disk on a worker thread
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _GLEST_GAME_SAVEGAMEWRITER_H_
+#define _GLEST_GAME_SAVEGAMEWRITER_H_
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <winsock.h>
+#endif
+
+#include <deque>
+#include <vector>
+#include <string>
+#include "simple_threads.h"
+#include "xml_parser.h"
+#include "replay_file.h"
+#include "leak_dumper.h"
+
+using std::deque;
+using std::vector;
+using std::string;
+using Shared::Xml::XmlTree;
+using Shared::PlatformCommon::BaseThread;
+using Shared::PlatformCommon::SimpleTaskThread;
+using Shared::PlatformCommon::SimpleTaskCallbackInterface;
+using Shared::Platform::Mutex;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		//	class SaveGameWriter
+		//
+		///	The game builds the node tree of a saved game within one
+		///	frame, this writes it out (and zips it for network games)
+		///	on its own thread so the game loop doesn't wait on disk.
+		///	The replay copy saved with a game is written here too.
+		// =====================================================
+
+		class SaveGameWriter : public SimpleTaskCallbackInterface {
+		public:
+			class Result {
+			public:
+				string file;
+				// set for the saved games sent to joining clients
+				string compressedFile;
+				// a replay copy rather than the saved game itself
+				bool replay;
+				string error;
+			};
+
+		private:
+			class Job {
+			public:
+				Job() : xmlTree(NULL), replayCopy(NULL), binary(true) {
+				}
+
+				XmlTree *xmlTree;
+				ReplayCopy *replayCopy;
+				string file;
+				bool binary;
+				string compressedFile;
+			};
+
+			Mutex mutexJobs;
+			deque<Job *> pendingJobs;
+			vector<Result> finishedJobs;
+			// the thread has taken a job from pendingJobs
+			bool writing;
+			SimpleTaskThread *writerThread;
+
+			Job *takePendingJob();
+			void writeJob(Job *job);
+
+		public:
+			SaveGameWriter();
+			// Writes the saved games that are still pending first
+			virtual ~SaveGameWriter();
+
+			// Takes ownership of xmlTree, which nothing may change anymore
+			void addJob(XmlTree *xmlTree, const string &file, bool binary,
+				const string &compressedFile = "");
+			// Takes ownership of replayCopy
+			void addReplayJob(ReplayCopy *replayCopy);
+			bool hasPendingJobs();
+			// The saved games written since the last call
+			vector<Result> getFinishedJobs();
+
+			virtual void simpleTask(BaseThread *callingThread, void *userdata);
+		};
+
+	}
+} //end namespace
+
+#endif
@@ -118,6 +118,7 @@ namespace Glest {
 		const char *Config::frustumPicking = "frustum";
 
 		map < string, string > Config::customRuntimeProperties;
+		int Config::changeCount = 0;
 
 		// =====================================================
 		//      class Config
@@ -436,6 +437,7 @@ namespace Glest {
 
 			Config & oldconfig = configList.find(type.first)->second;
 			CopyAll(&newconfig, &oldconfig);
+			changeCount++;
 
 			if (SystemFlags::VERBOSE_MODE_ENABLED)
 				if (SystemFlags::getSystemSettingType(SystemFlags::debugSystem).
@@ -671,6 +673,7 @@ namespace Glest {
 		//}
 
 		void Config::setInt(const string & key, int value, bool tempBuffer) {
+			changeCount++;
 			if (tempBuffer == true) {
 				tempProperties.setInt(key, value);
 				return;
@@ -683,6 +686,7 @@ namespace Glest {
 		}
 
 		void Config::setBool(const string & key, bool value, bool tempBuffer) {
+			changeCount++;
 			if (tempBuffer == true) {
 				tempProperties.setBool(key, value);
 				return;
@@ -697,6 +701,7 @@ namespace Glest {
 		}
 
 		void Config::setFloat(const string & key, float value, bool tempBuffer) {
+			changeCount++;
 			if (tempBuffer == true) {
 				tempProperties.setFloat(key, value);
 				return;
@@ -712,6 +717,7 @@ namespace Glest {
 
 		void Config::setString(const string & key, const string & value,
 			bool tempBuffer) {
+			changeCount++;
 			if (tempBuffer == true) {
 				tempProperties.setString(key, value);
 				return;
@@ -775,6 +781,7 @@ namespace Glest {
 
 		void Config::setUserProperties(const vector < pair < string,
 			string > >&valueList) {
+			changeCount++;
 			Properties & propertiesObj = properties.second;
 
 			for (unsigned int idx = 0; idx < valueList.size(); ++idx) {
@@ -71,6 +71,8 @@ namespace Glest {
 			static const char *glestuser_ini_filename;
 
 			static map < string, string > customRuntimeProperties;
+			// bumped by every reload and set, see getChangeCount
+			static int changeCount;
 
 		public:
 
@@ -156,6 +158,12 @@ namespace Glest {
 
 			string toString();
 
+			// Lets a value read on a hot path be kept until the config
+			// changes, compare with the count it was read at
+			static int getChangeCount() {
+				return changeCount;
+			}
+
 			static string getCustomRuntimeProperty(string key) {
 				return customRuntimeProperties[key];
 			}
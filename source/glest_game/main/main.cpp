@@ -84,6 +84,9 @@
 #include <stdlib.h>
 #include "network_message.h"
 #include "network_protocol.h"
+#include "replay_file.h"
+#include "replay_benchmark.h"
+#include "cooked_asset_cache.h"
 #include "conversion.h"
 #include "gen_uuid.h"
 //#include "intro.h"
@@ -5306,6 +5309,319 @@ namespace
 			return return_value;
 		}
 
+		int
+			handleBenchmarkCommandListCommand(int argc, char **argv) {
+			int
+				foundParamIndIndex = -1;
+			hasCommandArgument(argc, argv,
+				string(GAME_ARGS[GAME_ARG_BENCHMARK_COMMAND_LIST]) +
+				string("="), &foundParamIndIndex);
+			if (foundParamIndIndex < 0) {
+				hasCommandArgument(argc, argv,
+					string(GAME_ARGS[GAME_ARG_BENCHMARK_COMMAND_LIST]),
+					&foundParamIndIndex);
+			}
+			string
+				paramValue = argv[foundParamIndIndex];
+			vector < string > paramPartTokens;
+			Tokenize(paramValue, paramPartTokens, "=");
+			if (paramPartTokens.size() < 2 || paramPartTokens[1].length() == 0) {
+				printf
+				("\nInvalid missing replay file specified on commandline [%s]\n\n",
+					argv[foundParamIndIndex]);
+				return 1;
+			}
+
+			string
+				replayFile = paramPartTokens[1];
+			if (fileExists(replayFile) == false
+				&& fileExists(replayFile + ".replay") == true) {
+				replayFile += ".replay";
+			}
+			if (fileExists(replayFile) == false) {
+				printf("Replay file [%s] was NOT FOUND\n", replayFile.c_str());
+				return 1;
+			}
+
+			try {
+				GameSettings gameSettings;
+				int
+					lastFrame = 0;
+				std::map < int, vector < NetworkCommand > >commandsByFrame;
+				if (ReplayFile::isBinaryReplay(replayFile) == true) {
+					ReplayReader replayReader;
+					replayReader.open(replayFile);
+					gameSettings.loadGame(replayReader.getGameNode());
+					lastFrame = replayReader.getLastWorldFrameCount();
+
+					int
+						frame = 0;
+					vector < NetworkCommand > commands;
+					for (; replayReader.readFrame(frame, commands) == true;
+						commands.clear()) {
+						vector < NetworkCommand > &frameCommands = commandsByFrame[frame];
+						frameCommands.insert(frameCommands.end(), commands.begin(),
+							commands.end());
+						lastFrame = max(lastFrame, frame);
+					}
+				} else {
+					XmlTree xmlTreeReplay(XML_RAPIDXML_ENGINE);
+					std::map < string, string > mapExtraTagReplacementValues;
+					xmlTreeReplay.load(replayFile,
+						Properties::getTagReplacementValues
+						(&mapExtraTagReplacementValues), true);
+
+					const XmlNode *rootNode = xmlTreeReplay.getRootNode();
+					if (rootNode->hasChild("zetaglest-saved-game") == true) {
+						rootNode = rootNode->getChild("zetaglest-saved-game");
+					}
+					XmlNode *gameNode = rootNode->getChild("Game");
+
+					gameSettings.loadGame(gameNode);
+					lastFrame =
+						gameNode->getAttribute("LastWorldFrameCount")->getIntValue();
+
+					vector < XmlNode * >networkCommandNodeList =
+						gameNode->getChildList("NetworkCommand");
+					for (unsigned int i = 0; i < networkCommandNodeList.size(); ++i) {
+						XmlNode *node = networkCommandNodeList[i];
+						NetworkCommand command;
+						command.loadGame(node);
+						int
+							frame =
+							node->getAttribute("worldFrameCount")->getIntValue();
+						commandsByFrame[frame].push_back(command);
+						lastFrame = max(lastFrame, frame);
+					}
+				}
+				int
+					framePeriod = max(gameSettings.getNetworkFramePeriod(), 1);
+
+				// Replay the recorded commands as the server would broadcast
+				// them: one list per network frame holding everything given
+				// since the previous one.
+				enum {
+					formatRaw, formatPacked, formatCompact, formatCompressed,
+					formatCount
+				};
+				const char *
+					formatNames[formatCount] = {
+					"old protocol", "new protocol (packed)",
+					"compact", "compact + compressed"
+				};
+				uint64
+					totalBytes[formatCount] = { 0 };
+				uint64
+					commandBytes[formatCount] = { 0 };
+				unsigned int
+					packetCount = 0;
+				unsigned int
+					commandPacketCount = 0;
+				unsigned int
+					commandCount = 0;
+
+				std::map < int, vector < NetworkCommand > >::iterator
+					iterMap = commandsByFrame.begin();
+				for (int frame = framePeriod;
+					frame < lastFrame + framePeriod; frame += framePeriod) {
+					NetworkMessageCommandList networkMessageCommandList(frame);
+					for (; iterMap != commandsByFrame.end()
+						&& iterMap->first <= frame; ++iterMap) {
+						for (unsigned int i = 0; i < iterMap->second.size(); ++i) {
+							networkMessageCommandList.addCommand(&iterMap->
+								second[i]);
+						}
+					}
+
+					unsigned int
+						sizes[formatCount];
+					sizes[formatRaw] =
+						networkMessageCommandList.getLegacyWireSize(false);
+					sizes[formatPacked] =
+						networkMessageCommandList.getLegacyWireSize(true);
+					sizes[formatCompact] =
+						networkMessageCommandList.getCompactWireSize(false);
+					sizes[formatCompressed] =
+						networkMessageCommandList.getCompactWireSize(true);
+
+					packetCount++;
+					for (int format = 0; format < formatCount; ++format) {
+						totalBytes[format] += sizes[format];
+					}
+					if (networkMessageCommandList.getCommandCount() > 0) {
+						commandPacketCount++;
+						commandCount += networkMessageCommandList.getCommandCount();
+						for (int format = 0; format < formatCount; ++format) {
+							commandBytes[format] += sizes[format];
+						}
+					}
+				}
+
+				printf("Replay [%s]: %d frames, network frame period %d\n",
+					replayFile.c_str(), lastFrame, framePeriod);
+				printf("%u command lists, %u of them with %u commands\n\n",
+					packetCount, commandPacketCount, commandCount);
+				printf("%-24s %12s %10s %14s %10s\n", "format", "total bytes",
+					"ratio", "command lists", "bytes/list");
+				for (int format = 0; format < formatCount; ++format) {
+					double
+						ratio =
+						(totalBytes[formatRaw] >
+							0 ? (double) totalBytes[format] /
+							(double) totalBytes[formatRaw] : 0.0);
+					double
+						perCommandList =
+						(commandPacketCount >
+							0 ? (double) commandBytes[format] /
+							(double) commandPacketCount : 0.0);
+					printf("%-24s %12llu %10.3f %14llu %10.1f\n",
+						formatNames[format],
+						(unsigned long long) totalBytes[format], ratio,
+						(unsigned long long) commandBytes[format],
+						perCommandList);
+				}
+			}
+			catch(const exception & ex) {
+				printf("Error reading replay file [%s]: %s\n", replayFile.c_str(),
+					ex.what());
+				return 1;
+			}
+
+			return 0;
+		}
+
+		int
+			handleBenchmarkNetworkMessagesCommand(int argc, char **argv) {
+#if defined(__linux__)
+			int
+				foundParamIndIndex = -1;
+			hasCommandArgument(argc, argv,
+				string(GAME_ARGS[GAME_ARG_BENCHMARK_NETWORK_MESSAGES]) +
+				string("="), &foundParamIndIndex);
+			int
+				clientCount = 4;
+			if (foundParamIndIndex >= 0) {
+				string
+					paramValue = argv[foundParamIndIndex];
+				vector < string > paramPartTokens;
+				Tokenize(paramValue, paramPartTokens, "=");
+				if (paramPartTokens.size() >= 2 && paramPartTokens[1].length() > 0) {
+					clientCount = strToInt(paramPartTokens[1]);
+				}
+			}
+			if (clientCount < 1 || clientCount > GameConstants::maxPlayers) {
+				printf("\nInvalid client count specified on commandline [%d], must be 1 to %d\n\n",
+					clientCount, GameConstants::maxPlayers);
+				return 1;
+			}
+
+			std::vector < Socket * >clients;
+			std::vector < Socket * >serverSockets;
+			int
+				result = 0;
+			bool
+				oldProtocol = NetworkMessage::useOldProtocol;
+			try {
+				// One connected pair of sockets per simulated client
+				for (int index = 0; index < clientCount; ++index) {
+					int
+						socketPair[2];
+					if (socketpair(AF_UNIX, SOCK_STREAM, 0, socketPair) != 0) {
+						throw megaglest_runtime_error("Could not create the sockets of simulated client " + intToStr(index));
+					}
+					serverSockets.push_back(new Socket(socketPair[0]));
+					clients.push_back(new Socket(socketPair[1]));
+				}
+
+				// The server broadcasting a command list each network
+				// frame, with the lists of a busy game
+				const int
+					frameCount = 5000;
+				enum {
+					formatRaw, formatPacked, formatCompact, formatCount
+				};
+				const char *
+					formatNames[formatCount] = {
+					"old protocol", "new protocol (packed)", "compact"
+				};
+
+				printf("%d command lists sent to %d simulated clients over socket pairs\n\n",
+					frameCount, clientCount);
+				printf("%-24s %10s %14s %12s %12s\n", "format", "messages",
+					"buffer allocs", "allocs/msg", "us/msg");
+				for (int format = 0; format < formatCount; ++format) {
+					NetworkMessage::useOldProtocol = (format == formatRaw);
+
+					int64
+						messages = 0;
+					int64
+						allocationsStart = NetworkMessageBuffer::getAllocationCount();
+					int64
+						sendMicros = 0;
+					char
+						drain[8192];
+					for (int frame = 0; frame < frameCount; ++frame) {
+						NetworkMessageCommandList
+							networkMessageCommandList(frame, format == formatCompact);
+						int
+							commandCount = frame % 7;
+						for (int index = 0; index < commandCount; ++index) {
+							NetworkCommand
+								command;
+							command.networkCommandType = nctGiveCommand;
+							command.unitId = 1000 + frame % 50 + index;
+							command.commandTypeId = 3;
+							command.positionX = (int16) (frame % 128);
+							command.positionY = (int16) (index * 9);
+							command.targetId = -1;
+							command.fromFactionIndex = (int8) (index % clientCount);
+							networkMessageCommandList.addCommand(&command);
+						}
+
+						Chrono
+							chronoSend(true);
+						for (unsigned int index = 0; index < serverSockets.size(); ++index) {
+							networkMessageCommandList.send(serverSockets[index]);
+							messages++;
+						}
+						sendMicros += chronoSend.getMicros();
+
+						for (unsigned int index = 0; index < clients.size(); ++index) {
+							for (; Socket::hasDataToRead(clients[index]->getSocketId()) == true;) {
+								if (clients[index]->receive(drain, sizeof(drain), false) <= 0) {
+									break;
+								}
+							}
+						}
+					}
+					int64
+						allocations = NetworkMessageBuffer::getAllocationCount() - allocationsStart;
+					printf("%-24s %10lld %14lld %12.3f %12.2f\n", formatNames[format],
+						(long long) messages, (long long) allocations,
+						(double) allocations / (double) messages,
+						(double) sendMicros / (double) messages);
+				}
+			}
+			catch(const exception & ex) {
+				printf("Error running network message benchmark: %s\n", ex.what());
+				result = 1;
+			}
+			NetworkMessage::useOldProtocol = oldProtocol;
+
+			for (unsigned int index = 0; index < serverSockets.size(); ++index) {
+				delete serverSockets[index];
+			}
+			for (unsigned int index = 0; index < clients.size(); ++index) {
+				delete clients[index];
+			}
+			return result;
+#else
+			printf("\n%s is only available on linux\n\n",
+				GAME_ARGS[GAME_ARG_BENCHMARK_NETWORK_MESSAGES]);
+			return 1;
+#endif
+		}
+
 		int
 			handleListDataCommand(int argc, char **argv) {
 			int
@@ -5814,6 +6130,64 @@ namespace
 				}
 			}
 
+			string
+				benchmarkReplayFile = "";
+			if (hasCommandArgument
+			(argc, argv,
+				string(GAME_ARGS[GAME_ARG_BENCHMARK_REPLAY])) == true) {
+				int
+					foundParamIndIndex = -1;
+				hasCommandArgument(argc, argv,
+					string(GAME_ARGS[GAME_ARG_BENCHMARK_REPLAY]) +
+					string("="), &foundParamIndIndex);
+				if (foundParamIndIndex < 0) {
+					hasCommandArgument(argc, argv,
+						string(GAME_ARGS[GAME_ARG_BENCHMARK_REPLAY]),
+						&foundParamIndIndex);
+				}
+				string
+					paramValue = argv[foundParamIndIndex];
+				vector < string > paramPartTokens;
+				Tokenize(paramValue, paramPartTokens, "=");
+				if (paramPartTokens.size() < 2 || paramPartTokens[1].length() == 0) {
+					printf
+					("\nInvalid missing replay file specified on commandline [%s]\n\n",
+						argv[foundParamIndIndex]);
+					printParameterHelp(argv[0], false);
+					return 1;
+				}
+				benchmarkReplayFile = paramPartTokens[1];
+				// The saved game is loaded by its name, the replay is next to it
+				if (EndsWith(benchmarkReplayFile, ".replay") == true) {
+					benchmarkReplayFile.erase(benchmarkReplayFile.length() - 7);
+				}
+				if (fileExists(benchmarkReplayFile + ".replay") == false) {
+					printf("\nReplay file not found [%s.replay]\n\n",
+						benchmarkReplayFile.c_str());
+					return 1;
+				}
+				ReplayBenchmark::setOutput(paramPartTokens.size() >= 3
+					&& paramPartTokens[2].length() > 0 ? paramPartTokens[2] : "json");
+				if (paramPartTokens.size() >= 4 && paramPartTokens[3].length() > 0) {
+					string
+						thinkMode = paramPartTokens[3];
+					if (thinkMode != "serial" && thinkMode != "threaded") {
+						printf
+						("\nInvalid think mode specified on commandline [%s], must be serial or threaded\n\n",
+							thinkMode.c_str());
+						return 1;
+					}
+					ReplayBenchmark::setThinkMode(thinkMode);
+					Config::getInstance().setBool("ThreadedUnitThink",
+						thinkMode == "threaded", true);
+				}
+
+				// Run like a headless server that quits after its game
+				GlobalStaticFlags::setIsNonGraphicalModeEnabled(true);
+				Program::setWantShutdownApplicationAfterGame(true);
+				disableheadless_console = true;
+			}
+
 			if (hasCommandArgument(argc, argv, GAME_ARGS[GAME_ARG_SERVER_TITLE]) ==
 				true) {
 				int
@@ -6368,6 +6742,27 @@ namespace
 				}
 				setCRCCacheFilePath(crcCachePath);
 
+				// Parsed xml and decoded images of the game data, read back
+				// on later runs instead of parsing and decoding again, kept
+				// under CookedAssetCacheMaxMB by dropping the least used.
+				// Images only with CookedAssetCacheImages until measured
+				if (config.getBool("CookedAssetCache", "true") == true) {
+					const PathType
+						cookedPathTypes[] = { ptTechs, ptTilesets, ptScenarios, ptTutorials };
+					vector < string > cookedSourcePaths;
+					for (unsigned int i = 0;
+						i < sizeof(cookedPathTypes) / sizeof(cookedPathTypes[0]); ++i) {
+						vector < string > pathList =
+							config.getPathListForType(cookedPathTypes[i]);
+						cookedSourcePaths.insert(cookedSourcePaths.end(),
+							pathList.begin(), pathList.end());
+					}
+					CookedAssetCache::setPath(crcCachePath + "cooked/",
+						cookedSourcePaths,
+						(int64) config.getInt("CookedAssetCacheMaxMB", "256") * 1024 * 1024);
+					CookedAssetCache::setCookImages(config.getBool("CookedAssetCacheImages", "false"));
+				}
+
 				string
 					savedGamePath = userData + "saved/";
 				if (isdir(savedGamePath.c_str()) == false) {
@@ -6499,7 +6894,7 @@ namespace
 					|| hasCommandArgument(argc, argv,
 						string(GAME_ARGS
 							[GAME_ARG_MASTERSERVER_MODE])) ==
-					true) {
+					true || benchmarkReplayFile != "") {
 					config.setString("FactorySound", "None", true);
 					if (hasCommandArgument
 					(argc, argv,
@@ -6904,6 +7299,8 @@ namespace
 					if (SystemFlags::VERBOSE_MODE_ENABLED)
 						printf("**INFO** Disabling Interpolation\n");
 				}
+				InterpolationData::setCacheSize(config.getInt("InterpolationCacheSize", "4"));
+				InterpolationData::setCacheSteps(config.getInt("InterpolationCacheSteps", "16"));
 
 
 				if (config.getBool("EnableVSynch", "false") == true) {
@@ -7180,6 +7577,16 @@ namespace
 					return handleShowCRCValuesCommand(argc, argv);
 				}
 
+				if (hasCommandArgument
+				(argc, argv, GAME_ARGS[GAME_ARG_BENCHMARK_COMMAND_LIST]) == true) {
+					return handleBenchmarkCommandListCommand(argc, argv);
+				}
+
+				if (hasCommandArgument
+				(argc, argv, GAME_ARGS[GAME_ARG_BENCHMARK_NETWORK_MESSAGES]) == true) {
+					return handleBenchmarkNetworkMessagesCommand(argc, argv);
+				}
+
 				if (hasCommandArgument(argc, argv, GAME_ARGS[GAME_ARG_LIST_MAPS]) ==
 					true
 					|| hasCommandArgument(argc, argv,
@@ -7272,6 +7679,9 @@ namespace
 				} else if (hasCommandArgument(argc, argv, string(GAME_ARGS[GAME_ARG_AUTOSTART_LASTGAME])) == true) {
 					program->initServer(mainWindow, true, false);
 					gameInitialized = true;
+				} else if (benchmarkReplayFile != "") {
+					program->initSavedGame(mainWindow, true, benchmarkReplayFile);
+					gameInitialized = true;
 				} else if (hasCommandArgument(argc, argv, string(GAME_ARGS[GAME_ARG_AUTOSTART_LAST_SAVED_GAME])) == true) {
 					string
 						fileName = "";
@@ -8167,6 +8577,9 @@ namespace
 				"In [%s::%s Line: %d]\n", __FILE__,
 				__FUNCTION__, __LINE__);
 
+			if (ReplayBenchmark::getFailed() == true) {
+				return 1;
+			}
 			return 0;
 		}
 
@@ -0,0 +1,259 @@
+//
+//      client_frame_scheduler.cpp: paces a network client's simulation to the
+//                                  arrival of the server's command lists
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#include "client_frame_scheduler.h"
+
+#include <deque>
+#include "game_constants.h"
+#include "randomgen.h"
+#include "leak_dumper.h"
+
+using std::deque;
+using Shared::Util::RandomGen;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		//	class ClientFrameScheduler
+		// =====================================================
+
+		ClientFrameScheduler::ClientFrameScheduler() {
+			init(1, 1);
+		}
+
+		void ClientFrameScheduler::init(int networkFramePeriod, int updateFps) {
+			this->networkFramePeriod = (networkFramePeriod > 0 ? networkFramePeriod : 1);
+			this->updateFps = (updateFps > 0 ? updateFps : 1);
+			// Never hold back more than a few command lists worth of frames
+			this->maxLeadFrames = this->networkFramePeriod * 3;
+
+			lastArrivalFrame = -1;
+			lastArrivalMillis = 0;
+			jitterScaled = 0;
+
+			windowMinLead = -1;
+			windowKeyframe = -1;
+			windowCorrected = false;
+			surplusWindows = 0;
+			surplusMinLead = 0;
+
+			slowDownFrames = 0;
+			speedUpFrames = 0;
+			tickCount = 0;
+		}
+
+		void ClientFrameScheduler::addCommandListArrival(int frame, int64 millis) {
+			if (lastArrivalFrame >= 0 && frame > lastArrivalFrame) {
+				// How much later or earlier than the frames in between say
+				// this one came, the mean of that is the jitter
+				int64 expectedMillis = (int64) (frame - lastArrivalFrame) * 1000 / updateFps;
+				int64 deviation = (millis - lastArrivalMillis) - expectedMillis;
+				if (deviation < 0) {
+					deviation = -deviation;
+				}
+				jitterScaled += deviation - ((jitterScaled + 8) >> 4);
+			}
+			if (frame > lastArrivalFrame) {
+				lastArrivalFrame = frame;
+				lastArrivalMillis = millis;
+			}
+		}
+
+		int ClientFrameScheduler::getJitterMillis() const {
+			return (int) (jitterScaled >> 4);
+		}
+
+		int ClientFrameScheduler::getTargetLeadFrames() const {
+			int jitterFrames = (getJitterMillis() * updateFps + 999) / 1000;
+			int target = jitterFrames * 2 + 1;
+			if (target > maxLeadFrames) {
+				target = maxLeadFrames;
+			}
+			return target;
+		}
+
+		int ClientFrameScheduler::getUpdateLoops(int updateLoops, int frame, int lastServerFrame) {
+			if (updateLoops <= 0 || lastServerFrame <= 0) {
+				return updateLoops;
+			}
+
+			// The frames the client can still run before it waits on the
+			// next command list
+			int lead = lastServerFrame + networkFramePeriod - frame;
+			int keyframe = frame / networkFramePeriod;
+
+			if (keyframe != windowKeyframe) {
+				// The lowest lead of a keyframe is the one just before the next
+				// command list came, only those of windows that ran at the
+				// normal speed say how much is buffered
+				if (windowKeyframe >= 0 && windowCorrected == false &&
+					slowDownFrames == 0 && speedUpFrames == 0) {
+					int target = getTargetLeadFrames();
+					if (windowMinLead < target) {
+						slowDownFrames = target - windowMinLead;
+						surplusWindows = 0;
+					} else if (windowMinLead > target + networkFramePeriod / 2) {
+						// Only a surplus that lasted a few keyframes is given
+						// back, and only half of it, the arrivals seldom stay
+						// that even for long
+						if (surplusWindows == 0 || windowMinLead < surplusMinLead) {
+							surplusMinLead = windowMinLead;
+						}
+						if (++surplusWindows >= surplusWindowsToSpeedUp) {
+							speedUpFrames = (surplusMinLead - target) / 2;
+							surplusWindows = 0;
+						}
+					} else {
+						surplusWindows = 0;
+					}
+				}
+				windowKeyframe = keyframe;
+				windowMinLead = lead;
+				windowCorrected = false;
+			} else if (lead < windowMinLead) {
+				windowMinLead = lead;
+			}
+
+			// Spread the corrections out so the game never visibly stops
+			tickCount++;
+			if (tickCount % slowDownSpacing != 0) {
+				return updateLoops;
+			}
+			if (slowDownFrames > 0) {
+				slowDownFrames--;
+				windowCorrected = true;
+				return updateLoops - 1;
+			}
+			if (speedUpFrames > 0 && lead > 1) {
+				speedUpFrames--;
+				windowCorrected = true;
+				return updateLoops + 1;
+			}
+			return updateLoops;
+		}
+
+		// =====================================================
+		//	class ClientLagSimulation
+		// =====================================================
+
+		ClientLagSimulation::ClientLagSimulation() {
+			stalls = 0;
+			stallMillis = 0;
+			longestStallMillis = 0;
+			droppedUpdates = 0;
+			addedUpdates = 0;
+			averageLead = 0;
+			jitterMillis = 0;
+			targetLeadFrames = 0;
+		}
+
+		void ClientLagSimulation::run(int latencyMillis, int jitterMillis, bool adaptive,
+			int seconds, int seed) {
+			*this = ClientLagSimulation();
+
+			const int networkFramePeriod = GameConstants::networkFramePeriod;
+			const int frameMillis = 1000 / GameConstants::updateFps;
+			const int lastFrame = seconds * GameConstants::updateFps;
+
+			// The server sends each keyframe's command list as it gets
+			// there, over TCP nothing overtakes what was sent before it
+			deque<std::pair<int, int64> > arrivals;
+			RandomGen random;
+			random.init(seed);
+			int64 lastArrival = 0;
+			for (int frame = 0; frame <= lastFrame + networkFramePeriod; frame += networkFramePeriod) {
+				int64 arrival = (int64) frame * frameMillis + latencyMillis;
+				if (jitterMillis > 0) {
+					arrival += random.randRange(0, jitterMillis);
+				}
+				if (arrival < lastArrival) {
+					arrival = lastArrival;
+				}
+				lastArrival = arrival;
+				arrivals.push_back(std::make_pair(frame, arrival));
+			}
+
+			ClientFrameScheduler scheduler;
+			scheduler.init(networkFramePeriod, GameConstants::updateFps);
+
+			int64 now = 0;
+			int frame = 0;
+			int lastServerFrame = -1;
+			int64 leadSum = 0;
+			int64 ticks = 0;
+			for (; frame < lastFrame; ++ticks) {
+				// Like the game's update timer, ticks missed while waiting
+				// are run right after to catch up with the clock
+				if (now < ticks * frameMillis) {
+					now = ticks * frameMillis;
+				}
+				while (arrivals.empty() == false && arrivals.front().second <= now) {
+					lastServerFrame = arrivals.front().first;
+					scheduler.addCommandListArrival(lastServerFrame, arrivals.front().second);
+					arrivals.pop_front();
+				}
+
+				int updateLoops = 1;
+				if (adaptive == true) {
+					updateLoops = scheduler.getUpdateLoops(updateLoops, frame, lastServerFrame);
+				}
+				if (updateLoops < 1) {
+					droppedUpdates++;
+				} else if (updateLoops > 1) {
+					addedUpdates += updateLoops - 1;
+				}
+				leadSum += lastServerFrame + networkFramePeriod - frame;
+
+				for (int loop = 0; loop < updateLoops && frame < lastFrame; ++loop) {
+					if (frame % networkFramePeriod == 0 && frame > lastServerFrame) {
+						// Blocked until the keyframe's command list is in
+						int64 stall = 0;
+						while (arrivals.empty() == false && frame > lastServerFrame) {
+							if (arrivals.front().second > now) {
+								stall += arrivals.front().second - now;
+								now = arrivals.front().second;
+							}
+							lastServerFrame = arrivals.front().first;
+							scheduler.addCommandListArrival(lastServerFrame, arrivals.front().second);
+							arrivals.pop_front();
+						}
+						if (stall > 0) {
+							stalls++;
+							stallMillis += stall;
+							if (stall > longestStallMillis) {
+								longestStallMillis = stall;
+							}
+						}
+					}
+					frame++;
+				}
+			}
+
+			averageLead = (double) leadSum / ticks;
+			this->jitterMillis = scheduler.getJitterMillis();
+			targetLeadFrames = scheduler.getTargetLeadFrames();
+		}
+
+	}
+} //end namespace
@@ -0,0 +1,127 @@
+//
+//      client_frame_scheduler.h: paces a network client's simulation to the
+//                                arrival of the server's command lists
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _GLEST_GAME_CLIENTFRAMESCHEDULER_H_
+#define _GLEST_GAME_CLIENTFRAMESCHEDULER_H_
+
+#include "data_types.h"
+#include "leak_dumper.h"
+
+using Shared::Platform::int64;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		//	class ClientFrameScheduler
+		//
+		///	A client can only run a keyframe once the server's command
+		///	list for it arrived. This keeps the client just far enough
+		///	behind the last list received to ride out the jitter of
+		///	their arrival times, measured like RFC 3550 does, instead
+		///	of running into the keyframe and stopping dead. Too little
+		///	buffered and it drops an update every few ticks, too much
+		///	and it runs an extra one.
+		// =====================================================
+
+		class ClientFrameScheduler {
+		public:
+			// One update of every slowDownSpacing ticks is dropped or added
+			// while the lead is corrected
+			static const int slowDownSpacing = 4;
+			// Keyframes in a row with too much buffered before speeding up
+			static const int surplusWindowsToSpeedUp = 4;
+
+		private:
+			int networkFramePeriod;
+			int updateFps;
+			int maxLeadFrames;
+
+			int lastArrivalFrame;
+			int64 lastArrivalMillis;
+			// Mean deviation of the arrival times, times 16
+			int64 jitterScaled;
+
+			// Smallest lead seen since the last keyframe
+			int windowMinLead;
+			int windowKeyframe;
+			// The speed was corrected during this window
+			bool windowCorrected;
+			int surplusWindows;
+			int surplusMinLead;
+
+			int slowDownFrames;
+			int speedUpFrames;
+			int tickCount;
+
+		public:
+			ClientFrameScheduler();
+
+			// Forgets everything measured so far
+			void init(int networkFramePeriod, int updateFps);
+
+			// The command list for frame was received at millis
+			void addCommandListArrival(int frame, int64 millis);
+
+			int getJitterMillis() const;
+			// How many frames the client should at least be able to run
+			// before it would wait on the next command list
+			int getTargetLeadFrames() const;
+
+			// The number of world updates to run this tick instead of
+			// updateLoops, lastServerFrame is the frame of the newest
+			// command list received
+			int getUpdateLoops(int updateLoops, int frame, int lastServerFrame);
+		};
+
+		// =====================================================
+		//	class ClientLagSimulation
+		//
+		///	Plays a network game in virtual time with the server's
+		///	command lists reaching the client latencyMillis plus up to
+		///	jitterMillis late, for the client-lag benchmark.
+		// =====================================================
+
+		class ClientLagSimulation {
+		public:
+			int stalls;
+			int64 stallMillis;
+			int64 longestStallMillis;
+			int droppedUpdates;
+			int addedUpdates;
+			// Frames the client could run on before waiting, on average
+			double averageLead;
+			int jitterMillis;
+			int targetLeadFrames;
+
+			ClientLagSimulation();
+
+			// Without adaptive the client only stops when it has to
+			void run(int latencyMillis, int jitterMillis, bool adaptive,
+				int seconds, int seed);
+		};
+
+	}
+} //end namespace
+
+#endif
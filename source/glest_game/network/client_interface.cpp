@@ -54,6 +54,9 @@ namespace Glest {
 		const int ClientInterface::messageWaitTimeout = 10000;	//10 seconds
 		const int ClientInterface::waitSleepTime = 10;
 		const int ClientInterface::maxNetworkCommandListSendTimeWait = 5;
+		const int ClientInterface::commandListWaitTime = 10;
+		const int ClientInterface::messageWaitMicroseconds = 1000;
+		const int ClientInterface::disconnectCheckInterval = 250;
 
 		// =====================================================
 		//	class ClientInterfaceThread
@@ -101,6 +104,8 @@ namespace Glest {
 				if (SystemFlags::VERBOSE_MODE_ENABLED) printf("ClientInterfaceThread::exec Line: %d\n", __LINE__);
 
 				time_t clientSimulationLagStartTime = 0;
+				RandomGen simulateLagRandom;
+				simulateLagRandom.init((int) time(NULL));
 				Chrono chrono;
 				for (; this->clientInterface != NULL;) {
 
@@ -125,11 +130,16 @@ namespace Glest {
 
 						// START: Test simulating lag for the client
 						int simulateLag = Config::getInstance().getInt("SimulateClientLag", "0");
-						if (simulateLag > 0) {
+						int simulateLagJitter = Config::getInstance().getInt("SimulateClientLagJitter", "0");
+						if (simulateLag > 0 || simulateLagJitter > 0) {
 							if (clientSimulationLagStartTime == 0) {
 								clientSimulationLagStartTime = time(NULL);
 							}
 							if (difftime((long int) time(NULL), clientSimulationLagStartTime) <= Config::getInstance().getInt("SimulateClientLagDurationSeconds", "0")) {
+								// Up to simulateLagJitter more for each message read
+								if (simulateLagJitter > 0) {
+									simulateLag += simulateLagRandom.randRange(0, simulateLagJitter);
+								}
 								sleep(simulateLag);
 							}
 						}
@@ -198,6 +208,7 @@ namespace Glest {
 			cachedPendingCommandsIndex = 0;
 			cachedLastPendingFrameCount = 0;
 			timeClientWaitedForLastMessage = 0;
+			commandListReceived = new Semaphore();
 
 			flagAccessor = new Mutex(CODE_AT_LINE);
 
@@ -221,6 +232,7 @@ namespace Glest {
 			connectedTime = 0;
 			port = 0;
 			serverFTPPort = 0;
+			serverCommandListVersion = 0;
 
 			gotIntro = false;
 			lastNetworkCommandListSendTime = 0;
@@ -345,6 +357,9 @@ namespace Glest {
 
 			delete flagAccessor;
 			flagAccessor = NULL;
+
+			delete commandListReceived;
+			commandListReceived = NULL;
 			//printf("END === Client destructor\n");
 
 			delete quitThreadAccessor;
@@ -448,7 +463,9 @@ namespace Glest {
 			}
 
 			try {
-				NetworkMessageCommandList networkMessageCommandList(currentFrameCount);
+				bool compactCommandList = (serverCommandListVersion >= 1 &&
+					Config::getInstance().getBool("NetworkCommandListCompact", "true"));
+				NetworkMessageCommandList networkMessageCommandList(currentFrameCount, compactCommandList);
 				for (int index = 0; index < GameConstants::maxPlayers; ++index) {
 					networkMessageCommandList.setNetworkPlayerFactionCRC(index, this->getNetworkPlayerFactionCRC(index));
 				}
@@ -557,6 +574,7 @@ namespace Glest {
 						serverName = networkMessageIntro.getName();
 						serverUUID = networkMessageIntro.getPlayerUUID();
 						serverPlatform = networkMessageIntro.getPlayerPlatform();
+						serverCommandListVersion = networkMessageIntro.getCommandListVersion();
 						serverFTPPort = networkMessageIntro.getFtpPort();
 
 						if (playerIndex < 0 || playerIndex >= GameConstants::maxPlayers) {
@@ -1006,11 +1024,12 @@ namespace Glest {
 				break;
 
 				case nmtCommandList:
+				case nmtCommandListCompact:
 				{
 
 					//make sure we read the message
 					//time_t receiveTimeElapsed = time(NULL);
-					NetworkMessageCommandList networkMessageCommandList;
+					NetworkMessageCommandList networkMessageCommandList(-1, networkMessageType == nmtCommandListCompact);
 					bool gotCmd = receiveMessage(&networkMessageCommandList);
 					if (gotCmd == false) {
 						printf("Server has interrupted network connection...\n");
@@ -1098,7 +1117,7 @@ namespace Glest {
 					chronoPerf.start();
 				}
 
-				int waitMicroseconds = (checkFrame == NULL ? 10 : 0);
+				int waitMicroseconds = (checkFrame == NULL ? messageWaitMicroseconds : 0);
 
 				bool done = false;
 				while (done == false && getQuitThread() == false) {
@@ -1117,11 +1136,12 @@ namespace Glest {
 
 					switch (networkMessageType) {
 						case nmtCommandList:
+						case nmtCommandListCompact:
 						{
 
 							//make sure we read the message
 							//time_t receiveTimeElapsed = time(NULL);
-							NetworkMessageCommandList networkMessageCommandList;
+							NetworkMessageCommandList networkMessageCommandList(-1, networkMessageType == nmtCommandListCompact);
 							bool gotCmd = receiveMessage(&networkMessageCommandList);
 							if (gotCmd == false) {
 								SystemFlags::OutputDebug(SystemFlags::debugError, "In [%s::%s Line: %d] error retrieving nmtCommandList returned false!\n", __FILE__, __FUNCTION__, __LINE__);
@@ -1138,6 +1158,7 @@ namespace Glest {
 
 							MutexSafeWrapper safeMutex(networkCommandListThreadAccessor, CODE_AT_LINE);
 							cachedLastPendingFrameCount = networkMessageCommandList.getFrameCount();
+							frameScheduler.addCommandListArrival(networkMessageCommandList.getFrameCount(), Chrono::getCurMillis());
 							//printf("cachedLastPendingFrameCount = %lld\n",(long long int)cachedLastPendingFrameCount);
 
 							//check that we are in the right frame
@@ -1194,6 +1215,7 @@ namespace Glest {
 								}
 							}
 							safeMutex.ReleaseLock();
+							commandListReceived->signal();
 
 							done = true;
 						}
@@ -1396,6 +1418,11 @@ namespace Glest {
 			return result;
 		}
 
+		int ClientInterface::getAdaptiveUpdateLoops(int updateLoops, int frameCount) {
+			MutexSafeWrapper safeMutex(networkCommandListThreadAccessor, CODE_AT_LINE);
+			return frameScheduler.getUpdateLoops(updateLoops, frameCount, (int) cachedLastPendingFrameCount);
+		}
+
 		bool ClientInterface::getNetworkCommand(int frameCount, int currentCachedPendingCommandsIndex) {
 			bool result = false;
 			bool waitForData = false;
@@ -1411,6 +1438,11 @@ namespace Glest {
 				Chrono chrono;
 				MutexSafeWrapper safeMutex(NULL, CODE_AT_LINE);
 
+				// Only the command lists received from now on should wake
+				// this up
+				while (commandListReceived->tryDecrement() == true) {
+				}
+
 				for (; getQuit() == false && getQuitThread() == false;) {
 
 					if (safeMutex.isValidMutex() == false) {
@@ -1474,10 +1506,8 @@ namespace Glest {
 							break;
 						}
 
-						if (waitForData == false) {
-							waitForData = true;
-							sleep(0);
-						}
+						waitForData = true;
+						commandListReceived->waitTillSignalled(commandListWaitTime);
 
 						waitCount++;
 						//printf("Client waiting for packet for frame: %d, currentCachedPendingCommandsIndex = %d, cachedPendingCommandsIndex = %lld\n",frameCount,currentCachedPendingCommandsIndex,(long long int)cachedPendingCommandsIndex);
@@ -1499,6 +1529,8 @@ namespace Glest {
 			if (getQuit() == false && getQuitThread() == false) {
 				if (networkCommandListThread == NULL) {
 					static string mutexOwnerId = string(extractFileFromDirectoryPath(__FILE__).c_str()) + string("_") + intToStr(__LINE__);
+					frameScheduler.init(this->gameSettings.getNetworkFramePeriod(), GameConstants::updateFps);
+
 					networkCommandListThread = new ClientInterfaceThread(this);
 					networkCommandListThread->setUniqueID(mutexOwnerId);
 					networkCommandListThread->start();
@@ -1605,9 +1637,10 @@ namespace Glest {
 							return;
 
 						}
-					} else if (networkMessageType == nmtCommandList) {
+					} else if (networkMessageType == nmtCommandList ||
+						networkMessageType == nmtCommandListCompact) {
 						//make sure we read the message
-						NetworkMessageCommandList networkMessageCommandList;
+						NetworkMessageCommandList networkMessageCommandList(-1, networkMessageType == nmtCommandListCompact);
 						bool gotCmd = receiveMessage(&networkMessageCommandList);
 						if (gotCmd == false) {
 							printf("Server has interrupted network connection...\n");
@@ -1954,6 +1987,7 @@ namespace Glest {
 
 			Chrono chrono;
 			chrono.start();
+			int64 lastDisconnectCheck = 0;
 
 			NetworkMessageType msg = nmtInvalid;
 			while (msg == nmtInvalid &&
@@ -1961,7 +1995,11 @@ namespace Glest {
 
 				msg = getNextMessageType(waitMicroseconds);
 				if (msg == nmtInvalid) {
-					if (getSocket() == NULL || (chrono.getMillis() % 250 == 0 && isConnected() == false)) {
+					bool checkDisconnect = (chrono.getMillis() - lastDisconnectCheck >= disconnectCheckInterval);
+					if (checkDisconnect == true) {
+						lastDisconnectCheck = chrono.getMillis();
+					}
+					if (getSocket() == NULL || (checkDisconnect == true && isConnected() == false)) {
 						if (getQuit() == false) {
 							Lang &lang = Lang::getInstance();
 							DisplayErrorMessage(lang.getString("ServerDisconnected"));
@@ -1994,11 +2032,14 @@ namespace Glest {
 						close();
 						return msg;
 					}
-					// Sleep every x milli-seconds we wait to let other threads work
-					else if (chrono.getMillis() % 2 == 0) {
-						sleep(1);
-					} else {
-						sleep(0);
+					// Sleep every x milli-seconds we wait to let other threads work,
+					// waiting on the socket above already does
+					else if (waitMicroseconds <= 0) {
+						if (chrono.getMillis() % 2 == 0) {
+							sleep(1);
+						} else {
+							sleep(0);
+						}
 					}
 				}
 
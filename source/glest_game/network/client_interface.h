@@ -30,6 +30,7 @@
 
 #include <vector>
 #include "network_interface.h"
+#include "client_frame_scheduler.h"
 #include "socket.h"
 #include "leak_dumper.h"
 
@@ -71,6 +72,12 @@ namespace Glest {
 			static const int messageWaitTimeout;
 			static const int waitSleepTime;
 			static const int maxNetworkCommandListSendTimeWait;
+			// Milliseconds between checks for quitting while waiting on a
+			// command list
+			static const int commandListWaitTime;
+			// How long the client thread waits on the socket per message
+			static const int messageWaitMicroseconds;
+			static const int disconnectCheckInterval;
 
 		private:
 			ClientSocket * clientSocket;
@@ -97,6 +104,7 @@ namespace Glest {
 
 			string serverUUID;
 			string serverPlatform;
+			int serverCommandListVersion;
 
 			ClientInterfaceThread *networkCommandListThread;
 
@@ -106,6 +114,9 @@ namespace Glest {
 			uint64 cachedPendingCommandsIndex;
 			uint64 cachedLastPendingFrameCount;
 			int64 timeClientWaitedForLastMessage;
+			ClientFrameScheduler frameScheduler;
+			// Signalled by the client thread for each command list received
+			Semaphore *commandListReceived;
 
 			Mutex *flagAccessor;
 			bool joinGameInProgress;
@@ -141,6 +152,8 @@ namespace Glest {
 
 			uint64 getCachedLastPendingFrameCount();
 			int64 getTimeClientWaitedForLastMessage();
+			// updateLoops paced to the server's command lists
+			int getAdaptiveUpdateLoops(int updateLoops, int frameCount);
 
 			//message processing
 			virtual void update();
@@ -237,6 +237,13 @@ namespace Glest {
 								break;
 							}
 
+							// The server's reactor thread reads this slot's socket
+							if (this->slotInterface->isSocketReactorActive() == true) {
+								// quitting doesn't signal a started slot, so don't wait forever
+								semTaskSignalled.waitTillSignalled(1000);
+								continue;
+							}
+
 							ExecutingTaskSafeWrapper safeExecutingTaskMutex(this);
 
 							// If the slot or socket are NULL the connection was lost
@@ -356,6 +363,137 @@ namespace Glest {
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s] Line: %d\n", __FILE__, __FUNCTION__, __LINE__);
 		}
 
+		// =====================================================
+		//	class ConnectionSlotReactorThread
+		// =====================================================
+
+		ConnectionSlotReactorThread::ConnectionSlotReactorThread(ConnectionSlotCallbackInterface *slotInterface) : BaseThread() {
+			this->slotInterface = slotInterface;
+			uniqueID = "ConnectionSlotReactorThread";
+			for (int index = 0; index < GameConstants::maxPlayers; ++index) {
+				slotSocketIds[index] = 0;
+				slotSockets[index] = NULL;
+			}
+		}
+
+		bool ConnectionSlotReactorThread::canShutdown(bool deleteSelfIfShutdownDelayed) {
+			bool ret = (getExecutingTask() == false);
+			if (ret == false && deleteSelfIfShutdownDelayed == true) {
+				setDeleteSelfOnExecutionDone(deleteSelfIfShutdownDelayed);
+				deleteSelfIfRequired();
+				signalQuit();
+			}
+
+			return ret;
+		}
+
+		void ConnectionSlotReactorThread::syncSlotSockets() {
+			PLATFORM_SOCKET socketIds[GameConstants::maxPlayers];
+			Socket *sockets[GameConstants::maxPlayers];
+			for (int index = 0; index < GameConstants::maxPlayers; ++index) {
+				socketIds[index] = 0;
+				sockets[index] = NULL;
+
+				// Only started slots, the others still belong to their own thread
+				// or to the server's ready check
+				MutexSafeWrapper safeMutex(this->slotInterface->getSlotMutex(index), CODE_AT_LINE_X(index));
+				ConnectionSlot *slot = this->slotInterface->getSlot(index, false);
+				if (slot != NULL && slot->getGameStarted() == true) {
+					Socket *socket = slot->getSocket(true);
+					if (socket != NULL && socket->isSocketValid() == true) {
+						sockets[index] = socket;
+						socketIds[index] = socket->getSocketId();
+					}
+				}
+			}
+
+			// Drop everything that went away before adding, a new connection may
+			// have been given the descriptor of a closed one
+			for (int index = 0; index < GameConstants::maxPlayers; ++index) {
+				if (slotSockets[index] != sockets[index] || slotSocketIds[index] != socketIds[index]) {
+					if (slotSockets[index] != NULL) {
+						reactor.removeSocket(slotSocketIds[index]);
+					}
+					slotSockets[index] = NULL;
+					slotSocketIds[index] = 0;
+				}
+			}
+			for (int index = 0; index < GameConstants::maxPlayers; ++index) {
+				if (sockets[index] != NULL && slotSockets[index] == NULL) {
+					if (reactor.addSocket(socketIds[index], index) == true) {
+						slotSockets[index] = sockets[index];
+						slotSocketIds[index] = socketIds[index];
+					}
+				}
+			}
+		}
+
+		void ConnectionSlotReactorThread::execute() {
+			RunningStatusSafeWrapper runningStatus(this);
+			try {
+				if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d]\n", __FILE__, __FUNCTION__, __LINE__);
+
+				std::vector<int> readySlots;
+				Chrono chronoIdleUpdate;
+				chronoIdleUpdate.start();
+				for (; this->slotInterface != NULL;) {
+					if (getQuitStatus() == true) {
+						break;
+					}
+
+					syncSlotSockets();
+
+					// Same wait the slot threads used for their own socket
+					reactor.waitForData(readySlots, 150);
+
+					bool slotTriggered[GameConstants::maxPlayers];
+					for (int index = 0; index < GameConstants::maxPlayers; ++index) {
+						slotTriggered[index] = false;
+					}
+					for (unsigned int index = 0; index < readySlots.size(); ++index) {
+						slotTriggered[readySlots[index]] = true;
+					}
+
+					// The slot threads also updated idle slots after each wait,
+					// that is what picks up in game reconnects
+					bool idleUpdate = (chronoIdleUpdate.getMillis() >= 150);
+					if (idleUpdate == true) {
+						chronoIdleUpdate.start();
+					}
+
+					for (int index = 0; index < GameConstants::maxPlayers; ++index) {
+						if (getQuitStatus() == true) {
+							break;
+						}
+						if (slotSockets[index] == NULL ||
+							(slotTriggered[index] == false && idleUpdate == false)) {
+							continue;
+						}
+
+						ExecutingTaskSafeWrapper safeExecutingTaskMutex(this);
+
+						ConnectionSlotEvent event;
+						event.eventType = eReceiveSocketData;
+						event.connectionSlot = this->slotInterface->getSlot(index, true);
+						event.eventId = index;
+						event.socketTriggered = slotTriggered[index];
+
+						if (event.connectionSlot != NULL) {
+							event.connectionSlot->updateSlot(&event);
+						}
+					}
+				}
+
+				if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d]\n", __FILE__, __FUNCTION__, __LINE__);
+			} catch (const exception &ex) {
+
+				SystemFlags::OutputDebug(SystemFlags::debugError, "In [%s::%s Line: %d] Error [%s]\n", __FILE__, __FUNCTION__, __LINE__, ex.what());
+				if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d]\n", __FILE__, __FUNCTION__, __LINE__);
+
+				throw megaglest_runtime_error(ex.what());
+			}
+		}
+
 		// =====================================================
 		//	class ConnectionSlot
 		// =====================================================
@@ -376,6 +514,7 @@ namespace Glest {
 			this->playerLanguage = "";
 			this->playerUUID = "";
 			this->platform = "";
+			this->commandListVersion = 0;
 			this->currentFrameCount = 0;
 			this->currentLagCount = 0;
 			this->graceLagCtr = 0;
@@ -584,6 +723,7 @@ namespace Glest {
 								this->playerLanguage = "";
 								this->playerUUID = "";
 								this->platform = "";
+								this->commandListVersion = 0;
 								this->ready = false;
 								this->vctFileList.clear();
 								this->receivedNetworkGameStatus = false;
@@ -801,12 +941,13 @@ namespace Glest {
 								break;
 
 								//command list
-								case nmtCommandList: {
+								case nmtCommandList:
+								case nmtCommandListCompact: {
 
 									if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d] got nmtCommandList gotIntro = %d\n", __FILE__, __FUNCTION__, __LINE__, gotIntro);
 
 									if (gotIntro == true) {
-										NetworkMessageCommandList networkMessageCommandList;
+										NetworkMessageCommandList networkMessageCommandList(-1, networkMessageType == nmtCommandListCompact);
 										if (receiveMessage(&networkMessageCommandList)) {
 											currentFrameCount = networkMessageCommandList.getFrameCount();
 											lastReceiveCommandListTime = time(NULL);
@@ -849,6 +990,7 @@ namespace Glest {
 										this->playerLanguage = networkMessageIntro.getPlayerLanguage();
 										this->playerUUID = networkMessageIntro.getPlayerUUID();
 										this->platform = networkMessageIntro.getPlayerPlatform();
+										this->commandListVersion = networkMessageIntro.getCommandListVersion();
 
 										//printf("Got uuid from client [%s]\n",this->playerUUID.c_str());
 										if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s] got name [%s] versionString [%s], msgSessionId = %d\n", __FILE__, __FUNCTION__, name.c_str(), versionString.c_str(), msgSessionId);
@@ -82,6 +82,9 @@ namespace Glest {
 			virtual Mutex *getSlotMutex(int index) = 0;
 
 			virtual void slotUpdateTask(ConnectionSlotEvent *event) = 0;
+			// true while a ConnectionSlotReactorThread reads the sockets of
+			// the started slots, their own threads then stay idle
+			virtual bool isSocketReactorActive() = 0;
 			virtual ~ConnectionSlotCallbackInterface() {
 			}
 		};
@@ -135,6 +138,35 @@ namespace Glest {
 			virtual bool canShutdown(bool deleteSelfIfShutdownDelayed = false);
 		};
 
+		// =====================================================
+		//	class ConnectionSlotReactorThread
+		//
+		//	Once the game has started, waits for data on the sockets
+		//	of all slots at once and updates the slots that have
+		//	some, instead of one select() loop per slot thread.
+		// =====================================================
+
+		class ConnectionSlotReactorThread : public BaseThread {
+		protected:
+			ConnectionSlotCallbackInterface * slotInterface;
+			SocketReactor reactor;
+			// what the reactor watches for each slot, to notice new connections
+			PLATFORM_SOCKET slotSocketIds[GameConstants::maxPlayers];
+			Socket *slotSockets[GameConstants::maxPlayers];
+
+			void syncSlotSockets();
+
+		public:
+			explicit ConnectionSlotReactorThread(ConnectionSlotCallbackInterface *slotInterface);
+
+			bool isReactorOpen() const {
+				return reactor.isOpen();
+			}
+
+			virtual void execute();
+			virtual bool canShutdown(bool deleteSelfIfShutdownDelayed = false);
+		};
+
 		// =====================================================
 		//	class ConnectionSlot
 		// =====================================================
@@ -170,6 +202,7 @@ namespace Glest {
 			string playerLanguage;
 			string playerUUID;
 			string platform;
+			int commandListVersion;
 
 			bool skipLagCheck;
 			bool joinGameInProgress;
@@ -257,6 +290,9 @@ namespace Glest {
 			const string &getPlatform() const {
 				return platform;
 			}
+			int getCommandListVersion() const {
+				return commandListVersion;
+			}
 			void setName(string value) {
 				name = value;
 			}
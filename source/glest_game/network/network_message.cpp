@@ -52,6 +52,59 @@ namespace Glest {
 		Chrono NetworkMessage::lastSend;
 		Chrono NetworkMessage::lastRecv;
 		std::map<NetworkMessageStatisticType, int64> NetworkMessage::mapMessageStats;
+		int NetworkMessage::debugFlagsChangeCount = -1;
+		bool NetworkMessage::debugPacketStats = false;
+		bool NetworkMessage::debugPackets = false;
+		bool NetworkMessage::debugPacketSizes = false;
+
+		auto_ptr<Mutex> NetworkMessageBuffer::mutexPool(new Mutex(CODE_AT_LINE));
+		std::vector<std::vector<unsigned char> > NetworkMessageBuffer::pool;
+		int64 NetworkMessageBuffer::allocationCount = 0;
+
+		// =====================================================
+		//	class NetworkMessageBuffer
+		// =====================================================
+
+		NetworkMessageBuffer::NetworkMessageBuffer() {
+			lent = false;
+			lentCapacity = 0;
+		}
+
+		NetworkMessageBuffer::~NetworkMessageBuffer() {
+			if (lent == false) {
+				return;
+			}
+			MutexSafeWrapper safeMutex(mutexPool.get(), CODE_AT_LINE);
+			if (buffer.capacity() != lentCapacity) {
+				allocationCount++;
+			}
+			if (pool.size() < maxPooledBuffers && buffer.capacity() <= maxPooledCapacity) {
+				if (pool.capacity() < maxPooledBuffers) {
+					pool.reserve(maxPooledBuffers);
+				}
+				buffer.clear();
+				pool.push_back(std::vector<unsigned char>());
+				pool.back().swap(buffer);
+			}
+		}
+
+		std::vector<unsigned char> &NetworkMessageBuffer::get() {
+			if (lent == false) {
+				MutexSafeWrapper safeMutex(mutexPool.get(), CODE_AT_LINE);
+				if (pool.empty() == false) {
+					buffer.swap(pool.back());
+					pool.pop_back();
+				}
+				lent = true;
+				lentCapacity = buffer.capacity();
+			}
+			return buffer;
+		}
+
+		int64 NetworkMessageBuffer::getAllocationCount() {
+			MutexSafeWrapper safeMutex(mutexPool.get(), CODE_AT_LINE);
+			return allocationCount;
+		}
 
 		// =====================================================
 		//	class NetworkMessage
@@ -101,48 +154,29 @@ namespace Glest {
 		void NetworkMessage::send(Socket* socket, const void* data, int dataSize, int8 messageType) {
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d] socket = %p, data = %p, dataSize = %d\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, socket, data, dataSize);
 
-			if (socket != NULL) {
-				int msgTypeSize = sizeof(messageType);
-				int fullMsgSize = msgTypeSize + dataSize;
-
-				char *out_buffer = new char[fullMsgSize];
-				memcpy(out_buffer, &messageType, msgTypeSize);
-				memcpy(&out_buffer[msgTypeSize], (const char *) data, dataSize);
-
-				dump_packet("\nOUTGOING PACKET:\n", out_buffer, fullMsgSize, true);
-				int sendResult = socket->send(out_buffer, fullMsgSize);
-				if (sendResult != fullMsgSize) {
-					delete[] out_buffer;
-					if (socket != NULL && socket->isSocketValid() == true) {
-						char szBuf[8096] = "";
-						snprintf(szBuf, 8096, "Error sending NetworkMessage, sendResult = %d, dataSize = %d", sendResult, fullMsgSize);
-						throw megaglest_runtime_error(szBuf);
-					} else {
-						if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s] Line: %d socket has been disconnected\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__);
-					}
-				} else {
-					delete[] out_buffer;
-				}
-			}
+			const void *buffers[] = { &messageType, data };
+			const int bufferSizes[] = { (int) sizeof(messageType), dataSize };
+			send(socket, buffers, bufferSizes, 2);
 		}
 
 		void NetworkMessage::send(Socket* socket, const void* data, int dataSize, int8 messageType, uint32 compressedLength) {
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d] socket = %p, data = %p, dataSize = %d\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, socket, data, dataSize);
 
-			if (socket != NULL) {
-				int msgTypeSize = sizeof(messageType);
-				int compressedSize = sizeof(compressedLength);
-				int fullMsgSize = msgTypeSize + compressedSize + dataSize;
+			const void *buffers[] = { &messageType, &compressedLength, data };
+			const int bufferSizes[] = { (int) sizeof(messageType), (int) sizeof(compressedLength), dataSize };
+			send(socket, buffers, bufferSizes, 3);
+		}
 
-				char *out_buffer = new char[fullMsgSize];
-				memcpy(out_buffer, &messageType, msgTypeSize);
-				memcpy(&out_buffer[msgTypeSize], &compressedLength, compressedSize);
-				memcpy(&out_buffer[msgTypeSize + compressedSize], (const char *) data, dataSize);
+		void NetworkMessage::send(Socket* socket, const void *const buffers[], const int bufferSizes[], int bufferCount) {
+			if (socket != NULL) {
+				int fullMsgSize = 0;
+				for (int index = 0; index < bufferCount; ++index) {
+					fullMsgSize += bufferSizes[index];
+				}
+				dump_packet("\nOUTGOING PACKET:\n", buffers, bufferSizes, bufferCount, true);
 
-				dump_packet("\nOUTGOING PACKET:\n", out_buffer, fullMsgSize, true);
-				int sendResult = socket->send(out_buffer, fullMsgSize);
+				int sendResult = socket->send(buffers, bufferSizes, bufferCount);
 				if (sendResult != fullMsgSize) {
-					delete[] out_buffer;
 					if (socket != NULL && socket->isSocketValid() == true) {
 						char szBuf[8096] = "";
 						snprintf(szBuf, 8096, "Error sending NetworkMessage, sendResult = %d, dataSize = %d", sendResult, fullMsgSize);
@@ -150,8 +184,6 @@ namespace Glest {
 					} else {
 						if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s] Line: %d socket has been disconnected\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__);
 					}
-				} else {
-					delete[] out_buffer;
 				}
 			}
 		}
@@ -196,9 +228,33 @@ namespace Glest {
 			return result;
 		}
 
-		void NetworkMessage::dump_packet(string label, const void* data, int dataSize, bool isSend) {
+		void NetworkMessage::updateDebugFlags() {
+			int changeCount = Config::getChangeCount();
+			if (changeCount == debugFlagsChangeCount) {
+				return;
+			}
+			MutexSafeWrapper safeMutex(NetworkMessage::mutexMessageStats.get());
 			Config &config = Config::getInstance();
-			if (config.getBool("DebugNetworkPacketStats", "false") == true) {
+			debugPacketStats = config.getBool("DebugNetworkPacketStats", "false");
+			debugPackets = config.getBool("DebugNetworkPackets", "false");
+			debugPacketSizes = config.getBool("DebugNetworkPacketSizes", "false");
+			debugFlagsChangeCount = changeCount;
+		}
+
+		void NetworkMessage::dump_packet(const char *label, const void* data, int dataSize, bool isSend) {
+			const void *buffers[] = { data };
+			const int bufferSizes[] = { dataSize };
+			dump_packet(label, buffers, bufferSizes, 1, isSend);
+		}
+
+		void NetworkMessage::dump_packet(const char *label, const void *const buffers[], const int bufferSizes[], int bufferCount, bool isSend) {
+			int dataSize = 0;
+			for (int bufferIndex = 0; bufferIndex < bufferCount; ++bufferIndex) {
+				dataSize += bufferSizes[bufferIndex];
+			}
+
+			updateDebugFlags();
+			if (debugPacketStats == true) {
 
 				MutexSafeWrapper safeMutex(NetworkMessage::mutexMessageStats.get());
 
@@ -288,20 +344,22 @@ namespace Glest {
 				}
 			}
 
-			if (config.getBool("DebugNetworkPackets", "false") == true ||
-				config.getBool("DebugNetworkPacketSizes", "false") == true) {
+			if (debugPackets == true || debugPacketSizes == true) {
 
-				printf("%s DataSize = %d", label.c_str(), dataSize);
+				printf("%s DataSize = %d", label, dataSize);
 
-				if (config.getBool("DebugNetworkPackets", "false") == true) {
+				if (debugPackets == true) {
 
 					printf("\n");
-					const char *buf = static_cast<const char *>(data);
-					for (unsigned int index = 0; index < (unsigned int) dataSize; ++index) {
-
-						printf("%u[%X][%d] ", index, buf[index], buf[index]);
-						if (index % 10 == 0) {
-							printf("\n");
+					unsigned int index = 0;
+					for (int bufferIndex = 0; bufferIndex < bufferCount; ++bufferIndex) {
+						const char *buf = static_cast<const char *>(buffers[bufferIndex]);
+						for (int bufferOffset = 0; bufferOffset < bufferSizes[bufferIndex]; ++bufferOffset, ++index) {
+
+							printf("%u[%X][%d] ", index, buf[bufferOffset], buf[bufferOffset]);
+							if (index % 10 == 0) {
+								printf("\n");
+							}
 						}
 					}
 				}
@@ -312,6 +370,8 @@ namespace Glest {
 		// =====================================================
 		//	class NetworkMessageIntro
 		// =====================================================
+		static const char *commandListVersionTag = "|cmdlist=";
+
 		NetworkMessageIntro::NetworkMessageIntro() {
 			messageType = -1;
 			data.sessionId = -1;
@@ -341,7 +401,7 @@ namespace Glest {
 			data.language = playerLanguage;
 			data.gameInProgress = gameInProgress;
 			data.playerUUID = playerUUID;
-			data.platform = platform;
+			data.platform = platform + commandListVersionTag + intToStr(commandListVersion);
 		}
 
 		const char * NetworkMessageIntro::getPackedMessageFormat() const {
@@ -416,6 +476,25 @@ namespace Glest {
 			return buf;
 		}
 
+		string NetworkMessageIntro::getPlayerPlatform() const {
+			string platform = data.platform.getString();
+			size_t tagPos = platform.find(commandListVersionTag);
+			if (tagPos != string::npos) {
+				platform = platform.substr(0, tagPos);
+			}
+			return platform;
+		}
+
+		int NetworkMessageIntro::getCommandListVersion() const {
+			string platform = data.platform.getString();
+			size_t tagPos = platform.find(commandListVersionTag);
+			if (tagPos == string::npos) {
+				return 0;
+			}
+			string version = platform.substr(tagPos + strlen(commandListVersionTag));
+			return (version != "" && IsNumeric(version.c_str(), false) == true ? strToInt(version) : 0);
+		}
+
 		string NetworkMessageIntro::toString() const {
 			string result = "messageType = " + intToStr(messageType);
 			result += " sessionId = " + intToStr(data.sessionId);
@@ -1398,8 +1477,10 @@ namespace Glest {
 				if (result == true && compressedLength > 0 && socket != NULL && socket->isSocketValid()) {
 					//printf("UnCompressed launch packet before: %u after: %d\n",compressedLength,(int)getDataSize());
 
-					unsigned char *compressedMessage = new unsigned char[compressedLength + 1];
-					memset(compressedMessage, 0, compressedLength + 1);
+					NetworkMessageBuffer compressedBuffer;
+					std::vector<unsigned char> &compressedVector = compressedBuffer.get();
+					compressedVector.resize(compressedLength + 1);
+					unsigned char *compressedMessage = &compressedVector[0];
 
 					result = NetworkMessage::receive(socket, compressedMessage, compressedLength, true);
 					//printf("UnCompressed launch packet READ returned: %d\n",result);
@@ -1436,7 +1517,6 @@ namespace Glest {
 
 						//printf("SUCCESS UnCompressed launch packet before: %u after: %lu\n",compressedLength,decompressedBuffer.second);
 					}
-					delete[] compressedMessage;
 
 					if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chrono.getMillis() > 0) SystemFlags::OutputDebug(SystemFlags::debugPerformance, "In [%s::%s Line: %d] took msecs: %lld\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, chrono.getMillis());
 					if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chrono.getMillis() > 0) chrono.start();
@@ -1448,11 +1528,13 @@ namespace Glest {
 					if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chrono.getMillis() > 0) chrono.start();
 				}
 			} else {
-				unsigned char *buf = new unsigned char[getPackedSize() + 1];
+				NetworkMessageBuffer packedBuffer;
+				std::vector<unsigned char> &packed = packedBuffer.get();
+				packed.resize(getPackedSize() + 1);
+				unsigned char *buf = &packed[0];
 				result = NetworkMessage::receive(socket, buf, getPackedSize(), true);
 				unpackMessage(buf);
 				//printf("Got packet size = %u data.messageType = %d\n%s\n",getPackedSize(),data.messageType,buf);
-				delete[] buf;
 			}
 			fromEndian();
 
@@ -1495,11 +1577,7 @@ namespace Glest {
 		}
 
 		std::pair<unsigned char *, unsigned long> NetworkMessageLaunch::getCompressedMessage() {
-			unsigned char *buffer = this->getData();
-			std::pair<unsigned char *, unsigned long> result =
-				Shared::CompressionUtil::compressMemoryToMemory(buffer, getDataSize());
-			delete[] buffer;
-			return result;
+			return Shared::CompressionUtil::compressMemoryToMemory(reinterpret_cast<unsigned char *>(&data), getDataSize());
 		}
 
 		void NetworkMessageLaunch::send(Socket* socket) {
@@ -1638,18 +1716,300 @@ namespace Glest {
 		//	class NetworkMessageLaunch
 		// =====================================================
 
-		NetworkMessageCommandList::NetworkMessageCommandList(int32 frameCount) {
-			data.messageType = nmtCommandList;
+		// Compact command list (nmtCommandListCompact):
+		//   messageType flags payloadSize(uint16 little endian) payload
+		// payload, zlib compressed when flags has compactCommandListCompressed:
+		//   frameCount crcMask crc... commandCount
+		//   commandCount times: fieldMask fieldDelta...
+		// frameCount and the deltas are zigzag varints, crcMask and fieldMask
+		// varints and each crc with its bit set in crcMask 4 bytes little
+		// endian. A command only carries the fields in fieldMask, as the
+		// difference to the same field of the command before it, all others
+		// are the same. The commands of one group order differ by little more
+		// than the unit id.
+		static const uint8 compactCommandListCompressed = 0x01;
+		static const unsigned int compactCommandListHeaderSize = 4;
+		static const unsigned int compactCommandListMaxPayload = 0xFFFF;
+		// smaller payloads rarely shrink, don't spend the time on them
+		static const unsigned int compactCommandListCompressMinPayload = 64;
+		static const int compactCommandFieldCount = 14;
+
+		static void writeCompactVarint(std::vector<unsigned char> &out, uint32 value) {
+			while (value >= 0x80) {
+				out.push_back(static_cast<unsigned char>(value | 0x80));
+				value >>= 7;
+			}
+			out.push_back(static_cast<unsigned char>(value));
+		}
+
+		static bool readCompactVarint(const unsigned char *&pos, const unsigned char *end, uint32 &value) {
+			value = 0;
+			for (int shift = 0; shift < 35; shift += 7) {
+				if (pos >= end) {
+					return false;
+				}
+				unsigned char byte = *pos++;
+				value |= static_cast<uint32>(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		static uint32 zigzagEncode(int32 value) {
+			return (static_cast<uint32>(value) << 1) ^ static_cast<uint32>(value >> 31);
+		}
+
+		static int32 zigzagDecode(uint32 value) {
+			return static_cast<int32>((value >> 1) ^ (0U - (value & 1)));
+		}
+
+		// fields ordered by how often they change between two commands, so
+		// the mask of a command in a group order fits in one byte
+		static void getCompactCommandFields(const NetworkCommand &cmd, int32 fields[compactCommandFieldCount]) {
+			fields[0] = cmd.unitId;
+			fields[1] = cmd.positionX;
+			fields[2] = cmd.positionY;
+			fields[3] = cmd.targetId;
+			fields[4] = cmd.unitFactionUnitCount;
+			fields[5] = cmd.commandTypeId;
+			fields[6] = cmd.unitCommandGroupId;
+			fields[7] = cmd.networkCommandType;
+			fields[8] = cmd.unitTypeId;
+			fields[9] = cmd.wantQueue;
+			fields[10] = cmd.fromFactionIndex;
+			fields[11] = cmd.unitFactionIndex;
+			fields[12] = cmd.commandStateType;
+			fields[13] = cmd.commandStateValue;
+		}
+
+		static void setCompactCommandFields(NetworkCommand &cmd, const int32 fields[compactCommandFieldCount]) {
+			cmd.unitId = fields[0];
+			cmd.positionX = static_cast<int16>(fields[1]);
+			cmd.positionY = static_cast<int16>(fields[2]);
+			cmd.targetId = fields[3];
+			cmd.unitFactionUnitCount = static_cast<uint16>(fields[4]);
+			cmd.commandTypeId = static_cast<int16>(fields[5]);
+			cmd.unitCommandGroupId = fields[6];
+			cmd.networkCommandType = static_cast<int16>(fields[7]);
+			cmd.unitTypeId = static_cast<int16>(fields[8]);
+			cmd.wantQueue = static_cast<int8>(fields[9]);
+			cmd.fromFactionIndex = static_cast<int8>(fields[10]);
+			cmd.unitFactionIndex = static_cast<int8>(fields[11]);
+			cmd.commandStateType = static_cast<int8>(fields[12]);
+			cmd.commandStateValue = fields[13];
+		}
+
+		NetworkMessageCommandList::NetworkMessageCommandList(int32 frameCount, bool compact) {
+			this->compact = compact;
+			data.messageType = (compact == true ? nmtCommandListCompact : nmtCommandList);
 			data.header.frameCount = frameCount;
 			data.header.commandCount = 0;
 			for (int index = 0; index < GameConstants::maxPlayers; ++index) {
 				data.header.networkPlayerFactionCRC[index] = 0;
 			}
+			compactMessagePacked = false;
+		}
+
+		// appends to what payload already holds
+		void NetworkMessageCommandList::packCompactPayload(std::vector<unsigned char> &payload) const {
+			payload.reserve(payload.size() + 16 + data.header.commandCount * 4);
+
+			writeCompactVarint(payload, zigzagEncode(data.header.frameCount));
+
+			uint32 crcMask = 0;
+			for (int index = 0; index < GameConstants::maxPlayers; ++index) {
+				if (data.header.networkPlayerFactionCRC[index] != 0) {
+					crcMask |= (1U << index);
+				}
+			}
+			writeCompactVarint(payload, crcMask);
+			for (int index = 0; index < GameConstants::maxPlayers; ++index) {
+				uint32 crc = data.header.networkPlayerFactionCRC[index];
+				if (crc != 0) {
+					payload.push_back(static_cast<unsigned char>(crc));
+					payload.push_back(static_cast<unsigned char>(crc >> 8));
+					payload.push_back(static_cast<unsigned char>(crc >> 16));
+					payload.push_back(static_cast<unsigned char>(crc >> 24));
+				}
+			}
+
+			writeCompactVarint(payload, data.header.commandCount);
+			int32 previous[compactCommandFieldCount] = { 0 };
+			int32 fields[compactCommandFieldCount];
+			for (int idx = 0; idx < data.header.commandCount; ++idx) {
+				getCompactCommandFields(data.commands[idx], fields);
+
+				uint32 fieldMask = 0;
+				for (int field = 0; field < compactCommandFieldCount; ++field) {
+					if (fields[field] != previous[field]) {
+						fieldMask |= (1U << field);
+					}
+				}
+				writeCompactVarint(payload, fieldMask);
+				for (int field = 0; field < compactCommandFieldCount; ++field) {
+					if (fields[field] != previous[field]) {
+						// wraps around like the decoder, no overflow for far apart ids
+						uint32 delta = static_cast<uint32>(fields[field]) - static_cast<uint32>(previous[field]);
+						writeCompactVarint(payload, zigzagEncode(static_cast<int32>(delta)));
+						previous[field] = fields[field];
+					}
+				}
+			}
+		}
+
+		bool NetworkMessageCommandList::unpackCompactPayload(const unsigned char *buf, unsigned int size) {
+			const unsigned char *pos = buf;
+			const unsigned char *end = buf + size;
+
+			uint32 value = 0;
+			if (readCompactVarint(pos, end, value) == false) {
+				return false;
+			}
+			data.header.frameCount = zigzagDecode(value);
+
+			uint32 crcMask = 0;
+			if (readCompactVarint(pos, end, crcMask) == false) {
+				return false;
+			}
+			for (int index = 0; index < GameConstants::maxPlayers; ++index) {
+				data.header.networkPlayerFactionCRC[index] = 0;
+				if ((crcMask & (1U << index)) != 0) {
+					if (end - pos < 4) {
+						return false;
+					}
+					data.header.networkPlayerFactionCRC[index] =
+						static_cast<uint32>(pos[0]) | (static_cast<uint32>(pos[1]) << 8) |
+						(static_cast<uint32>(pos[2]) << 16) | (static_cast<uint32>(pos[3]) << 24);
+					pos += 4;
+				}
+			}
+
+			uint32 commandCount = 0;
+			if (readCompactVarint(pos, end, commandCount) == false || commandCount > 0xFFFF) {
+				return false;
+			}
+			data.header.commandCount = static_cast<uint16>(commandCount);
+			data.commands.clear();
+			data.commands.resize(commandCount);
+
+			int32 fields[compactCommandFieldCount] = { 0 };
+			for (unsigned int idx = 0; idx < commandCount; ++idx) {
+				uint32 fieldMask = 0;
+				if (readCompactVarint(pos, end, fieldMask) == false) {
+					return false;
+				}
+				for (int field = 0; field < compactCommandFieldCount; ++field) {
+					if ((fieldMask & (1U << field)) != 0) {
+						if (readCompactVarint(pos, end, value) == false) {
+							return false;
+						}
+						fields[field] = static_cast<int32>(static_cast<uint32>(fields[field]) + static_cast<uint32>(zigzagDecode(value)));
+					}
+				}
+				setCompactCommandFields(data.commands[idx], fields);
+			}
+			return (pos == end);
+		}
+
+		bool NetworkMessageCommandList::packCompactMessage(std::vector<unsigned char> &message, bool allowCompression) const {
+			// the payload is packed straight in after the header
+			message.clear();
+			message.resize(compactCommandListHeaderSize);
+			packCompactPayload(message);
+			size_t payloadSize = message.size() - compactCommandListHeaderSize;
+			// the receiver bounds the extracted size by the same limit
+			if (payloadSize > compactCommandListMaxPayload) {
+				message.clear();
+				return false;
+			}
+
+			uint8 flags = 0;
+			if (allowCompression == true && payloadSize >= compactCommandListCompressMinPayload) {
+				std::pair<unsigned char *, unsigned long> compressionResult =
+					Shared::CompressionUtil::compressMemoryToMemory(&message[compactCommandListHeaderSize], (unsigned long) payloadSize);
+				if (compressionResult.second < payloadSize) {
+					message.resize(compactCommandListHeaderSize);
+					message.insert(message.end(), compressionResult.first, compressionResult.first + compressionResult.second);
+					payloadSize = compressionResult.second;
+					flags |= compactCommandListCompressed;
+				}
+				delete[] compressionResult.first;
+			}
+
+			message[0] = static_cast<unsigned char>(nmtCommandListCompact);
+			message[1] = flags;
+			message[2] = static_cast<unsigned char>(payloadSize);
+			message[3] = static_cast<unsigned char>(payloadSize >> 8);
+			return true;
+		}
+
+		unsigned int NetworkMessageCommandList::getLegacyWireSize(bool packed) {
+			if (packed == true) {
+				return getPackedSizeHeader() + getPackedSizeDetail(data.header.commandCount);
+			}
+			return sizeof(data.messageType) + sizeof(DataHeader) + sizeof(NetworkCommand) * data.header.commandCount;
+		}
+
+		unsigned int NetworkMessageCommandList::getCompactWireSize(bool allowCompression) const {
+			NetworkMessageBuffer messageBuffer;
+			std::vector<unsigned char> &message = messageBuffer.get();
+			if (packCompactMessage(message, allowCompression) == false) {
+				return 0;
+			}
+			return (unsigned int) message.size();
+		}
+
+		bool NetworkMessageCommandList::receiveCompact(Socket* socket) {
+			// the message type has already been read
+			unsigned char header[compactCommandListHeaderSize - 1];
+			bool result = NetworkMessage::receive(socket, header, sizeof(header), true);
+			if (result == false) {
+				return false;
+			}
+			uint8 flags = header[0];
+			unsigned int payloadSize = static_cast<unsigned int>(header[1]) | (static_cast<unsigned int>(header[2]) << 8);
+
+			NetworkMessageBuffer payloadBuffer;
+			std::vector<unsigned char> &payload = payloadBuffer.get();
+			payload.resize(payloadSize + 1);
+			if (payloadSize > 0) {
+				result = NetworkMessage::receive(socket, &payload[0], payloadSize, true);
+				if (result == false) {
+					return false;
+				}
+			}
+
+			bool unpacked = false;
+			if ((flags & compactCommandListCompressed) != 0) {
+				std::pair<unsigned char *, unsigned long> decompressedBuffer =
+					Shared::CompressionUtil::extractMemoryToMemory(&payload[0], payloadSize, compactCommandListMaxPayload);
+				unpacked = unpackCompactPayload(decompressedBuffer.first, decompressedBuffer.second);
+				delete[] decompressedBuffer.first;
+			} else {
+				unpacked = unpackCompactPayload(&payload[0], payloadSize);
+			}
+			if (unpacked == false) {
+				throw megaglest_runtime_error("Error receiving NetworkMessageCommandList, invalid compact payload of size " + intToStr(payloadSize));
+			}
+			data.messageType = nmtCommandListCompact;
+
+			if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled == true) {
+				SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d] got compact command list, flags = %u, payloadSize = %u, commandCount = %u, frameCount = %d\n",
+					extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, flags, payloadSize, data.header.commandCount, data.header.frameCount);
+				for (int idx = 0; idx < data.header.commandCount; ++idx) {
+					SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d] index = %d, received networkCommand [%s]\n",
+						extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, idx, data.commands[idx].toString().c_str());
+				}
+			}
+			return true;
 		}
 
 		bool NetworkMessageCommandList::addCommand(const NetworkCommand* networkCommand) {
 			data.commands.push_back(*networkCommand);
 			data.header.commandCount++;
+			compactMessagePacked = false;
 			return true;
 		}
 
@@ -1694,8 +2054,7 @@ namespace Glest {
 				&data.header.networkPlayerFactionCRC[7]);
 		}
 
-		unsigned char * NetworkMessageCommandList::packMessageHeader() {
-			unsigned char *buf = new unsigned char[getPackedSizeHeader() + 1];
+		void NetworkMessageCommandList::packMessageHeader(unsigned char *buf) {
 			pack(buf, getPackedMessageFormatHeader(),
 				data.messageType,
 				data.header.commandCount,
@@ -1708,7 +2067,6 @@ namespace Glest {
 				data.header.networkPlayerFactionCRC[5],
 				data.header.networkPlayerFactionCRC[6],
 				data.header.networkPlayerFactionCRC[7]);
-			return buf;
 		}
 
 		const char * NetworkMessageCommandList::getPackedMessageFormatDetail() const {
@@ -1716,12 +2074,12 @@ namespace Glest {
 		}
 
 		unsigned int NetworkMessageCommandList::getPackedSizeDetail(int count) {
-			unsigned int result = 0;
-			//if(result == 0) {
-			for (unsigned int i = 0; i < (unsigned int) count; ++i) {
+			// every command packs to the same size
+			static unsigned int commandSize = 0;
+			if (commandSize == 0) {
 				NetworkCommand packedData;
 				unsigned char *buf = new unsigned char[sizeof(NetworkCommand) * 3];
-				result += pack(buf, getPackedMessageFormatDetail(),
+				commandSize = pack(buf, getPackedMessageFormatDetail(),
 					packedData.networkCommandType,
 					packedData.unitId,
 					packedData.unitTypeId,
@@ -1738,8 +2096,7 @@ namespace Glest {
 					packedData.unitCommandGroupId);
 				delete[] buf;
 			}
-			//}
-			return result;
+			return commandSize * (unsigned int) count;
 		}
 		void NetworkMessageCommandList::unpackMessageDetail(unsigned char *buf, int count) {
 			data.commands.clear();
@@ -1768,9 +2125,7 @@ namespace Glest {
 			//printf("\nUnPacked detail size = %u\n",bytes_processed_total);
 		}
 
-		unsigned char * NetworkMessageCommandList::packMessageDetail(uint16 totalCommand) {
-			int packetSize = getPackedSizeDetail(totalCommand) + 1;
-			unsigned char *buf = new unsigned char[packetSize];
+		void NetworkMessageCommandList::packMessageDetail(unsigned char *buf, uint16 totalCommand) {
 			unsigned char *bufMove = buf;
 			//unsigned int bytes_processed_total = 0;
 			for (unsigned int i = 0; i < totalCommand; ++i) {
@@ -1792,13 +2147,18 @@ namespace Glest {
 				bufMove += bytes_processed;
 				//bytes_processed_total += bytes_processed;
 			}
-			//printf("\nPacked detail size = %u, allocated = %d\n",bytes_processed_total,packetSize);
-			return buf;
+			//printf("\nPacked detail size = %u\n",bytes_processed_total);
 		}
 
 		bool NetworkMessageCommandList::receive(Socket* socket) {
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d]\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__);
 
+			compactMessagePacked = false;
+			if (compact == true) {
+				return receiveCompact(socket);
+			}
+
+			NetworkMessageBuffer packedBuffer;
 			unsigned char *buf = NULL;
 			bool result = false;
 			if (useOldProtocol == true) {
@@ -1809,11 +2169,11 @@ namespace Glest {
 
 				//printf("!!! =====> IN Network hdr cmd get frame: %d data.header.commandCount: %u\n",data.header.frameCount,data.header.commandCount);
 			} else {
-				buf = new unsigned char[getPackedSizeHeader() + 1];
+				packedBuffer.get().resize(getPackedSizeHeader() + 1);
+				buf = &packedBuffer.get()[0];
 				result = NetworkMessage::receive(socket, buf, getPackedSizeHeader(), true);
 				unpackMessageHeader(buf);
 				//if(data.header.commandCount) printf("\n\nGot packet size = %u data.messageType = %d\n%s\ncommandcount [%u] framecount [%d]\n",getPackedSizeHeader(),data.header.messageType,buf,data.header.commandCount,data.header.frameCount);
-				delete[] buf;
 			}
 			fromEndianHeader();
 
@@ -1835,11 +2195,11 @@ namespace Glest {
 					} else {
 						//int totalMsgSize = (sizeof(NetworkCommand) * data.header.commandCount);
 						//result = NetworkMessage::receive(socket, &data.commands[0], totalMsgSize, true);
-						buf = new unsigned char[getPackedSizeDetail(data.header.commandCount) + 1];
+						packedBuffer.get().resize(getPackedSizeDetail(data.header.commandCount) + 1);
+						buf = &packedBuffer.get()[0];
 						result = NetworkMessage::receive(socket, buf, getPackedSizeDetail(data.header.commandCount), true);
 						unpackMessageDetail(buf, data.header.commandCount);
 						//printf("Got packet size = %u data.messageType = %d\n%s\n",getPackedSize(),data.messageType,buf);
-						delete[] buf;
 					}
 					fromEndianDetail();
 
@@ -1884,58 +2244,57 @@ namespace Glest {
 		void NetworkMessageCommandList::send(Socket* socket) {
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d] nmtCommandList, frameCount = %d, data.header.commandCount = %d, data.header.messageType = %d\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, data.header.frameCount, data.header.commandCount, data.messageType);
 
+			if (compact == true) {
+				// the server sends the same list to every client, it's
+				// packed for the first one only
+				std::vector<unsigned char> &message = compactMessage.get();
+				if (compactMessagePacked == false) {
+					packCompactMessage(message, Config::getInstance().getBool("NetworkCommandListCompression", "true"));
+					compactMessagePacked = true;
+				}
+				if (message.empty() == false) {
+					data.messageType = nmtCommandListCompact;
+					NetworkMessage::send(socket, &message[0], (int) message.size());
+
+					if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled == true) {
+						SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d] sent compact command list, size = %d, frameCount = %d, data.header.commandCount = %d\n",
+							extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, (int) message.size(), data.header.frameCount, data.header.commandCount);
+						for (int idx = 0; idx < data.header.commandCount; ++idx) {
+							SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d] index = %d, sent networkCommand [%s]\n",
+								extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, idx, data.commands[idx].toString().c_str());
+						}
+					}
+					return;
+				}
+				// too large for the compact header, peers that read the
+				// compact format read the old one as well
+			}
+			data.messageType = nmtCommandList;
+
 			assert(data.messageType == nmtCommandList);
 			uint16 totalCommand = data.header.commandCount;
 			toEndianHeader();
 			toEndianDetail(totalCommand);
 
-			unsigned char *buf = NULL;
-			//bool result = false;
 			if (useOldProtocol == true) {
 				//printf("<===== OUT Network hdr cmd type: frame: %d totalCommand: %u [%u]\n",data.header.frameCount,totalCommand,data.header.commandCount);
-				//NetworkMessage::send(socket, &data.messageType, sizeof(data.messageType));
-
-				//NetworkMessage::send(socket, &data.header, commandListHeaderSize, data.messageType);
-				unsigned char *send_buffer = getData();
-				int headerSize = sizeof(data.header);
-				uint16 totalCommand = data.header.commandCount;
-				int detailSize = (sizeof(NetworkCommand) * totalCommand);
-				int fullBufferSize = headerSize + detailSize;
-				NetworkMessage::send(socket, send_buffer, fullBufferSize, data.messageType);
-				delete[] send_buffer;
+				// type, header and commands go out together straight from data
+				const void *buffers[] = { &data.messageType, &data.header, (totalCommand > 0 ? &data.commands[0] : NULL) };
+				const int bufferSizes[] = { (int) sizeof(data.messageType), (int) sizeof(data.header), (int) (sizeof(NetworkCommand) * totalCommand) };
+				NetworkMessage::send(socket, buffers, bufferSizes, 3);
 			} else {
-				//NetworkMessage::send(socket, &data.header, commandListHeaderSize);
-				buf = packMessageHeader();
-				//if(totalCommand) printf("\n\nSend packet size = %u data.messageType = %d\n%s\ncommandcount [%u] framecount [%d]\n",getPackedSizeHeader(),data.header.messageType,buf,totalCommand,data.header.frameCount);
-				NetworkMessage::send(socket, buf, getPackedSizeHeader());
-				delete[] buf;
-			}
-
-			if (totalCommand > 0) {
-				//printf("\n#2 Send packet commandcount [%u] framecount [%d]\n",totalCommand,data.header.frameCount);
-				//toEndianDetail(totalCommand);
-				//printf("\n#3 Send packet commandcount [%u] framecount [%d]\n",totalCommand,data.header.frameCount);
-
-				//bool result = false;
-				if (useOldProtocol == true) {
-					//			if(data.commands[0].getNetworkCommandType() == nctPauseResume) {
-					//				printf("<===== OUT Network cmd type: %d [%d] frame: %d totalCommand: %u [%u]\n",data.commands[0].getNetworkCommandType(),nctPauseResume,data.header.frameCount,totalCommand,data.header.commandCount);
-					//			}
-								//NetworkMessage::send(socket, &data.commands[0], (sizeof(NetworkCommand) * totalCommand));
-				} else {
-					buf = packMessageDetail(totalCommand);
-					//printf("\n#4 Send packet commandcount [%u] framecount [%d]\n",totalCommand,data.header.frameCount);
-					//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
-					NetworkMessage::send(socket, buf, getPackedSizeDetail(totalCommand));
-					//printf("\n#5 Send packet commandcount [%u] framecount [%d]\n",totalCommand,data.header.frameCount);
-					delete[] buf;
-					//printf("\n#6 Send packet commandcount [%u] framecount [%d]\n",totalCommand,data.header.frameCount);
-
-			//        for(int idx = 0 ; idx < totalCommand; ++idx) {
-			//            const NetworkCommand &cmd = data.commands[idx];
-			//            printf("========> Send index = %d / %u, sent networkCommand [%s]\n",idx, totalCommand,cmd.toString().c_str());
-			//        }
+				// header and commands packed into one buffer and sent at once
+				unsigned int headerSize = getPackedSizeHeader();
+				unsigned int detailSize = getPackedSizeDetail(totalCommand);
+				NetworkMessageBuffer packedBuffer;
+				std::vector<unsigned char> &packed = packedBuffer.get();
+				packed.resize(headerSize + detailSize + 1);
+				packMessageHeader(&packed[0]);
+				if (totalCommand > 0) {
+					packMessageDetail(&packed[headerSize], totalCommand);
 				}
+				//if(totalCommand) printf("\n\nSend packet size = %u data.messageType = %d\n%s\ncommandcount [%u] framecount [%d]\n",getPackedSizeHeader(),data.header.messageType,buf,totalCommand,data.header.frameCount);
+				NetworkMessage::send(socket, &packed[0], headerSize + detailSize);
 			}
 
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled == true) {
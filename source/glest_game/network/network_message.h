@@ -28,6 +28,7 @@
 #include "network_types.h"
 #include "byte_order.h"
 #include <map>
+#include <vector>
 #include "common_scoped_ptr.h"
 #include "leak_dumper.h"
 
@@ -61,6 +62,7 @@ namespace Glest {
 			nmtMarkCell,
 			nmtUnMarkCell,
 			nmtHighlightCell,
+			nmtCommandListCompact,
 			//	nmtCompressedPacket,
 
 			nmtCount
@@ -77,6 +79,41 @@ namespace Glest {
 		static const int maxLanguageStringSize = 60;
 		static const int maxNetworkMessageSize = 20000;
 
+		// =====================================================
+		//	class NetworkMessageBuffer
+		//
+		//	Bytes to serialize a message into, lent from a pool on
+		//	first use and given back when this goes away, so the
+		//	messages of every network frame reuse the same memory
+		// =====================================================
+
+		class NetworkMessageBuffer {
+		private:
+			static const unsigned int maxPooledBuffers = 16;
+			// larger ones (launch messages) are freed instead of kept
+			static const unsigned int maxPooledCapacity = 65536;
+
+			static auto_ptr<Mutex> mutexPool;
+			static std::vector<std::vector<unsigned char> > pool;
+			static int64 allocationCount;
+
+			std::vector<unsigned char> buffer;
+			bool lent;
+			size_t lentCapacity;
+
+			NetworkMessageBuffer(const NetworkMessageBuffer &);
+			NetworkMessageBuffer &operator=(const NetworkMessageBuffer &);
+
+		public:
+			NetworkMessageBuffer();
+			~NetworkMessageBuffer();
+
+			std::vector<unsigned char> &get();
+
+			// Times a buffer had to be allocated or grown since the start
+			static int64 getAllocationCount();
+		};
+
 		// =====================================================
 		//	class NetworkMessage
 		// =====================================================
@@ -116,6 +153,14 @@ namespace Glest {
 			static Chrono lastRecv;
 			static std::map<NetworkMessageStatisticType, int64> mapMessageStats;
 
+			// the DebugNetworkPacket* settings, read again when the config
+			// changes since dump_packet runs for every packet
+			static int debugFlagsChangeCount;
+			static bool debugPacketStats;
+			static bool debugPackets;
+			static bool debugPacketSizes;
+			static void updateDebugFlags();
+
 		public:
 			static void resetNetworkPacketStats();
 			static string getNetworkPacketStats();
@@ -136,7 +181,9 @@ namespace Glest {
 
 			virtual NetworkMessageType getNetworkMessageType() const = 0;
 
-			void dump_packet(string label, const void* data, int dataSize, bool isSend);
+			void dump_packet(const char *label, const void* data, int dataSize, bool isSend);
+			// one message sent from several buffers counts and dumps as one packet
+			void dump_packet(const char *label, const void *const buffers[], const int bufferSizes[], int bufferCount, bool isSend);
 
 		protected:
 			//bool peek(Socket* socket, void* data, int dataSize);
@@ -144,6 +191,8 @@ namespace Glest {
 			void send(Socket* socket, const void* data, int dataSize);
 			void send(Socket* socket, const void* data, int dataSize, int8 messageType);
 			void send(Socket* socket, const void* data, int dataSize, int8 messageType, uint32 compressedLength);
+			// Sends the parts as one message without copying them together
+			void send(Socket* socket, const void *const buffers[], const int bufferSizes[], int bufferCount);
 
 			virtual const char * getPackedMessageFormat() const = 0;
 			virtual unsigned int getPackedSize() = 0;
@@ -160,6 +209,12 @@ namespace Glest {
 
 #pragma pack(push, 1)
 		class NetworkMessageIntro : public NetworkMessage {
+		public:
+			// Newest command list wire format this build understands. The intro
+			// layout is fixed, so the version travels as a suffix of the platform
+			// string, peers that don't send it only understand version 0.
+			static const int commandListVersion = 1;
+
 		private:
 			static const int maxVersionStringSize = 128;
 			static const int maxNameSize = 32;
@@ -241,9 +296,8 @@ namespace Glest {
 			string getPlayerUUID() const {
 				return data.playerUUID.getString();
 			}
-			string getPlayerPlatform() const {
-				return data.platform.getString();
-			}
+			string getPlayerPlatform() const;
+			int getCommandListVersion() const;
 
 			virtual bool receive(Socket* socket);
 			virtual void send(Socket* socket);
@@ -475,6 +529,12 @@ namespace Glest {
 		//	class CommandList
 		//
 		//	Message to order a commands to several units
+		//
+		//	The compact format (nmtCommandListCompact, command list
+		//	version 1) is only sent to peers that announced it in
+		//	their intro: a small header followed by a varint payload
+		//	where each command only carries the fields that differ
+		//	from the previous one, optionally zlib compressed.
 		// =====================================================
 
 #pragma pack(push, 1)
@@ -511,6 +571,15 @@ namespace Glest {
 
 		private:
 			Data data;
+			bool compact;
+			// The compact form is packed once and sent to every client
+			NetworkMessageBuffer compactMessage;
+			bool compactMessagePacked;
+
+			void packCompactPayload(std::vector<unsigned char> &payload) const;
+			bool unpackCompactPayload(const unsigned char *buf, unsigned int size);
+			bool packCompactMessage(std::vector<unsigned char> &message, bool allowCompression) const;
+			bool receiveCompact(Socket* socket);
 
 		protected:
 			virtual const char * getPackedMessageFormat() const {
@@ -528,15 +597,15 @@ namespace Glest {
 			const char * getPackedMessageFormatHeader() const;
 			unsigned int getPackedSizeHeader();
 			void unpackMessageHeader(unsigned char *buf);
-			unsigned char * packMessageHeader();
+			void packMessageHeader(unsigned char *buf);
 
 			const char * getPackedMessageFormatDetail() const;
 			unsigned int getPackedSizeDetail(int count);
 			void unpackMessageDetail(unsigned char *buf, int count);
-			unsigned char * packMessageDetail(uint16 totalCommand);
+			void packMessageDetail(unsigned char *buf, uint16 totalCommand);
 
 		public:
-			explicit NetworkMessageCommandList(int32 frameCount = -1);
+			explicit NetworkMessageCommandList(int32 frameCount = -1, bool compact = false);
 
 			virtual size_t getDataSize() const {
 				return sizeof(Data);
@@ -544,13 +613,27 @@ namespace Glest {
 			virtual unsigned char * getData();
 
 			virtual NetworkMessageType getNetworkMessageType() const {
-				return nmtCommandList;
+				return (compact == true ? nmtCommandListCompact : nmtCommandList);
+			}
+
+			bool getCompact() const {
+				return compact;
+			}
+			void setCompact(bool value) {
+				compact = value;
+				compactMessagePacked = false;
 			}
 
+			// bytes this list takes on the wire in each format, used to
+			// compare them on recorded games
+			unsigned int getLegacyWireSize(bool packed);
+			unsigned int getCompactWireSize(bool allowCompression) const;
+
 			bool addCommand(const NetworkCommand* networkCommand);
 
 			void clear() {
 				data.header.commandCount = 0;
+				compactMessagePacked = false;
 			}
 			int getCommandCount() const {
 				return data.header.commandCount;
@@ -563,6 +646,7 @@ namespace Glest {
 			}
 			void setNetworkPlayerFactionCRC(int index, uint32 crc) {
 				data.header.networkPlayerFactionCRC[index] = crc;
+				compactMessagePacked = false;
 			}
 
 			const NetworkCommand* getCommand(int i) const {
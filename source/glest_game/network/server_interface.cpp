@@ -85,6 +85,7 @@ namespace Glest {
 			gameStartTime = 0;
 			resumeGameStartTime = 0;
 			publishToMasterserverThread = NULL;
+			socketReactorThread = NULL;
 			lastMasterserverHeartbeatTime = 0;
 			needToRepublishToMasterserver = false;
 			ftpServer = NULL;
@@ -275,10 +276,46 @@ namespace Glest {
 			}
 		}
 
+		void ServerInterface::startSocketReactor() {
+			if (socketReactorThread != NULL || SocketReactor::isSupported() == false ||
+				Config::getInstance().getBool("EnableServerSocketReactor", "true") == false) {
+				return;
+			}
+
+			socketReactorThread = new ConnectionSlotReactorThread(this);
+			if (socketReactorThread->isReactorOpen() == false) {
+				// Keep one thread per slot
+				delete socketReactorThread;
+				socketReactorThread = NULL;
+				return;
+			}
+			static string mutexOwnerId = string(extractFileFromDirectoryPath(__FILE__).c_str()) + string("_") + intToStr(__LINE__);
+			socketReactorThread->setUniqueID(mutexOwnerId);
+			socketReactorThread->start();
+
+			if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d] socket reactor started\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__);
+		}
+
+		void ServerInterface::shutdownSocketReactor() {
+			if (socketReactorThread != NULL) {
+				// Wait for the thread to leave execute(), it may be inside
+				// the reactor's wait which goes away with the thread object
+				if (socketReactorThread->shutdownAndWait() == true) {
+					delete socketReactorThread;
+				} else {
+					socketReactorThread->setDeleteSelfOnExecutionDone(true);
+				}
+				socketReactorThread = NULL;
+			}
+		}
+
 		ServerInterface::~ServerInterface() {
 			//printf("===> Destructor for ServerInterface\n");
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d]\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__);
 
+			// Stops reading the slots before they go away
+			shutdownSocketReactor();
+
 			masterController.clearSlaves(true);
 			exitServer = true;
 			for (int index = 0; index < GameConstants::maxPlayers; ++index) {
@@ -688,6 +725,19 @@ namespace Glest {
 			return connectedSlotCount;
 		}
 
+		bool ServerInterface::getConnectedSlotsSupportCompactCommandList() {
+			bool result = true;
+			for (int index = 0; exitServer == false && index < GameConstants::maxPlayers; ++index) {
+				MutexSafeWrapper safeMutexSlot(slotAccessorMutexes[index], CODE_AT_LINE_X(index));
+				if (slots[index] != NULL && slots[index]->isConnected() == true &&
+					slots[index]->getCommandListVersion() < 1) {
+					result = false;
+					break;
+				}
+			}
+			return result;
+		}
+
 		int64 ServerInterface::getNextEventId() {
 			nextEventId++;
 			if (nextEventId > INT_MAX) {
@@ -1658,7 +1708,11 @@ namespace Glest {
 			currentFrameCount = frameCount;
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d] currentFrameCount = %d, requestedCommands.size() = %d\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, currentFrameCount, requestedCommands.size());
 
-			NetworkMessageCommandList networkMessageCommandList(frameCount);
+			// one broadcast goes to all clients, a single older client keeps
+			// everyone on the old format
+			bool compactCommandList = (Config::getInstance().getBool("NetworkCommandListCompact", "true") &&
+				getConnectedSlotsSupportCompactCommandList() == true);
+			NetworkMessageCommandList networkMessageCommandList(frameCount, compactCommandList);
 			for (int index = 0; index < GameConstants::maxPlayers; ++index) {
 				networkMessageCommandList.setNetworkPlayerFactionCRC(index, this->getNetworkPlayerFactionCRC(index));
 			}
@@ -1899,6 +1953,8 @@ namespace Glest {
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s] START\n", __FUNCTION__);
 			Logger & logger = Logger::getInstance();
 			gameHasBeenInitiated = true;
+			// Before any slot is marked started, so no socket is read twice
+			startSocketReactor();
 			Chrono chrono;
 			chrono.start();
 
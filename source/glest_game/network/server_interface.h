@@ -100,6 +100,7 @@ namespace Glest {
 
 			SimpleTaskThread *publishToMasterserverThread;
 			Mutex *masterServerThreadAccessor;
+			ConnectionSlotReactorThread *socketReactorThread;
 			time_t lastMasterserverHeartbeatTime;
 			bool needToRepublishToMasterserver;
 
@@ -219,6 +220,8 @@ namespace Glest {
 			virtual Mutex *getSlotMutex(int playerIndex);
 			int getSlotCount();
 			int getConnectedSlotCount(bool authenticated);
+			// true when every connected client reads the compact command list
+			bool getConnectedSlotsSupportCompactCommandList();
 
 			int getOpenSlotCount();
 			bool launchGame(const GameSettings *gameSettings);
@@ -242,6 +245,9 @@ namespace Glest {
 
 			virtual void slotUpdateTask(ConnectionSlotEvent *event) {
 			};
+			virtual bool isSocketReactorActive() {
+				return socketReactorThread != NULL;
+			}
 			bool hasClientConnection();
 			virtual bool isClientConnected(int index);
 
@@ -336,6 +342,8 @@ namespace Glest {
 			void dispatchPendingHighlightCellMessages(std::vector <string> &errorMsgList);
 
 			void shutdownMasterserverPublishThread();
+			void startSocketReactor();
+			void shutdownSocketReactor();
 
 
 		};
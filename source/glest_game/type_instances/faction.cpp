@@ -224,6 +224,12 @@ namespace Glest {
 				units.push_back(this->findUnit(unitId));
 			}
 
+			// the update flags follow the order of units
+			unitUpdateFlags.clear();
+			for (unsigned int i = 0; i < units.size(); ++i) {
+				unitUpdateFlags.addUnit(units[i]);
+			}
+
 			//assert(originalUnitSize == units.size());
 		}
 
@@ -416,10 +422,15 @@ namespace Glest {
 						//printf("In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 
 						codeLocation = "9";
-						int unitCount = this->faction->getUnitCount();
+						// the checks below and the think pass of the world
+						// share one needToUpdate per unit
+						UnitUpdateFlags *updateFlags = this->faction->getUnitUpdateFlags();
+						updateFlags->refresh(currentTriggeredFrameIndex);
+
+						int unitCount = updateFlags->getCount();
 						for (int j = 0; j < unitCount; ++j) {
 							codeLocation = "10";
-							Unit *unit = this->faction->getUnit(j);
+							Unit *unit = updateFlags->getUnit(j);
 							if (unit == NULL) {
 								throw megaglest_runtime_error("unit == NULL");
 							}
@@ -429,7 +440,7 @@ namespace Glest {
 							if (minorDebugPerformance)
 								elapsed1 = chrono.getMillis();
 
-							bool update = unit->needToUpdate();
+							bool update = updateFlags->getNeedUpdate(j);
 
 							codeLocation = "12";
 							if (minorDebugPerformance
@@ -475,6 +486,10 @@ namespace Glest {
 										("world->getUnitUpdater() == NULL");
 								}
 
+								if (world->getUnitUpdater()->getThreadedThink() == true) {
+									world->getUnitUpdater()->thinkUnit(unit,
+										currentTriggeredFrameIndex);
+								}
 								world->getUnitUpdater()->updateUnitCommand(unit,
 									currentTriggeredFrameIndex);
 
@@ -658,6 +673,7 @@ namespace Glest {
 				intToStr(__LINE__));
 			deleteValues(units.begin(), units.end());
 			units.clear();
+			unitUpdateFlags.clear();
 
 			safeMutex.ReleaseLock();
 
@@ -699,6 +715,7 @@ namespace Glest {
 				intToStr(__LINE__));
 			deleteValues(units.begin(), units.end());
 			units.clear();
+			unitUpdateFlags.clear();
 
 			safeMutex.ReleaseLock();
 
@@ -1611,6 +1628,7 @@ namespace Glest {
 				intToStr(__LINE__));
 			units.push_back(unit);
 			unitMap[unit->getId()] = unit;
+			unitUpdateFlags.addUnit(unit);
 		}
 
 		void Faction::removeUnit(Unit * unit) {
@@ -1625,6 +1643,7 @@ namespace Glest {
 				if (units[i]->getId() == unitId) {
 					units.erase(units.begin() + i);
 					unitMap.erase(unitId);
+					unitUpdateFlags.removeUnit(i);
 					assert(units.size() == unitMap.size());
 					return;
 				}
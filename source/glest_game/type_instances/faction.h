@@ -27,6 +27,7 @@
 #   include "base_thread.h"
 #   include <set>
 #   include "faction_type.h"
+#   include "unit_update_flags.h"
 #   include "leak_dumper.h"
 
 using std::map;
@@ -146,6 +147,7 @@ namespace Glest {
 			Mutex *unitsMutex;
 			Units units;
 			UnitMap unitMap;
+			UnitUpdateFlags unitUpdateFlags;
 			World *world;
 			ScriptManager *scriptManager;
 
@@ -358,6 +360,9 @@ namespace Glest {
 			inline Mutex *getUnitMutex() {
 				return unitsMutex;
 			}
+			inline UnitUpdateFlags *getUnitUpdateFlags() {
+				return &unitUpdateFlags;
+			}
 
 			inline const UpgradeManager *getUpgradeManager() const {
 				return &upgradeManager;
@@ -657,6 +657,7 @@ namespace Glest {
 			lastStuckPos = Vec2i(0, 0);
 			lastPathfindFailedFrame = 0;
 			lastPathfindFailedPos = Vec2i(0, 0);
+			cachedRangeUnitsFrame = -1;
 			usePathfinderExtendedMaxNodes = false;
 			this->currentAttackBoostOriginatorEffect.skillType = NULL;
 			lastAttackerUnitId = -1;
@@ -5491,21 +5492,9 @@ namespace Glest {
 					throw megaglest_runtime_error("game->getWorld() == NULL");
 				}
 
-				// Try the local unit exploration cache
-				if (!forceRefresh &&
-					cacheExploredCellsKey.first == newPos &&
-					cacheExploredCellsKey.second == sightRange) {
-					game->getWorld()->exploreCells(teamIndex, cacheExploredCells);
-				} else {
-					// Try the world exploration scan or possible cache
-					cacheExploredCells =
-						game->getWorld()->exploreCells(newPos, sightRange, teamIndex,
-							this);
-
-					// Cache the result for this unit
-					cacheExploredCellsKey.first = newPos;
-					cacheExploredCellsKey.second = sightRange;
-				}
+				// Only counts the cells again when the position, sight or
+				// team changed since the last call
+				game->getWorld()->exploreCells(this, newPos, sightRange, teamIndex, forceRefresh);
 			}
 		}
 
@@ -5736,11 +5725,6 @@ namespace Glest {
 			cachedFow.surfPosAlphaList.clear();
 			cachedFowPos = Vec2i(0, 0);
 
-			cacheExploredCells.exploredCellList.clear();
-			cacheExploredCells.visibleCellList.clear();
-			cacheExploredCellsKey.first = Vec2i(-1, -1);
-			cacheExploredCellsKey.second = -1;
-
 			if (unitPath != NULL) {
 				unitPath->clearCaches();
 			}
@@ -7083,7 +7067,7 @@ namespace Glest {
 			}
 
 			//TotalUpgrade totalUpgrade;
-			uint32 crc = totalUpgrade.getCRC().getSum();
+			uint32 crc = totalUpgrade.getCRCSum();
 			crcForUnit.addBytes(&crc, sizeof(uint32));
 
 			//Map *map;
@@ -7192,8 +7176,12 @@ namespace Glest {
 			//CauseOfDeathType causeOfDeath;
 
 			//uint32 pathfindFailedConsecutiveFrameCount;
-			crcForUnit.addString(this->
-				currentPathFinderDesiredFinalPos.getString());
+			// The text of Vec2i::getString() without a stream every frame
+			char szDesiredFinalPos[64] = "";
+			snprintf(szDesiredFinalPos, 64, "x [%d] y [%d]",
+				currentPathFinderDesiredFinalPos.x,
+				currentPathFinderDesiredFinalPos.y);
+			crcForUnit.addBytes(szDesiredFinalPos, strlen(szDesiredFinalPos));
 
 			crcForUnit.addInt(random.getLastNumber());
 			if (this->random.getLastCaller() != "") {
@@ -565,8 +565,11 @@ namespace Glest {
 			FowAlphaCellsLookupItem cachedFow;
 			Vec2i cachedFowPos;
 
-			ExploredCellsLookupItem cacheExploredCells;
-			std::pair < Vec2i, int >cacheExploredCellsKey;
+			// units around the unit found by the think pass of a frame,
+			// see UnitUpdater::thinkUnit
+			vector < Unit * >cachedRangeUnits;
+			std::pair < Vec2i, int >cachedRangeUnitsKey;
+			int32 cachedRangeUnitsFrame;
 
 			Vec2i lastHarvestedResourcePos;
 
@@ -587,6 +590,26 @@ namespace Glest {
 				game = value;
 			}
 
+			inline void setCachedRangeUnits(int frame, const Vec2i & pos, int range,
+				const vector < Unit * >&units) {
+				cachedRangeUnits = units;
+				cachedRangeUnitsKey = std::make_pair(pos, range);
+				cachedRangeUnitsFrame = frame;
+			}
+			// units found around pos in the think pass of frame, NULL when
+			// the pass did not run for this frame, pos or range
+			inline const vector < Unit * >*getCachedRangeUnits(int frame,
+				const Vec2i & pos, int range) const {
+				if (cachedRangeUnitsFrame != frame || cachedRangeUnitsKey.first != pos ||
+					cachedRangeUnitsKey.second < range) {
+					return NULL;
+				}
+				return &cachedRangeUnits;
+			}
+			inline int getCachedRangeUnitsFrame() const {
+				return cachedRangeUnitsFrame;
+			}
+
 			inline int getPathFindRefreshCellCount() const {
 				return pathFindRefreshCellCount;
 			}
@@ -659,6 +682,9 @@ namespace Glest {
 			inline int getProgress2() const {
 				return progress2;
 			}
+			inline int64 getProgress() const {
+				return progress;
+			}
 			inline int getFactionIndex() const {
 				return faction->getIndex();
 			}
@@ -0,0 +1,75 @@
+//
+//      unit_update_flags.cpp: which units of a faction need an update this frame
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#include "unit_update_flags.h"
+
+#include "unit.h"
+#include "conversion.h"
+#include "leak_dumper.h"
+
+using namespace std;
+using namespace Shared::Util;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		// 	class UnitUpdateFlags
+		// =====================================================
+
+		UnitUpdateFlags::UnitUpdateFlags() {
+			frame = -1;
+		}
+
+		void UnitUpdateFlags::addUnit(Unit *unit) {
+			units.push_back(unit);
+			// not known until the next refresh, update it like before
+			needUpdates.push_back(1);
+
+			// invalidate the flags so a refresh is not skipped this frame
+			frame = -1;
+		}
+
+		void UnitUpdateFlags::removeUnit(int index) {
+			if (index < 0 || index >= (int) units.size()) {
+				throw megaglest_runtime_error("Invalid unit update flags index: " + intToStr(index));
+			}
+			units.erase(units.begin() + index);
+			needUpdates.erase(needUpdates.begin() + index);
+			frame = -1;
+		}
+
+		void UnitUpdateFlags::clear() {
+			units.clear();
+			needUpdates.clear();
+			frame = -1;
+		}
+
+		void UnitUpdateFlags::refresh(int frame) {
+			for (int i = 0; i < (int) units.size(); ++i) {
+				needUpdates[i] = (units[i]->needToUpdate() == true);
+			}
+			this->frame = frame;
+		}
+
+	}
+} //end namespace
@@ -0,0 +1,85 @@
+//
+//      unit_update_flags.h: which units of a faction need an update this frame
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _GLEST_GAME_UNITUPDATEFLAGS_H_
+#define _GLEST_GAME_UNITUPDATEFLAGS_H_
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <winsock.h>
+#endif
+
+#include <vector>
+#include "leak_dumper.h"
+
+using std::vector;
+
+namespace Glest {
+	namespace Game {
+
+		class Unit;
+
+		// =====================================================
+		//	class UnitUpdateFlags
+		//
+		///	Unit::needToUpdate of every unit of a faction, in the
+		///	order of Faction::getUnit, worked out once a frame. The
+		///	faction thread and the think pass of the world both ask
+		///	it, and it walks the skill speed and the map heights.
+		// =====================================================
+
+		class UnitUpdateFlags {
+		private:
+			vector<Unit *> units;
+			vector<char> needUpdates;
+			int frame;
+
+		public:
+			UnitUpdateFlags();
+
+			void addUnit(Unit *unit);
+			// index in Faction::getUnit
+			void removeUnit(int index);
+			void clear();
+
+			// asks every unit, run before the update loops of a frame
+			void refresh(int frame);
+			int getFrame() const {
+				return frame;
+			}
+
+			int getCount() const {
+				return (int) units.size();
+			}
+			Unit *getUnit(int index) const {
+				return units[index];
+			}
+			// Unit::needToUpdate at the time of the last refresh
+			bool getNeedUpdate(int index) const {
+				return needUpdates[index] != 0;
+			}
+		};
+
+	}
+} //end namespace
+
+#endif
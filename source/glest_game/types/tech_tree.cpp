@@ -16,6 +16,7 @@
 #include "util.h"
 #include "resource.h"
 #include "faction_type.h"
+#include "tech_tree_preloader.h"
 #include "logger.h"
 #include "xml_parser.h"
 #include "platform_util.h"
@@ -403,6 +404,17 @@ namespace Glest {
 			try {
 				factionTypes.resize(factions.size());
 
+				// Decodes the files of the factions on worker threads ahead
+				// of the loop below, what it didn't get to is dropped after
+				auto_ptr < TechTreePreloader > preloader;
+				if (TechTreePreloader::isEnabled() == true) {
+					preloader.reset(new TechTreePreloader(treePath, pathList));
+					for (set < string >::iterator it = factions.begin();
+						it != factions.end(); ++it) {
+						preloader->addFaction(*it);
+					}
+				}
+
 				int i = 0;
 				for (set < string >::iterator it = factions.begin();
 					it != factions.end(); ++it) {
@@ -0,0 +1,203 @@
+//
+//      tech_tree_cache.cpp: loaded tech trees kept between the games of a
+//                           headless server
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#include "tech_tree_cache.h"
+
+#include "tech_tree.h"
+#include "config.h"
+#include "lang.h"
+#include "properties.h"
+#include "util.h"
+#include "platform_util.h"
+#include "leak_dumper.h"
+
+using namespace Shared::Util;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		//	class TechTreeCache
+		// =====================================================
+
+		TechTreeCache::TechTreeCache() : mutex(CODE_AT_LINE) {
+			useCount = 0;
+		}
+
+		TechTreeCache &TechTreeCache::getInstance() {
+			static TechTreeCache techTreeCache;
+			return techTreeCache;
+		}
+
+		bool TechTreeCache::isEnabled() {
+			return GlobalStaticFlags::getIsNonGraphicalModeEnabled() == true &&
+				Config::getInstance().getBool("HeadlessServerShareTechTrees", "true") == true;
+		}
+
+		TechTree *TechTreeCache::acquire(const vector<string> &pathList, const string &techName,
+			set<string> &factions, Checksum *checksum,
+			std::map<string, vector<pair<string, string> > > &loadedFileList,
+			Checksum &techtreeChecksum) {
+
+			TechTree *techTree = NULL;
+			string path = TechTree::findPath(techName, pathList);
+			if (path == "") {
+				// let loadTech report it
+				techTree = new TechTree(pathList);
+				techtreeChecksum = techTree->loadTech(techName, factions, checksum, loadedFileList);
+				return techTree;
+			}
+			endPathWithSlash(path);
+
+			string key = path;
+			for (set<string>::const_iterator iterSet = factions.begin(); iterSet != factions.end(); ++iterSet) {
+				key += "|" + *iterSet;
+			}
+
+			MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+			std::map<string, Entry>::iterator iterFind = entries.find(key);
+			if (iterFind != entries.end() && iterFind->second.inUse == false) {
+				Entry &entry = iterFind->second;
+
+				// The data may have been updated on disk since, a download
+				// clears the checksum file cache so the files are read again
+				Checksum files = entry.files;
+				if (files.getFinalFileListSum() == entry.fileListSum) {
+					entry.inUse = true;
+					entry.lastUsed = ++useCount;
+
+					// What TechTree::load does besides filling the tree
+					Lang::getInstance().loadTechTreeStrings(entry.techTree->getNameUntranslated(), true);
+					Properties::setTechtreePath(entry.techTree->getPath());
+
+					checksum->addFileList(entry.files);
+					for (std::map<string, vector<pair<string, string> > >::const_iterator iterMap = entry.loadedFileList.begin();
+						iterMap != entry.loadedFileList.end(); ++iterMap) {
+						vector<pair<string, string> > &fileList = loadedFileList[iterMap->first];
+						fileList.insert(fileList.end(), iterMap->second.begin(), iterMap->second.end());
+					}
+					techtreeChecksum = entry.techtreeChecksum;
+
+					if (SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem, "In [%s::%s Line: %d] reusing loaded techtree [%s]\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, key.c_str());
+					return entry.techTree;
+				}
+
+				if (SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem, "In [%s::%s Line: %d] techtree [%s] changed on disk, loading it again\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, key.c_str());
+				delete entry.techTree;
+				entries.erase(iterFind);
+				iterFind = entries.end();
+			}
+
+			// Load into a checksum of our own to know which files to give
+			// the next games
+			Checksum files;
+			std::map<string, vector<pair<string, string> > > treeLoadedFileList;
+			techTree = new TechTree(pathList);
+			try {
+				techtreeChecksum = techTree->loadTech(techName, factions, &files, treeLoadedFileList);
+			} catch (...) {
+				delete techTree;
+				throw;
+			}
+
+			checksum->addFileList(files);
+			for (std::map<string, vector<pair<string, string> > >::const_iterator iterMap = treeLoadedFileList.begin();
+				iterMap != treeLoadedFileList.end(); ++iterMap) {
+				vector<pair<string, string> > &fileList = loadedFileList[iterMap->first];
+				fileList.insert(fileList.end(), iterMap->second.begin(), iterMap->second.end());
+			}
+
+			// Another game is still using the cached one, this tree is its own
+			if (iterFind != entries.end()) {
+				return techTree;
+			}
+
+			evictUnused(max(getMaxUnusedCount() - 1, 0));
+
+			Entry &entry = entries[key];
+			entry.techTree = techTree;
+			entry.inUse = true;
+			entry.lastUsed = ++useCount;
+			entry.files = files;
+			entry.fileListSum = files.getFinalFileListSum();
+			entry.techtreeChecksum = techtreeChecksum;
+			entry.loadedFileList = treeLoadedFileList;
+			return techTree;
+		}
+
+		bool TechTreeCache::release(TechTree *techTree) {
+			if (techTree == NULL) {
+				return false;
+			}
+
+			MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+			for (std::map<string, Entry>::iterator iterMap = entries.begin();
+				iterMap != entries.end(); ++iterMap) {
+				if (iterMap->second.techTree == techTree) {
+					iterMap->second.inUse = false;
+					evictUnused(getMaxUnusedCount());
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Unused trees kept for the next games. Each holds all the types of a
+		// tech tree, so only the last one is kept unless configured otherwise,
+		// 0 frees a tree as soon as its game ends
+		int TechTreeCache::getMaxUnusedCount() {
+			return max(Config::getInstance().getInt("HeadlessServerTechTreeCacheSize", "1"), 0);
+		}
+
+		void TechTreeCache::evictUnused(int keepCount) {
+			int unusedCount = 0;
+			for (std::map<string, Entry>::iterator iterMap = entries.begin();
+				iterMap != entries.end(); ++iterMap) {
+				if (iterMap->second.inUse == false) {
+					unusedCount++;
+				}
+			}
+			for (; unusedCount > keepCount; --unusedCount) {
+				std::map<string, Entry>::iterator iterOldest = entries.end();
+				for (std::map<string, Entry>::iterator iterMap = entries.begin();
+					iterMap != entries.end(); ++iterMap) {
+					if (iterMap->second.inUse == false &&
+						(iterOldest == entries.end() || iterMap->second.lastUsed < iterOldest->second.lastUsed)) {
+						iterOldest = iterMap;
+					}
+				}
+				if (iterOldest == entries.end()) {
+					break;
+				}
+				delete iterOldest->second.techTree;
+				entries.erase(iterOldest);
+			}
+		}
+
+		void TechTreeCache::clear() {
+			MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+			evictUnused(0);
+		}
+
+	}
+} //end namespace
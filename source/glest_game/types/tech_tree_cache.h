@@ -0,0 +1,108 @@
+//
+//      tech_tree_cache.h: loaded tech trees kept between the games of a
+//                         headless server
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _GLEST_GAME_TECHTREECACHE_H_
+#define _GLEST_GAME_TECHTREECACHE_H_
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <winsock.h>
+#endif
+
+#include <set>
+#include <map>
+#include <vector>
+#include <string>
+#include "checksum.h"
+#include "thread.h"
+#include "leak_dumper.h"
+
+using std::set;
+using std::map;
+using std::vector;
+using std::string;
+using std::pair;
+using Shared::Util::Checksum;
+using Shared::Platform::Mutex;
+
+namespace Glest {
+	namespace Game {
+
+		class TechTree;
+
+		// =====================================================
+		//	class TechTreeCache
+		//
+		///	Keeps the tech trees of finished games loaded so the
+		///	next game with the same tech and factions skips parsing
+		///	them. Only used without graphics: the types then hold no
+		///	textures or models of the renderer's game scope, and
+		///	nothing changes a loaded tech tree during a game.
+		// =====================================================
+
+		class TechTreeCache {
+		private:
+			class Entry {
+			public:
+				Entry() : techTree(NULL), inUse(false), lastUsed(0), fileListSum(0) {
+				}
+
+				TechTree *techTree;
+				bool inUse;
+				int64 lastUsed;
+				// what loading added to the game's checksum and file list,
+				// given again to every game that uses this tree
+				Checksum files;
+				uint32 fileListSum;
+				Checksum techtreeChecksum;
+				std::map<string, vector<pair<string, string> > > loadedFileList;
+			};
+
+			Mutex mutex;
+			std::map<string, Entry> entries;
+			int64 useCount;
+
+			TechTreeCache();
+			static int getMaxUnusedCount();
+			// frees the least recently used unused trees until keepCount are left
+			void evictUnused(int keepCount);
+
+		public:
+			static TechTreeCache &getInstance();
+			static bool isEnabled();
+
+			// Returns a tech tree loaded like TechTree::loadTech, shared with
+			// the earlier games that used the same one
+			TechTree *acquire(const vector<string> &pathList, const string &techName,
+				set<string> &factions, Checksum *checksum,
+				std::map<string, vector<pair<string, string> > > &loadedFileList,
+				Checksum &techtreeChecksum);
+			// false when techTree doesn't come from the cache
+			bool release(TechTree *techTree);
+			void clear();
+		};
+
+	}
+} //end namespace
+
+#endif
@@ -0,0 +1,447 @@
+//
+//      tech_tree_preloader.cpp: decodes the files of a tech tree's factions
+//                               on worker threads while the types load
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#include "tech_tree_preloader.h"
+
+#include <SDL.h>
+#include "tech_tree.h"
+#include "config.h"
+#include "properties.h"
+#include "model_manager.h"
+#include "model_header.h"
+#include "texture.h"
+#include "sound.h"
+#include "preload_cache.h"
+#include "platform_util.h"
+#include "conversion.h"
+#include "util.h"
+#include "leak_dumper.h"
+
+using namespace Shared::Util;
+using namespace Shared::Xml;
+using namespace Shared::Graphics;
+using namespace Shared::Sound;
+using namespace Shared::PlatformCommon;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		//	class TechTreePreloader
+		// =====================================================
+
+		static int getLoadThreadCount() {
+			// -1 is a thread per core, 0 loads everything on the main thread
+			int threadCount = Config::getInstance().getInt("LoadThreadCount", "-1");
+			if (threadCount < 0) {
+				threadCount = SDL_GetCPUCount();
+			}
+			return threadCount;
+		}
+
+		static string getFileExtension(const string &path) {
+			size_t pos = path.find_last_of('.');
+			return (pos != string::npos ? toLower(path.substr(pos + 1)) : "");
+		}
+
+		TechTreePreloader::TechTreePreloader(const string &techTreePath, const vector<string> &pathList) :
+			mutexJobs(CODE_AT_LINE) {
+			this->techTreePath = techTreePath;
+			this->techTreePathList = pathList;
+			loadGraphics = (GlobalStaticFlags::getIsNonGraphicalModeEnabled() == false);
+			chrono.start();
+
+			int threadCount = getLoadThreadCount();
+			for (int index = 0; index < threadCount; ++index) {
+				SimpleTaskThread *thread = new SimpleTaskThread(this, 0, 5, true);
+				thread->setUniqueID(CODE_AT_LINE);
+				thread->start();
+				workerThreads.push_back(thread);
+			}
+		}
+
+		TechTreePreloader::~TechTreePreloader() {
+			stopThreads();
+			report();
+			clearCaches();
+		}
+
+		bool TechTreePreloader::isEnabled() {
+			return getLoadThreadCount() > 0;
+		}
+
+		void TechTreePreloader::stopThreads() {
+			{
+				MutexSafeWrapper safeMutex(&mutexJobs, CODE_AT_LINE);
+				pendingJobs.clear();
+			}
+			for (unsigned int index = 0; index < workerThreads.size(); ++index) {
+				SimpleTaskThread *thread = workerThreads[index];
+				thread->setSimpleTaskInterfaceValid(false);
+				thread->signalQuit();
+			}
+			for (unsigned int index = 0; index < workerThreads.size(); ++index) {
+				SimpleTaskThread *thread = workerThreads[index];
+				if (thread->shutdownAndWait() == true) {
+					delete thread;
+				}
+			}
+			workerThreads.clear();
+		}
+
+		void TechTreePreloader::clearCaches() {
+			XmlTree::getPreloaded().clear();
+			ModelManager::getPreloaded().clear();
+			Texture2D::getPreloadedPixmaps().clear();
+			StaticSound::getPreloaded().clear();
+		}
+
+		void TechTreePreloader::report() {
+			bool showPerfStats = Config::getInstance().getBool("ShowPerfStats", "false");
+			if (showPerfStats == false && SystemFlags::VERBOSE_MODE_ENABLED == false &&
+				SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled == false) {
+				return;
+			}
+
+			int takenCount = XmlTree::getPreloaded().getTakenCount() +
+				ModelManager::getPreloaded().getTakenCount() +
+				Texture2D::getPreloadedPixmaps().getTakenCount() +
+				StaticSound::getPreloaded().getTakenCount();
+			int missedCount = XmlTree::getPreloaded().getMissedCount() +
+				ModelManager::getPreloaded().getMissedCount() +
+				Texture2D::getPreloadedPixmaps().getMissedCount() +
+				StaticSound::getPreloaded().getMissedCount();
+			int unusedCount = XmlTree::getPreloaded().getUnusedCount() +
+				ModelManager::getPreloaded().getUnusedCount() +
+				Texture2D::getPreloadedPixmaps().getUnusedCount() +
+				StaticSound::getPreloaded().getUnusedCount();
+
+			MutexSafeWrapper safeMutex(&mutexJobs, CODE_AT_LINE);
+			char szBuf[8096] = "";
+			snprintf(szBuf, 8096, "Tech tree [%s] loaded in " MG_I64_SPECIFIER " ms with %d load threads. "
+				"Worker time: xml %d files " MG_I64_SPECIFIER " ms, models %d files " MG_I64_SPECIFIER " ms, "
+				"textures %d files " MG_I64_SPECIFIER " ms, sounds %d files " MG_I64_SPECIFIER " ms. "
+				"Files taken %d, loaded before a worker got to them %d, unused %d\n",
+				techTreePath.c_str(), chrono.getMillis(), (int) workerThreads.size(),
+				timings[jtXml].count, timings[jtXml].millis,
+				timings[jtModel].count, timings[jtModel].millis,
+				timings[jtTexture].count, timings[jtTexture].millis,
+				timings[jtSound].count, timings[jtSound].millis,
+				takenCount, missedCount, unusedCount);
+			safeMutex.ReleaseLock();
+
+			if (showPerfStats || SystemFlags::VERBOSE_MODE_ENABLED) printf("%s", szBuf);
+			if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled) SystemFlags::OutputDebug(SystemFlags::debugPerformance, "In [%s::%s Line: %d] %s", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, szBuf);
+		}
+
+		void TechTreePreloader::addJob(const Job &job) {
+			MutexSafeWrapper safeMutex(&mutexJobs, CODE_AT_LINE);
+			pendingJobs.push_back(job);
+			safeMutex.ReleaseLock();
+
+			for (unsigned int index = 0; index < workerThreads.size(); ++index) {
+				workerThreads[index]->setTaskSignalled(true);
+			}
+		}
+
+		void TechTreePreloader::addFaction(const string &factionName) {
+			if (workerThreads.empty() == true) {
+				return;
+			}
+			Job job;
+			job.type = jtFaction;
+			job.path = factionName;
+			addJob(job);
+		}
+
+		void TechTreePreloader::addXmlJob(const string &path, const string &dir, const string &commonDataPath) {
+			std::map<string, string> mapExtraTagReplacementValues;
+			mapExtraTagReplacementValues["$COMMONDATAPATH"] = commonDataPath;
+
+			Job job;
+			job.type = jtXml;
+			job.path = path;
+			job.key = XmlTree::getPreloadKey(path, Properties::getTagReplacementValues(&mapExtraTagReplacementValues));
+			job.dir = dir;
+			job.commonDataPath = commonDataPath;
+			if (XmlTree::getPreloaded().reserve(job.key) == true) {
+				addJob(job);
+			}
+		}
+
+		void TechTreePreloader::addFileJob(const string &path, const XmlNode *node) {
+			string extension = getFileExtension(path);
+			Job job;
+			job.path = path;
+			if (extension == "g3d") {
+				job.type = jtModel;
+				job.key = path;
+				if (ModelManager::getPreloaded().reserve(job.key) == true) {
+					addJob(job);
+				}
+			} else if (extension == "png" || extension == "jpg" || extension == "jpeg" ||
+				extension == "tga" || extension == "bmp") {
+				// Particle textures may be luminance only, everything else
+				// gets the default components of a texture
+				job.type = jtTexture;
+				job.components = Texture::defaultComponents;
+				if (node->getName() == "texture" && node->hasAttribute("luminance") == true &&
+					node->getAttribute("luminance")->getBoolValue() == true) {
+					job.components = 1;
+				}
+				job.key = Texture2D::getPreloadKey(path, job.components);
+				if (Texture2D::getPreloadedPixmaps().reserve(job.key) == true) {
+					addJob(job);
+				}
+			} else if (node->getName() == "sound-file") {
+				// Only the sound effects, music streams as it plays
+				job.type = jtSound;
+				job.key = path;
+				if (StaticSound::getPreloaded().reserve(job.key) == true) {
+					addJob(job);
+				}
+			}
+		}
+
+		void TechTreePreloader::addFileJobs(const XmlNode *node, const string &dir, const string &commonDataPath) {
+			const XmlAttribute *pathAttribute = node->getAttribute("path", false);
+			if (pathAttribute != NULL) {
+				try {
+					string path = pathAttribute->getRestrictedValue(dir);
+					if (fileExists(path) == true) {
+						if (getFileExtension(path) == "xml") {
+							// Particle files name their files relative to the
+							// directory of the xml naming them, except for their
+							// own child particles
+							addXmlJob(path, dir, commonDataPath);
+						} else if (loadGraphics == true) {
+							addFileJob(path, node);
+						}
+					}
+				} catch (const exception &ex) {
+					// Left for the loader to report
+				}
+			}
+
+			for (unsigned int index = 0; index < node->getChildCount(); ++index) {
+				const XmlNode *childNode = node->getChild(index);
+				if (childNode->getName() == "child-particles") {
+					for (unsigned int childIndex = 0; childIndex < childNode->getChildCount(); ++childIndex) {
+						const XmlNode *particleFileNode = childNode->getChild(childIndex);
+						const XmlAttribute *childPathAttribute = particleFileNode->getAttribute("path", false);
+						if (childPathAttribute != NULL) {
+							string childPath = dir + childPathAttribute->getRestrictedValue();
+							if (fileExists(childPath) == true) {
+								addXmlJob(childPath, extractDirectoryPathFromFile(childPath), commonDataPath);
+							}
+						}
+					}
+				} else {
+					addFileJobs(childNode, dir, commonDataPath);
+				}
+			}
+		}
+
+		void TechTreePreloader::simpleTask(BaseThread *callingThread, void *userdata) {
+			for (; callingThread->getQuitStatus() == false;) {
+				MutexSafeWrapper safeMutex(&mutexJobs, CODE_AT_LINE);
+				if (pendingJobs.empty() == true) {
+					break;
+				}
+				Job job = pendingJobs.front();
+				pendingJobs.pop_front();
+				safeMutex.ReleaseLock();
+
+				Chrono chronoJob(true);
+				runJob(job);
+				int64 millis = chronoJob.getMillis();
+
+				safeMutex.Lock();
+				timings[job.type].count++;
+				timings[job.type].millis += millis;
+			}
+		}
+
+		void TechTreePreloader::runJob(const Job &job) {
+			switch (job.type) {
+				case jtFaction:
+					loadFaction(job);
+					break;
+				case jtXml:
+					loadXml(job);
+					break;
+				case jtModel:
+					loadModel(job);
+					break;
+				case jtTexture:
+					loadTexture(job);
+					break;
+				case jtSound:
+					loadSound(job);
+					break;
+				default:
+					break;
+			}
+		}
+
+		void TechTreePreloader::loadFaction(const Job &job) {
+			// The same walk over linked factions as FactionType::load
+			const string &factionName = job.path;
+			string factionTechTreePath = techTreePath;
+			string currentPath = "";
+			for (int linkCount = 0; linkCount < 16; ++linkCount) {
+				currentPath = factionTechTreePath + "factions/" + factionName;
+				endPathWithSlash(currentPath);
+				string path = currentPath + factionName + ".xml";
+				if (fileExists(path) == false) {
+					return;
+				}
+
+				try {
+					std::map<string, string> mapExtraTagReplacementValues;
+					XmlTree xmlTree;
+					xmlTree.setSkipPreloaded(true);
+					xmlTree.load(path, Properties::getTagReplacementValues(&mapExtraTagReplacementValues), false, true);
+
+					const XmlNode *rootNode = xmlTree.getRootNode();
+					if (rootNode->getName() != "link") {
+						break;
+					}
+					string linkedTechTreeName = rootNode->getChild("techtree")->getAttribute("name")->getRestrictedValue();
+					factionTechTreePath = TechTree::findPath(linkedTechTreeName, techTreePathList);
+					endPathWithSlash(factionTechTreePath);
+				} catch (const exception &ex) {
+					return;
+				}
+			}
+
+			addXmlJob(currentPath + factionName + ".xml", currentPath, factionTechTreePath + "/commondata/");
+
+			vector<string> unitNames;
+			findDirs(currentPath + "units/", unitNames, false, false);
+			for (unsigned int index = 0; index < unitNames.size(); ++index) {
+				string unitPath = currentPath + "units/" + unitNames[index];
+				endPathWithSlash(unitPath);
+				addXmlJob(unitPath + unitNames[index] + ".xml", unitPath, factionTechTreePath + "/commondata/");
+			}
+
+			// Upgrades of a linked faction use the loaded tech tree's
+			// common data
+			vector<string> upgradeNames;
+			findDirs(currentPath + "upgrades/", upgradeNames, false, false);
+			for (unsigned int index = 0; index < upgradeNames.size(); ++index) {
+				string upgradePath = currentPath + "upgrades/" + upgradeNames[index];
+				endPathWithSlash(upgradePath);
+				addXmlJob(upgradePath + upgradeNames[index] + ".xml", upgradePath, techTreePath + "/commondata/");
+			}
+		}
+
+		void TechTreePreloader::loadXml(const Job &job) {
+			if (XmlTree::getPreloaded().start(job.key) == false) {
+				return;
+			}
+
+			XmlTree *xmlTree = new XmlTree();
+			try {
+				std::map<string, string> mapExtraTagReplacementValues;
+				mapExtraTagReplacementValues["$COMMONDATAPATH"] = job.commonDataPath;
+				xmlTree->setSkipPreloaded(true);
+				xmlTree->load(job.path, Properties::getTagReplacementValues(&mapExtraTagReplacementValues), false, true);
+
+				// Particles and models named here are loaded with the tech
+				// tree's common data path, whatever the faction links to
+				addFileJobs(xmlTree->getRootNode(), job.dir, techTreePath + "/commondata/");
+			} catch (const exception &ex) {
+				delete xmlTree;
+				xmlTree = NULL;
+			}
+			XmlTree::getPreloaded().set(job.key, xmlTree);
+		}
+
+		void TechTreePreloader::loadModel(const Job &job) {
+			if (ModelManager::getPreloaded().start(job.key) == false) {
+				return;
+			}
+
+			Model *model = NULL;
+			try {
+				model = ModelManager::loadWithoutTextures(job.path);
+				if (model != NULL) {
+					// Queued before the model is handed over, so loading its
+					// textures finds them reserved
+					for (uint32 meshIndex = 0; meshIndex < model->getMeshCount(); ++meshIndex) {
+						const Mesh *mesh = model->getMesh(meshIndex);
+						for (int textureIndex = 0; textureIndex < MESH_TEXTURE_COUNT; ++textureIndex) {
+							const string &texturePath = mesh->getTexturePath(textureIndex);
+							if (texturePath != "" && fileExists(texturePath) == true) {
+								Job textureJob;
+								textureJob.type = jtTexture;
+								textureJob.path = texturePath;
+								textureJob.components = meshTextureChannelCount[textureIndex];
+								textureJob.key = Texture2D::getPreloadKey(texturePath, textureJob.components);
+								if (Texture2D::getPreloadedPixmaps().reserve(textureJob.key) == true) {
+									addJob(textureJob);
+								}
+							}
+						}
+					}
+				}
+			} catch (const exception &ex) {
+				delete model;
+				model = NULL;
+			}
+			ModelManager::getPreloaded().set(job.key, model);
+		}
+
+		void TechTreePreloader::loadTexture(const Job &job) {
+			if (Texture2D::getPreloadedPixmaps().start(job.key) == false) {
+				return;
+			}
+
+			Pixmap2D *pixmap = new Pixmap2D(job.components);
+			try {
+				pixmap->load(job.path);
+			} catch (const exception &ex) {
+				delete pixmap;
+				pixmap = NULL;
+			}
+			Texture2D::getPreloadedPixmaps().set(job.key, pixmap);
+		}
+
+		void TechTreePreloader::loadSound(const Job &job) {
+			if (StaticSound::getPreloaded().start(job.key) == false) {
+				return;
+			}
+
+			StaticSound *sound = new StaticSound();
+			try {
+				sound->loadFile(job.path);
+			} catch (const exception &ex) {
+				delete sound;
+				sound = NULL;
+			}
+			StaticSound::getPreloaded().set(job.key, sound);
+		}
+
+	}
+} //end namespace
@@ -0,0 +1,151 @@
+//
+//      tech_tree_preloader.h: decodes the files of a tech tree's factions on
+//                             worker threads while the types load
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _GLEST_GAME_TECHTREEPRELOADER_H_
+#define _GLEST_GAME_TECHTREEPRELOADER_H_
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <winsock.h>
+#endif
+
+#include <deque>
+#include <map>
+#include <vector>
+#include <string>
+#include "simple_threads.h"
+#include "platform_common.h"
+#include "xml_parser.h"
+#include "leak_dumper.h"
+
+using std::deque;
+using std::map;
+using std::vector;
+using std::string;
+using Shared::Xml::XmlNode;
+using Shared::PlatformCommon::BaseThread;
+using Shared::PlatformCommon::SimpleTaskThread;
+using Shared::PlatformCommon::SimpleTaskCallbackInterface;
+using Shared::PlatformCommon::Chrono;
+using Shared::Platform::Mutex;
+using Shared::Platform::int64;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		//	class TechTreePreloader
+		//
+		///	Loading a tech tree is a long run of parsing xml and
+		///	decoding models, images and sounds, one file after the
+		///	other. This walks the factions ahead of the loader on
+		///	LoadThreadCount threads: a parsed unit xml queues the
+		///	files it names, a decoded model queues its textures.
+		///	The results wait in the preload caches of XmlTree,
+		///	ModelManager, Texture2D and StaticSound, which the
+		///	normal loading code takes from, so the types still load
+		///	on the main thread in the same order and only the
+		///	texture and buffer uploads to OpenGL stay there.
+		// =====================================================
+
+		class TechTreePreloader : public SimpleTaskCallbackInterface {
+		private:
+			enum JobType {
+				jtFaction,
+				jtXml,
+				jtModel,
+				jtTexture,
+				jtSound,
+
+				jtCount
+			};
+
+			class Job {
+			public:
+				Job() : type(jtFaction), components(0) {
+				}
+
+				JobType type;
+				string path;
+				// the preload cache key, reserved when the job was queued
+				string key;
+				// files named in an xml are relative to this
+				string dir;
+				// the $COMMONDATAPATH of the loader of the xml
+				string commonDataPath;
+				int components;
+			};
+
+			class Timing {
+			public:
+				Timing() : count(0), millis(0) {
+				}
+
+				int count;
+				int64 millis;
+			};
+
+			Mutex mutexJobs;
+			deque<Job> pendingJobs;
+			Timing timings[jtCount];
+			vector<SimpleTaskThread *> workerThreads;
+
+			string techTreePath;
+			vector<string> techTreePathList;
+			bool loadGraphics;
+			Chrono chrono;
+
+			void addJob(const Job &job);
+			void addXmlJob(const string &path, const string &dir, const string &commonDataPath);
+			void addFileJob(const string &path, const XmlNode *node);
+			void addFileJobs(const XmlNode *node, const string &dir, const string &commonDataPath);
+
+			void runJob(const Job &job);
+			void loadFaction(const Job &job);
+			void loadXml(const Job &job);
+			void loadModel(const Job &job);
+			void loadTexture(const Job &job);
+			void loadSound(const Job &job);
+
+			void stopThreads();
+			void clearCaches();
+			void report();
+
+		public:
+			// techTreePath ends with a slash, pathList is the one given to
+			// the tech tree to find the tech trees of linked factions
+			TechTreePreloader(const string &techTreePath, const vector<string> &pathList);
+			// Drops what the loading didn't take
+			virtual ~TechTreePreloader();
+
+			static bool isEnabled();
+
+			void addFaction(const string &factionName);
+
+			virtual void simpleTask(BaseThread *callingThread, void *userdata);
+		};
+
+	}
+} //end namespace
+
+#endif
@@ -1299,6 +1299,9 @@ namespace Glest {
 		}
 
 		void TotalUpgrade::reset() {
+			crcSumValid = false;
+			crcSum = 0;
+
 			maxHp = 0;
 			maxHpIsMultiplier = false;
 			maxHpRegeneration = 0;
@@ -1335,6 +1338,7 @@ namespace Glest {
 
 		void TotalUpgrade::sum(const UpgradeTypeBase * ut, const Unit * unit,
 			bool boostMode) {
+			crcSumValid = false;
 			maxHpIsMultiplier = ut->getMaxHpIsMultiplier();
 			sightIsMultiplier = ut->getSightIsMultiplier();
 			maxEpIsMultiplier = ut->getMaxEpIsMultiplier();
@@ -1624,6 +1628,7 @@ namespace Glest {
 		void TotalUpgrade::apply(int sourceUnitId, const UpgradeTypeBase * ut,
 			const Unit * unit) {
 			//sum(ut, unit);
+			crcSumValid = false;
 
 			//printf("====> About to apply boost: %s\nTo unit: %d\n\n",ut->toString().c_str(),unit->getId());
 			TotalUpgrade *boostUpgrade = new TotalUpgrade();
@@ -1639,6 +1644,7 @@ namespace Glest {
 		void TotalUpgrade::deapply(int sourceUnitId, const UpgradeTypeBase * ut,
 			int destUnitId) {
 			//printf("<****** About to de-apply boost: %s\nTo unit: %d\n\n",ut->toString().c_str(),destUnitId);
+			crcSumValid = false;
 
 			bool removedBoost = false;
 			for (unsigned int index = 0; index < boostUpgrades.size(); ++index) {
@@ -1799,7 +1805,16 @@ namespace Glest {
 			return result;
 		}
 
+		uint32 TotalUpgrade::getCRCSum() {
+			if (crcSumValid == false) {
+				crcSum = getCRC().getSum();
+				crcSumValid = true;
+			}
+			return crcSum;
+		}
+
 		void TotalUpgrade::incLevel(const UnitType * ut) {
+			crcSumValid = false;
 			maxHp += ut->getMaxHp() * 50 / 100;
 			maxEp += ut->getMaxEp() * 50 / 100;
 			sight += ut->getSight() * 20 / 100;
@@ -2024,6 +2039,7 @@ namespace Glest {
 		}
 
 		void TotalUpgrade::loadGame(const XmlNode * rootNode) {
+			crcSumValid = false;
 			const XmlNode *upgradeTypeBaseNode =
 				rootNode->getChild("TotalUpgrade");
 
@@ -446,6 +446,11 @@ namespace Glest {
 			int boostUpgradeDestUnit;
 			std::vector < TotalUpgrade * >boostUpgrades;
 
+			// The checksum of a unit's upgrades is taken every frame for
+			// the network synch checks but only changes when they do
+			bool crcSumValid;
+			uint32 crcSum;
+
 		public:
 			TotalUpgrade();
 			virtual ~TotalUpgrade() {
@@ -495,6 +500,11 @@ namespace Glest {
 			void deapply(int sourceUnitId, const UpgradeTypeBase * ut,
 				int destUnitId);
 
+			/**
+		 * The sum of getCRC(), only computed again after the upgrades changed.
+		 */
+			uint32 getCRCSum();
+
 			virtual int getMaxHp() const;
 			virtual int getMaxHpRegeneration() const;
 			virtual int getSight() const;
@@ -146,6 +146,7 @@ namespace Glest {
 			for (int index = 0; index < GameConstants::maxPlayers + GameConstants::specialFactions; ++index) {
 				setVisible(index, false);
 				setExplored(index, false);
+				visibleCount[index] = 0;
 			}
 		}
 
@@ -201,29 +202,6 @@ namespace Glest {
 			}
 
 			this->visible[teamIndex] = visible;
-
-			if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true &&
-				SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
-				char szBuf[8096] = "";
-				snprintf(szBuf, 8096, "In setVisible() teamIndex %d visible %d", teamIndex, visible);
-
-				//		if(frameIndex < 0) {
-				//			unit->logSynchData(__FILE__,__LINE__,szBuf);
-				//		}
-				//		else {
-				//			unit->logSynchDataThreaded(__FILE__,__LINE__,szBuf);
-				//		}
-
-				if (Thread::isCurrentThreadMainThread()) {
-					//unit->logSynchDataThreaded(__FILE__,__LINE__,szBuf);
-					SystemFlags::OutputDebug(SystemFlags::debugWorldSynch, szBuf);
-				} else {
-					//unit->logSynchData(__FILE__,__LINE__,szBuf);
-					printf("%s", szBuf);
-				}
-
-			}
-
 		}
 
 		string SurfaceCell::isVisibleString() const {
@@ -345,6 +323,7 @@ namespace Glest {
 
 		const int Map::cellScale = 2;
 		const int Map::mapScale = 2;
+		const int Map::passabilityBlockSize = 16;
 
 		Map::Map() {
 			cells = NULL;
@@ -363,6 +342,9 @@ namespace Glest {
 			surfaceSize = (surfaceW * surfaceH);
 			maxPlayers = 0;
 			maxMapHeight = 0;
+			passabilityBlocksW = 0;
+			passabilityBlocksH = 0;
+			passabilityRevision = 0;
 		}
 
 		Map::~Map() {
@@ -495,6 +477,13 @@ namespace Glest {
 					cells = new Cell[getCellArraySize()];
 					surfaceCells = new SurfaceCell[getSurfaceCellArraySize()];
 
+					passabilityBlocksW = (w + passabilityBlockSize - 1) / passabilityBlockSize;
+					passabilityBlocksH = (h + passabilityBlockSize - 1) / passabilityBlockSize;
+					passabilityBlockRevision.assign(passabilityBlocksW * passabilityBlocksH, 0);
+					passabilityRevision = 0;
+					passabilityCache.init(w, h, fieldCount);
+					unitGrid.init(w, h);
+
 					//read heightmap
 					for (int j = 0; j < surfaceH; ++j) {
 						for (int i = 0; i < surfaceW; ++i) {
@@ -935,45 +924,23 @@ namespace Glest {
 		// ==================== unit placement ====================
 
 		//checks if a unit can move from between 2 cells
-		bool Map::canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<Field, bool> > > > *lookupCache) const {
+		bool Map::canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2) const {
 			int size = unit->getType()->getSize();
 			Field field = unit->getCurrField();
 
-			if (lookupCache != NULL) {
-				std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<Field, bool> > > >::const_iterator iterFind1 = lookupCache->find(pos1);
-				if (iterFind1 != lookupCache->end()) {
-					std::map<Vec2i, std::map<int, std::map<Field, bool> > >::const_iterator iterFind2 = iterFind1->second.find(pos2);
-					if (iterFind2 != iterFind1->second.end()) {
-						std::map<int, std::map<Field, bool> >::const_iterator iterFind3 = iterFind2->second.find(size);
-						if (iterFind3 != iterFind2->second.end()) {
-							std::map<Field, bool>::const_iterator iterFind4 = iterFind3->second.find(field);
-							if (iterFind4 != iterFind3->second.end()) {
-								// Found this result in the cache
-								return iterFind4->second;
-							}
-						}
-					}
-				}
-			}
-
-			for (int i = pos2.x; i < pos2.x + size; ++i) {
-				for (int j = pos2.y; j < pos2.y + size; ++j) {
-					if (isInside(i, j) && isInsideSurface(toSurfCoords(Vec2i(i, j)))) {
-						if (getCell(i, j)->getUnit(field) != unit) {
-							if (isFreeCell(Vec2i(i, j), field) == false) {
-								if (lookupCache != NULL) {
-									(*lookupCache)[pos1][pos2][size][field] = false;
+			// a cached free block needs no cell by cell check
+			if (isCachedFreeCells(pos2, size, field) == false) {
+				for (int i = pos2.x; i < pos2.x + size; ++i) {
+					for (int j = pos2.y; j < pos2.y + size; ++j) {
+						if (isInside(i, j) && isInsideSurface(toSurfCoords(Vec2i(i, j)))) {
+							if (getCell(i, j)->getUnit(field) != unit) {
+								if (isFreeCell(Vec2i(i, j), field) == false) {
+									return false;
 								}
-
-								return false;
 							}
+						} else {
+							return false;
 						}
-					} else {
-						if (lookupCache != NULL) {
-							(*lookupCache)[pos1][pos2][size][field] = false;
-						}
-
-						return false;
 					}
 				}
 			}
@@ -990,22 +957,14 @@ namespace Glest {
 			//}
 
 			if (isBadHarvestPos == true) {
-				if (lookupCache != NULL) {
-					(*lookupCache)[pos1][pos2][size][field] = false;
-				}
-
 				return false;
 			}
 
-			if (lookupCache != NULL) {
-				(*lookupCache)[pos1][pos2][size][field] = true;
-			}
-
 			return true;
 		}
 
 		//checks if a unit can move from between 2 cells using only visible cells (for pathfinding)
-		bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<int, std::map<Field, bool> > > > > *lookupCache) const {
+		bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2) const {
 			if (isInside(pos1) == false || isInsideSurface(toSurfCoords(pos1)) == false ||
 				isInside(pos2) == false || isInsideSurface(toSurfCoords(pos2)) == false) {
 
@@ -1020,45 +979,16 @@ namespace Glest {
 			int teamIndex = unit->getTeam();
 			Field field = unit->getCurrField();
 
-			if (lookupCache != NULL) {
-				std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<int, std::map<Field, bool> > > > >::const_iterator iterFind1 = lookupCache->find(pos1);
-				if (iterFind1 != lookupCache->end()) {
-					std::map<Vec2i, std::map<int, std::map<int, std::map<Field, bool> > > >::const_iterator iterFind2 = iterFind1->second.find(pos2);
-					if (iterFind2 != iterFind1->second.end()) {
-						std::map<int, std::map<int, std::map<Field, bool> > >::const_iterator iterFind3 = iterFind2->second.find(teamIndex);
-						if (iterFind3 != iterFind2->second.end()) {
-							std::map<int, std::map<Field, bool> >::const_iterator iterFind4 = iterFind3->second.find(size);
-							if (iterFind4 != iterFind3->second.end()) {
-								std::map<Field, bool>::const_iterator iterFind5 = iterFind4->second.find(field);
-								if (iterFind5 != iterFind4->second.end()) {
-									// Found this result in the cache
-									if (iterFind5->second == false) {
-										//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
-									}
-									return iterFind5->second;
-								}
-							}
-						}
-					}
-				}
-			}
-
 			//single cell units
 			if (size == 1) {
-				if (isAproxFreeCell(pos2, field, teamIndex) == false) {
-					if (lookupCache != NULL) {
-						(*lookupCache)[pos1][pos2][teamIndex][size][field] = false;
-					}
-
+				if (isCachedFreeCells(pos2, 1, field) == false &&
+					isAproxFreeCell(pos2, field, teamIndex) == false) {
 					//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
 					return false;
 				}
 				if (pos1.x != pos2.x && pos1.y != pos2.y) {
-					if (isAproxFreeCell(Vec2i(pos1.x, pos2.y), field, teamIndex) == false) {
-						if (lookupCache != NULL) {
-							(*lookupCache)[pos1][pos2][teamIndex][size][field] = false;
-						}
-
+					if (isCachedFreeCells(Vec2i(pos1.x, pos2.y), 1, field) == false &&
+						isAproxFreeCell(Vec2i(pos1.x, pos2.y), field, teamIndex) == false) {
 						//Unit *cellUnit = getCell(Vec2i(pos1.x, pos2.y))->getUnit(field);
 						//Object * obj = getSurfaceCell(toSurfCoords(Vec2i(pos1.x, pos2.y)))->getObject();
 
@@ -1066,11 +996,8 @@ namespace Glest {
 						//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
 						return false;
 					}
-					if (isAproxFreeCell(Vec2i(pos2.x, pos1.y), field, teamIndex) == false) {
-						if (lookupCache != NULL) {
-							(*lookupCache)[pos1][pos2][teamIndex][size][field] = false;
-						}
-
+					if (isCachedFreeCells(Vec2i(pos2.x, pos1.y), 1, field) == false &&
+						isAproxFreeCell(Vec2i(pos2.x, pos1.y), field, teamIndex) == false) {
 						//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
 						return false;
 					}
@@ -1088,45 +1015,31 @@ namespace Glest {
 				//}
 
 				if (unit == NULL || isBadHarvestPos == true) {
-					if (lookupCache != NULL) {
-						(*lookupCache)[pos1][pos2][teamIndex][size][field] = false;
-					}
-
 					//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
 					return false;
 				}
 
-				if (lookupCache != NULL) {
-					(*lookupCache)[pos1][pos2][teamIndex][size][field] = true;
-				}
-
 				return true;
 			}
 			//multi cell units
 			else {
-				for (int i = pos2.x; i < pos2.x + size; ++i) {
-					for (int j = pos2.y; j < pos2.y + size; ++j) {
-
-						Vec2i cellPos = Vec2i(i, j);
-						if (isInside(cellPos) && isInsideSurface(toSurfCoords(cellPos))) {
-							if (getCell(cellPos)->getUnit(unit->getCurrField()) != unit) {
-								if (isAproxFreeCell(cellPos, field, teamIndex) == false) {
-									if (lookupCache != NULL) {
-										(*lookupCache)[pos1][pos2][teamIndex][size][field] = false;
+				// a cached free block needs no cell by cell check
+				if (isCachedFreeCells(pos2, size, field) == false) {
+					for (int i = pos2.x; i < pos2.x + size; ++i) {
+						for (int j = pos2.y; j < pos2.y + size; ++j) {
+
+							Vec2i cellPos = Vec2i(i, j);
+							if (isInside(cellPos) && isInsideSurface(toSurfCoords(cellPos))) {
+								if (getCell(cellPos)->getUnit(unit->getCurrField()) != unit) {
+									if (isAproxFreeCell(cellPos, field, teamIndex) == false) {
+										//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
+										return false;
 									}
-
-									//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
-									return false;
 								}
+							} else {
+								//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
+								return false;
 							}
-						} else {
-
-							if (lookupCache != NULL) {
-								(*lookupCache)[pos1][pos2][teamIndex][size][field] = false;
-							}
-
-							//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
-							return false;
 						}
 					}
 				}
@@ -1141,17 +1054,9 @@ namespace Glest {
 				}
 
 				if (isBadHarvestPos == true) {
-					if (lookupCache != NULL) {
-						(*lookupCache)[pos1][pos2][teamIndex][size][field] = false;
-					}
-
 					//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
 					return false;
 				}
-
-				if (lookupCache != NULL) {
-					(*lookupCache)[pos1][pos2][teamIndex][size][field] = true;
-				}
 			}
 			return true;
 		}
@@ -1444,6 +1349,11 @@ namespace Glest {
 					}
 				}
 			}
+			unitGrid.addUnit(unit, pos, ut->getSize());
+			passabilityCache.invalidate(pos, ut->getSize());
+			if (ut->isMobile() == false) {
+				markPassabilityChanged(pos, ut->getSize());
+			}
 			if (canPutInCell == true) {
 				unit->setPos(pos, false, threaded);
 			}
@@ -1511,6 +1421,65 @@ namespace Glest {
 					}
 				}
 			}
+			unitGrid.removeUnit(unit);
+			passabilityCache.invalidate(pos, ut->getSize());
+			if (ut->isMobile() == false) {
+				markPassabilityChanged(pos, ut->getSize());
+			}
+		}
+
+		void Map::markPassabilityChanged(const Vec2i &pos, int size) {
+			if (passabilityBlockRevision.empty() == true) {
+				return;
+			}
+			int minX = max(0, pos.x) / passabilityBlockSize;
+			int minY = max(0, pos.y) / passabilityBlockSize;
+			int maxX = min(w - 1, pos.x + size - 1) / passabilityBlockSize;
+			int maxY = min(h - 1, pos.y + size - 1) / passabilityBlockSize;
+			for (int y = minY; y <= maxY; ++y) {
+				for (int x = minX; x <= maxX; ++x) {
+					passabilityBlockRevision[y * passabilityBlocksW + x]++;
+				}
+			}
+			passabilityRevision++;
+			passabilityCache.invalidate(pos, size);
+		}
+
+		// the map cells as the passability cache reads them
+		class MapPassabilityCells {
+		private:
+			const Map *map;
+
+		public:
+			explicit MapPassabilityCells(const Map *map) : map(map) {
+			}
+			inline bool isFreeCell(const Vec2i &pos, int field) const {
+				return map->isFreeCell(pos, static_cast<Field>(field));
+			}
+		};
+
+		void Map::updatePassabilityCache() {
+			passabilityCache.update(MapPassabilityCells(this));
+		}
+
+		// every set bit must still be true, a missed invalidation would let
+		// units path through cells that are no longer free
+		void Map::checkPassabilityCache() const {
+			for (int y = 0; y < h; ++y) {
+				for (int x = 0; x < w; ++x) {
+					for (int field = 0; field < fieldCount; ++field) {
+						for (int size = 1; size <= PassabilityCache::sizes; ++size) {
+							Vec2i pos(x, y);
+							if (isCachedFreeCells(pos, size, static_cast<Field>(field)) == true &&
+								isFreeCells(pos, size, static_cast<Field>(field)) == false) {
+								char szBuf[8096] = "";
+								snprintf(szBuf, 8096, "Stale passability cache bit at [%s] size: %d field: %d", pos.getString().c_str(), size, field);
+								throw megaglest_runtime_error(szBuf);
+							}
+						}
+					}
+				}
+			}
 		}
 
 		// ==================== misc ====================
@@ -1636,6 +1605,8 @@ namespace Glest {
 		}
 
 		void Map::computeInterpolatedHeights() {
+			// deep water cells may have changed
+			passabilityCache.invalidate();
 
 			for (int i = 0; i < w; ++i) {
 				for (int j = 0; j < h; ++j) {
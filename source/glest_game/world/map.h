@@ -39,6 +39,9 @@
 #include "unit_type.h"
 #include "command.h"
 #include "checksum.h"
+#include "unit_grid.h"
+#include "passability_cache.h"
+#include "synch_trace.h"
 #include "leak_dumper.h"
 
 
@@ -165,6 +168,8 @@ namespace Glest {
 			//visibility
 			bool visible[GameConstants::maxPlayers + GameConstants::specialFactions];
 			bool explored[GameConstants::maxPlayers + GameConstants::specialFactions];
+			// units of each team whose sight currently covers the cell
+			int visibleCount[GameConstants::maxPlayers + GameConstants::specialFactions];
 
 			//cache
 			bool nearSubmerged;
@@ -219,6 +224,24 @@ namespace Glest {
 			string isVisibleString() const;
 			string isExploredString() const;
 
+			inline int getVisibleCount(int teamIndex) const {
+				return visibleCount[teamIndex];
+			}
+			// returns true when the cell was not seen by the team before
+			inline bool incVisibleCount(int teamIndex) {
+				return ++visibleCount[teamIndex] == 1;
+			}
+			// returns true when the last unit of the team stopped seeing the cell
+			inline bool decVisibleCount(int teamIndex) {
+				if (visibleCount[teamIndex] <= 0) {
+					return false;
+				}
+				return --visibleCount[teamIndex] == 0;
+			}
+			inline void resetVisibleCount(int teamIndex) {
+				visibleCount[teamIndex] = 0;
+			}
+
 			//set
 			inline void setVertex(const Vec3f &vertex) {
 				this->vertex = vertex;
@@ -277,19 +300,11 @@ namespace Glest {
 		///	Represents the game map (and loads it from a gbm file)
 		// =====================================================
 
-		class FastAINodeCache {
-		public:
-			explicit FastAINodeCache(Unit *unit) {
-				this->unit = unit;
-			}
-			Unit *unit;
-			std::map<Vec2i, std::map<Vec2i, bool> > cachedCanMoveSoonList;
-		};
-
 		class Map {
 		public:
 			static const int cellScale;	//number of cells per surfaceCell
 			static const int mapScale;	//horizontal scale of surface
+			static const int passabilityBlockSize;	//cells per side of a passability revision block
 
 		private:
 			string title;
@@ -312,6 +327,17 @@ namespace Glest {
 			float maxMapHeight;
 			string mapFile;
 
+			// bumped whenever buildings or map objects change inside a block
+			std::vector<uint32> passabilityBlockRevision;
+			int passabilityBlocksW;
+			int passabilityBlocksH;
+			// bumped whenever any block changes
+			uint32 passabilityRevision;
+
+			// which unit sizes fit at each cell, refreshed once a frame
+			PassabilityCache passabilityCache;
+			UnitGrid unitGrid;
+
 		private:
 			Map(Map&);
 			void operator=(Map&);
@@ -442,11 +468,38 @@ namespace Glest {
 			//bool canOccupy(const Vec2i &pos, Field field, const UnitType *ut, CardinalDir facing);
 
 			//unit placement
-			bool aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<int, std::map<Field, bool> > > > > *lookupCache = NULL) const;
-			bool canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<Field, bool> > > > *lookupCache = NULL) const;
+			bool aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2) const;
+			bool canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2) const;
 			void putUnitCells(Unit *unit, const Vec2i &pos, bool ignoreSkill = false, bool threaded = false);
 			void clearUnitCells(Unit *unit, const Vec2i &pos, bool ignoreSkill = false);
 
+			//static passability (buildings, objects) change tracking
+			void markPassabilityChanged(const Vec2i &pos, int size);
+			inline int getPassabilityBlocksW() const {
+				return passabilityBlocksW;
+			}
+			inline int getPassabilityBlocksH() const {
+				return passabilityBlocksH;
+			}
+			inline uint32 getPassabilityRevision(int blockX, int blockY) const {
+				return passabilityBlockRevision[blockY * passabilityBlocksW + blockX];
+			}
+			inline uint32 getPassabilityRevision() const {
+				return passabilityRevision;
+			}
+
+			inline const UnitGrid &getUnitGrid() const {
+				return unitGrid;
+			}
+
+			//per cell passability cache, only a set bit is trusted, a clear bit
+			//means the cells have to be checked one by one
+			void updatePassabilityCache();
+			inline bool isCachedFreeCells(const Vec2i &pos, int size, Field field) const {
+				return passabilityCache.isFree(pos, size, field);
+			}
+			void checkPassabilityCache() const;
+
 			Vec2i computeRefPos(const Selection *selection) const;
 			Vec2i computeDestPos(const Vec2i &refUnitPos, const Vec2i &unitPos,
 				const Vec2i &commandPos) const;
@@ -508,16 +561,7 @@ namespace Glest {
 					isInside(pos2) == false || isInsideSurface(toSurfCoords(pos2)) == false) {
 
 					//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
-					if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true &&
-						SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
-						char szBuf[8096] = "";
-						snprintf(szBuf, 8096, "In aproxCanMoveSoon() return false");
-						if (Thread::isCurrentThreadMainThread() == false) {
-							unit->logSynchDataThreaded(__FILE__, __LINE__, szBuf);
-						} else {
-							unit->logSynchData(__FILE__, __LINE__, szBuf);
-						}
-					}
+					SYNCH_TRACE(unit->getId(), "aproxCanMoveSoon outside map(pos.x,pos.y)", pos2.x, pos2.y);
 
 					return false;
 				}
@@ -532,84 +576,33 @@ namespace Glest {
 
 				//single cell units
 				if (size == 1) {
-					bool tryPosResult = isAproxFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(), pos2, field, teamIndex);
-
-					if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true &&
-						SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
-						string extraInfo = (string("tryPosResult = ") + (tryPosResult ? string("true") : string("false")));
-						const SurfaceCell *sc = getSurfaceCell(toSurfCoords(pos2));
-						if (sc->isVisible(teamIndex)) {
-							bool testCond = isFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(), pos2, field);
-							extraInfo += (string("isFreeCellOrMightBeFreeSoon = ") + (testCond ? string("true") : string("false")));
-						} else if (sc->isExplored(teamIndex)) {
-							bool testCond = field == fLand ? sc->isFree() && !getDeepSubmerged(getCell(pos2)) : true;
-							extraInfo += (string("field==fLand = ") + (testCond ? string("true") : string("false")));
-						}
+					bool tryPosResult = isCachedFreeCells(pos2, 1, field) ||
+						isAproxFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(), pos2, field, teamIndex);
 
-						char szBuf[8096] = "";
-						snprintf(szBuf, 8096, "In aproxCanMoveSoon() pos2 = %s extraInfo = %s %s %s", pos2.getString().c_str(), extraInfo.c_str(), sc->isVisibleString().c_str(), sc->isExploredString().c_str());
-						if (Thread::isCurrentThreadMainThread() == false) {
-							unit->logSynchDataThreaded(__FILE__, __LINE__, szBuf);
-						} else {
-							unit->logSynchData(__FILE__, __LINE__, szBuf);
-						}
-					}
+					SYNCH_TRACE(unit->getId(), "aproxCanMoveSoon(pos.x,pos.y,tryPosResult,visible)",
+						pos2.x, pos2.y, tryPosResult, getSurfaceCell(toSurfCoords(pos2))->isVisible(teamIndex));
 
 					if (tryPosResult == false) {
 						return false;
 					}
 					if (pos1.x != pos2.x && pos1.y != pos2.y) {
 						Vec2i tryPos = Vec2i(pos1.x, pos2.y);
-						bool tryPosResult = isAproxFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(), tryPos, field, teamIndex);
-
-						if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true &&
-							SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
-							string extraInfo = (string("tryPosResult = ") + (tryPosResult ? string("true") : string("false")));
-							const SurfaceCell *sc = getSurfaceCell(toSurfCoords(tryPos));
-							if (sc->isVisible(teamIndex)) {
-								bool testCond = isFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(), tryPos, field);
-								extraInfo += (string("isFreeCellOrMightBeFreeSoon = ") + (testCond ? string("true") : string("false")));
-							} else if (sc->isExplored(teamIndex)) {
-								bool testCond = field == fLand ? sc->isFree() && !getDeepSubmerged(getCell(tryPos)) : true;
-								extraInfo += (string("field==fLand = ") + (testCond ? string("true") : string("false")));
-							}
+						bool tryPosResult = isCachedFreeCells(tryPos, 1, field) ||
+							isAproxFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(), tryPos, field, teamIndex);
 
-							char szBuf[8096] = "";
-							snprintf(szBuf, 8096, "In aproxCanMoveSoon() extraInfo = %s", extraInfo.c_str());
-							if (Thread::isCurrentThreadMainThread() == false) {
-								unit->logSynchDataThreaded(__FILE__, __LINE__, szBuf);
-							} else {
-								unit->logSynchData(__FILE__, __LINE__, szBuf);
-							}
-						}
+						SYNCH_TRACE(unit->getId(), "aproxCanMoveSoon(pos.x,pos.y,tryPosResult,visible)",
+							tryPos.x, tryPos.y, tryPosResult, getSurfaceCell(toSurfCoords(tryPos))->isVisible(teamIndex));
 
 						if (tryPosResult == false) {
 							return false;
 						}
 
 						tryPos = Vec2i(pos2.x, pos1.y);
-						tryPosResult = isAproxFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(), tryPos, field, teamIndex);
-
-						if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true &&
-							SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
-							string extraInfo = (string("tryPosResult = ") + (tryPosResult ? string("true") : string("false")));
-							const SurfaceCell *sc = getSurfaceCell(toSurfCoords(tryPos));
-							if (sc->isVisible(teamIndex)) {
-								bool testCond = isFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(), tryPos, field);
-								extraInfo += (string("isFreeCellOrMightBeFreeSoon = ") + (testCond ? string("true") : string("false")));
-							} else if (sc->isExplored(teamIndex)) {
-								bool testCond = field == fLand ? sc->isFree() && !getDeepSubmerged(getCell(tryPos)) : true;
-								extraInfo += (string("field==fLand = ") + (testCond ? string("true") : string("false")));
-							}
+						tryPosResult = isCachedFreeCells(tryPos, 1, field) ||
+							isAproxFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(), tryPos, field, teamIndex);
 
-							char szBuf[8096] = "";
-							snprintf(szBuf, 8096, "In aproxCanMoveSoon() extraInfo = %s", extraInfo.c_str());
-							if (Thread::isCurrentThreadMainThread() == false) {
-								unit->logSynchDataThreaded(__FILE__, __LINE__, szBuf);
-							} else {
-								unit->logSynchData(__FILE__, __LINE__, szBuf);
-							}
-						}
+						SYNCH_TRACE(unit->getId(), "aproxCanMoveSoon(pos.x,pos.y,tryPosResult,visible)",
+							tryPos.x, tryPos.y, tryPosResult, getSurfaceCell(toSurfCoords(tryPos))->isVisible(teamIndex));
 
 						if (tryPosResult == false) {
 
@@ -627,16 +620,7 @@ namespace Glest {
 					}
 
 					if (unit == NULL || isBadHarvestPos == true) {
-						if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true &&
-							SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
-							char szBuf[8096] = "";
-							snprintf(szBuf, 8096, "In aproxCanMoveSoon() return false");
-							if (Thread::isCurrentThreadMainThread() == false) {
-								unit->logSynchDataThreaded(__FILE__, __LINE__, szBuf);
-							} else {
-								unit->logSynchData(__FILE__, __LINE__, szBuf);
-							}
-						}
+						SYNCH_TRACE(unit->getId(), "aproxCanMoveSoon bad harvest pos(pos.x,pos.y)", pos2.x, pos2.y);
 
 						return false;
 					}
@@ -645,38 +629,22 @@ namespace Glest {
 				}
 				//multi cell units
 				else {
-					for (int i = pos2.x; i < pos2.x + size; ++i) {
+					// a cached free block needs no cell by cell check
+					bool cachedFree = isCachedFreeCells(pos2, size, field);
+					for (int i = pos2.x; cachedFree == false && i < pos2.x + size; ++i) {
 						for (int j = pos2.y; j < pos2.y + size; ++j) {
 
 							Vec2i cellPos = Vec2i(i, j);
 							if (isInside(cellPos) && isInsideSurface(toSurfCoords(cellPos))) {
 								if (getCell(cellPos)->getUnit(unit->getCurrField()) != unit) {
 									if (isAproxFreeCellOrMightBeFreeSoon(unit->getPosNotThreadSafe(), cellPos, field, teamIndex) == false) {
-										if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true &&
-											SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
-											char szBuf[8096] = "";
-											snprintf(szBuf, 8096, "In aproxCanMoveSoon() return false");
-											if (Thread::isCurrentThreadMainThread() == false) {
-												unit->logSynchDataThreaded(__FILE__, __LINE__, szBuf);
-											} else {
-												unit->logSynchData(__FILE__, __LINE__, szBuf);
-											}
-										}
+										SYNCH_TRACE(unit->getId(), "aproxCanMoveSoon cell not free(pos.x,pos.y,cell.x,cell.y)", pos2.x, pos2.y, cellPos.x, cellPos.y);
 
 										return false;
 									}
 								}
 							} else {
-								if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true &&
-									SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
-									char szBuf[8096] = "";
-									snprintf(szBuf, 8096, "In aproxCanMoveSoon() return false");
-									if (Thread::isCurrentThreadMainThread() == false) {
-										unit->logSynchDataThreaded(__FILE__, __LINE__, szBuf);
-									} else {
-										unit->logSynchData(__FILE__, __LINE__, szBuf);
-									}
-								}
+								SYNCH_TRACE(unit->getId(), "aproxCanMoveSoon cell outside map(pos.x,pos.y,cell.x,cell.y)", pos2.x, pos2.y, cellPos.x, cellPos.y);
 
 								return false;
 							}
@@ -693,16 +661,7 @@ namespace Glest {
 					}
 
 					if (isBadHarvestPos == true) {
-						if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true &&
-							SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
-							char szBuf[8096] = "";
-							snprintf(szBuf, 8096, "In aproxCanMoveSoon() return false");
-							if (Thread::isCurrentThreadMainThread() == false) {
-								unit->logSynchDataThreaded(__FILE__, __LINE__, szBuf);
-							} else {
-								unit->logSynchData(__FILE__, __LINE__, szBuf);
-							}
-						}
+						SYNCH_TRACE(unit->getId(), "aproxCanMoveSoon bad harvest pos(pos.x,pos.y)", pos2.x, pos2.y);
 
 						return false;
 					}
@@ -12,6 +12,7 @@
 #include "minimap.h"
 
 #include <cassert>
+#include <algorithm>
 
 #include "world.h"
 #include "vec.h"
@@ -21,6 +22,7 @@
 #include "game_settings.h"
 #include "leak_dumper.h"
 
+using namespace std;
 using namespace Shared::Graphics;
 
 namespace Glest {
@@ -43,6 +45,7 @@ namespace Glest {
 			gameSettings = NULL;
 			tex = NULL;
 			fowTex = NULL;
+			fowResetStamp = 0;
 		}
 
 		void Minimap::init(int w, int h, const World *world, bool fogOfWar) {
@@ -196,46 +199,52 @@ namespace Glest {
 				fowPixmap0 = fowPixmap1;
 				fowPixmap1 = tmpPixmap;
 
-				// Could turn off ONLY fog of war by setting below to false
-				bool overridefogOfWarValue = fogOfWar;
-
 				for (int indexPixelWidth = 0;
 					indexPixelWidth < fowTex->getPixmap()->getW();
 					++indexPixelWidth) {
 					for (int indexPixelHeight = 0;
 						indexPixelHeight < fowTex->getPixmap()->getH();
 						++indexPixelHeight) {
-						if ((fogOfWar == false && overridefogOfWarValue == false)) {
-							//(gameSettings->getFlagTypes1() & ft1_show_map_resources) != ft1_show_map_resources) {
-							//printf("Line: %d\n",__LINE__);
-
-							float p0 = fowPixmap0->getPixelf(indexPixelWidth, indexPixelHeight);
-							float p1 = fowPixmap1->getPixelf(indexPixelWidth, indexPixelHeight);
-							if (p0 > p1) {
-								fowPixmap1->setPixel(indexPixelWidth, indexPixelHeight, p0);
-							} else {
-								fowPixmap1->setPixel(indexPixelWidth, indexPixelHeight, p1);
-							}
-						} else if ((fogOfWar && overridefogOfWarValue) ||
-							(gameSettings->getFlagTypes1() & ft1_show_map_resources) == ft1_show_map_resources) {
-							//printf("Line: %d\n",__LINE__);
+						resetFowTexPixel(indexPixelWidth, indexPixelHeight);
+					}
+				}
+			}
+		}
 
-							float p0 = fowPixmap0->getPixelf(indexPixelWidth, indexPixelHeight);
-							float p1 = fowPixmap1->getPixelf(indexPixelWidth, indexPixelHeight);
+		int Minimap::resetFowTex(const FowDirtyAreas &areas) {
+			int pixelCount = 0;
+			if (fowTex && fowPixmap0 && fowPixmap1) {
+				Pixmap2D *tmpPixmap = fowPixmap0;
+				fowPixmap0 = fowPixmap1;
+				fowPixmap1 = tmpPixmap;
 
-							if (p1 > exploredAlpha) {
-								fowPixmap1->setPixel(indexPixelWidth, indexPixelHeight, exploredAlpha);
-							}
-							if (p0 > p1) {
-								fowPixmap1->setPixel(indexPixelWidth, indexPixelHeight, p0);
+				int w = fowTex->getPixmap()->getW();
+				int h = fowTex->getPixmap()->getH();
+				if ((int) fowResetStamps.size() != w * h) {
+					fowResetStamps.assign(w * h, 0);
+					fowResetStamp = 0;
+				}
+				// areas may overlap and a pixel must not be reset twice
+				fowResetStamp++;
+
+				for (unsigned int i = 0; i < areas.size(); ++i) {
+					int minX = max(areas[i].first.x, 0);
+					int minY = max(areas[i].first.y, 0);
+					int maxX = min(areas[i].second.x, w - 1);
+					int maxY = min(areas[i].second.y, h - 1);
+					for (int y = minY; y <= maxY; ++y) {
+						for (int x = minX; x <= maxX; ++x) {
+							int &stamp = fowResetStamps[y * w + x];
+							if (stamp != fowResetStamp) {
+								stamp = fowResetStamp;
+								resetFowTexPixel(x, y);
+								pixelCount++;
 							}
-						} else {
-							//printf("Line: %d\n",__LINE__);
-							fowPixmap1->setPixel(indexPixelWidth, indexPixelHeight, 1.f);
 						}
 					}
 				}
 			}
+			return pixelCount;
 		}
 
 		void Minimap::updateFowTex(float t) {
@@ -246,11 +255,22 @@ namespace Glest {
 					for (int indexPixelHeight = 0;
 						indexPixelHeight < fowPixmap0->getH();
 						++indexPixelHeight) {
-						float p1 = fowPixmap1->getPixelf(indexPixelWidth, indexPixelHeight);
-						float p2 = fowTex->getPixmap()->getPixelf(indexPixelWidth, indexPixelHeight);
-						if (p1 != p2) {
-							float p0 = fowPixmap0->getPixelf(indexPixelWidth, indexPixelHeight);
-							fowTex->getPixmap()->setPixel(indexPixelWidth, indexPixelHeight, p0 + (t*(p1 - p0)));
+						updateFowTexPixel(indexPixelWidth, indexPixelHeight, t);
+					}
+				}
+			}
+		}
+
+		void Minimap::updateFowTex(float t, const FowDirtyAreas &areas) {
+			if (fowTex && fowPixmap0 && fowPixmap1) {
+				for (unsigned int i = 0; i < areas.size(); ++i) {
+					int minX = max(areas[i].first.x, 0);
+					int minY = max(areas[i].first.y, 0);
+					int maxX = min(areas[i].second.x, fowPixmap0->getW() - 1);
+					int maxY = min(areas[i].second.y, fowPixmap0->getH() - 1);
+					for (int y = minY; y <= maxY; ++y) {
+						for (int x = minX; x <= maxX; ++x) {
+							updateFowTexPixel(x, y, t);
 						}
 					}
 				}
@@ -259,6 +279,49 @@ namespace Glest {
 
 		// ==================== PRIVATE ====================
 
+		void Minimap::resetFowTexPixel(int x, int y) {
+			// Could turn off ONLY fog of war by setting below to false
+			bool overridefogOfWarValue = fogOfWar;
+
+			if ((fogOfWar == false && overridefogOfWarValue == false)) {
+				//(gameSettings->getFlagTypes1() & ft1_show_map_resources) != ft1_show_map_resources) {
+				//printf("Line: %d\n",__LINE__);
+
+				float p0 = fowPixmap0->getPixelf(x, y);
+				float p1 = fowPixmap1->getPixelf(x, y);
+				if (p0 > p1) {
+					fowPixmap1->setPixel(x, y, p0);
+				} else {
+					fowPixmap1->setPixel(x, y, p1);
+				}
+			} else if ((fogOfWar && overridefogOfWarValue) ||
+				(gameSettings->getFlagTypes1() & ft1_show_map_resources) == ft1_show_map_resources) {
+				//printf("Line: %d\n",__LINE__);
+
+				float p0 = fowPixmap0->getPixelf(x, y);
+				float p1 = fowPixmap1->getPixelf(x, y);
+
+				if (p1 > exploredAlpha) {
+					fowPixmap1->setPixel(x, y, exploredAlpha);
+				}
+				if (p0 > p1) {
+					fowPixmap1->setPixel(x, y, p0);
+				}
+			} else {
+				//printf("Line: %d\n",__LINE__);
+				fowPixmap1->setPixel(x, y, 1.f);
+			}
+		}
+
+		void Minimap::updateFowTexPixel(int x, int y, float t) {
+			float p1 = fowPixmap1->getPixelf(x, y);
+			float p2 = fowTex->getPixmap()->getPixelf(x, y);
+			if (p1 != p2) {
+				float p0 = fowPixmap0->getPixelf(x, y);
+				fowTex->getPixmap()->setPixel(x, y, p0 + (t*(p1 - p0)));
+			}
+		}
+
 		void Minimap::computeTexture(const World *world) {
 
 			Vec4f color;
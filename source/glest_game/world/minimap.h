@@ -17,6 +17,8 @@
 #include <winsock.h>
 #endif
 
+#include <vector>
+#include <utility>
 #include "pixmap.h"
 #include "texture.h"
 #include "xml_parser.h"
@@ -35,6 +37,9 @@ namespace Glest {
 		class World;
 		class GameSettings;
 
+		// surface areas, from first to second inclusive
+		typedef std::vector<std::pair<Vec2i, Vec2i> > FowDirtyAreas;
+
 		enum ExplorationState {
 			esNotExplored,
 			esExplored,
@@ -61,6 +66,10 @@ namespace Glest {
 			bool fogOfWar;
 			const GameSettings *gameSettings;
 
+			// pixels already reset by the current resetFowTex call
+			std::vector<int> fowResetStamps;
+			int fowResetStamp;
+
 		private:
 			static const float exploredAlpha;
 
@@ -78,7 +87,10 @@ namespace Glest {
 
 			void incFowTextureAlphaSurface(const Vec2i sPos, float alpha, bool isIncrementalUpdate = false);
 			void resetFowTex();
+			// resets only the pixels inside areas, returns the number of pixels reset
+			int resetFowTex(const FowDirtyAreas &areas);
 			void updateFowTex(float t);
+			void updateFowTex(float t, const FowDirtyAreas &areas);
 			void setFogOfWar(bool value);
 
 			void copyFowTex();
@@ -92,6 +104,8 @@ namespace Glest {
 
 		private:
 			void computeTexture(const World *world);
+			void resetFowTexPixel(int x, int y);
+			void updateFowTexPixel(int x, int y, float t);
 		};
 
 	}
@@ -0,0 +1,185 @@
+//
+//      passability_cache.h: per cell bits telling which unit sizes fit
+//      in the free cells starting at a cell
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _GLEST_GAME_PASSABILITYCACHE_H_
+#define _GLEST_GAME_PASSABILITYCACHE_H_
+
+#include <vector>
+#include <algorithm>
+#include "vec.h"
+#include "leak_dumper.h"
+
+using std::vector;
+using std::pair;
+using Shared::Graphics::Vec2i;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		//	class PassabilityCache
+		//
+		///	Bit (field * sizes + size - 1) of a cell is set when the
+		///	size x size block starting at the cell is free. Only a set
+		///	bit is trusted, a clear bit means the cells have to be
+		///	checked one by one. The cells are read through a Cells
+		///	object which has:
+		///	  bool isFreeCell(const Vec2i &pos, int field)
+		// =====================================================
+
+		class PassabilityCache {
+		public:
+			static const int sizes = 4;	//unit sizes kept, fieldCount * sizes bits fit a byte
+
+		private:
+			int w;
+			int h;
+			int fieldCount;
+			vector<unsigned char> bits;
+			// cell areas whose occupancy changed since the last update
+			vector<pair<Vec2i, Vec2i> > dirtyAreas;
+			bool rebuild;
+
+		public:
+			PassabilityCache() {
+				w = 0;
+				h = 0;
+				fieldCount = 0;
+				rebuild = true;
+			}
+
+			void init(int w, int h, int fieldCount) {
+				this->w = w;
+				this->h = h;
+				this->fieldCount = fieldCount;
+				bits.assign(w * h, 0);
+				dirtyAreas.clear();
+				rebuild = true;
+			}
+
+			inline bool isFree(const Vec2i &pos, int size, int field) const {
+				if (size > sizes || pos.x < 0 || pos.y < 0 || pos.x >= w || pos.y >= h ||
+					bits.empty() == true) {
+					return false;
+				}
+				return (bits[pos.y * w + pos.x] & (1 << (field * sizes + size - 1))) != 0;
+			}
+
+			// everything is recomputed on the next update
+			void invalidate() {
+				rebuild = true;
+				dirtyAreas.clear();
+				std::fill(bits.begin(), bits.end(), 0);
+			}
+
+			// clears the bits of every block touching the area right away so a
+			// stale bit is never trusted, they are recomputed in update
+			void invalidate(const Vec2i &pos, int size) {
+				if (bits.empty() == true || rebuild == true) {
+					return;
+				}
+				Vec2i minPos(std::max(0, pos.x), std::max(0, pos.y));
+				Vec2i maxPos(std::min(w - 1, pos.x + size - 1), std::min(h - 1, pos.y + size - 1));
+				if (minPos.x > maxPos.x || minPos.y > maxPos.y) {
+					return;
+				}
+				for (int field = 0; field < fieldCount; ++field) {
+					for (int blockSize = 1; blockSize <= sizes; ++blockSize) {
+						unsigned char mask = (unsigned char) ~(1 << (field * sizes + blockSize - 1));
+						for (int y = std::max(0, minPos.y - blockSize + 1); y <= maxPos.y; ++y) {
+							for (int x = std::max(0, minPos.x - blockSize + 1); x <= maxPos.x; ++x) {
+								bits[y * w + x] &= mask;
+							}
+						}
+					}
+				}
+				dirtyAreas.push_back(std::make_pair(minPos, maxPos));
+			}
+
+			template <typename Cells>
+			void update(const Cells &cells) {
+				if (bits.empty() == true) {
+					return;
+				}
+				vector<pair<Vec2i, Vec2i> > areas;
+				if (rebuild == true) {
+					areas.push_back(std::make_pair(Vec2i(0, 0), Vec2i(w - 1, h - 1)));
+					rebuild = false;
+				} else {
+					areas.swap(dirtyAreas);
+				}
+				if (areas.empty() == true) {
+					return;
+				}
+
+				// single cells first, then every block size from the four blocks
+				// one size smaller at (x,y), (x+1,y), (x,y+1) and (x+1,y+1)
+				for (unsigned int i = 0; i < areas.size(); ++i) {
+					computeCells(cells, areas[i].first, areas[i].second);
+				}
+				for (int blockSize = 2; blockSize <= sizes; ++blockSize) {
+					for (int field = 0; field < fieldCount; ++field) {
+						int smallerShift = field * sizes + blockSize - 2;
+						unsigned char bit = (unsigned char) (1 << (smallerShift + 1));
+						for (unsigned int i = 0; i < areas.size(); ++i) {
+							for (int y = std::max(0, areas[i].first.y - blockSize + 1); y <= areas[i].second.y; ++y) {
+								for (int x = std::max(0, areas[i].first.x - blockSize + 1); x <= areas[i].second.x; ++x) {
+									bool free = (x + 1 < w && y + 1 < h &&
+										((bits[y * w + x] >> smallerShift) & 1) &&
+										((bits[y * w + x + 1] >> smallerShift) & 1) &&
+										((bits[(y + 1) * w + x] >> smallerShift) & 1) &&
+										((bits[(y + 1) * w + x + 1] >> smallerShift) & 1));
+									if (free == true) {
+										bits[y * w + x] |= bit;
+									} else {
+										bits[y * w + x] &= (unsigned char) ~bit;
+									}
+								}
+							}
+						}
+					}
+				}
+			}
+
+		private:
+			template <typename Cells>
+			void computeCells(const Cells &cells, const Vec2i &minPos, const Vec2i &maxPos) {
+				for (int field = 0; field < fieldCount; ++field) {
+					unsigned char bit = (unsigned char) (1 << (field * sizes));
+					for (int y = minPos.y; y <= maxPos.y; ++y) {
+						for (int x = minPos.x; x <= maxPos.x; ++x) {
+							if (cells.isFreeCell(Vec2i(x, y), field) == true) {
+								bits[y * w + x] |= bit;
+							} else {
+								bits[y * w + x] &= (unsigned char) ~bit;
+							}
+						}
+					}
+				}
+			}
+		};
+
+	}
+}
+
+#endif
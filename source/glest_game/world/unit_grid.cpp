@@ -0,0 +1,176 @@
+//
+//      unit_grid.cpp: bucketed index of the units placed on the map
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#include "unit_grid.h"
+
+#include <algorithm>
+
+#include "unit.h"
+#include "conversion.h"
+#include "leak_dumper.h"
+
+using namespace std;
+using namespace Shared::Util;
+
+namespace Glest {
+	namespace Game {
+
+		// =====================================================
+		// 	class UnitGrid
+		// =====================================================
+
+		const int UnitGrid::bucketSize = 8;
+
+		UnitGrid::UnitGrid() {
+			w = 0;
+			h = 0;
+			bucketsW = 0;
+			bucketsH = 0;
+			maxUnitSize = 1;
+		}
+
+		void UnitGrid::init(int w, int h) {
+			this->w = w;
+			this->h = h;
+			bucketsW = (w + bucketSize - 1) / bucketSize;
+			bucketsH = (h + bucketSize - 1) / bucketSize;
+			buckets.clear();
+			buckets.resize(bucketsW * bucketsH);
+			unitBuckets.clear();
+			maxUnitSize = 1;
+		}
+
+		void UnitGrid::clear() {
+			for (unsigned int i = 0; i < buckets.size(); ++i) {
+				buckets[i].clear();
+			}
+			unitBuckets.clear();
+			maxUnitSize = 1;
+		}
+
+		int UnitGrid::getBucketIndex(const Vec2i &pos) const {
+			int x = min(max(pos.x, 0), w - 1) / bucketSize;
+			int y = min(max(pos.y, 0), h - 1) / bucketSize;
+			return y * bucketsW + x;
+		}
+
+		void UnitGrid::addUnit(Unit *unit, const Vec2i &pos, int size) {
+			if (unit == NULL || buckets.empty() == true) {
+				return;
+			}
+			maxUnitSize = max(maxUnitSize, size);
+
+			int bucketIndex = getBucketIndex(pos);
+			std::map<int, int>::iterator iterFind = unitBuckets.find(unit->getId());
+			if (iterFind != unitBuckets.end()) {
+				Bucket &bucket = buckets[iterFind->second];
+				for (unsigned int i = 0; i < bucket.size(); ++i) {
+					if (bucket[i].unit == unit) {
+						// put again at the same place (morphing units block
+						// the cells of the bigger type too), keep the larger area
+						if (iterFind->second == bucketIndex && bucket[i].pos == pos) {
+							bucket[i].size = max(bucket[i].size, size);
+							return;
+						}
+						bucket.erase(bucket.begin() + i);
+						break;
+					}
+				}
+			}
+			buckets[bucketIndex].push_back(UnitGridEntry(unit, pos, size));
+			unitBuckets[unit->getId()] = bucketIndex;
+		}
+
+		void UnitGrid::removeUnit(const Unit *unit) {
+			if (unit == NULL) {
+				return;
+			}
+			std::map<int, int>::iterator iterFind = unitBuckets.find(unit->getId());
+			if (iterFind == unitBuckets.end()) {
+				return;
+			}
+			Bucket &bucket = buckets[iterFind->second];
+			for (unsigned int i = 0; i < bucket.size(); ++i) {
+				if (bucket[i].unit == unit) {
+					bucket.erase(bucket.begin() + i);
+					break;
+				}
+			}
+			unitBuckets.erase(iterFind);
+		}
+
+		bool UnitGrid::findUnit(const Unit *unit, UnitGridEntry &entry) const {
+			std::map<int, int>::const_iterator iterFind = unitBuckets.find(unit->getId());
+			if (iterFind == unitBuckets.end()) {
+				return false;
+			}
+			const Bucket &bucket = buckets[iterFind->second];
+			for (unsigned int i = 0; i < bucket.size(); ++i) {
+				if (bucket[i].unit == unit) {
+					entry = bucket[i];
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void UnitGrid::findUnits(const Vec2i &minPos, const Vec2i &maxPos, vector<UnitGridEntry> &units) const {
+			if (buckets.empty() == true || maxPos.x < 0 || maxPos.y < 0 ||
+				minPos.x >= w || minPos.y >= h) {
+				return;
+			}
+			int minX = max(minPos.x - maxUnitSize + 1, 0) / bucketSize;
+			int minY = max(minPos.y - maxUnitSize + 1, 0) / bucketSize;
+			int maxX = min(maxPos.x, w - 1) / bucketSize;
+			int maxY = min(maxPos.y, h - 1) / bucketSize;
+			for (int y = minY; y <= maxY; ++y) {
+				for (int x = minX; x <= maxX; ++x) {
+					const Bucket &bucket = buckets[y * bucketsW + x];
+					for (unsigned int i = 0; i < bucket.size(); ++i) {
+						const UnitGridEntry &entry = bucket[i];
+						if (entry.pos.x <= maxPos.x && entry.pos.y <= maxPos.y &&
+							entry.pos.x + entry.size > minPos.x &&
+							entry.pos.y + entry.size > minPos.y) {
+							units.push_back(entry);
+						}
+					}
+				}
+			}
+		}
+
+		string UnitGrid::getStats() const {
+			int usedBuckets = 0;
+			int largestBucket = 0;
+			for (unsigned int i = 0; i < buckets.size(); ++i) {
+				if (buckets[i].empty() == false) {
+					usedBuckets++;
+					largestBucket = max(largestBucket, (int) buckets[i].size());
+				}
+			}
+
+			char szBuf[8096] = "";
+			snprintf(szBuf, 8096, "units [%d] buckets [%d/%d] largest bucket [%d]", (int) unitBuckets.size(), usedBuckets, (int) buckets.size(), largestBucket);
+			return szBuf;
+		}
+
+	}
+} //end namespace
@@ -0,0 +1,113 @@
+//
+//      unit_grid.h: bucketed index of the units placed on the map
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _GLEST_GAME_UNITGRID_H_
+#define _GLEST_GAME_UNITGRID_H_
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <winsock.h>
+#endif
+
+#include <vector>
+#include <map>
+#include <string>
+#include "vec.h"
+#include "leak_dumper.h"
+
+using std::vector;
+using std::string;
+using Shared::Graphics::Vec2i;
+
+namespace Glest {
+	namespace Game {
+
+		class Unit;
+
+		// =====================================================
+		//	class UnitGridEntry
+		// =====================================================
+
+		class UnitGridEntry {
+		public:
+			UnitGridEntry() :
+				unit(NULL), pos(0), size(0) {
+			}
+			UnitGridEntry(Unit *unit, const Vec2i &pos, int size) :
+				unit(unit), pos(pos), size(size) {
+			}
+			Unit *unit;
+			Vec2i pos;	// cells the unit was put into, pos to pos + size - 1
+			int size;
+		};
+
+		// =====================================================
+		//	class UnitGrid
+		//
+		///	Units of all factions bucketed by the cell they were put
+		///	into, so range queries only visit the buckets around the
+		///	range instead of every cell. Kept up to date by
+		///	Map::putUnitCells and Map::clearUnitCells.
+		// =====================================================
+
+		class UnitGrid {
+		public:
+			static const int bucketSize;	//cells per side of a bucket
+
+		private:
+			typedef vector<UnitGridEntry> Bucket;
+
+			int w;
+			int h;
+			int bucketsW;
+			int bucketsH;
+			// largest unit ever added, queries are widened by it since
+			// units are only bucketed by their top left cell
+			int maxUnitSize;
+			vector<Bucket> buckets;
+			std::map<int, int> unitBuckets;	// unit id -> bucket index
+
+		private:
+			int getBucketIndex(const Vec2i &pos) const;
+
+		public:
+			UnitGrid();
+
+			void init(int w, int h);
+			void clear();
+
+			void addUnit(Unit *unit, const Vec2i &pos, int size);
+			void removeUnit(const Unit *unit);
+
+			// current entry of unit, false when it is not on the map
+			bool findUnit(const Unit *unit, UnitGridEntry &entry) const;
+			// entries whose cells overlap the area from minPos to maxPos,
+			// in bucket order
+			void findUnits(const Vec2i &minPos, const Vec2i &maxPos, vector<UnitGridEntry> &units) const;
+
+			string getStats() const;
+		};
+
+	}
+} //end namespace
+
+#endif
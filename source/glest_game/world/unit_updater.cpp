@@ -40,6 +40,7 @@
 #include "sound_renderer.h"
 #include "upgrade.h"
 #include "unit.h"
+#include "synch_trace.h"
 
 #include "leak_dumper.h"
 
@@ -53,12 +54,9 @@ namespace Glest {
 		// 	class UnitUpdater
 		// =====================================================
 
-		time_t UnitRangeCellsLookupItem::lastDebug = 0;
-
 		// ===================== PUBLIC ========================
 
-		UnitUpdater::UnitUpdater() : mutexAttackWarnings(new Mutex(CODE_AT_LINE)),
-			mutexUnitRangeCellsLookupItemCache(new Mutex(CODE_AT_LINE)) {
+		UnitUpdater::UnitUpdater() : mutexAttackWarnings(new Mutex(CODE_AT_LINE)) {
 			this->game = NULL;
 			this->gui = NULL;
 			this->gameCamera = NULL;
@@ -67,8 +65,9 @@ namespace Glest {
 			this->console = NULL;
 			this->scriptManager = NULL;
 			this->pathFinder = NULL;
-			//UnitRangeCellsLookupItemCacheTimerCount = 0;
 			attackWarnRange = 0;
+			threadedThink = false;
+			thinkPassFrame = -1;
 		}
 
 		void UnitUpdater::init(Game *game) {
@@ -82,7 +81,7 @@ namespace Glest {
 			this->scriptManager = game->getScriptManager();
 			this->pathFinder = NULL;
 			attackWarnRange = Config::getInstance().getFloat("AttackWarnRange", "50.0");
-			//UnitRangeCellsLookupItemCacheTimerCount = 0;
+			threadedThink = Config::getInstance().getBool("ThreadedUnitThink", "true");
 
 			switch (this->game->getGameSettings()->getPathFinderType()) {
 				case pfBasic:
@@ -106,9 +105,23 @@ namespace Glest {
 			}
 		}
 
-		UnitUpdater::~UnitUpdater() {
-			//UnitRangeCellsLookupItemCache.clear();
+		int UnitUpdater::processPathFindingJobs(int frameIndex) {
+			int jobCount = 0;
+			if (pathFinder != NULL) {
+				jobCount = pathFinder->runPathJobs(frameIndex);
+			}
+			return jobCount;
+		}
+
+		void UnitUpdater::takePathFindingMicros(int64 &precacheMicros, int64 &serialMicros) {
+			precacheMicros = 0;
+			serialMicros = 0;
+			if (pathFinder != NULL) {
+				pathFinder->takeFindPathMicros(precacheMicros, serialMicros);
+			}
+		}
 
+		UnitUpdater::~UnitUpdater() {
 			delete pathFinder;
 			pathFinder = NULL;
 
@@ -123,9 +136,6 @@ namespace Glest {
 
 			delete mutexAttackWarnings;
 			mutexAttackWarnings = NULL;
-
-			delete mutexUnitRangeCellsLookupItemCache;
-			mutexUnitRangeCellsLookupItemCache = NULL;
 		}
 
 		// ==================== progress skills ====================
@@ -448,6 +458,37 @@ namespace Glest {
 		}
 
 
+		// ==================== think ====================
+
+		// Read only work for a unit that updates this frame, done by the faction
+		// threads (or by World when they do not) before any unit of any faction
+		// is updated. It only reads the state the frame started with, so the
+		// result is the same whichever thread runs it and in whatever order.
+		// That includes the units around it: one created later in the same
+		// frame, by a unit producing, morphing or building, is acquired one
+		// frame late, by the next think pass. checkRangeUnits checks that this
+		// is the only difference to searching the unit grid.
+		void UnitUpdater::thinkUnit(Unit *unit, int frameIndex) {
+			if (unit->isAlive() == false || unit->getCurrCommand() == NULL) {
+				return;
+			}
+
+			// target acquisition of the commands that look for enemies
+			CommandClass commandClass = unit->getCurrCommand()->getCommandType()->getClass();
+			if (commandClass == ccStop || commandClass == ccAttack || commandClass == ccAttackStopped) {
+				int range = unit->getType()->getTotalSight(unit->getTotalUpgrade()) + thinkRangeMargin;
+				int size = unit->getType()->getSize();
+				Vec2i center = unit->getPosNotThreadSafe();
+
+				vector<UnitGridEntry> candidates;
+				map->getUnitGrid().findUnits(Vec2i(center.x - range, center.y - range),
+					Vec2i(center.x + range + size - 1, center.y + range + size - 1), candidates);
+				vector<Unit*> rangeUnits;
+				findUnitsOnRangeCells(unit, center, range, NULL, candidates, rangeUnits);
+				unit->setCachedRangeUnits(frameIndex, center, range, rangeUnits);
+			}
+		}
+
 		// ==================== progress commands ====================
 
 		//VERY IMPORTANT: compute next state depending on the first order of the list
@@ -626,11 +667,7 @@ namespace Glest {
 
 				Vec2i pos = command->getUnit() != NULL ? command->getUnit()->getCenteredPos() : command->getPos();
 
-				if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-					char szBuf[8096] = "";
-					snprintf(szBuf, 8096, "[updateMove] pos [%s] unit [%d - %s] cmd [%s]", pos.getString().c_str(), unit->getId(), unit->getFullName(false).c_str(), command->toString(false).c_str());
-					unit->logSynchData(__FILE__, __LINE__, szBuf);
-				}
+				if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateMove(pos.x,pos.y,commandTypeId)", pos.x, pos.y, command->getCommandType()->getId());
 
 				if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chrono.getMillis() > 0) SystemFlags::OutputDebug(SystemFlags::debugPerformance, "In [%s::%s Line: %d] took msecs: %lld\n", __FILE__, __FUNCTION__, __LINE__, chrono.getMillis());
 
@@ -638,7 +675,9 @@ namespace Glest {
 				TravelState tsValue = tsImpossible;
 				switch (this->game->getGameSettings()->getPathFinderType()) {
 					case pfBasic:
-						tsValue = pathFinder->findPath(unit, pos, NULL, frameIndex);
+						// large groups sent to a position share one flow field
+						tsValue = pathFinder->findPath(unit, pos, NULL, frameIndex,
+							command->getUnit() != NULL ? -1 : command->getUnitCommandGroupId());
 						break;
 					default:
 						throw megaglest_runtime_error("detected unsupported pathfinder type!");
@@ -667,11 +706,7 @@ namespace Glest {
 				}
 
 
-				if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-					char szBuf[8096] = "";
-					snprintf(szBuf, 8096, "[updateMove] tsValue [%d]", tsValue);
-					unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-				}
+				if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateMove(tsValue)", tsValue);
 
 				if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chrono.getMillis() > 0) SystemFlags::OutputDebug(SystemFlags::debugPerformance, "In [%s::%s] Line: %d took msecs: %lld --------------------------- [END OF METHOD] ---------------------------\n", __FILE__, __FUNCTION__, __LINE__, chrono.getMillis());
 
@@ -697,11 +732,7 @@ namespace Glest {
 		void UnitUpdater::updateAttack(Unit *unit, int frameIndex) {
 			try {
 
-				if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-					char szBuf[8096] = "";
-					snprintf(szBuf, 8096, "[updateAttack]");
-					unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-				}
+				if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateAttack(line)", __LINE__);
 
 				Chrono chrono;
 				if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled) chrono.start();
@@ -709,22 +740,14 @@ namespace Glest {
 				Command *command = unit->getCurrCommand();
 				if (command == NULL) {
 
-					if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-						char szBuf[8096] = "";
-						snprintf(szBuf, 8096, "[updateAttack]");
-						unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-					}
+					if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateAttack(line)", __LINE__);
 
 					return;
 				}
 				const AttackCommandType *act = static_cast<const AttackCommandType*>(command->getCommandType());
 				if (act == NULL) {
 
-					if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-						char szBuf[8096] = "";
-						snprintf(szBuf, 8096, "[updateAttack]");
-						unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-					}
+					if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateAttack(line)", __LINE__);
 
 					return;
 				}
@@ -737,11 +760,7 @@ namespace Glest {
 					if (frameIndex < 0) {
 						unit->finishCommand(); // all queued "ground attacks" are skipped if somthing else is queued after them.
 
-						if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-							char szBuf[8096] = "";
-							snprintf(szBuf, 8096, "[updateAttack]");
-							unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-						}
+						if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateAttack(line)", __LINE__);
 					}
 					return;
 				}
@@ -758,11 +777,7 @@ namespace Glest {
 								unit->setCurrSkill(scStop);
 							}
 
-							if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-								char szBuf[8096] = "";
-								snprintf(szBuf, 8096, "[updateAttack]");
-								unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-							}
+							if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateAttack(line)", __LINE__);
 						}
 						if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chrono.getMillis() > 0) SystemFlags::OutputDebug(SystemFlags::debugPerformance, "In [%s::%s Line: %d] took msecs: %lld\n", __FILE__, __FUNCTION__, __LINE__, chrono.getMillis());
 					} else {
@@ -776,11 +791,7 @@ namespace Glest {
 							pos = command->getPos();
 						}
 
-						if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-							char szBuf[8096] = "";
-							snprintf(szBuf, 8096, "[updateAttack] pos [%s] unit->getPos() [%s]", pos.getString().c_str(), unit->getPos().getString().c_str());
-							unit->logSynchData(__FILE__, __LINE__, szBuf);
-						}
+						if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateAttack(pos.x,pos.y,unitPos.x,unitPos.y)", pos.x, pos.y, unit->getPos().x, unit->getPos().y);
 
 						if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chrono.getMillis() > 0) SystemFlags::OutputDebug(SystemFlags::debugPerformance, "In [%s::%s Line: %d] took msecs: %lld\n", __FILE__, __FUNCTION__, __LINE__, chrono.getMillis());
 
@@ -807,19 +818,10 @@ namespace Glest {
 								// don't run over to dead body if there is still something to do in the queue
 								unit->finishCommand();
 
-								if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-									char szBuf[8096] = "";
-									snprintf(szBuf, 8096, "[updateAttack]");
-									unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-								}
+								if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateAttack(line)", __LINE__);
 							} else {
 								//if unit arrives destPos order has ended
-								if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0 &&
-									SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
-									char szBuf[8096] = "";
-									snprintf(szBuf, 8096, "#1 [updateAttack] tsValue = %d", tsValue);
-									unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-								}
+								if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "#1 updateAttack(tsValue)", tsValue);
 
 								switch (tsValue) {
 									case tsMoving:
@@ -875,12 +877,7 @@ namespace Glest {
 												}
 								*/
 
-								if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0 &&
-									SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
-									char szBuf[8096] = "";
-									snprintf(szBuf, 8096, "#2 [updateAttack] tsValue = %d", tsValue);
-									unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-								}
+								if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "#2 updateAttack(tsValue)", tsValue);
 
 							}
 						}
@@ -915,11 +912,6 @@ namespace Glest {
 
 				// Nothing to do
 				if (frameIndex >= 0) {
-					if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex >= 0) {
-						char szBuf[8096] = "";
-						snprintf(szBuf, 8096, "[updateAttackStopped]");
-						unit->logSynchDataThreaded(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-					}
 					clearUnitPrecache(unit);
 					return;
 				}
@@ -937,11 +929,7 @@ namespace Glest {
 
 
 				if (unit->getCommandSize() > 1) {
-					if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-						char szBuf[8096] = "";
-						snprintf(szBuf, 8096, "[updateAttackStopped]");
-						unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-					}
+					if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateAttackStopped(line)", __LINE__);
 
 					unit->finishCommand(); // attackStopped is skipped if somthing else is queued after this.
 					return;
@@ -957,28 +945,16 @@ namespace Glest {
 					unit->setCurrSkill(asct->getAttackSkillType());
 					unit->setTarget(result.second);
 
-					if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-						char szBuf[8096] = "";
-						snprintf(szBuf, 8096, "[updateAttackStopped]");
-						unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-					}
+					if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateAttackStopped(line)", __LINE__);
 				} else if (attackableOnRange(unit, &enemy, asct->getAttackSkillType(), (frameIndex >= 0))) {
 					unit->setCurrSkill(asct->getAttackSkillType());
 					unit->setTarget(enemy);
 
-					if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-						char szBuf[8096] = "";
-						snprintf(szBuf, 8096, "[updateAttackStopped]");
-						unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-					}
+					if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateAttackStopped(line)", __LINE__);
 				} else {
 					unit->setCurrSkill(asct->getStopSkillType());
 
-					if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-						char szBuf[8096] = "";
-						snprintf(szBuf, 8096, "[updateAttackStopped]");
-						unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-					}
+					if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateAttackStopped(line)", __LINE__);
 				}
 
 				if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chrono.getMillis() > 0) SystemFlags::OutputDebug(SystemFlags::debugPerformance, "In [%s::%s] Line: %d took msecs: %lld --------------------------- [END OF METHOD] ---------------------------\n", __FILE__, __FUNCTION__, __LINE__, chrono.getMillis());
@@ -1055,11 +1031,7 @@ namespace Glest {
 		void UnitUpdater::updateBuild(Unit *unit, int frameIndex) {
 			try {
 
-				if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-					char szBuf[8096] = "";
-					snprintf(szBuf, 8096, "[updateBuild]");
-					unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-				}
+				if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateBuild(line)", __LINE__);
 
 				Chrono chrono;
 				if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled) chrono.start();
@@ -1087,20 +1059,11 @@ namespace Glest {
 						{
 							Vec2i buildPos = map->findBestBuildApproach(unit, command->getPos(), ut);
 
-							if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-								char szBuf[8096] = "";
-								snprintf(szBuf, 8096, "[updateBuild] unit->getPos() [%s] command->getPos() [%s] buildPos [%s]",
-									unit->getPos().getString().c_str(), command->getPos().getString().c_str(), buildPos.getString().c_str());
-								unit->logSynchData(__FILE__, __LINE__, szBuf);
-							}
+							if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateBuild(unitPos.x,unitPos.y,buildPos.x,buildPos.y)", unit->getPos().x, unit->getPos().y, buildPos.x, buildPos.y);
 
 							tsValue = pathFinder->findPath(unit, buildPos, NULL, frameIndex);
 
-							if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-								char szBuf[8096] = "";
-								snprintf(szBuf, 8096, "[updateBuild] tsValue: %d", tsValue);
-								unit->logSynchData(__FILE__, __LINE__, szBuf);
-							}
+							if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateBuild(tsValue)", tsValue);
 
 						}
 						break;
@@ -1243,21 +1206,13 @@ namespace Glest {
 						if (builtUnit != NULL && builtUnit != command->getUnit()) {
 							if (SystemFlags::getSystemSettingType(SystemFlags::debugUnitCommands).enabled) SystemFlags::OutputDebug(SystemFlags::debugUnitCommands, "In [%s::%s Line: %d] builtUnit is not the command's unit!\n", __FILE__, __FUNCTION__, __LINE__);
 
-							if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-								char szBuf[8096] = "";
-								snprintf(szBuf, 8096, "[updateBuild]");
-								unit->logSynchData(__FILE__, __LINE__, szBuf);
-							}
+							if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateBuild(line)", __LINE__);
 
 							unit->setCurrSkill(scStop);
 						} else if (builtUnit == NULL || builtUnit->isBuilt()) {
 							if (SystemFlags::getSystemSettingType(SystemFlags::debugUnitCommands).enabled) SystemFlags::OutputDebug(SystemFlags::debugUnitCommands, "In [%s::%s Line: %d] builtUnit is NULL or ALREADY built\n", __FILE__, __FUNCTION__, __LINE__);
 
-							if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-								char szBuf[8096] = "";
-								snprintf(szBuf, 8096, "[updateBuild]");
-								unit->logSynchData(__FILE__, __LINE__, szBuf);
-							}
+							if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateBuild(line)", __LINE__);
 
 							unit->finishCommand();
 							unit->setCurrSkill(scStop);
@@ -1265,11 +1220,7 @@ namespace Glest {
 						} else if (builtUnit == NULL || builtUnit->repair()) {
 							if (SystemFlags::getSystemSettingType(SystemFlags::debugUnitCommands).enabled) SystemFlags::OutputDebug(SystemFlags::debugUnitCommands, "In [%s::%s Line: %d]\n", __FILE__, __FUNCTION__, __LINE__);
 
-							if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-								char szBuf[8096] = "";
-								snprintf(szBuf, 8096, "[updateBuild]");
-								unit->logSynchData(__FILE__, __LINE__, szBuf);
-							}
+							if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateBuild(line)", __LINE__);
 
 							const CommandType *ct = (command != NULL ? command->getCommandType() : NULL);
 							//building finished
@@ -1316,11 +1267,7 @@ namespace Glest {
 					return;
 				}
 
-				if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-					char szBuf[8096] = "";
-					snprintf(szBuf, 8096, "[updateHarvestEmergencyReturn]");
-					unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-				}
+				if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateHarvestEmergencyReturn(line)", __LINE__);
 
 				//printf("\n#1 updateHarvestEmergencyReturn\n");
 				Command *command = unit->getCurrCommand();
@@ -1402,11 +1349,7 @@ namespace Glest {
 		void UnitUpdater::updateHarvest(Unit *unit, int frameIndex) {
 			try {
 
-				if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-					char szBuf[8096] = "";
-					snprintf(szBuf, 8096, "[updateHarvest]");
-					unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-				}
+				if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateHarvest(line)", __LINE__);
 
 				Chrono chrono;
 				if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled) chrono.start();
@@ -1473,11 +1416,7 @@ namespace Glest {
 												//printf("%%----------- unit [%s - %d] CHANGING RESOURCE POS from [%s] to [%s]\n",unit->getFullName().c_str(),unit->getId(),command->getOriginalPos().getString().c_str(),clickPos.getString().c_str());
 
 												if (frameIndex < 0) {
-													if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-														char szBuf[8096] = "";
-														snprintf(szBuf, 8096, "[updateHarvest] clickPos [%s]", clickPos.getString().c_str());
-														unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-													}
+													if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateHarvest(clickPos.x,clickPos.y)", clickPos.x, clickPos.y);
 
 													command->setPos(clickPos);
 												}
@@ -1493,11 +1432,7 @@ namespace Glest {
 
 								if (canHarvestDestPos == true) {
 									if (frameIndex < 0) {
-										if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-											char szBuf[8096] = "";
-											snprintf(szBuf, 8096, "[updateHarvest]");
-											unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-										}
+										if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateHarvest(line)", __LINE__);
 
 										unit->setLastHarvestResourceTarget(NULL);
 									}
@@ -1526,34 +1461,21 @@ namespace Glest {
 													throw megaglest_runtime_error("detected unsupported pathfinder type!");
 											}
 
-											if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-												char szBuf[8096] = "";
-												snprintf(szBuf, 8096, "[updateHarvest] targetPos [%s]", targetPos.getString().c_str());
-												unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-											}
+											if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateHarvest(targetPos.x,targetPos.y,line)", targetPos.x, targetPos.y, __LINE__);
 										}
 										if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chrono.getMillis() > 0) SystemFlags::OutputDebug(SystemFlags::debugPerformance, "In [%s::%s Line: %d] took msecs: %lld\n", __FILE__, __FUNCTION__, __LINE__, chrono.getMillis());
 									}
 								}
 								if (canHarvestDestPos == false) {
 									if (frameIndex < 0) {
-										if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-											char szBuf[8096] = "";
-											snprintf(szBuf, 8096, "[updateHarvest] targetPos [%s]", targetPos.getString().c_str());
-											unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-										}
+										if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateHarvest(targetPos.x,targetPos.y,line)", targetPos.x, targetPos.y, __LINE__);
 
 										unit->setLastHarvestResourceTarget(&targetPos);
 									}
 
 									if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chrono.getMillis() > 0) SystemFlags::OutputDebug(SystemFlags::debugPerformance, "In [%s::%s Line: %d] took msecs: %lld\n", __FILE__, __FUNCTION__, __LINE__, chrono.getMillis());
 
-									if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-										char szBuf[8096] = "";
-										snprintf(szBuf, 8096, "[updateHarvest] unit->getPos() [%s] command->getPos() [%s]",
-											unit->getPos().getString().c_str(), command->getPos().getString().c_str());
-										unit->logSynchData(__FILE__, __LINE__, szBuf);
-									}
+									if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateHarvest(unitPos.x,unitPos.y,commandPos.x,commandPos.y)", unit->getPos().x, unit->getPos().y, command->getPos().x, command->getPos().y);
 
 									//if not continue walking
 									bool wasStuck = false;
@@ -1629,12 +1551,7 @@ namespace Glest {
 											if (targetPos.x >= 0) {
 												//if not continue walking
 
-												if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-													char szBuf[8096] = "";
-													snprintf(szBuf, 8096, "[updateHarvest #2] unit->getPos() [%s] command->getPos() [%s] targetPos [%s]",
-														unit->getPos().getString().c_str(), command->getPos().getString().c_str(), targetPos.getString().c_str());
-													unit->logSynchData(__FILE__, __LINE__, szBuf);
-												}
+												if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateHarvest #2(unitPos.x,unitPos.y,targetPos.x,targetPos.y)", unit->getPos().x, unit->getPos().y, targetPos.x, targetPos.y);
 
 												wasStuck = false;
 												TravelState tsValue = tsImpossible;
@@ -1682,12 +1599,7 @@ namespace Glest {
 						//if loaded, return to store
 						Unit *store = world->nearestStore(unit->getPos(), unit->getFaction()->getIndex(), unit->getLoadType());
 						if (store != NULL) {
-							if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-								char szBuf[8096] = "";
-								snprintf(szBuf, 8096, "[updateHarvest #3] unit->getPos() [%s] store->getCenteredPos() [%s]",
-									unit->getPos().getString().c_str(), store->getCenteredPos().getString().c_str());
-								unit->logSynchData(__FILE__, __LINE__, szBuf);
-							}
+							if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateHarvest #3(unitPos.x,unitPos.y,storePos.x,storePos.y)", unit->getPos().x, unit->getPos().y, store->getCenteredPos().x, store->getCenteredPos().y);
 
 							TravelState tsValue = tsImpossible;
 							switch (this->game->getGameSettings()->getPathFinderType()) {
@@ -1806,6 +1718,7 @@ namespace Glest {
 										if (sc->decAmount(1)) {
 											//const ResourceType *rt = r->getType();
 											sc->deleteResource();
+											map->markPassabilityChanged(Map::toUnitCoords(Map::toSurfCoords(unitTargetPos)), Map::cellScale);
 											world->removeResourceTargetFromCache(unitTargetPos);
 
 											switch (this->game->getGameSettings()->getPathFinderType()) {
@@ -1979,11 +1892,7 @@ namespace Glest {
 					clearUnitPrecache(unit);
 					return;
 				}
-				if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-					char szBuf[8096] = "";
-					snprintf(szBuf, 8096, "[updateRepair]");
-					unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-				}
+				if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateRepair(line)", __LINE__);
 
 				Chrono chrono;
 				if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled) chrono.start();
@@ -2150,11 +2059,7 @@ namespace Glest {
 						} else {
 							if (SystemFlags::getSystemSettingType(SystemFlags::debugUnitCommands).enabled) SystemFlags::OutputDebug(SystemFlags::debugUnitCommands, "In [%s::%s Line: %d]\n", __FILE__, __FUNCTION__, __LINE__);
 
-							if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-								char szBuf[8096] = "";
-								snprintf(szBuf, 8096, "[updateRepair] unit->getPos() [%s] command->getPos()() [%s] repairPos [%s]", unit->getPos().getString().c_str(), command->getPos().getString().c_str(), repairPos.getString().c_str());
-								unit->logSynchData(__FILE__, __LINE__, szBuf);
-							}
+							if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateRepair(unitPos.x,unitPos.y,repairPos.x,repairPos.y)", unit->getPos().x, unit->getPos().y, repairPos.x, repairPos.y);
 
 							if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chrono.getMillis() > 0) SystemFlags::OutputDebug(SystemFlags::debugPerformance, "In [%s::%s] Line: %d took msecs: %lld\n", __FILE__, __FUNCTION__, __LINE__, chrono.getMillis());
 
@@ -2289,11 +2194,7 @@ namespace Glest {
 					clearUnitPrecache(unit);
 					return;
 				}
-				if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-					char szBuf[8096] = "";
-					snprintf(szBuf, 8096, "[updateProduce]");
-					unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-				}
+				if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateProduce(line)", __LINE__);
 
 				Chrono chrono;
 				if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled) chrono.start();
@@ -2387,11 +2288,7 @@ namespace Glest {
 					clearUnitPrecache(unit);
 					return;
 				}
-				if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-					char szBuf[8096] = "";
-					snprintf(szBuf, 8096, "[updateUpgrade]");
-					unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-				}
+				if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateUpgrade(line)", __LINE__);
 
 				Chrono chrono;
 				if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled) chrono.start();
@@ -2444,11 +2341,7 @@ namespace Glest {
 					clearUnitPrecache(unit);
 					return;
 				}
-				if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true && frameIndex < 0) {
-					char szBuf[8096] = "";
-					snprintf(szBuf, 8096, "[updateMorph]");
-					unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(), __LINE__, szBuf);
-				}
+				if (frameIndex < 0) SYNCH_TRACE(unit->getId(), "updateMorph(line)", __LINE__);
 
 				Chrono chrono;
 				if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled) chrono.start();
@@ -2791,84 +2684,160 @@ namespace Glest {
 			return unitOnRange(unit, range, rangedPtr, ast, evalMode);
 		}
 
-		bool UnitUpdater::findCachedCellsEnemies(Vec2i center, int range, int size, vector<Unit*> &enemies,
-			const AttackSkillType *ast, const Unit *unit,
-			const Unit *commandTarget) {
-			bool result = false;
-			MutexSafeWrapper safeMutex(mutexUnitRangeCellsLookupItemCache, string(__FILE__) + "_" + intToStr(__LINE__));
-			std::map<Vec2i, std::map<int, std::map<int, UnitRangeCellsLookupItem > > >::iterator iterFind = UnitRangeCellsLookupItemCache.find(center);
-
-			if (iterFind != UnitRangeCellsLookupItemCache.end()) {
-				std::map<int, std::map<int, UnitRangeCellsLookupItem > >::iterator iterFind3 = iterFind->second.find(size);
-				if (iterFind3 != iterFind->second.end()) {
-					std::map<int, UnitRangeCellsLookupItem>::iterator iterFind4 = iterFind3->second.find(range);
-					if (iterFind4 != iterFind3->second.end()) {
-						result = true;
-
-						std::vector<Cell *> &cellList = iterFind4->second.rangeCellList;
-						for (int idx = 0; idx < (int) cellList.size(); ++idx) {
-							Cell *cell = cellList[idx];
-
-							findEnemiesForCell(ast, cell, unit, commandTarget, enemies);
-						}
+		// Units in the cells within range of unit, from the think pass of this
+		// frame when it looked far enough, from the unit grid otherwise
+		void UnitUpdater::findUnitsOnRange(const Unit *unit, const Vec2i &center, int range,
+			const AttackSkillType *ast, vector<Unit*> &units) const {
+			vector<UnitGridEntry> candidates;
+			const vector<Unit*> *cachedUnits = unit->getCachedRangeUnits(world->getFrameCount(), center, range);
+			if (cachedUnits != NULL) {
+				// units that died since are no longer in the grid
+				candidates.reserve(cachedUnits->size());
+				UnitGridEntry entry;
+				for (unsigned int i = 0; i < cachedUnits->size(); ++i) {
+					if (map->getUnitGrid().findUnit((*cachedUnits)[i], entry) == true) {
+						candidates.push_back(entry);
 					}
 				}
+			} else {
+				int size = unit->getType()->getSize();
+				map->getUnitGrid().findUnits(Vec2i(center.x - range, center.y - range),
+					Vec2i(center.x + range + size - 1, center.y + range + size - 1), candidates);
 			}
+			findUnitsOnRangeCells(unit, center, range, ast, candidates, units);
 
-			return result;
+			if (cachedUnits != NULL && SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true) {
+				checkRangeUnits(unit, center, range, ast, units);
+			}
 		}
 
-		void UnitUpdater::findEnemiesForCell(const AttackSkillType *ast, Cell *cell, const Unit *unit,
-			const Unit *commandTarget, vector<Unit*> &enemies) {
-			//all fields
-			for (int k = 0; k < fieldCount; k++) {
-				Field f = static_cast<Field>(k);
+		void UnitUpdater::setThinkPassUnits(int frameIndex, const std::set<int> &unitIds) {
+			thinkPassUnitIds = unitIds;
+			thinkPassFrame = frameIndex;
+		}
 
-				//check field
-				if ((ast == NULL || ast->getAttackField(f))) {
-					Unit *possibleEnemy = cell->getUnit(f);
+		// units, found from the think pass, must be what the unit grid gives
+		// now less the units created after the think pass of this frame
+		void UnitUpdater::checkRangeUnits(const Unit *unit, const Vec2i &center, int range,
+			const AttackSkillType *ast, const vector<Unit*> &units) const {
+			if (thinkPassFrame != world->getFrameCount()) {
+				return;
+			}
+			int size = unit->getType()->getSize();
+			vector<UnitGridEntry> candidates;
+			map->getUnitGrid().findUnits(Vec2i(center.x - range, center.y - range),
+				Vec2i(center.x + range + size - 1, center.y + range + size - 1), candidates);
+			vector<Unit*> gridUnits;
+			findUnitsOnRangeCells(unit, center, range, ast, candidates, gridUnits);
 
-					//check enemy
-					if (possibleEnemy != NULL && possibleEnemy->isAlive()) {
-						if ((unit->isAlly(possibleEnemy) == false && commandTarget == NULL) ||
-							commandTarget == possibleEnemy) {
+			vector<Unit*> expectedUnits;
+			for (unsigned int i = 0; i < gridUnits.size(); ++i) {
+				if (thinkPassUnitIds.find(gridUnits[i]->getId()) != thinkPassUnitIds.end()) {
+					expectedUnits.push_back(gridUnits[i]);
+				}
+			}
+			if (expectedUnits != units) {
+				char szBuf[8096] = "";
+				snprintf(szBuf, 8096, "Think pass range units of unit: %d at [%s] range: %d are %d, the unit grid has %d for frame: %d",
+					unit->getId(), center.getString().c_str(), range, (int) units.size(), (int) expectedUnits.size(), world->getFrameCount());
+				throw megaglest_runtime_error(szBuf);
+			}
+		}
 
-							enemies.push_back(possibleEnemy);
+		// The candidates occupying cells within range of unit, in the order a
+		// scan of the range cells (x, then y, then field) first meets them. Only
+		// the fields ast can attack are checked, all of them when ast is NULL.
+		void UnitUpdater::findUnitsOnRangeCells(const Unit *unit, const Vec2i &center, int range,
+			const AttackSkillType *ast, const vector<UnitGridEntry> &candidates,
+			vector<Unit*> &units) const {
+			int size = unit->getType()->getSize();
+			Vec2f floatCenter = unit->getFloatCenteredPos();
+			Vec2i minPos(center.x - range, center.y - range);
+			Vec2i maxPos(center.x + range + size - 1, center.y + range + size - 1);
+			int scanH = maxPos.y - minPos.y + 1;
+
+			vector<std::pair<int, Unit *> > found;
+			found.reserve(candidates.size());
+			for (unsigned int idx = 0; idx < candidates.size(); ++idx) {
+				const UnitGridEntry &entry = candidates[idx];
+				int scanIndex = -1;
+				for (int i = max(minPos.x, entry.pos.x); scanIndex < 0 && i <= min(maxPos.x, entry.pos.x + entry.size - 1); ++i) {
+					for (int j = max(minPos.y, entry.pos.y); scanIndex < 0 && j <= min(maxPos.y, entry.pos.y + entry.size - 1); ++j) {
+						//cells inside map and in range
+#ifdef USE_STREFLOP
+						if (map->isInside(i, j) && streflop::floor(static_cast<streflop::Simple>(floatCenter.dist(Vec2f((float) i, (float) j)))) <= (range + 1)) {
+#else
+						if (map->isInside(i, j) && floor(floatCenter.dist(Vec2f((float) i, (float) j))) <= (range + 1)) {
+#endif
+							Cell *cell = map->getCell(i, j);
+							for (int k = 0; k < fieldCount; k++) {
+								Field f = static_cast<Field>(k);
+								if ((ast == NULL || ast->getAttackField(f)) && cell->getUnit(f) == entry.unit) {
+									scanIndex = ((i - minPos.x) * scanH + (j - minPos.y)) * fieldCount + k;
+									break;
+								}
+							}
 						}
 					}
 				}
+				if (scanIndex >= 0) {
+					found.push_back(std::make_pair(scanIndex, entry.unit));
+				}
+			}
+
+			// a cell field holds one unit so the scan indexes are unique
+			std::sort(found.begin(), found.end());
+			for (unsigned int idx = 0; idx < found.size(); ++idx) {
+				units.push_back(found[idx].second);
 			}
 		}
 
 		void UnitUpdater::findEnemiesForCell(const Vec2i pos, int size, int sightRange, const Faction *faction, vector<Unit*> &enemies, bool attackersOnly) const {
-			//all fields
-			for (int k = 0; k < fieldCount; k++) {
-				Field f = static_cast<Field>(k);
+			Vec2i minPos(pos.x - sightRange, pos.y - sightRange);
+			Vec2i maxPos(pos.x + size + sightRange - 1, pos.y + size + sightRange - 1);
 
-				for (int i = pos.x - sightRange; i < pos.x + size + sightRange; ++i) {
-					for (int j = pos.y - sightRange; j < pos.y + size + sightRange; ++j) {
+			vector<UnitGridEntry> candidates;
+			map->getUnitGrid().findUnits(minPos, maxPos, candidates);
+
+			vector<std::pair<int, Unit *> > found;
+			for (unsigned int idx = 0; idx < candidates.size(); ++idx) {
+				Unit *possibleEnemy = candidates[idx].unit;
+
+				//check enemy
+				if (possibleEnemy->isAlive() == false || faction->getTeam() == possibleEnemy->getTeam()) {
+					continue;
+				}
+				if (attackersOnly == true &&
+					possibleEnemy->getType()->hasCommandClass(ccAttack) == false &&
+					possibleEnemy->getType()->hasCommandClass(ccAttackStopped) == false) {
+					continue;
+				}
+
+				const UnitGridEntry &entry = candidates[idx];
+				bool inCells = false;
+				for (int i = max(minPos.x, entry.pos.x); inCells == false && i <= min(maxPos.x, entry.pos.x + entry.size - 1); ++i) {
+					for (int j = max(minPos.y, entry.pos.y); inCells == false && j <= min(maxPos.y, entry.pos.y + entry.size - 1); ++j) {
 						Vec2i testPos(i, j);
 						if (map->isInside(testPos) &&
 							map->isInsideSurface(map->toSurfCoords(testPos))) {
 							Cell *cell = map->getCell(testPos);
-							//check field
-							Unit *possibleEnemy = cell->getUnit(f);
-
-							//check enemy
-							if (possibleEnemy != NULL && possibleEnemy->isAlive()) {
-								if (faction->getTeam() != possibleEnemy->getTeam()) {
-									if (attackersOnly == true) {
-										if (possibleEnemy->getType()->hasCommandClass(ccAttack) || possibleEnemy->getType()->hasCommandClass(ccAttackStopped)) {
-											enemies.push_back(possibleEnemy);
-										}
-									} else {
-										enemies.push_back(possibleEnemy);
-									}
+							for (int k = 0; k < fieldCount; k++) {
+								if (cell->getUnit(static_cast<Field>(k)) == possibleEnemy) {
+									inCells = true;
+									break;
 								}
 							}
 						}
 					}
 				}
+				if (inCells == true) {
+					found.push_back(std::make_pair(possibleEnemy->getId(), possibleEnemy));
+				}
+			}
+
+			std::sort(found.begin(), found.end());
+			for (unsigned int idx = 0; idx < found.size(); ++idx) {
+				enemies.push_back(found[idx].second);
 			}
 		}
 
@@ -2889,42 +2858,21 @@ namespace Glest {
 				if (commandTarget != NULL && commandTarget->isDead()) {
 					commandTarget = NULL;
 				}
-				//aux vars
-				int size = unit->getType()->getSize();
-				Vec2i center = unit->getPos();
-				Vec2f floatCenter = unit->getFloatCenteredPos();
-
-				//bool foundInCache = true;
-				if (findCachedCellsEnemies(center, range, size, enemies, ast,
-					unit, commandTarget) == false) {
-
-					//foundInCache = false;
-					//nearby cells
-					UnitRangeCellsLookupItem cacheItem;
-					for (int i = center.x - range; i < center.x + range + size; ++i) {
-						for (int j = center.y - range; j < center.y + range + size; ++j) {
-							//cells inside map and in range
-#ifdef USE_STREFLOP
-							if (map->isInside(i, j) && streflop::floor(static_cast<streflop::Simple>(floatCenter.dist(Vec2f((float) i, (float) j)))) <= (range + 1)) {
-#else
-							if (map->isInside(i, j) && floor(floatCenter.dist(Vec2f((float) i, (float) j))) <= (range + 1)) {
-#endif
-								Cell *cell = map->getCell(i, j);
-								findEnemiesForCell(ast, cell, unit, commandTarget, enemies);
-
-								cacheItem.rangeCellList.push_back(cell);
-							}
-							}
-						}
+				//units in the nearby cells
+				vector<Unit*> rangeUnits;
+				findUnitsOnRange(unit, unit->getPos(), range, ast, rangeUnits);
+				for (int i = 0; i < (int) rangeUnits.size(); ++i) {
+					Unit *possibleEnemy = rangeUnits[i];
 
+					//check enemy
+					if (possibleEnemy->isAlive()) {
+						if ((unit->isAlly(possibleEnemy) == false && commandTarget == NULL) ||
+							commandTarget == possibleEnemy) {
 
-					// Ok update our caches with the latest info
-					if (cacheItem.rangeCellList.empty() == false) {
-						MutexSafeWrapper safeMutex(mutexUnitRangeCellsLookupItemCache, string(__FILE__) + "_" + intToStr(__LINE__));
-
-						UnitRangeCellsLookupItemCache[center][size][range] = cacheItem;
-					}
+							enemies.push_back(possibleEnemy);
+						}
 					}
+				}
 
 				//attack enemies that can attack first
 				float distToUnit = -1;
@@ -3120,41 +3068,21 @@ namespace Glest {
 				//		commandTarget = NULL;
 				//	}
 
-					//aux vars
-				int size = unit->getType()->getSize();
-				Vec2i center = unit->getPosNotThreadSafe();
-				Vec2f floatCenter = unit->getFloatCenteredPos();
-
-				//bool foundInCache = true;
-				if (findCachedCellsEnemies(center, range, size, enemies, ast,
-					unit, commandTarget) == false) {
-
-					//foundInCache = false;
-					//nearby cells
-					UnitRangeCellsLookupItem cacheItem;
-					for (int i = center.x - range; i < center.x + range + size; ++i) {
-						for (int j = center.y - range; j < center.y + range + size; ++j) {
-							//cells inside map and in range
-#ifdef USE_STREFLOP
-							if (map->isInside(i, j) && streflop::floor(static_cast<streflop::Simple>(floatCenter.dist(Vec2f((float) i, (float) j)))) <= (range + 1)) {
-#else
-							if (map->isInside(i, j) && floor(floatCenter.dist(Vec2f((float) i, (float) j))) <= (range + 1)) {
-#endif
-								Cell *cell = map->getCell(i, j);
-								findEnemiesForCell(ast, cell, unit, commandTarget, enemies);
-
-								cacheItem.rangeCellList.push_back(cell);
-							}
-							}
-						}
+				//units in the nearby cells
+				vector<Unit*> rangeUnits;
+				findUnitsOnRange(unit, unit->getPosNotThreadSafe(), range, ast, rangeUnits);
+				for (int i = 0; i < (int) rangeUnits.size(); ++i) {
+					Unit *possibleEnemy = rangeUnits[i];
 
-					// Ok update our caches with the latest info
-					if (cacheItem.rangeCellList.empty() == false) {
-						MutexSafeWrapper safeMutex(mutexUnitRangeCellsLookupItemCache, string(__FILE__) + "_" + intToStr(__LINE__));
+					//check enemy
+					if (possibleEnemy->isAlive()) {
+						if ((unit->isAlly(possibleEnemy) == false && commandTarget == NULL) ||
+							commandTarget == possibleEnemy) {
 
-						UnitRangeCellsLookupItemCache[center][size][range] = cacheItem;
-					}
+							enemies.push_back(possibleEnemy);
+						}
 					}
+				}
 
 				} catch (const exception &ex) {
 					//setRunningStatus(false);
@@ -3174,97 +3102,21 @@ namespace Glest {
 			}
 
 
-		void UnitUpdater::findUnitsForCell(Cell *cell, vector<Unit*> &units) {
-			//all fields
-			if (cell != NULL) {
-				for (int k = 0; k < fieldCount; k++) {
-					Field f = static_cast<Field>(k);
-
-					//check field
-					Unit *cellUnit = cell->getUnit(f);
-
-					if (cellUnit != NULL && cellUnit->isAlive()) {
-						// check if unit already is in list
-						bool found = false;
-						//printf("---- search for cellUnit=%d\n",cellUnit->getId());
-						for (unsigned int i = 0; i < units.size(); ++i) {
-							Unit *unitInList = units[i];
-							//printf("compare unitInList=%d cellUnit=%d\n",unitInList->getId(),cellUnit->getId());
-							if (unitInList->getId() == cellUnit->getId()) {
-								found = true;
-								break;
-							}
-						}
-						if (found == false) {
-							//printf(">>> adding cellUnit=%d\n",cellUnit->getId());
-							units.push_back(cellUnit);
-						}
-					}
-				}
-			}
-		}
-
 		vector<Unit*> UnitUpdater::findUnitsInRange(const Unit *unit, int radius) {
-			int range = radius;
-			vector<Unit*> units;
-
-			//aux vars
-			int size = unit->getType()->getSize();
-			Vec2i center = unit->getPosNotThreadSafe();
-			Vec2f floatCenter = unit->getFloatCenteredPos();
+			vector<Unit*> rangeUnits;
+			findUnitsOnRange(unit, unit->getPosNotThreadSafe(), radius, NULL, rangeUnits);
 
-			//nearby cells
-			//UnitRangeCellsLookupItem cacheItem;
-			for (int i = center.x - range; i < center.x + range + size; ++i) {
-				for (int j = center.y - range; j < center.y + range + size; ++j) {
-					//cells inside map and in range
-#ifdef USE_STREFLOP
-					if (map->isInside(i, j) && streflop::floor(static_cast<streflop::Simple>(floatCenter.dist(Vec2f((float) i, (float) j)))) <= (range + 1)) {
-#else
-					if (map->isInside(i, j) && floor(floatCenter.dist(Vec2f((float) i, (float) j))) <= (range + 1)) {
-#endif
-						Cell *cell = map->getCell(i, j);
-						findUnitsForCell(cell, units);
-					}
-					}
-				}
-
-			return units;
-			}
-
-		string UnitUpdater::getUnitRangeCellsLookupItemCacheStats() {
-			string result = "";
-
-			int posCount = 0;
-			int sizeCount = 0;
-			int rangeCount = 0;
-			int rangeCountCellCount = 0;
-
-			MutexSafeWrapper safeMutex(mutexUnitRangeCellsLookupItemCache, string(__FILE__) + "_" + intToStr(__LINE__));
-			for (std::map<Vec2i, std::map<int, std::map<int, UnitRangeCellsLookupItem > > >::iterator iterMap1 = UnitRangeCellsLookupItemCache.begin();
-				iterMap1 != UnitRangeCellsLookupItemCache.end(); ++iterMap1) {
-				posCount++;
-
-				for (std::map<int, std::map<int, UnitRangeCellsLookupItem > >::iterator iterMap2 = iterMap1->second.begin();
-					iterMap2 != iterMap1->second.end(); ++iterMap2) {
-					sizeCount++;
-
-					for (std::map<int, UnitRangeCellsLookupItem>::iterator iterMap3 = iterMap2->second.begin();
-						iterMap3 != iterMap2->second.end(); ++iterMap3) {
-						rangeCount++;
-
-						rangeCountCellCount += (int) iterMap3->second.rangeCellList.size();
-					}
+			vector<Unit*> units;
+			for (unsigned int i = 0; i < rangeUnits.size(); ++i) {
+				if (rangeUnits[i]->isAlive()) {
+					units.push_back(rangeUnits[i]);
 				}
 			}
+			return units;
+		}
 
-			uint64 totalBytes = rangeCountCellCount * sizeof(Cell *);
-			totalBytes /= 1000;
-
-			char szBuf[8096] = "";
-			snprintf(szBuf, 8096, "pos [%d] size [%d] range [%d][%d] total KB: %s", posCount, sizeCount, rangeCount, rangeCountCellCount, formatNumber(totalBytes).c_str());
-			result = szBuf;
-			return result;
+		string UnitUpdater::getUnitGridStats() {
+			return map->getUnitGrid().getStats();
 		}
 
 		void UnitUpdater::saveGame(XmlNode *rootNode) {
@@ -33,6 +33,8 @@
 #include "particle.h"
 #include "randomgen.h"
 #include "command.h"
+#include "unit_grid.h"
+#include <set>
 #include "leak_dumper.h"
 
 using Shared::Graphics::ParticleObserver;
@@ -57,15 +59,6 @@ namespace Glest {
 		class ParticleDamager;
 		class Cell;
 
-		class UnitRangeCellsLookupItem {
-		public:
-
-			//int UnitRangeCellsLookupItemCacheTimerCountIndex;
-			std::vector<Cell *> rangeCellList;
-
-			static time_t lastDebug;
-		};
-
 		class AttackWarningData {
 		public:
 			Vec2f attackPosition;
@@ -82,6 +75,9 @@ namespace Glest {
 			static const int harvestDistance = 5;
 			static const int ultraResourceFactor = 3;
 			static const int megaResourceFactor = 4;
+			// cells a unit can get closer during one frame of updates, the
+			// think pass looks this much further so its result still holds
+			static const int thinkRangeMargin = 2;
 
 		private:
 			const GameCamera *gameCamera;
@@ -96,18 +92,19 @@ namespace Glest {
 			Mutex *mutexAttackWarnings;
 			float attackWarnRange;
 			AttackWarnings attackWarnings;
-
-			Mutex *mutexUnitRangeCellsLookupItemCache;
-			std::map<Vec2i, std::map<int, std::map<int, UnitRangeCellsLookupItem > > > UnitRangeCellsLookupItemCache;
-			//std::map<int,ExploredCellsLookupKey> ExploredCellsLookupItemCacheTimer;
-			//int UnitRangeCellsLookupItemCacheTimerCount;
-
-			bool findCachedCellsEnemies(Vec2i center, int range,
-				int size, vector<Unit*> &enemies,
-				const AttackSkillType *ast, const Unit *unit,
-				const Unit *commandTarget);
-			void findEnemiesForCell(const AttackSkillType *ast, Cell *cell, const Unit *unit,
-				const Unit *commandTarget, vector<Unit*> &enemies);
+			bool threadedThink;
+			// ids of all units when the think pass of thinkPassFrame ended,
+			// only kept while debugWorldSynch is on, see checkRangeUnits
+			std::set<int> thinkPassUnitIds;
+			int thinkPassFrame;
+
+			void findUnitsOnRange(const Unit *unit, const Vec2i &center, int range,
+				const AttackSkillType *ast, vector<Unit*> &units) const;
+			void findUnitsOnRangeCells(const Unit *unit, const Vec2i &center, int range,
+				const AttackSkillType *ast, const vector<UnitGridEntry> &candidates,
+				vector<Unit*> &units) const;
+			void checkRangeUnits(const Unit *unit, const Vec2i &center, int range,
+				const AttackSkillType *ast, const vector<Unit*> &units) const;
 
 		public:
 			UnitUpdater();
@@ -117,6 +114,13 @@ namespace Glest {
 			//update skills
 			bool updateUnit(Unit *unit);
 
+			//read only work done for all factions before any unit is updated
+			void thinkUnit(Unit *unit, int frameIndex);
+			inline bool getThreadedThink() const {
+				return threadedThink;
+			}
+			void setThinkPassUnits(int frameIndex, const std::set<int> &unitIds);
+
 			//update commands
 			void updateUnitCommand(Unit *unit, int frameIndex);
 			void updateStop(Unit *unit, int frameIndex);
@@ -134,6 +138,8 @@ namespace Glest {
 
 			void clearUnitPrecache(Unit *unit);
 			void removeUnitPrecache(Unit *unit);
+			int processPathFindingJobs(int frameIndex);
+			void takePathFindingMicros(int64 &precacheMicros, int64 &serialMicros);
 
 			inline unsigned int getAttackWarningCount() const {
 				return (unsigned int) attackWarnings.size();
@@ -145,7 +151,7 @@ namespace Glest {
 
 			vector<Unit*> findUnitsInRange(const Unit *unit, int radius);
 
-			string getUnitRangeCellsLookupItemCacheStats();
+			string getUnitGridStats();
 
 			void saveGame(XmlNode *rootNode);
 			void loadGame(const XmlNode *rootNode);
@@ -176,7 +182,6 @@ namespace Glest {
 			void SwapActiveCommandState(Unit *unit, CommandStateType commandStateType,
 				const CommandType *commandType,
 				int originalValue, int newValue);
-			void findUnitsForCell(Cell *cell, vector<Unit*> &units);
 
 		};
 
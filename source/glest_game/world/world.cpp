@@ -36,6 +36,8 @@
 #include <iostream>
 #include "sound.h"
 #include "sound_renderer.h"
+#include "synch_trace.h"
+#include "tech_tree_cache.h"
 
 #include "leak_dumper.h"
 
@@ -94,6 +96,13 @@ namespace Glest {
 			cacheFowAlphaTexture = false;
 			cacheFowAlphaTextureFogOfWarValue = false;
 
+			fowDirtyAreaIndex = 0;
+			fowTickCount = 0;
+			fowLastFullTick = -fowDirtyAreaTicks;
+			fowCellsTouched = 0;
+			fowTeamIndex = -1;
+			fowRebuild = true;
+
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem, "In [%s::%s Line: %d]\n", __FILE__, __FUNCTION__, __LINE__);
 		}
 
@@ -127,7 +136,10 @@ namespace Glest {
 
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem, "In [%s::%s Line: %d]\n", __FILE__, __FUNCTION__, __LINE__);
 
-			delete techTree;
+			// A headless server keeps the tech tree for its next games
+			if (TechTreeCache::getInstance().release(techTree) == false) {
+				delete techTree;
+			}
 			techTree = NULL;
 
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem, "In [%s::%s Line: %d]\n", __FILE__, __FUNCTION__, __LINE__);
@@ -175,6 +187,10 @@ namespace Glest {
 			cacheFowAlphaTexture = false;
 			cacheFowAlphaTextureFogOfWarValue = false;
 
+			unitVisibility.clear();
+			releasedVisibleCells.clear();
+			fowRebuild = true;
+
 			map.end();
 
 			//stats will be deleted by BattleEnd
@@ -185,6 +201,11 @@ namespace Glest {
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem, "In [%s::%s Line: %d]\n", __FILE__, __FUNCTION__, __LINE__);
 			Logger::getInstance().add(Lang::getInstance().getString("LogScreenGameUnLoadingWorld", ""), true);
 
+#ifdef USE_SYNCH_TRACE
+			saveSynchTrace();
+			SynchTrace::setEnabled(false);
+#endif
+
 			animatedTilesetObjectPosListLoaded = false;
 
 			ExploredCellsLookupItemCache.clear();
@@ -210,6 +231,10 @@ namespace Glest {
 			originalGameFogOfWar = fogOfWar;
 			fogOfWarSkillTypeValue = -1;
 
+			unitVisibility.clear();
+			releasedVisibleCells.clear();
+			fowRebuild = true;
+
 			map.end();
 			cacheFowAlphaTexture = false;
 			cacheFowAlphaTextureFogOfWarValue = false;
@@ -256,6 +281,7 @@ namespace Glest {
 					fogOfWarSkillTypeValue = -1;
 					fogOfWarOverride = false;
 					minimap.restoreFowTex();
+					fowRebuild = true;
 				} else {
 					bool fowEnabled = false;
 					for (std::map<int, std::pair<const Unit *, const FogOfWarSkillType *> >::const_iterator iterMap = mapFogOfWarUnitList.begin();
@@ -338,6 +364,13 @@ namespace Glest {
 
 			ExploredCellsLookupItemCache.clear();
 			ExploredCellsLookupItemCacheTimer.clear();
+			fowRebuild = true;
+
+#ifdef USE_SYNCH_TRACE
+			SynchTrace::clear();
+			SynchTrace::setEnabled(SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled);
+			SynchTrace::setFrame(frameCount);
+#endif
 
 			this->game = game;
 			scriptManager = game->getScriptManager();
@@ -428,7 +461,7 @@ namespace Glest {
 			if (getFrameCount() > 1) {
 				// this is needed for games that are loaded to "switch the light on".
 				// otherwise the FowTexture is completely black like in the beginning of a game.
-				minimap.updateFowTex(1.f);
+				updateMinimapFowTex(1.f);
 			}
 
 			if (gotError == true) {
@@ -474,9 +507,14 @@ namespace Glest {
 
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem, "In [%s::%s Line: %d]\n", __FILE__, __FUNCTION__, __LINE__);
 
-			techTree = new TechTree(pathList);
-			techtreeChecksum = techTree->loadTech(techName, factions,
-				checksum, loadedFileList, validationMode);
+			if (validationMode == false && TechTreeCache::isEnabled() == true) {
+				techTree = TechTreeCache::getInstance().acquire(pathList, techName, factions,
+					checksum, loadedFileList, techtreeChecksum);
+			} else {
+				techTree = new TechTree(pathList);
+				techtreeChecksum = techTree->loadTech(techName, factions,
+					checksum, loadedFileList, validationMode);
+			}
 			XmlTree xmlTree;
 			string currentPath = techTree->findPath(techName, pathList);
 			endPathWithSlash(currentPath);
@@ -620,6 +658,12 @@ namespace Glest {
 				faction->clearWorldSynchThreadedLogList();
 			}
 
+			// Refresh the passability of the cells units moved through last frame
+			map.updatePassabilityCache();
+			if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true) {
+				map.checkPassabilityCache();
+			}
+
 			if (showPerfStats) {
 				sprintf(perfBuf, "In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER "\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, chronoPerf.getMillis());
 				perfList.push_back(perfBuf);
@@ -682,6 +726,62 @@ namespace Glest {
 				if (SystemFlags::VERBOSE_MODE_ENABLED && chrono.getMillis() >= 10) printf("In [%s::%s Line: %d] *** Faction thread preprocessing took [%lld] msecs for %d factions for frameCount = %d.\n", __FILE__, __FUNCTION__, __LINE__, (long long int)chrono.getMillis(), factionCount, frameCount);
 			}
 
+			// Think for the units the faction threads did not, before any unit
+			// is updated so the result does not depend on who did it
+			for (int i = 0; i < factionCount; ++i) {
+				Faction *faction = getFaction(i);
+				// Normally refreshed by the faction thread for this frame. It
+				// cannot be stale: since then only the faction threads ran and
+				// they neither add, remove nor progress units, and adding or
+				// removing a unit drops the frame so it is refreshed here
+				UnitUpdateFlags *updateFlags = faction->getUnitUpdateFlags();
+				MutexSafeWrapper safeMutex(faction->getUnitMutex(), CODE_AT_LINE);
+				if (updateFlags->getFrame() != frameCount) {
+					updateFlags->refresh(frameCount);
+				}
+				safeMutex.ReleaseLock();
+
+				bool checkUpdateFlags = SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled;
+				int unitCount = updateFlags->getCount();
+				for (int j = 0; j < unitCount; ++j) {
+					if (checkUpdateFlags == true &&
+						updateFlags->getNeedUpdate(j) != updateFlags->getUnit(j)->needToUpdate()) {
+						throw megaglest_runtime_error("Stale unit update flag for unit: " + intToStr(updateFlags->getUnit(j)->getId()));
+					}
+					if (updateFlags->getNeedUpdate(j) == true) {
+						Unit *unit = updateFlags->getUnit(j);
+						if (unit->getCachedRangeUnitsFrame() != frameCount) {
+							unitUpdater.thinkUnit(unit, frameCount);
+						}
+					}
+				}
+			}
+			// units created from here on are only acquired next frame, the
+			// unit updater checks that against the unit grid
+			if (SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true) {
+				std::set<int> unitIds;
+				for (int i = 0; i < factionCount; ++i) {
+					Faction *faction = getFaction(i);
+					for (int j = 0; j < faction->getUnitCount(); ++j) {
+						unitIds.insert(faction->getUnit(j)->getId());
+					}
+				}
+				unitUpdater.setThinkPassUnits(frameCount, unitIds);
+			}
+
+			// Solve the path searches queued by the faction threads
+			Chrono chronoPathJobs;
+			if (this->game || showPerfStats || SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled) chronoPathJobs.start();
+			int pathJobCount = unitUpdater.processPathFindingJobs(frameCount);
+			int64 pathJobMillis = chronoPathJobs.getMillis();
+			if (this->game) this->game->addPerformanceCount("pathfinder jobs", pathJobMillis);
+
+			if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chronoPathJobs.getMillis() >= 1) SystemFlags::OutputDebug(SystemFlags::debugPerformance, "In [%s::%s Line: %d] %d path jobs took msecs: %lld for frameCount = %d\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, pathJobCount, (long long int)chronoPathJobs.getMillis(), frameCount);
+			if (showPerfStats) {
+				sprintf(perfBuf, "In [%s::%s] Line: %d path jobs: %d took msecs: " MG_I64_SPECIFIER "\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, pathJobCount, chronoPathJobs.getMillis());
+				perfList.push_back(perfBuf);
+			}
+
 			if (showPerfStats) {
 				sprintf(perfBuf, "In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER "\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, chronoPerf.getMillis());
 				perfList.push_back(perfBuf);
@@ -766,6 +866,17 @@ namespace Glest {
 				}
 			}
 
+			// The faction threads precache in parallel so their part is the
+			// summed thread time, not the wall time of the frame
+			int64 precacheMicros = 0;
+			int64 serialMicros = 0;
+			unitUpdater.takePathFindingMicros(precacheMicros, serialMicros);
+			if (this->game) {
+				this->game->addPerformanceCount("pathfinder precache", precacheMicros / 1000);
+				this->game->addPerformanceCount("pathfinder serial", serialMicros / 1000);
+				this->game->addPerformanceCount("pathfinder", pathJobMillis + (precacheMicros + serialMicros) / 1000);
+			}
+
 			if (showPerfStats) {
 				sprintf(perfBuf, "In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER " totalUnitsProcessed = %d\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, chronoPerf.getMillis(), totalUnitsProcessed);
 				perfList.push_back(perfBuf);
@@ -846,6 +957,9 @@ namespace Glest {
 			Chrono chronoGamePerformanceCounts;
 
 			++frameCount;
+#ifdef USE_SYNCH_TRACE
+			SynchTrace::setFrame(frameCount);
+#endif
 
 			//time
 			timeFlow.update();
@@ -924,7 +1038,7 @@ namespace Glest {
 					if (this->game) chronoGamePerformanceCounts.start();
 
 					float fogFactor = static_cast<float>(frameCount % GameConstants::updateFps) / GameConstants::updateFps;
-					minimap.updateFowTex(clamp(fogFactor, 0.f, 1.f));
+					updateMinimapFowTex(clamp(fogFactor, 0.f, 1.f));
 
 					if (this->game) this->game->addPerformanceCount("minimap.updateFowTex", chronoGamePerformanceCounts.getMillis());
 				}
@@ -1001,7 +1115,7 @@ namespace Glest {
 			if (fogOfWarSmoothing == false) {
 				if (this->game) chronoGamePerformanceCounts.start();
 
-				minimap.updateFowTex(1.f);
+				updateMinimapFowTex(1.f);
 
 				if (this->game) this->game->addPerformanceCount("minimap.updateFowTex", chronoGamePerformanceCounts.getMillis());
 			}
@@ -1357,7 +1471,7 @@ namespace Glest {
 					if (game->getPaused() == true) {
 						// new units added in pause mode might change the Fow. ( Scenarios do this )
 						computeFow();
-						minimap.updateFowTex(1.f);
+						updateMinimapFowTex(1.f);
 					}
 				} else {
 					delete unit;
@@ -1712,6 +1826,7 @@ namespace Glest {
 			ExploredCellsLookupItemCache.clear();
 			ExploredCellsLookupItemCacheTimer.clear();
 			ExploredCellsLookupItemCacheTimerCount = 0;
+			fowRebuild = true;
 
 			unitUpdater.clearCaches();
 		}
@@ -1720,7 +1835,7 @@ namespace Glest {
 			game->setPaused(pauseStatus, forceAllowPauseStateChange, false, false);
 			// ensures that the Fow is really up to date when the game switches to pause mode. ( mainly for scenarios )
 			computeFow();
-			minimap.updateFowTex(1.f);
+			updateMinimapFowTex(1.f);
 		}
 
 		void World::addConsoleText(const string &text) {
@@ -2472,6 +2587,108 @@ namespace Glest {
 			return exploredCellsCache;
 		}
 
+		void World::exploreCells(Unit *unit, const Vec2i &newPos, int sightRange, int teamIndex, bool forceRefresh) {
+			UnitVisibilityItem &item = unitVisibility[unit->getId()];
+			item.tick = fowTickCount;
+			if (forceRefresh == false && item.teamIndex == teamIndex &&
+				item.pos == newPos && item.sightRange == sightRange) {
+				return;
+			}
+
+			if (item.teamIndex >= 0) {
+				releaseUnitVisibility(item);
+			}
+
+			item.teamIndex = teamIndex;
+			item.pos = newPos;
+			item.sightRange = sightRange;
+			item.visibleCellList = exploreCells(newPos, sightRange, teamIndex, unit).visibleCellList;
+			countVisibleCells(teamIndex, item.visibleCellList);
+
+			// same area Unit::getFogOfWarRadius iterates
+			const Vec2i unitPos = unit->getPosNotThreadSafe();
+			const Vec2i radius(sightRange + indirectSightRange);
+			item.fowArea.first = Map::toSurfCoords(unitPos - radius);
+			item.fowArea.second = Map::toSurfCoords(unitPos + radius);
+			if (teamIndex == thisTeamIndex) {
+				addFowDirtyArea(item.fowArea);
+			}
+		}
+
+		void World::releaseUnitVisibility(UnitVisibilityItem &item) {
+			releasedVisibleCells.push_back(std::make_pair(item.teamIndex, std::vector<SurfaceCell *>()));
+			releasedVisibleCells.back().second.swap(item.visibleCellList);
+			if (item.teamIndex == thisTeamIndex) {
+				addFowDirtyArea(item.fowArea);
+			}
+		}
+
+		void World::countVisibleCells(int teamIndex, const std::vector<SurfaceCell *> &cells) {
+			for (unsigned int i = 0; i < cells.size(); ++i) {
+				cells[i]->incVisibleCount(teamIndex);
+			}
+			fowCellsTouched += (int) cells.size();
+		}
+
+		void World::uncountVisibleCells(int teamIndex, const std::vector<SurfaceCell *> &cells) {
+			for (unsigned int i = 0; i < cells.size(); ++i) {
+				if (cells[i]->decVisibleCount(teamIndex) == true && fogOfWar == true) {
+					cells[i]->setVisible(teamIndex, false);
+				}
+			}
+			fowCellsTouched += (int) cells.size();
+		}
+
+		void World::resetVisibility() {
+			unitVisibility.clear();
+			releasedVisibleCells.clear();
+
+			bool resetTeams[GameConstants::maxPlayers + GameConstants::specialFactions];
+			for (int teamIndex = 0; teamIndex < GameConstants::maxPlayers + GameConstants::specialFactions; ++teamIndex) {
+				resetTeams[teamIndex] = false;
+			}
+			if (fogOfWar) {
+				for (int factionIndex = 0; factionIndex < getFactionCount(); ++factionIndex) {
+					resetTeams[getFaction(factionIndex)->getTeam()] = true;
+				}
+			}
+
+			for (int indexSurfaceW = 0; indexSurfaceW < map.getSurfaceW(); ++indexSurfaceW) {
+				for (int indexSurfaceH = 0; indexSurfaceH < map.getSurfaceH(); ++indexSurfaceH) {
+					SurfaceCell *sc = map.getSurfaceCell(indexSurfaceW, indexSurfaceH);
+					for (int teamIndex = 0; teamIndex < GameConstants::maxPlayers + GameConstants::specialFactions; ++teamIndex) {
+						sc->resetVisibleCount(teamIndex);
+						// set all cells to not visible
+						if (resetTeams[teamIndex] == true) {
+							sc->setVisible(teamIndex, false);
+						}
+					}
+				}
+			}
+		}
+
+		void World::addFowDirtyArea(const std::pair<Vec2i, Vec2i> &area) {
+			fowDirtyAreas[fowDirtyAreaIndex].push_back(area);
+		}
+
+		void World::getFowDirtyAreas(int ticks, FowDirtyAreas &areas) const {
+			for (int i = 0; i < ticks && i < fowDirtyAreaTicks; ++i) {
+				const FowDirtyAreas &tickAreas = fowDirtyAreas[(fowDirtyAreaIndex - i + fowDirtyAreaTicks) % fowDirtyAreaTicks];
+				areas.insert(areas.end(), tickAreas.begin(), tickAreas.end());
+			}
+		}
+
+		void World::updateMinimapFowTex(float t) {
+			if (fowTickCount - fowLastFullTick < fowDirtyAreaTicks - 1) {
+				minimap.updateFowTex(t);
+			} else {
+				// pixels that changed in the last ticks may still be blending
+				FowDirtyAreas areas;
+				getFowDirtyAreas(fowDirtyAreaTicks, areas);
+				minimap.updateFowTex(t, areas);
+			}
+		}
+
 		bool World::showWorldForPlayer(int factionIndex, bool excludeFogOfWarCheck) const {
 			bool ret = false;
 			if (factionIndex >= 0) {
@@ -2527,13 +2744,52 @@ namespace Glest {
 		}
 
 		//computes the fog of war texture, contained in the minimap
+		//
+		// Visibility is reference counted per team and cell, so a tick only
+		// counts the cells of units that moved, spawned, died or changed their
+		// sight since the last one. The minimap is then reset only inside the
+		// areas those units touched during the last ticks, it takes two ticks
+		// for a pixel to settle after its alpha changed (see resetFowTexPixel).
+		// Settings that affect the whole map still do a full rebuild.
 		void World::computeFow() {
 			if (SystemFlags::VERBOSE_MODE_ENABLED) printf("In [%s::%s] Line: %d in frame: %d\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, getFrameCount());
 
+			fowTickCount++;
+
+			bool showWorld = false;
+			for (int factionIndex = 0; factionIndex < getFactionCount(); ++factionIndex) {
+				if (showWorldForPlayer(factionIndex) == true) {
+					showWorld = true;
+					break;
+				}
+			}
+
+			if (fowRebuild == true || fogOfWar == false || showWorld == true ||
+				cacheFowAlphaTexture == true || fowTeamIndex != thisTeamIndex) {
+				computeFowFull();
+			} else {
+				computeFowIncremental();
+			}
+			fowRebuild = false;
+			fowTeamIndex = thisTeamIndex;
+
+			// a cell count, not millis, so not in the game performance counts
+			if (SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && fowCellsTouched > 0) SystemFlags::OutputDebug(SystemFlags::debugPerformance, "In [%s::%s Line: %d] fog of war cells touched: %d\n", __FILE__, __FUNCTION__, __LINE__, fowCellsTouched);
+			fowCellsTouched = 0;
+
+			// areas changed until the next tick belong to it
+			fowDirtyAreaIndex = (fowDirtyAreaIndex + 1) % fowDirtyAreaTicks;
+			fowDirtyAreas[fowDirtyAreaIndex].clear();
+		}
+
+		void World::computeFowFull() {
 			Chrono chronoGamePerformanceCounts;
 			if (this->game) chronoGamePerformanceCounts.start();
 
+			addFowDirtyArea(std::make_pair(Vec2i(0, 0), Vec2i(map.getSurfaceW() - 1, map.getSurfaceH() - 1)));
+			fowLastFullTick = fowTickCount;
 			minimap.resetFowTex();
+			fowCellsTouched += map.getSurfaceW() * map.getSurfaceH();
 
 			if (this->game) this->game->addPerformanceCount("world minimap.resetFowTex", chronoGamePerformanceCounts.getMillis());
 
@@ -2542,6 +2798,9 @@ namespace Glest {
 
 			if (this->game) chronoGamePerformanceCounts.start();
 
+			// If fog of war enabled set cells visible to false and later set those close to units to true
+			resetVisibility();
+
 			// Once we have calculated fog of war texture alpha, they are cached so we
 			// restore the default texture in one shot for speed
 			if (fogOfWar && cacheFowAlphaTexture == true) {
@@ -2558,19 +2817,6 @@ namespace Glest {
 					continue;
 				}
 				Faction *faction = getFaction(factionIndex);
-				//	for(int indexTeamFaction = 0;
-				//			indexTeamFaction < GameConstants::maxPlayers + GameConstants::specialFactions;
-				//			++indexTeamFaction) {
-
-						// If fog of war enabled set cell visible to false and later set those close to units to true
-				if (fogOfWar) {
-					for (int indexSurfaceW = 0; indexSurfaceW < map.getSurfaceW(); ++indexSurfaceW) {
-						for (int indexSurfaceH = 0; indexSurfaceH < map.getSurfaceH(); ++indexSurfaceH) {
-							// set all cells to not visible
-							map.getSurfaceCell(indexSurfaceW, indexSurfaceH)->setVisible(faction->getTeam(), false);
-						}
-					}
-				}
 
 				// Remove fog of war for factions NOT on my team which i can see
 				if (!fogOfWar || (faction->getTeam() != thisTeamIndex)) {
@@ -2668,20 +2914,7 @@ namespace Glest {
 					// exploration
 					unit->exploreCells();
 
-					// fire particle visible
-					ParticleSystem *fire = unit->getFire();
-					if (fire != NULL) {
-						bool cellVisible = cellVisibleForFaction;
-						if (cellVisible == false) {
-							Vec2i sCoords = Map::toSurfCoords(unit->getPos());
-							SurfaceCell *sc = map.getSurfaceCell(sCoords);
-							if (sc != NULL) {
-								cellVisible = sc->isVisible(thisTeamIndex);
-							}
-						}
-
-						fire->setActive(cellVisible);
-					}
+					updateUnitFireVisibility(unit, cellVisibleForFaction);
 
 					// compute fog of war render texture
 					if (fogOfWar == true &&
@@ -2703,6 +2936,105 @@ namespace Glest {
 			if (this->game) this->game->addPerformanceCount("world compute cells", chronoGamePerformanceCounts.getMillis());
 		}
 
+		void World::computeFowIncremental() {
+			Chrono chronoGamePerformanceCounts;
+			if (this->game) chronoGamePerformanceCounts.start();
+
+			for (unsigned int i = 0; i < releasedVisibleCells.size(); ++i) {
+				uncountVisibleCells(releasedVisibleCells[i].first, releasedVisibleCells[i].second);
+			}
+			releasedVisibleCells.clear();
+
+			for (int factionIndex = 0; factionIndex < getFactionCount(); ++factionIndex) {
+				Faction *faction = getFaction(factionIndex);
+				int unitCount = faction->getUnitCount();
+				for (int unitIndex = 0; unitIndex < unitCount; ++unitIndex) {
+					// only counts the cells again when the unit moved or its sight changed
+					faction->getUnit(unitIndex)->exploreCells();
+				}
+			}
+
+			// units that died or were removed since the last tick
+			for (std::map<int, UnitVisibilityItem>::iterator iterMap = unitVisibility.begin();
+				iterMap != unitVisibility.end();) {
+				if (iterMap->second.tick != fowTickCount) {
+					UnitVisibilityItem &item = iterMap->second;
+					uncountVisibleCells(item.teamIndex, item.visibleCellList);
+					if (item.teamIndex == thisTeamIndex) {
+						addFowDirtyArea(item.fowArea);
+					}
+					unitVisibility.erase(iterMap++);
+				} else {
+					++iterMap;
+				}
+			}
+
+			if (this->game) this->game->addPerformanceCount("world update visible cells", chronoGamePerformanceCounts.getMillis());
+
+			if (this->game) chronoGamePerformanceCounts.start();
+
+			FowDirtyAreas resetAreas;
+			getFowDirtyAreas(3, resetAreas);
+			fowCellsTouched += minimap.resetFowTex(resetAreas);
+
+			if (this->game) this->game->addPerformanceCount("world minimap.resetFowTex", chronoGamePerformanceCounts.getMillis());
+
+			if (this->game) chronoGamePerformanceCounts.start();
+
+			for (int factionIndex = 0; factionIndex < getFactionCount(); ++factionIndex) {
+				Faction *faction = getFaction(factionIndex);
+				bool cellVisibleForFaction = showWorldForPlayer(thisFactionIndex);
+
+				int unitCount = faction->getUnitCount();
+				for (int unitIndex = 0; unitIndex < unitCount; ++unitIndex) {
+					Unit *unit = faction->getUnit(unitIndex);
+					updateUnitFireVisibility(unit, cellVisibleForFaction);
+
+					// outside the reset areas the alpha of the unit is already applied
+					if (faction->getTeam() == thisTeamIndex && unit->isAlive() == true) {
+						std::map<int, UnitVisibilityItem>::const_iterator iterFind = unitVisibility.find(unit->getId());
+						if (iterFind == unitVisibility.end()) {
+							continue;
+						}
+						const std::pair<Vec2i, Vec2i> &fowArea = iterFind->second.fowArea;
+						bool overlaps = false;
+						for (unsigned int i = 0; i < resetAreas.size() && overlaps == false; ++i) {
+							overlaps = (fowArea.first.x <= resetAreas[i].second.x && fowArea.second.x >= resetAreas[i].first.x &&
+								fowArea.first.y <= resetAreas[i].second.y && fowArea.second.y >= resetAreas[i].first.y);
+						}
+						if (overlaps == false) {
+							continue;
+						}
+
+						const FowAlphaCellsLookupItem &cellList = unit->getCachedFow();
+						for (std::map<Vec2i, float>::const_iterator iterMap = cellList.surfPosAlphaList.begin();
+							iterMap != cellList.surfPosAlphaList.end(); ++iterMap) {
+							minimap.incFowTextureAlphaSurface(iterMap->first, iterMap->second, true);
+						}
+					}
+				}
+			}
+
+			if (this->game) this->game->addPerformanceCount("world compute cells", chronoGamePerformanceCounts.getMillis());
+		}
+
+		void World::updateUnitFireVisibility(Unit *unit, bool cellVisibleForFaction) {
+			// fire particle visible
+			ParticleSystem *fire = unit->getFire();
+			if (fire != NULL) {
+				bool cellVisible = cellVisibleForFaction;
+				if (cellVisible == false) {
+					Vec2i sCoords = Map::toSurfCoords(unit->getPos());
+					SurfaceCell *sc = map.getSurfaceCell(sCoords);
+					if (sc != NULL) {
+						cellVisible = sc->isVisible(thisTeamIndex);
+					}
+				}
+
+				fire->setActive(cellVisible);
+			}
+		}
+
 		GameSettings * World::getGameSettingsPtr() {
 			return (game != NULL ? game->getGameSettings() : NULL);
 		}
@@ -2943,6 +3275,32 @@ namespace Glest {
 			return false;
 		}
 
+		std::string World::saveSynchTrace() const {
+			string synchTraceFile = "";
+#ifdef USE_SYNCH_TRACE
+			if (SynchTrace::getCount() <= 0) {
+				return synchTraceFile;
+			}
+
+			synchTraceFile = Config::getInstance().getString("SynchTraceFile", "synchTrace.bin");
+			if (getGameReadWritePath(GameConstants::path_logs_CacheLookupKey) != "") {
+				synchTraceFile = getGameReadWritePath(GameConstants::path_logs_CacheLookupKey) + synchTraceFile;
+			} else {
+				string userData = Config::getInstance().getString("UserData_Root", "");
+				if (userData != "") {
+					endPathWithSlash(userData);
+				}
+				synchTraceFile = userData + synchTraceFile;
+			}
+
+			if (SynchTrace::save(synchTraceFile) == false) {
+				SystemFlags::OutputDebug(SystemFlags::debugError, "In [%s::%s Line: %d] could not write synch trace [%s]\n", __FILE__, __FUNCTION__, __LINE__, synchTraceFile.c_str());
+				synchTraceFile = "";
+			}
+#endif
+			return synchTraceFile;
+		}
+
 		std::string World::DumpWorldToLog(bool consoleBasicInfoOnly) const {
 
 			string debugWorldLogFile = Config::getInstance().getString("DebugWorldLogFile", "debugWorld.log");
@@ -3018,6 +3376,8 @@ namespace Glest {
 				this->game->saveGame(GameConstants::saveGameFileDefault);
 			}
 
+			saveSynchTrace();
+
 			return debugWorldLogFile;
 		}
 
@@ -83,6 +83,25 @@ namespace Glest {
 			int teamIndex;
 		};
 
+		// cells a unit is currently counted as seeing
+		class UnitVisibilityItem {
+		public:
+			UnitVisibilityItem() {
+				teamIndex = -1;
+				sightRange = -1;
+				tick = 0;
+			}
+
+			int teamIndex;
+			Vec2i pos;
+			int sightRange;
+			std::vector<SurfaceCell *> visibleCellList;
+			// surface area of the unit fog of war alpha on the minimap
+			std::pair<Vec2i, Vec2i> fowArea;
+			// last fog of war tick the unit was seen alive in
+			int tick;
+		};
+
 		class World {
 		private:
 			typedef vector<Faction *> Factions;
@@ -91,6 +110,20 @@ namespace Glest {
 			std::map<int, ExploredCellsLookupKey> ExploredCellsLookupItemCacheTimer;
 			int ExploredCellsLookupItemCacheTimerCount;
 
+			// incremental fog of war, see computeFow()
+			static const int fowDirtyAreaTicks = 5;
+			std::map<int, UnitVisibilityItem> unitVisibility;	// unit id -> counted cells
+			// cells units moved away from, uncounted on the next tick so they
+			// stay visible as long as they did with a full rebuild
+			std::vector<std::pair<int, std::vector<SurfaceCell *> > > releasedVisibleCells;
+			FowDirtyAreas fowDirtyAreas[fowDirtyAreaTicks];
+			int fowDirtyAreaIndex;
+			int fowTickCount;
+			int fowLastFullTick;
+			int fowCellsTouched;
+			int fowTeamIndex;
+			bool fowRebuild;
+
 		public:
 			static const int generationArea = 100;
 			static const int indirectSightRange = 5;
@@ -362,6 +395,8 @@ namespace Glest {
 			}
 
 			std::string DumpWorldToLog(bool consoleBasicInfoOnly = false) const;
+			// writes the synch trace of builds with USE_SYNCH_TRACE, returns the file name
+			std::string saveSynchTrace() const;
 
 			inline int getUpdateFps(int factionIndex) const {
 				int result = GameConstants::updateFps;
@@ -371,6 +406,7 @@ namespace Glest {
 
 			ExploredCellsLookupItem exploreCells(const Vec2i &newPos, int sightRange, int teamIndex, Unit *unit);
 			void exploreCells(int teamIndex, ExploredCellsLookupItem &exploredCellsCache);
+			void exploreCells(Unit *unit, const Vec2i &newPos, int sightRange, int teamIndex, bool forceRefresh);
 			bool showWorldForPlayer(int factionIndex, bool excludeFogOfWarCheck = false) const;
 
 			inline UnitUpdater * getUnitUpdater() {
@@ -416,6 +452,16 @@ namespace Glest {
 			//misc
 			void tick();
 			void computeFow();
+			void computeFowFull();
+			void computeFowIncremental();
+			void updateUnitFireVisibility(Unit *unit, bool cellVisibleForFaction);
+			void resetVisibility();
+			void countVisibleCells(int teamIndex, const std::vector<SurfaceCell *> &cells);
+			void uncountVisibleCells(int teamIndex, const std::vector<SurfaceCell *> &cells);
+			void releaseUnitVisibility(UnitVisibilityItem &item);
+			void addFowDirtyArea(const std::pair<Vec2i, Vec2i> &area);
+			void getFowDirtyAreas(int ticks, FowDirtyAreas &areas) const;
+			void updateMinimapFowTex(float t);
 
 			void updateAllTilesetObjects();
 			void updateAllFactionUnits();
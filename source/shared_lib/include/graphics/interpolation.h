@@ -15,8 +15,16 @@
 #include "vec.h"
 #include "model.h"
 #include <map>
+#include <vector>
+#include <algorithm>
+#include "data_types.h"
 #include "leak_dumper.h"
 
+using std::vector;
+using std::max;
+using Shared::Platform::int64;
+using Shared::Platform::uint32;
+
 namespace Shared {
 	namespace Graphics {
 
@@ -26,16 +34,39 @@ namespace Shared {
 
 		class InterpolationData {
 		private:
+			// One interpolated frame, the units sharing the mesh that
+			// ask for the same quantised t take it from here
+			class CacheEntry {
+			public:
+				CacheEntry() : key(-1), lastUse(0), vertices(NULL), normals(NULL),
+					hasVertices(false), hasNormals(false) {
+				}
+
+				int64 key;
+				uint32 lastUse;
+				Vec3f *vertices;
+				Vec3f *normals;
+				bool hasVertices;
+				bool hasNormals;
+			};
+
 			const Mesh *mesh;
 
+			// point into the cache entry last asked for
 			Vec3f *vertices;
 			Vec3f *normals;
 
 			int raw_frame_ofs;
 
+			vector<CacheEntry> cache;
+			uint32 cacheUseCount;
+
 			static bool enableInterpolation;
+			static int cacheSize;
+			static int cacheSteps;
 
-			void update(const Vec3f* src, Vec3f* &dest, float t, bool cycle);
+			CacheEntry &getCacheEntry(int64 key);
+			void update(float t, bool cycle, bool updateVertexData);
 
 		public:
 			InterpolationData(const Mesh *mesh);
@@ -44,6 +75,28 @@ namespace Shared {
 			static void setEnableInterpolation(bool enabled) {
 				enableInterpolation = enabled;
 			}
+			// Interpolated frames kept per mesh, 1 keeps only the last one
+			static void setCacheSize(int value) {
+				cacheSize = max(value, 1);
+			}
+			static int getCacheSize() {
+				return cacheSize;
+			}
+			// t is rounded to this many steps between two key frames so
+			// units close in their animation share a frame, 0 keeps t
+			static void setCacheSteps(int value) {
+				cacheSteps = max(value, 0);
+			}
+			static int getCacheSteps() {
+				return cacheSteps;
+			}
+
+			// dest[i] = prev[i] + (next[i] - prev[i]) * t, four floats at a
+			// time with SSE (eight with AVX) where the build targets it
+			static void lerpFrames(const Vec3f *prev, const Vec3f *next, float t, Vec3f *dest, uint32 count);
+			// The same one float at a time, the fallback and what the
+			// tests compare with
+			static void lerpFramesScalar(const Vec3f *prev, const Vec3f *next, float t, Vec3f *dest, uint32 count);
 
 			const Vec3f *getVertices() const {
 				return !vertices || !enableInterpolation ? mesh->getVertices() + raw_frame_ofs : vertices;
@@ -22,6 +22,7 @@
 #include <memory>
 #include "common_scoped_ptr.h"
 #include "byte_order.h"
+#include "mapped_file.h"
 #include "leak_dumper.h"
 
 using std::string;
@@ -37,6 +38,34 @@ namespace Shared {
 		class InterpolationData;
 		class TextureManager;
 
+		// =====================================================
+		//	class ModelFileReader
+		//
+		//	Reads a g3d file, from a mapping of the whole file or
+		//	through stdio, read() and seek() work like fread() and
+		//	fseek(SEEK_CUR)
+		// =====================================================
+
+		class ModelFileReader {
+		private:
+			Shared::PlatformCommon::MappedFile mappedFile;
+			FILE *file;
+			size_t position;
+
+			ModelFileReader(const ModelFileReader &);
+			void operator =(const ModelFileReader &);
+
+		public:
+			ModelFileReader();
+			~ModelFileReader();
+
+			bool open(const string &path, bool mapped);
+			void close();
+
+			size_t read(void *data, size_t size, size_t count);
+			int seek(long offset);
+		};
+
 		// =====================================================
 		//	class Mesh
 		//
@@ -101,6 +130,10 @@ namespace Shared {
 			const Texture2D *getTexture(int i) const {
 				return textures[i];
 			}
+			// Set for the textures of a mesh loaded without a texture manager
+			const string &getTexturePath(int i) const {
+				return texturePaths[i];
+			}
 
 			//counts
 			uint32 getFrameCount() const {
@@ -146,6 +179,8 @@ namespace Shared {
 				return indices;
 			}
 
+			// frames in the vertices and normals set below
+			void setFrameCount(uint32 count);
 			void setVertices(Vec3f *data, uint32 count);
 			void setNormals(Vec3f *data, uint32 count);
 			void setTexCoords(Vec2f *data, uint32 count);
@@ -207,11 +242,13 @@ namespace Shared {
 				string sourceLoader = "", string modelFile = "");
 
 			//load
-			void loadV2(int meshIndex, const string &dir, FILE *f, TextureManager *textureManager,
+			void loadV2(int meshIndex, const string &dir, ModelFileReader &f, TextureManager *textureManager,
 				bool deletePixMapAfterLoad, std::map<string, vector<pair<string, string> > > *loadedFileList = NULL, string sourceLoader = "", string modelFile = "");
-			void loadV3(int meshIndex, const string &dir, FILE *f, TextureManager *textureManager,
+			void loadV3(int meshIndex, const string &dir, ModelFileReader &f, TextureManager *textureManager,
 				bool deletePixMapAfterLoad, std::map<string, vector<pair<string, string> > > *loadedFileList = NULL, string sourceLoader = "", string modelFile = "");
-			void load(int meshIndex, const string &dir, FILE *f, TextureManager *textureManager, bool deletePixMapAfterLoad, std::map<string, vector<pair<string, string> > > *loadedFileList = NULL, string sourceLoader = "", string modelFile = "");
+			void load(int meshIndex, const string &dir, ModelFileReader &f, TextureManager *textureManager, bool deletePixMapAfterLoad, std::map<string, vector<pair<string, string> > > *loadedFileList = NULL, string sourceLoader = "", string modelFile = "");
+			void loadTextures(int meshIndex, TextureManager *textureManager, bool deletePixMapAfterLoad,
+				std::map<string, vector<pair<string, string> > > *loadedFileList, string sourceLoader, string modelFile);
 			void save(int meshIndex, const string &dir, FILE *f, TextureManager *textureManager,
 				string convertTextureToFormat, std::map<string, int> &textureDeleteList,
 				bool keepsmallest, string modelFile);
@@ -250,6 +287,8 @@ namespace Shared {
 			string fileName;
 			string sourceLoader;
 
+			static bool mappedFileLoading;
+
 			//static bool masterserverMode;
 
 		public:
@@ -261,6 +300,15 @@ namespace Shared {
 
 			//static void setMasterserverMode(bool value) { masterserverMode=value; }
 
+			// g3d files are mapped into memory to load, false reads them
+			// through stdio
+			static void setMappedFileLoading(bool value) {
+				mappedFileLoading = value;
+			}
+			static bool getMappedFileLoading() {
+				return mappedFileLoading;
+			}
+
 			//data
 			void updateInterpolationData(float t, bool cycle);
 			void updateInterpolationVertices(float t, bool cycle);
@@ -291,6 +339,10 @@ namespace Shared {
 				this->textureManager = textureManager;
 			}
 			void deletePixels();
+			// A model loaded without a texture manager has no textures, this
+			// reads them and joins the meshes as loading with one does
+			void loadTextures(TextureManager *textureManager, bool deletePixMapAfterLoad = false,
+				std::map<string, vector<pair<string, string> > > *loadedFileList = NULL, string *sourceLoader = NULL);
 
 			string getFileName() const {
 				return fileName;
@@ -19,6 +19,10 @@
 using namespace std;
 
 namespace Shared {
+	namespace PlatformCommon {
+		template <typename T> class PreloadCache;
+	}
+
 	namespace Graphics {
 
 		class TextureManager;
@@ -34,11 +38,26 @@ namespace Shared {
 		protected:
 			ModelContainer models;
 			TextureManager *textureManager;
+			// A file is loaded once and its model shared by everything that
+			// asks for it, endModel() only deletes it with the last user
+			std::map<string, Model*> modelsByPath;
+			std::map<Model*, int> modelReferences;
+
+			static string getModelKey(const string &path);
+			void forgetModel(Model *model);
 
 		public:
 			ModelManager();
 			virtual ~ModelManager();
 
+			// Models decoded on worker threads without their textures,
+			// newModel() takes the one of the same path and only reads
+			// the textures
+			static Shared::PlatformCommon::PreloadCache<Model> &getPreloaded();
+			// Decodes path for getPreloaded() on the calling thread, NULL
+			// for the old model versions that need the textures to load
+			static Model *loadWithoutTextures(const string &path);
+
 			Model *newModel(const string &path, bool deletePixMapAfterLoad, std::map<string, vector<pair<string, string> > > *loadedFileList, string *sourceLoader);
 
 			void init();
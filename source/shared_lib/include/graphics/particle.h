@@ -13,18 +13,22 @@
 #define _SHARED_GRAPHICS_PARTICLE_H_
 
 #include <list>
+#include <map>
+#include <vector>
 #include <cassert>
 #include "vec.h"
 #include "pixmap.h"
 #include "texture_manager.h"
 #include "randomgen.h"
 #include "xml_parser.h"
+#include "thread.h"
 #include "leak_dumper.h"
 #include "interpolation.h"
 
 using std::list;
 using Shared::Util::RandomGen;
 using Shared::Xml::XmlNode;
+using Shared::Platform::Mutex;
 
 namespace Shared {
 	namespace Graphics {
@@ -127,6 +131,42 @@ namespace Shared {
 
 		};
 
+		// =====================================================
+		//	class ParticleSystemPool
+		//
+		///	Keeps the memory of deleted particle systems and their
+		///	particle arrays for the next systems of the same size.
+		///	A battle makes and deletes many projectiles and splashes
+		///	a second, each with room for 1000 particles, and unit
+		///	systems with room for 2000.
+		// =====================================================
+
+		class ParticleSystemPool {
+		private:
+			// blocks and arrays kept per size, the rest is freed
+			static const unsigned int maxPooledPerSize = 64;
+
+			Mutex mutex;
+			std::map<size_t, vector<void *> > freeSystems;
+			std::map<int, vector<std::vector<Particle> > > freeParticles;
+
+			ParticleSystemPool();
+
+		public:
+			// Lives until the process ends, particle systems can be
+			// deleted during static destruction
+			static ParticleSystemPool &getInstance();
+
+			void *allocateSystem(size_t size);
+			void freeSystem(void *system, size_t size);
+
+			// Swaps an array of particleCount unused particles into particles
+			void takeParticles(std::vector<Particle> &particles, int particleCount);
+			// Takes the array out of particles, usedCount is how many at
+			// its front were written to
+			void giveParticles(std::vector<Particle> &particles, int usedCount);
+		};
+
 		// =====================================================
 		//	class ParticleSystem
 		// =====================================================
@@ -167,6 +207,8 @@ namespace Shared {
 			bool visible;
 			int aliveParticleCount;
 			int particleCount;
+			// particles at the front of the array ever handed out
+			int usedParticleCount;
 
 			string textureFileLoadDeferred;
 			int textureFileLoadDeferredSystemId;
@@ -199,6 +241,12 @@ namespace Shared {
 			virtual ~ParticleSystem();
 			virtual ParticleSystemType getParticleSystemType() const = 0;
 
+#ifndef SL_LEAK_DUMP
+			// from ParticleSystemPool
+			static void *operator new(size_t size);
+			static void operator delete(void *system, size_t size);
+#endif
+
 			//public
 			virtual void update();
 			virtual void render(ParticleRenderer *pr, ModelRenderer *mr);
@@ -305,6 +353,31 @@ namespace Shared {
 			virtual void initParticle(Particle *p, int particleIndex);
 			virtual void updateParticle(Particle *p);
 			virtual bool deathTest(Particle *p);
+
+			// Updates the alive particles and kills the dead ones, calling
+			// updateParticle() and deathTest() for each
+			virtual void updateParticles();
+
+			// updateParticles() for the particles of a T, calling T's
+			// functions directly so the loop has no virtual call per
+			// particle, for the systems that override one of them
+			template <typename T>
+			void updateParticleArray(T *system) {
+				for (int i = 0; i < aliveParticleCount; ++i) {
+					system->T::updateParticle(&particles[i]);
+
+					if (system->T::deathTest(&particles[i])) {
+
+						//kill the particle
+						killParticle(&particles[i]);
+
+						//maintain alive particles at front of the array
+						if (aliveParticleCount > 0) {
+							particles[i] = particles[aliveParticleCount];
+						}
+					}
+				}
+			}
 		};
 
 		// =====================================================
@@ -326,6 +399,7 @@ namespace Shared {
 			//virtual
 			virtual void initParticle(Particle *p, int particleIndex);
 			virtual void updateParticle(Particle *p);
+			virtual void updateParticles();
 
 			//set params
 			void setRadius(float radius);
@@ -474,6 +548,7 @@ namespace Shared {
 			//virtual
 			virtual void initParticle(Particle *p, int particleIndex);
 			virtual void updateParticle(Particle *p);
+			virtual void updateParticles();
 			virtual void update();
 			virtual bool getVisible() const;
 			virtual void fade();
@@ -601,6 +676,7 @@ namespace Shared {
 
 			virtual void initParticle(Particle *p, int particleIndex);
 			virtual bool deathTest(Particle *p);
+			virtual void updateParticles();
 
 			void setRadius(float radius);
 			void setWind(float windAngle, float windSpeed);
@@ -628,6 +704,7 @@ namespace Shared {
 
 			virtual void initParticle(Particle *p, int particleIndex);
 			virtual bool deathTest(Particle *p);
+			virtual void updateParticles();
 
 			void setRadius(float radius);
 			void setWind(float windAngle, float windSpeed);
@@ -722,6 +799,7 @@ namespace Shared {
 			virtual void update();
 			virtual void initParticle(Particle *p, int particleIndex);
 			virtual void updateParticle(Particle *p);
+			virtual void updateParticles();
 
 			void setTrajectory(Trajectory trajectory) {
 				this->trajectory = trajectory;
@@ -774,6 +852,7 @@ namespace Shared {
 			virtual void update();
 			virtual void initParticle(Particle *p, int particleIndex);
 			virtual void updateParticle(Particle *p);
+			virtual void updateParticles();
 
 			virtual void initParticleSystem();
 
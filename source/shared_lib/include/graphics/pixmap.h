@@ -315,6 +315,8 @@ namespace Shared {
 			void splat(const Pixmap2D *leftUp, const Pixmap2D *rightUp, const Pixmap2D *leftDown, const Pixmap2D *rightDown);
 			void lerp(float t, const Pixmap2D *pixmap1, const Pixmap2D *pixmap2);
 			void copy(const Pixmap2D *sourcePixmap);
+			// Exchanges the pixels and size of both, without copying
+			void swap(Pixmap2D *otherPixmap);
 			void subCopy(int x, int y, const Pixmap2D *sourcePixmap);
 			void copyImagePart(int x, int y, const Pixmap2D *sourcePixmap);
 			string getPath() const {
@@ -23,6 +23,10 @@ using Shared::Platform::uint8;
 struct SDL_Surface;
 
 namespace Shared {
+	namespace PlatformCommon {
+		template <typename T> class PreloadCache;
+	}
+
 	namespace Graphics {
 
 		class TextureParams;
@@ -174,6 +178,11 @@ namespace Shared {
 			Pixmap2D pixmap;
 
 		public:
+			// Images decoded on worker threads, load() takes the one with
+			// the same path and components instead of reading the file
+			static Shared::PlatformCommon::PreloadCache<Pixmap2D> &getPreloadedPixmaps();
+			static string getPreloadKey(const string &path, int components);
+
 			void load(const string &path);
 
 			Pixmap2D *getPixmap() {
@@ -0,0 +1,78 @@
+//
+//      mapped_file.h: read only view of a whole file mapped into memory
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _SHARED_PLATFORMCOMMON_MAPPEDFILE_H_
+#define _SHARED_PLATFORMCOMMON_MAPPEDFILE_H_
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <winsock.h>
+#endif
+
+#include <string>
+#include "leak_dumper.h"
+
+using std::string;
+
+namespace Shared {
+	namespace PlatformCommon {
+
+		// =====================================================
+		//	class MappedFile
+		//
+		///	Maps a file into memory so it is read straight from the
+		///	page cache, without copying it through stdio buffers.
+		// =====================================================
+
+		class MappedFile {
+		private:
+			const char *data;
+			size_t size;
+#ifdef WIN32
+			HANDLE fileHandle;
+			HANDLE mappingHandle;
+#endif
+
+			MappedFile(const MappedFile &);
+			void operator =(const MappedFile &);
+
+		public:
+			MappedFile();
+			~MappedFile();
+
+			// false when the file can't be opened or mapped, an empty
+			// file opens with no data
+			bool open(const string &path);
+			void close();
+
+			const char *getData() const {
+				return data;
+			}
+			size_t getSize() const {
+				return size;
+			}
+		};
+
+	}
+} //end namespace
+
+#endif
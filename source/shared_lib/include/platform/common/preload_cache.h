@@ -0,0 +1,193 @@
+//
+//      preload_cache.h: files decoded on worker threads ahead of the
+//                       loader that asks for them
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _SHARED_PLATFORMCOMMON_PRELOADCACHE_H_
+#define _SHARED_PLATFORMCOMMON_PRELOADCACHE_H_
+
+#include <map>
+#include <string>
+#include "thread.h"
+#include "platform_common.h"
+#include "leak_dumper.h"
+
+using std::string;
+using Shared::Platform::Mutex;
+using Shared::Platform::MutexSafeWrapper;
+
+namespace Shared {
+	namespace PlatformCommon {
+
+		// =====================================================
+		//	class PreloadCache
+		//
+		///	Items a worker thread decodes before the loader gets to
+		///	them. A key is reserved when the work is queued, started
+		///	when a worker picks it up and set once decoded. The
+		///	loader takes a decoded item, waits for one being decoded
+		///	and cancels a queued one, reading the file itself.
+		// =====================================================
+
+		template <typename T>
+		class PreloadCache {
+		private:
+			enum State {
+				psQueued,
+				psDecoding,
+				psReady
+			};
+
+			class Entry {
+			public:
+				Entry() : state(psQueued), item(NULL) {
+				}
+
+				State state;
+				T *item;
+			};
+
+			Mutex mutex;
+			std::map<string, Entry> entries;
+			// decoded items the loader took, and the ones it asked for
+			// before a worker got to them
+			int takenCount;
+			int missedCount;
+
+			PreloadCache(const PreloadCache &);
+			void operator =(const PreloadCache &);
+
+		public:
+			PreloadCache() : mutex(CODE_AT_LINE), takenCount(0), missedCount(0) {
+			}
+			~PreloadCache() {
+				clear();
+			}
+
+			// false when key is already queued or decoded
+			bool reserve(const string &key) {
+				MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+				if (entries.find(key) != entries.end()) {
+					return false;
+				}
+				entries[key] = Entry();
+				return true;
+			}
+
+			// false when the loader cancelled key, the worker skips it then
+			bool start(const string &key) {
+				MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+				typename std::map<string, Entry>::iterator iterFind = entries.find(key);
+				if (iterFind == entries.end() || iterFind->second.state != psQueued) {
+					return false;
+				}
+				iterFind->second.state = psDecoding;
+				return true;
+			}
+
+			// Takes ownership of item, NULL when decoding failed so the
+			// loader reads the file and reports the error itself
+			void set(const string &key, T *item) {
+				MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+				typename std::map<string, Entry>::iterator iterFind = entries.find(key);
+				if (iterFind == entries.end()) {
+					safeMutex.ReleaseLock();
+					delete item;
+					return;
+				}
+				if (item == NULL) {
+					entries.erase(iterFind);
+					return;
+				}
+				iterFind->second.state = psReady;
+				iterFind->second.item = item;
+			}
+
+			// The caller owns the item returned, NULL when it has to load
+			// the file itself
+			T *take(const string &key) {
+				for (;;) {
+					MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+					if (entries.empty() == true) {
+						return NULL;
+					}
+					typename std::map<string, Entry>::iterator iterFind = entries.find(key);
+					if (iterFind == entries.end()) {
+						return NULL;
+					}
+					if (iterFind->second.state == psQueued) {
+						entries.erase(iterFind);
+						missedCount++;
+						return NULL;
+					}
+					if (iterFind->second.state == psReady) {
+						T *item = iterFind->second.item;
+						entries.erase(iterFind);
+						takenCount++;
+						return item;
+					}
+					safeMutex.ReleaseLock();
+					sleep(1);
+				}
+			}
+
+			bool isEmpty() {
+				MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+				return entries.empty();
+			}
+			int getTakenCount() {
+				MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+				return takenCount;
+			}
+			int getMissedCount() {
+				MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+				return missedCount;
+			}
+			// Number of decoded items nothing took
+			int getUnusedCount() {
+				MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+				int result = 0;
+				for (typename std::map<string, Entry>::iterator iterMap = entries.begin();
+					iterMap != entries.end(); ++iterMap) {
+					if (iterMap->second.state == psReady) {
+						result++;
+					}
+				}
+				return result;
+			}
+
+			// Drops what nothing took, no worker may be decoding anymore
+			void clear() {
+				MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+				for (typename std::map<string, Entry>::iterator iterMap = entries.begin();
+					iterMap != entries.end(); ++iterMap) {
+					delete iterMap->second.item;
+				}
+				entries.clear();
+				takenCount = 0;
+				missedCount = 0;
+			}
+		};
+
+	}
+} //end namespace
+
+#endif
@@ -162,6 +162,9 @@ namespace Shared {
 			static std::vector<string> intfTypes;
 
 		public:
+			// Most parts send() takes in one call
+			static const int maxSendBuffers = 8;
+
 			Socket(PLATFORM_SOCKET sock);
 			Socket();
 			virtual ~Socket();
@@ -201,6 +204,9 @@ namespace Shared {
 
 			int getDataToRead(bool wantImmediateReply = false);
 			int send(const void *data, int dataSize);
+			// Sends the parts one after the other without copying them
+			// together first, returns the bytes sent of all of them
+			int send(const void *const buffers[], const int bufferSizes[], int bufferCount);
 			int receive(void *data, int dataSize, bool tryReceiveUntilDataSizeMet);
 			int peek(void *data, int dataSize, bool mustGetData = true, int *pLastSocketError = NULL);
 
@@ -243,6 +249,43 @@ namespace Shared {
 			void Restore();
 		};
 
+		// =====================================================
+		//	class SocketReactor
+		//
+		///	Waits for incoming data on many sockets with a single
+		///	call. Backed by epoll on Linux, elsewhere isSupported()
+		///	is false and callers poll the sockets one at a time.
+		// =====================================================
+
+		class SocketReactor {
+		private:
+			int pollId;
+			// socket -> tag given to addSocket, returned by waitForData
+			std::map<PLATFORM_SOCKET, int> socketTags;
+
+		public:
+			SocketReactor();
+			~SocketReactor();
+
+			static bool isSupported();
+			bool isOpen() const {
+				return pollId >= 0;
+			}
+
+			bool addSocket(PLATFORM_SOCKET socket, int tag);
+			void removeSocket(PLATFORM_SOCKET socket);
+			bool hasSocket(PLATFORM_SOCKET socket) const {
+				return socketTags.find(socket) != socketTags.end();
+			}
+			int getSocketCount() const {
+				return (int) socketTags.size();
+			}
+
+			// Waits up to waitMilliseconds for any socket to become readable
+			// and fills readyTags with their tags, returns how many did
+			int waitForData(std::vector<int> &readyTags, int waitMilliseconds);
+		};
+
 		class BroadCastClientSocketThread : public BaseThread {
 		private:
 			DiscoveredServersInterface *discoveredServersCB;
@@ -96,6 +96,9 @@ const char  *GAME_ARGS[] = {
 	"--debug-network-packet-sizes",
 	"--debug-network-packet-stats",
 	"--enable-new-protocol",
+	"--benchmark-command-list",
+	"--benchmark-replay",
+	"--benchmark-network-messages",
 
 	"--create-data-archives",
 	"--steam",
@@ -183,6 +186,9 @@ enum GAME_ARG_TYPE {
 	GAME_ARG_DEBUG_NETWORK_PACKET_SIZES,
 	GAME_ARG_DEBUG_NETWORK_PACKET_STATS,
 	GAME_ARG_ENABLE_NEW_PROTOCOL,
+	GAME_ARG_BENCHMARK_COMMAND_LIST,
+	GAME_ARG_BENCHMARK_REPLAY,
+	GAME_ARG_BENCHMARK_NETWORK_MESSAGES,
 
 	GAME_ARG_CREATE_DATA_ARCHIVES,
 	GAME_ARG_STEAM,
@@ -461,6 +467,36 @@ void printParameterHelp(const char *argv0, bool foundInvalidArgs) {
 	printf("\n\n                     \tDisables opengl capability checks (for corrupt or flaky video");
 	printf("\n\n                     \t    drivers).");
 
+	printf("\n\n%s=x  ", GAME_ARGS[GAME_ARG_BENCHMARK_COMMAND_LIST]);
+	printf("\n\n                     \tCompare the size of the network command lists of a recorded");
+	printf("\n\n                     \t    game in the old and the compact wire formats.");
+	printf("\n\n                     \tWhere x is the .replay file written next to a saved game");
+	printf("\n\n                     \t    with SaveCommandsForReplay enabled.");
+	printf("\n\n                     \texample: %s %s=saved/mygame.xml.replay", extractFileFromDirectoryPath(argv0).c_str(), GAME_ARGS[GAME_ARG_BENCHMARK_COMMAND_LIST]);
+
+	printf("\n\n%s=x=y=z  ", GAME_ARGS[GAME_ARG_BENCHMARK_REPLAY]);
+	printf("\n\n                     \tPlay a replay headless as fast as possible, then print the");
+	printf("\n\n                     \t    time spent in each part of the simulation and check the");
+	printf("\n\n                     \t    world checksum at the last frame against the recorded one.");
+	printf("\n\n                     \tWhere x is the .replay file written next to a saved game");
+	printf("\n\n                     \t    with SaveCommandsForReplay enabled.");
+	printf("\n\n                     \tWhere y is json or csv to print the results, or a file");
+	printf("\n\n                     \t    ending in .json or .csv to write them to, json if omitted.");
+	printf("\n\n                     \tWhere z is serial or threaded to run the unit think step on");
+	printf("\n\n                     \t    the main thread or the faction threads and write the");
+	printf("\n\n                     \t    world checksum of every frame next to the replay. The run");
+	printf("\n\n                     \t    in the other mode compares its checksums with them.");
+	printf("\n\n                     \tExits with 1 when a checksum doesn't match.");
+	printf("\n\n                     \texample: %s %s=saved/mygame.xml.replay=csv", extractFileFromDirectoryPath(argv0).c_str(), GAME_ARGS[GAME_ARG_BENCHMARK_REPLAY]);
+	printf("\n\n                     \texample: %s %s=saved/mygame.xml.replay=csv=serial", extractFileFromDirectoryPath(argv0).c_str(), GAME_ARGS[GAME_ARG_BENCHMARK_REPLAY]);
+
+	printf("\n\n%s=x  ", GAME_ARGS[GAME_ARG_BENCHMARK_NETWORK_MESSAGES]);
+	printf("\n\n                     \tSend command lists in each protocol to simulated clients");
+	printf("\n\n                     \t    over socket pairs and count the message buffers allocated");
+	printf("\n\n                     \t    and the time taken per message (linux only).");
+	printf("\n\n                     \tWhere x is the number of clients, 4 if omitted.");
+	printf("\n\n                     \texample: %s %s=4", extractFileFromDirectoryPath(argv0).c_str(), GAME_ARGS[GAME_ARG_BENCHMARK_NETWORK_MESSAGES]);
+
 	printf("\n\n%s=x=y  ", GAME_ARGS[GAME_ARG_CREATE_DATA_ARCHIVES]);
 	printf("\n\n                     \tCompress selected game data into archives for network sharing.");
 	printf("\n\n                     \tWhere x is one of the following data items to compress:");
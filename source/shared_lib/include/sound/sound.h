@@ -20,6 +20,10 @@ using namespace std;
 using namespace Shared::Platform;
 
 namespace Shared {
+	namespace PlatformCommon {
+		template <typename T> class PreloadCache;
+	}
+
 	namespace Sound {
 
 		// =====================================================
@@ -123,7 +127,12 @@ namespace Shared {
 				return samples;
 			}
 
+			// Sounds decoded on worker threads by loadFile(), load() takes
+			// the one of the same path instead of decoding it again
+			static Shared::PlatformCommon::PreloadCache<StaticSound> &getPreloaded();
+
 			void load(const string &path);
+			void loadFile(const string &path);
 			void close();
 		};
 
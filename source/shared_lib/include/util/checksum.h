@@ -57,6 +57,8 @@ namespace Shared {
 			uint32 addUInt(const uint32 &value);
 			uint32 addInt64(const int64 &value);
 			void addFile(const string &path);
+			// Adds the files another checksum was given with addFile
+			void addFileList(const Checksum &other);
 
 			static void removeFileFromCache(const string file);
 			static void clearFileCache();
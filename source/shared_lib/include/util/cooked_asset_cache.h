@@ -0,0 +1,109 @@
+//
+//      cooked_asset_cache.h: parsed and decoded game files kept on disk
+//                            between runs
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _SHARED_UTIL_COOKEDASSETCACHE_H_
+#define _SHARED_UTIL_COOKEDASSETCACHE_H_
+
+#include <string>
+#include <vector>
+#include "data_types.h"
+#include "leak_dumper.h"
+
+using std::string;
+using std::vector;
+
+namespace Shared {
+	namespace Util {
+
+		// =====================================================
+		//	class CookedAssetCache
+		//
+		///	What parsing or decoding a file gave, saved so the next
+		///	run reads it back instead. An entry is named by the CRC
+		///	and size of the source file's bytes, so editing the file
+		///	just makes a new entry. Entries start with "ZGCA", the
+		///	format version (4 bytes, common endian) and a 4 letter
+		///	kind; a missing or damaged one only means the source is
+		///	read the usual way again. Reading an entry touches it so
+		///	the least recently used ones go first when the folder is
+		///	pruned back under its size cap.
+		// =====================================================
+
+		class CookedAssetCache {
+		public:
+			// What the cache did since the last resetStats()
+			struct Stats {
+				Shared::Platform::uint32 hits;
+				Shared::Platform::uint32 misses;
+				Shared::Platform::uint32 writes;
+				Shared::Platform::int64 checksumMicros;
+				Shared::Platform::int64 readMicros;
+				Shared::Platform::int64 writeMicros;
+				Shared::Platform::int64 writtenBytes;
+			};
+
+		private:
+			static string path;
+			static vector<string> sourcePaths;
+			static bool cookImages;
+			static Stats stats;
+
+		public:
+			static const Shared::Platform::uint32 version = 1;
+
+			// The folder entries go to, empty turns the cache off. Only
+			// files under sourcePaths are cooked, the game data that
+			// rarely changes rather than saved games and settings. The
+			// folder is pruned to maxBytes, 0 keeps every entry
+			static void setPath(const string &value, const vector<string> &sourcePaths, Shared::Platform::int64 maxBytes = 0);
+			static bool isEnabledFor(const string &sourceFile);
+			// Decoded images are only cooked when this is set, off by
+			// default since an entry is far bigger than the file it
+			// replaces and the warm load has not been shown faster yet
+			static void setCookImages(bool value) {
+				cookImages = value;
+			}
+			static bool getCookImages() {
+				return cookImages;
+			}
+			// Removes the least recently used entries until the rest take
+			// at most maxBytes, returns how many were removed
+			static int prune(Shared::Platform::int64 maxBytes);
+
+			// variant tells apart entries cooked differently from the same
+			// source, like the pixel format of an image
+			static string getEntryPath(const string &prefix, const char *sourceData, size_t sourceSize, const string &variant = "");
+			// false when the entry is missing or isn't of kind, data gets
+			// what was written without the header
+			static bool read(const string &entryPath, const char *kind, vector<char> &data);
+			// Errors are ignored, the entry is simply not there next time
+			static void write(const string &entryPath, const char *kind, const char *data, size_t size);
+
+			static Stats getStats();
+			static void resetStats();
+		};
+
+	}
+} //end namespace
+
+#endif
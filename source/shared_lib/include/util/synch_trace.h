@@ -0,0 +1,113 @@
+//
+//      synch_trace.h: binary trace of the world synch events of the simulation
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#ifndef _SHARED_UTIL_SYNCHTRACE_H_
+#define _SHARED_UTIL_SYNCHTRACE_H_
+
+#include <string>
+#include <vector>
+#include "data_types.h"
+#include "thread.h"
+#include "leak_dumper.h"
+
+using std::string;
+using std::vector;
+using namespace Shared::Platform;
+
+// SYNCH_TRACE(unitId, event, args...) records a world synch event with up
+// to 4 int arguments. event must be a string literal, by convention the name
+// of the event followed by the names of its arguments, e.g.
+// "processNode(sucPos.x,sucPos.y)". Only debug builds and builds configured
+// with WANT_SYNCH_TRACE define USE_SYNCH_TRACE, everywhere else the macro and its
+// arguments compile to nothing.
+#ifdef USE_SYNCH_TRACE
+#define SYNCH_TRACE_ENABLED() (::Shared::Util::SynchTrace::isEnabled())
+#define SYNCH_TRACE(unitId, event, ...) \
+	do { \
+		if (::Shared::Util::SynchTrace::isEnabled()) { \
+			::Shared::Util::SynchTrace::add(unitId, event, ##__VA_ARGS__); \
+		} \
+	} while (0)
+#else
+#define SYNCH_TRACE_ENABLED() (false)
+#define SYNCH_TRACE(unitId, event, ...) do { } while (0)
+#endif
+
+namespace Shared {
+	namespace Util {
+
+		// =====================================================
+		//	class SynchTraceRecord
+		// =====================================================
+
+		class SynchTraceRecord {
+		public:
+			static const int maxArgs = 4;
+
+			int frame;
+			int unitId;
+			const char *event;
+			int args[maxArgs];
+		};
+
+		// =====================================================
+		//	class SynchTrace
+		//
+		///	Ring buffer of the last world synch events. Recording
+		///	only copies a few ints, the events are named when the
+		///	buffer is saved. The file is decoded offline with
+		///	source/tools/decode_synch_trace.
+		// =====================================================
+
+		class SynchTrace {
+		public:
+			static const int capacity;
+
+		private:
+			static Mutex mutex;
+			static vector<SynchTraceRecord> records;
+			static int64 recordCount;	// ever added, the ring holds the last capacity of them
+			static int frame;
+			static bool enabled;
+
+		public:
+			static bool isEnabled() {
+				return enabled;
+			}
+			static void setEnabled(bool value);
+			static void setFrame(int value) {
+				frame = value;
+			}
+
+			static void add(int unitId, const char *event, int arg0 = 0, int arg1 = 0, int arg2 = 0, int arg3 = 0);
+			static void clear();
+			static int getCount();
+
+			// writes the buffered records, oldest first, false when the file
+			// could not be written
+			static bool save(const string &path);
+		};
+
+	}
+} //end namespace
+
+#endif
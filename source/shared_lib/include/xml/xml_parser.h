@@ -49,6 +49,10 @@ XERCES_CPP_NAMESPACE_USE
 #endif
 
 namespace Shared {
+	namespace PlatformCommon {
+		template <typename T> class PreloadCache;
+	}
+
 	namespace Xml {
 
 		enum xml_engine_parser_type {
@@ -129,6 +133,35 @@ namespace Shared {
 			void save(const string &path, const XmlNode *node);
 		};
 
+		// =====================================================
+		//	class XmlIoBinary
+		//
+		///	Binary form of a node tree: "ZGXB", the format version
+		///	(4 bytes, common endian), the table of every distinct
+		///	name and value, then the nodes depth first. Counts,
+		///	lengths and string indexes are varints. Loading it
+		///	gives the same nodes as loading the xml would.
+		// =====================================================
+
+		class XmlIoBinary {
+		private:
+			class Reader;
+
+		public:
+			static const Shared::Platform::uint32 version = 1;
+			static const int maxDepth = 1000;
+
+			static bool isBinaryData(const char *data, size_t size);
+			static bool isBinaryFile(const string &path);
+
+			static XmlNode *load(const char *data, size_t size, const string &path, const std::map<string, string> &mapTagReplacementValues, bool skipUpdatePathClimbingParts = false);
+			static XmlNode *load(const string &path, const std::map<string, string> &mapTagReplacementValues, bool skipUpdatePathClimbingParts = false);
+			static void save(const string &path, const XmlNode *node);
+			// The binary form of a parsed document before any tag
+			// replacement, for the cooked asset cache
+			static string encode(xml_node<> *node);
+		};
+
 		// =====================================================
 		//	class XmlTree
 		// =====================================================
@@ -140,6 +173,7 @@ namespace Shared {
 			xml_engine_parser_type engine_type;
 			bool skipStackCheck;
 			bool skipUpdatePathClimbingParts;
+			bool skipPreloaded;
 		private:
 			XmlTree(XmlTree&);
 			void operator =(XmlTree&);
@@ -149,10 +183,18 @@ namespace Shared {
 			XmlTree(xml_engine_parser_type engine_type = XML_RAPIDXML_ENGINE);
 			~XmlTree();
 
+			// Trees parsed on worker threads, load() takes the one with the
+			// same path and tag replacement values instead of parsing again
+			static Shared::PlatformCommon::PreloadCache<XmlTree> &getPreloaded();
+			static string getPreloadKey(const string &path, const std::map<string, string> &mapTagReplacementValues);
+
 			void setSkipUpdatePathClimbingParts(bool value);
+			// Set by the worker threads that fill getPreloaded()
+			void setSkipPreloaded(bool value);
 			void init(const string &name);
 			void load(const string &path, const std::map<string, string> &mapTagReplacementValues, bool noValidation = false, bool skipStackCheck = false, bool skipStackTrace = false);
 			void save(const string &path);
+			void saveBinary(const string &path);
 
 			XmlNode *getRootNode() const {
 				return rootNode;
@@ -164,6 +206,8 @@ namespace Shared {
 		// =====================================================
 
 		class XmlNode {
+			friend class XmlIoBinary;
+
 		private:
 			string name;
 			string text;
@@ -12,8 +12,18 @@
 #include "interpolation.h"
 
 #include <cassert>
+#include <cstring>
 #include <algorithm>
 
+#if defined(__AVX__)
+#define MG_INTERPOLATION_AVX
+#include <immintrin.h>
+#endif
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MG_INTERPOLATION_SSE
+#include <xmmintrin.h>
+#endif
+
 #include "model.h"
 #include "conversion.h"
 #include "util.h"
@@ -32,6 +42,8 @@ namespace Shared {
 		// =====================================================
 
 		bool InterpolationData::enableInterpolation = true;
+		int InterpolationData::cacheSize = 4;
+		int InterpolationData::cacheSteps = 16;
 
 		InterpolationData::InterpolationData(const Mesh *mesh) {
 			if (GlobalStaticFlags::getIsNonGraphicalModeEnabled() == true) {
@@ -42,46 +54,130 @@ namespace Shared {
 			normals = NULL;
 
 			raw_frame_ofs = 0;
+			cacheUseCount = 0;
 
 			this->mesh = mesh;
 		}
 
 		InterpolationData::~InterpolationData() {
-			delete[] vertices;
+			for (unsigned int i = 0; i < cache.size(); ++i) {
+				delete[] cache[i].vertices;
+				delete[] cache[i].normals;
+			}
+			cache.clear();
 			vertices = NULL;
-			delete[] normals;
 			normals = NULL;
 		}
 
+		void InterpolationData::lerpFramesScalar(const Vec3f *prev, const Vec3f *next, float t, Vec3f *dest, uint32 count) {
+			const float *a = &prev[0].x;
+			const float *b = &next[0].x;
+			float *d = &dest[0].x;
+			const uint32 floatCount = count * 3;
+			for (uint32 i = 0; i < floatCount; ++i) {
+				d[i] = a[i] + (b[i] - a[i]) * t;
+			}
+		}
+
+		void InterpolationData::lerpFrames(const Vec3f *prev, const Vec3f *next, float t, Vec3f *dest, uint32 count) {
+			// a frame is vertexCount Vec3f one after the other, so it is
+			// lerped as one run of floats whatever the vector width
+			const float *a = &prev[0].x;
+			const float *b = &next[0].x;
+			float *d = &dest[0].x;
+			const uint32 floatCount = count * 3;
+			uint32 i = 0;
+
+#if defined(MG_INTERPOLATION_AVX)
+			const __m256 t8 = _mm256_set1_ps(t);
+			for (; i + 8 <= floatCount; i += 8) {
+				__m256 va = _mm256_loadu_ps(a + i);
+				__m256 vb = _mm256_loadu_ps(b + i);
+				_mm256_storeu_ps(d + i, _mm256_add_ps(va, _mm256_mul_ps(_mm256_sub_ps(vb, va), t8)));
+			}
+#endif
+#if defined(MG_INTERPOLATION_SSE)
+			const __m128 t4 = _mm_set1_ps(t);
+			for (; i + 4 <= floatCount; i += 4) {
+				__m128 va = _mm_loadu_ps(a + i);
+				__m128 vb = _mm_loadu_ps(b + i);
+				_mm_storeu_ps(d + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), t4)));
+			}
+#endif
+			for (; i < floatCount; ++i) {
+				d[i] = a[i] + (b[i] - a[i]) * t;
+			}
+		}
+
+		InterpolationData::CacheEntry &InterpolationData::getCacheEntry(int64 key) {
+			cacheUseCount++;
+
+			int leastUsed = -1;
+			for (unsigned int i = 0; i < cache.size(); ++i) {
+				if (cache[i].key == key) {
+					cache[i].lastUse = cacheUseCount;
+					return cache[i];
+				}
+				if (leastUsed < 0 || cache[i].lastUse < cache[leastUsed].lastUse) {
+					leastUsed = i;
+				}
+			}
+
+			// the buffers of an entry are reused rather than freed, what
+			// getVertices() handed out last stays valid memory
+			if ((int)cache.size() < cacheSize || leastUsed < 0) {
+				cache.push_back(CacheEntry());
+				leastUsed = (int)cache.size() - 1;
+			}
+			CacheEntry &entry = cache[leastUsed];
+			entry.key = key;
+			entry.lastUse = cacheUseCount;
+			entry.hasVertices = false;
+			entry.hasNormals = false;
+			return entry;
+		}
+
 		void InterpolationData::update(float t, bool cycle) {
 			updateVertices(t, cycle);
 			updateNormals(t, cycle);
 		}
 
 		void InterpolationData::updateVertices(float t, bool cycle) {
-			update(mesh->getVertices(), vertices, t, cycle);
+			update(t, cycle, true);
 		}
 
 		void InterpolationData::updateNormals(float t, bool cycle) {
-			update(mesh->getNormals(), normals, t, cycle);
+			update(t, cycle, false);
 		}
 
-		void InterpolationData::update(const Vec3f* src, Vec3f* &dest, float t, bool cycle) {
-
-			if (t <0.0f || t>1.0f) {
-				printf("ERROR t = [%f] for cycle [%d] f [%d] v [%d]\n", t, cycle, mesh->getFrameCount(), mesh->getVertexCount());
-			}
-			//assert(t>=0.0f && t<=1.0f);
-			if (t < 0.0f || t > 1.0f) {
-				throw megaglest_runtime_error("t < 0.0f || t > 1.0f t = [" + floatToStr(t, 16) + "]");
-
-				assert(t >= 0.f && t <= 1.f);
+		void InterpolationData::update(float t, bool cycle, bool updateVertexData) {
+			// an animation progress a hair outside 0..1 from float error
+			// is no reason to stop the game
+			if (t < 0.0f) {
+				t = 0.0f;
+			} else if (t > 1.0f) {
+				t = 1.0f;
 			}
 
 			uint32 frameCount = mesh->getFrameCount();
 			uint32 vertexCount = mesh->getVertexCount();
 
 			if (frameCount > 1) {
+				uint32 frameSpan = (cycle == true ? frameCount : frameCount - 1);
+
+				int64 key;
+				if (cacheSteps > 0 && enableInterpolation) {
+					uint32 stepCount = frameSpan * cacheSteps;
+					uint32 step = static_cast<uint32>(t * stepCount + 0.5f);
+					t = static_cast<float>(step) / stepCount;
+					key = static_cast<int64>(step);
+				} else {
+					uint32 bits = 0;
+					memcpy(&bits, &t, sizeof(bits));
+					key = static_cast<int64>(bits);
+				}
+				key = (key << 1) | (cycle == true ? 1 : 0);
+
 				//misc vars
 				uint32 prevFrame;
 				uint32 nextFrame;
@@ -106,11 +202,22 @@ namespace Shared {
 				assert(nextFrame < frameCount);
 
 				if (enableInterpolation) {
-					if (!dest) { // not previously allocated
-						dest = new Vec3f[vertexCount];
+					CacheEntry &entry = getCacheEntry(key);
+					Vec3f *&dest = (updateVertexData == true ? entry.vertices : entry.normals);
+					bool &valid = (updateVertexData == true ? entry.hasVertices : entry.hasNormals);
+
+					if (valid == false) {
+						if (!dest) { // not previously allocated
+							dest = new Vec3f[vertexCount];
+						}
+						const Vec3f *src = (updateVertexData == true ? mesh->getVertices() : mesh->getNormals());
+						lerpFrames(src + prevFrameBase, src + nextFrameBase, localT, dest, vertexCount);
+						valid = true;
 					}
-					for (uint32 j = 0; j < vertexCount; ++j) {
-						dest[j] = src[prevFrameBase + j].lerp(localT, src[nextFrameBase + j]);
+					if (updateVertexData == true) {
+						vertices = dest;
+					} else {
+						normals = dest;
 					}
 				} else {
 					raw_frame_ofs = prevFrameBase;
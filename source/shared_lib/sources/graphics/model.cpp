@@ -14,6 +14,7 @@
 #include <cstdio>
 #include <cassert>
 #include <stdexcept>
+#include <algorithm>
 
 #include "interpolation.h"
 #include "conversion.h"
@@ -196,6 +197,70 @@ namespace Shared {
 			}
 		}
 
+		// =====================================================
+		//	class ModelFileReader
+		// =====================================================
+
+		ModelFileReader::ModelFileReader() {
+			file = NULL;
+			position = 0;
+		}
+
+		ModelFileReader::~ModelFileReader() {
+			close();
+		}
+
+		bool ModelFileReader::open(const string &path, bool mapped) {
+			close();
+			if (mapped == true) {
+				return mappedFile.open(path);
+			}
+#ifdef WIN32
+			file = _wfopen(utf8_decode(path).c_str(), L"rb");
+#else
+			file = fopen(path.c_str(), "rb");
+#endif
+			return file != NULL;
+		}
+
+		void ModelFileReader::close() {
+			if (file != NULL) {
+				fclose(file);
+				file = NULL;
+			}
+			mappedFile.close();
+			position = 0;
+		}
+
+		size_t ModelFileReader::read(void *data, size_t size, size_t count) {
+			if (file != NULL) {
+				return fread(data, size, count, file);
+			}
+			if (size == 0) {
+				return 0;
+			}
+			size_t available = position < mappedFile.getSize() ? mappedFile.getSize() - position : 0;
+			size_t result = std::min(count, available / size);
+			// One copy straight out of the page cache, there is no byte
+			// order work after it on little endian hosts
+			if (result > 0) {
+				memcpy(data, mappedFile.getData() + position, result * size);
+				position += result * size;
+			}
+			return result;
+		}
+
+		int ModelFileReader::seek(long offset) {
+			if (file != NULL) {
+				return fseek(file, offset, SEEK_CUR);
+			}
+			if (offset < 0 && (size_t) -offset > position) {
+				return -1;
+			}
+			position += offset;
+			return 0;
+		}
+
 		// =====================================================
 		//	class Mesh
 		// =====================================================
@@ -404,13 +469,13 @@ namespace Shared {
 			return result;
 		}
 
-		void Mesh::loadV2(int meshIndex, const string &dir, FILE *f, TextureManager *textureManager,
+		void Mesh::loadV2(int meshIndex, const string &dir, ModelFileReader &f, TextureManager *textureManager,
 			bool deletePixMapAfterLoad, std::map<string, vector<pair<string, string> > > *loadedFileList,
 			string sourceLoader, string modelFile) {
 			this->textureManager = textureManager;
 			//read header
 			MeshHeaderV2 meshHeader;
-			size_t readBytes = fread(&meshHeader, sizeof(MeshHeaderV2), 1, f);
+			size_t readBytes = f.read(&meshHeader, sizeof(MeshHeaderV2), 1);
 			if (readBytes != 1) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " on line: %d.", readBytes, __LINE__);
@@ -493,7 +558,7 @@ namespace Shared {
 			}
 
 			//read data
-			readBytes = fread(vertices, sizeof(Vec3f)*frameCount*vertexCount, 1, f);
+			readBytes = f.read(vertices, sizeof(Vec3f)*frameCount*vertexCount, 1);
 			if (readBytes != 1 && (frameCount * vertexCount) != 0) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " [%u][%u] on line: %d.", readBytes, frameCount, vertexCount, __LINE__);
@@ -501,7 +566,7 @@ namespace Shared {
 			}
 			fromEndianVecArray<Vec3f>(vertices, frameCount*vertexCount);
 
-			readBytes = fread(normals, sizeof(Vec3f)*frameCount*vertexCount, 1, f);
+			readBytes = f.read(normals, sizeof(Vec3f)*frameCount*vertexCount, 1);
 			if (readBytes != 1 && (frameCount * vertexCount) != 0) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " [%u][%u] on line: %d.", readBytes, frameCount, vertexCount, __LINE__);
@@ -510,7 +575,7 @@ namespace Shared {
 			fromEndianVecArray<Vec3f>(normals, frameCount*vertexCount);
 
 			if ((textureFlags & mtDiffuse) == mtDiffuse) {
-				readBytes = fread(texCoords, sizeof(Vec2f)*vertexCount, 1, f);
+				readBytes = f.read(texCoords, sizeof(Vec2f)*vertexCount, 1);
 				if (readBytes != 1 && vertexCount != 0) {
 					char szBuf[8096] = "";
 					snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " [%u][%u] on line: %d.", readBytes, frameCount, vertexCount, __LINE__);
@@ -518,7 +583,7 @@ namespace Shared {
 				}
 				fromEndianVecArray<Vec2f>(texCoords, vertexCount);
 			}
-			readBytes = fread(&diffuseColor, sizeof(Vec3f), 1, f);
+			readBytes = f.read(&diffuseColor, sizeof(Vec3f), 1);
 			if (readBytes != 1) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " on line: %d.", readBytes, __LINE__);
@@ -526,7 +591,7 @@ namespace Shared {
 			}
 			fromEndianVecArray<Vec3f>(&diffuseColor, 1);
 
-			readBytes = fread(&opacity, sizeof(float32), 1, f);
+			readBytes = f.read(&opacity, sizeof(float32), 1);
 			if (readBytes != 1) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " on line: %d.", readBytes, __LINE__);
@@ -534,13 +599,13 @@ namespace Shared {
 			}
 			opacity = Shared::PlatformByteOrder::fromCommonEndian(opacity);
 
-			int seek_result = fseek(f, sizeof(Vec4f)*(meshHeader.colorFrameCount - 1), SEEK_CUR);
+			int seek_result = f.seek(sizeof(Vec4f)*(meshHeader.colorFrameCount - 1));
 			if (seek_result != 0) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fseek returned failure = %d [%u] on line: %d.", seek_result, indexCount, __LINE__);
 				throw megaglest_runtime_error(szBuf);
 			}
-			readBytes = fread(indices, sizeof(uint32)*indexCount, 1, f);
+			readBytes = f.read(indices, sizeof(uint32)*indexCount, 1);
 			if (readBytes != 1 && indexCount != 0) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " [%u] on line: %d.", readBytes, indexCount, __LINE__);
@@ -549,7 +614,7 @@ namespace Shared {
 			Shared::PlatformByteOrder::fromEndianTypeArray<uint32>(indices, indexCount);
 		}
 
-		void Mesh::loadV3(int meshIndex, const string &dir, FILE *f,
+		void Mesh::loadV3(int meshIndex, const string &dir, ModelFileReader &f,
 			TextureManager *textureManager, bool deletePixMapAfterLoad,
 			std::map<string, vector<pair<string, string> > > *loadedFileList,
 			string sourceLoader, string modelFile) {
@@ -557,7 +622,7 @@ namespace Shared {
 
 			//read header
 			MeshHeaderV3 meshHeader;
-			size_t readBytes = fread(&meshHeader, sizeof(MeshHeaderV3), 1, f);
+			size_t readBytes = f.read(&meshHeader, sizeof(MeshHeaderV3), 1);
 			if (readBytes != 1) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " on line: %d.", readBytes, __LINE__);
@@ -637,7 +702,7 @@ namespace Shared {
 			}
 
 			//read data
-			readBytes = fread(vertices, sizeof(Vec3f)*frameCount*vertexCount, 1, f);
+			readBytes = f.read(vertices, sizeof(Vec3f)*frameCount*vertexCount, 1);
 			if (readBytes != 1 && (frameCount * vertexCount) != 0) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " [%u][%u] on line: %d.", readBytes, frameCount, vertexCount, __LINE__);
@@ -645,7 +710,7 @@ namespace Shared {
 			}
 			fromEndianVecArray<Vec3f>(vertices, frameCount*vertexCount);
 
-			readBytes = fread(normals, sizeof(Vec3f)*frameCount*vertexCount, 1, f);
+			readBytes = f.read(normals, sizeof(Vec3f)*frameCount*vertexCount, 1);
 			if (readBytes != 1 && (frameCount * vertexCount) != 0) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " [%u][%u] on line: %d.", readBytes, frameCount, vertexCount, __LINE__);
@@ -655,7 +720,7 @@ namespace Shared {
 
 			if ((textureFlags & mtDiffuse) == mtDiffuse) {
 				for (unsigned int i = 0; i < meshHeader.texCoordFrameCount; ++i) {
-					readBytes = fread(texCoords, sizeof(Vec2f)*vertexCount, 1, f);
+					readBytes = f.read(texCoords, sizeof(Vec2f)*vertexCount, 1);
 					if (readBytes != 1 && vertexCount != 0) {
 						char szBuf[8096] = "";
 						snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " [%u][%u] on line: %d.", readBytes, frameCount, vertexCount, __LINE__);
@@ -664,7 +729,7 @@ namespace Shared {
 					fromEndianVecArray<Vec2f>(texCoords, vertexCount);
 				}
 			}
-			readBytes = fread(&diffuseColor, sizeof(Vec3f), 1, f);
+			readBytes = f.read(&diffuseColor, sizeof(Vec3f), 1);
 			if (readBytes != 1) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " on line: %d.", readBytes, __LINE__);
@@ -672,7 +737,7 @@ namespace Shared {
 			}
 			fromEndianVecArray<Vec3f>(&diffuseColor, 1);
 
-			readBytes = fread(&opacity, sizeof(float32), 1, f);
+			readBytes = f.read(&opacity, sizeof(float32), 1);
 			if (readBytes != 1) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " on line: %d.", readBytes, __LINE__);
@@ -680,14 +745,14 @@ namespace Shared {
 			}
 			opacity = Shared::PlatformByteOrder::fromCommonEndian(opacity);
 
-			int seek_result = fseek(f, sizeof(Vec4f)*(meshHeader.colorFrameCount - 1), SEEK_CUR);
+			int seek_result = f.seek(sizeof(Vec4f)*(meshHeader.colorFrameCount - 1));
 			if (seek_result != 0) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fseek returned failure = %d [%u] on line: %d.", seek_result, indexCount, __LINE__);
 				throw megaglest_runtime_error(szBuf);
 			}
 
-			readBytes = fread(indices, sizeof(uint32)*indexCount, 1, f);
+			readBytes = f.read(indices, sizeof(uint32)*indexCount, 1);
 			if (readBytes != 1 && indexCount != 0) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " [%u] on line: %d.", readBytes, indexCount, __LINE__);
@@ -748,14 +813,14 @@ namespace Shared {
 			return texture;
 		}
 
-		void Mesh::load(int meshIndex, const string &dir, FILE *f, TextureManager *textureManager,
+		void Mesh::load(int meshIndex, const string &dir, ModelFileReader &f, TextureManager *textureManager,
 			bool deletePixMapAfterLoad, std::map<string, vector<pair<string, string> > > *loadedFileList,
 			string sourceLoader, string modelFile) {
 			this->textureManager = textureManager;
 
 			//read header
 			MeshHeader meshHeader;
-			size_t readBytes = fread(&meshHeader, sizeof(MeshHeader), 1, f);
+			size_t readBytes = f.read(&meshHeader, sizeof(MeshHeader), 1);
 			if (readBytes != 1) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " on line: %d.", readBytes, __LINE__);
@@ -801,7 +866,7 @@ namespace Shared {
 				if (meshHeader.textures & flag) {
 					uint8 cMapPath[mapPathSize + 1];
 					memset(&cMapPath[0], 0, mapPathSize + 1);
-					readBytes = fread(cMapPath, mapPathSize, 1, f);
+					readBytes = f.read(cMapPath, mapPathSize, 1);
 					cMapPath[mapPathSize] = 0;
 					if (readBytes != 1 && mapPathSize != 0) {
 						char szBuf[8096] = "";
@@ -825,13 +890,15 @@ namespace Shared {
 					if (textureManager) {
 						textures[i] = loadMeshTexture(meshIndex, i, textureManager, mapFullPath, meshTextureChannelCount[i], texturesOwned[i],
 							deletePixMapAfterLoad, loadedFileList, sourceLoader, modelFile);
+					} else {
+						texturePaths[i] = mapFullPath;
 					}
 				}
 				flag *= 2;
 			}
 
 			//read data
-			readBytes = fread(vertices, sizeof(Vec3f)*frameCount*vertexCount, 1, f);
+			readBytes = f.read(vertices, sizeof(Vec3f)*frameCount*vertexCount, 1);
 			if (readBytes != 1 && (frameCount * vertexCount) != 0) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " [%u][%u] on line: %d.", readBytes, frameCount, vertexCount, __LINE__);
@@ -839,7 +906,7 @@ namespace Shared {
 			}
 			fromEndianVecArray<Vec3f>(vertices, frameCount*vertexCount);
 
-			readBytes = fread(normals, sizeof(Vec3f)*frameCount*vertexCount, 1, f);
+			readBytes = f.read(normals, sizeof(Vec3f)*frameCount*vertexCount, 1);
 			if (readBytes != 1 && (frameCount * vertexCount) != 0) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " [%u][%u] on line: %d.", readBytes, frameCount, vertexCount, __LINE__);
@@ -848,7 +915,7 @@ namespace Shared {
 			fromEndianVecArray<Vec3f>(normals, frameCount*vertexCount);
 
 			if (meshHeader.textures != 0) {
-				readBytes = fread(texCoords, sizeof(Vec2f)*vertexCount, 1, f);
+				readBytes = f.read(texCoords, sizeof(Vec2f)*vertexCount, 1);
 				if (readBytes != 1 && vertexCount != 0) {
 					char szBuf[8096] = "";
 					snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " [%u][%u] on line: %d.", readBytes, frameCount, vertexCount, __LINE__);
@@ -856,7 +923,7 @@ namespace Shared {
 				}
 				fromEndianVecArray<Vec2f>(texCoords, vertexCount);
 			}
-			readBytes = fread(indices, sizeof(uint32)*indexCount, 1, f);
+			readBytes = f.read(indices, sizeof(uint32)*indexCount, 1);
 			if (readBytes != 1 && indexCount != 0) {
 				char szBuf[8096] = "";
 				snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " [%u] on line: %d.", readBytes, indexCount, __LINE__);
@@ -870,6 +937,20 @@ namespace Shared {
 			}*/
 		}
 
+		void Mesh::loadTextures(int meshIndex, TextureManager *textureManager, bool deletePixMapAfterLoad,
+			std::map<string, vector<pair<string, string> > > *loadedFileList, string sourceLoader, string modelFile) {
+			this->textureManager = textureManager;
+
+			uint32 flag = 1;
+			for (int i = 0; i < MESH_TEXTURE_COUNT; ++i) {
+				if ((textureFlags & flag) && textures[i] == NULL && texturePaths[i] != "" && textureManager != NULL) {
+					textures[i] = loadMeshTexture(meshIndex, i, textureManager, texturePaths[i], meshTextureChannelCount[i], texturesOwned[i],
+						deletePixMapAfterLoad, loadedFileList, sourceLoader, modelFile);
+				}
+				flag *= 2;
+			}
+		}
+
 		void Mesh::save(int meshIndex, const string &dir, FILE *f, TextureManager *textureManager,
 			string convertTextureToFormat, std::map<string, int> &textureDeleteList,
 			bool keepsmallest, string modelFile) {
@@ -1072,6 +1153,8 @@ namespace Shared {
 
 		// ==================== constructor & destructor ====================
 
+		bool Model::mappedFileLoading = true;
+
 		Model::Model() {
 			if (GlobalStaticFlags::getIsNonGraphicalModeEnabled() == true) {
 				throw megaglest_runtime_error("Loading graphics in headless server mode not allowed!");
@@ -1158,6 +1241,22 @@ namespace Shared {
 			}
 		}
 
+		void Model::loadTextures(TextureManager *textureManager, bool deletePixMapAfterLoad,
+			std::map<string, vector<pair<string, string> > > *loadedFileList, string *sourceLoader) {
+
+			this->textureManager = textureManager;
+			this->sourceLoader = (sourceLoader != NULL ? *sourceLoader : "");
+			if (loadedFileList) {
+				(*loadedFileList)[fileName].push_back(make_pair(this->sourceLoader, this->sourceLoader));
+			}
+
+			for (uint32 i = 0; i < meshCount; ++i) {
+				meshes[i].loadTextures(i, textureManager, deletePixMapAfterLoad,
+					loadedFileList, this->sourceLoader, fileName);
+			}
+			autoJoinMeshFrames();
+		}
+
 		void Model::save(const string &path, string convertTextureToFormat,
 			bool keepsmallest) {
 			string extension = (path.empty() == false ? path.substr(path.find_last_of('.') + 1) : "");
@@ -1174,12 +1273,8 @@ namespace Shared {
 			string sourceLoader) {
 
 			try {
-#ifdef WIN32
-				FILE *f = _wfopen(utf8_decode(path).c_str(), L"rb");
-#else
-				FILE *f = fopen(path.c_str(), "rb");
-#endif
-				if (f == NULL) {
+				ModelFileReader f;
+				if (f.open(path, mappedFileLoading) == false) {
 					printf("In [%s::%s] cannot load file = [%s]\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, path.c_str());
 					throw megaglest_runtime_error("Error opening g3d model file [" + path + "]", true);
 				}
@@ -1192,9 +1287,8 @@ namespace Shared {
 
 				//file header
 				FileHeader fileHeader;
-				size_t readBytes = fread(&fileHeader, sizeof(FileHeader), 1, f);
+				size_t readBytes = f.read(&fileHeader, sizeof(FileHeader), 1);
 				if (readBytes != 1) {
-					fclose(f);
 					char szBuf[8096] = "";
 					snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " on line: %d.", readBytes, __LINE__);
 					throw megaglest_runtime_error(szBuf);
@@ -1206,8 +1300,6 @@ namespace Shared {
 				memcpy(&fileId[0], reinterpret_cast<char*>(fileHeader.id), 3);
 
 				if (strncmp(fileId, "G3D", 3) != 0) {
-					fclose(f);
-					f = NULL;
 					printf("In [%s::%s] file = [%s] fileheader.id = [%s]\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, path.c_str(), fileId);
 					throw megaglest_runtime_error("Not a valid G3D model", true);
 				}
@@ -1219,7 +1311,7 @@ namespace Shared {
 				if (fileHeader.version == 4) {
 					//model header
 					ModelHeader modelHeader;
-					readBytes = fread(&modelHeader, sizeof(ModelHeader), 1, f);
+					readBytes = f.read(&modelHeader, sizeof(ModelHeader), 1);
 					if (readBytes != 1) {
 						char szBuf[8096] = "";
 						snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " on line: %d.", readBytes, __LINE__);
@@ -1252,7 +1344,7 @@ namespace Shared {
 				}
 				//version 3
 				else if (fileHeader.version == 3) {
-					readBytes = fread(&meshCount, sizeof(meshCount), 1, f);
+					readBytes = f.read(&meshCount, sizeof(meshCount), 1);
 					if (readBytes != 1 && meshCount != 0) {
 						char szBuf[8096] = "";
 						snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " [%u] on line: %d.", readBytes, meshCount, __LINE__);
@@ -1278,7 +1370,7 @@ namespace Shared {
 				}
 				//version 2
 				else if (fileHeader.version == 2) {
-					readBytes = fread(&meshCount, sizeof(meshCount), 1, f);
+					readBytes = f.read(&meshCount, sizeof(meshCount), 1);
 					if (readBytes != 1 && meshCount != 0) {
 						char szBuf[8096] = "";
 						snprintf(szBuf, 8096, "fread returned wrong size = " MG_SIZE_T_SPECIFIER " [%u] on line: %d.", readBytes, meshCount, __LINE__);
@@ -1306,9 +1398,13 @@ namespace Shared {
 					throw megaglest_runtime_error("Invalid model version: " + intToStr(fileHeader.version));
 				}
 
-				fclose(f);
+				f.close();
 
-				autoJoinMeshFrames();
+				// Meshes are joined by texture, without a texture manager
+				// that waits for loadTextures()
+				if (textureManager != NULL) {
+					autoJoinMeshFrames();
+				}
 			} catch (megaglest_runtime_error& ex) {
 				//printf("1111111 ex.wantStackTrace() = %d\n",ex.wantStackTrace());
 				SystemFlags::OutputDebug(SystemFlags::debugError, "In [%s::%s Line: %d] Error [%s]\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, ex.what());
@@ -1410,6 +1506,9 @@ namespace Shared {
 			}
 		};
 
+		void Mesh::setFrameCount(uint32 count) {
+			this->frameCount = count;
+		}
 		void Mesh::setVertices(Vec3f *data, uint32 count) {
 			delete[] this->vertices;
 			this->vertices = data;
@@ -17,6 +17,7 @@
 #include <stdexcept>
 #include "util.h"
 #include "platform_util.h"
+#include "preload_cache.h"
 #include "leak_dumper.h"
 
 using namespace Shared::Util;
@@ -41,9 +42,70 @@ namespace Shared {
 			end();
 		}
 
+		Shared::PlatformCommon::PreloadCache<Model> &ModelManager::getPreloaded() {
+			static Shared::PlatformCommon::PreloadCache<Model> preloaded;
+			return preloaded;
+		}
+
+		Model *ModelManager::loadWithoutTextures(const string &path) {
+			Model *model = GraphicsInterface::getInstance().getFactory()->newModel(path, NULL, false, NULL, NULL);
+			if (model != NULL && model->getFileVersion() != 4) {
+				delete model;
+				model = NULL;
+			}
+			return model;
+		}
+
+		string ModelManager::getModelKey(const string &path) {
+			string key = formatPath(path);
+			updatePathClimbingParts(key);
+			return key;
+		}
+
+		void ModelManager::forgetModel(Model *model) {
+			modelReferences.erase(model);
+			for (std::map<string, Model*>::iterator iterMap = modelsByPath.begin();
+				iterMap != modelsByPath.end(); ++iterMap) {
+				if (iterMap->second == model) {
+					modelsByPath.erase(iterMap);
+					break;
+				}
+			}
+		}
+
 		Model *ModelManager::newModel(const string &path, bool deletePixMapAfterLoad, std::map<string, vector<pair<string, string> > > *loadedFileList, string *sourceLoader) {
-			Model *model = GraphicsInterface::getInstance().getFactory()->newModel(path, textureManager, deletePixMapAfterLoad, loadedFileList, sourceLoader);
+			string key = getModelKey(path);
+			std::map<string, Model*>::iterator iterFind = modelsByPath.find(key);
+			if (iterFind != modelsByPath.end()) {
+				Model *model = iterFind->second;
+				modelReferences[model]++;
+				if (loadedFileList) {
+					string loader = (sourceLoader != NULL ? *sourceLoader : "");
+					(*loadedFileList)[path].push_back(make_pair(loader, loader));
+					for (uint32 i = 0; i < model->getMeshCount(); ++i) {
+						for (int j = 0; j < MESH_TEXTURE_COUNT; ++j) {
+							const Texture2D *texture = model->getMesh(i)->getTexture(j);
+							if (texture != NULL) {
+								(*loadedFileList)[texture->getPath()].push_back(make_pair(loader, loader));
+							}
+						}
+					}
+				}
+				return model;
+			}
+
+			Model *model = NULL;
+			if (getPreloaded().isEmpty() == false) {
+				model = getPreloaded().take(path);
+			}
+			if (model != NULL) {
+				model->loadTextures(textureManager, deletePixMapAfterLoad, loadedFileList, sourceLoader);
+			} else {
+				model = GraphicsInterface::getInstance().getFactory()->newModel(path, textureManager, deletePixMapAfterLoad, loadedFileList, sourceLoader);
+			}
 			models.push_back(model);
+			modelsByPath[key] = model;
+			modelReferences[model] = 1;
 			return model;
 		}
 
@@ -64,10 +126,19 @@ namespace Shared {
 				}
 			}
 			models.clear();
+			modelsByPath.clear();
+			modelReferences.clear();
 		}
 
 		void ModelManager::endModel(Model *model, bool mustExistInList) {
 			if (model != NULL) {
+				std::map<Model*, int>::iterator iterReferences = modelReferences.find(model);
+				if (iterReferences != modelReferences.end() && iterReferences->second > 1) {
+					iterReferences->second--;
+					return;
+				}
+				forgetModel(model);
+
 				bool found = false;
 				for (unsigned int idx = 0; idx < models.size(); idx++) {
 					Model *curModel = models[idx];
@@ -93,10 +164,15 @@ namespace Shared {
 				found = true;
 				size_t index = models.size() - 1;
 				Model *curModel = models[index];
-				models.erase(models.begin() + index);
-
-				curModel->end();
-				delete curModel;
+				if (modelReferences[curModel] > 1) {
+					modelReferences[curModel]--;
+				} else {
+					models.erase(models.begin() + index);
+					forgetModel(curModel);
+
+					curModel->end();
+					delete curModel;
+				}
 			}
 			if (found == false && mustExistInList == true) {
 				throw std::runtime_error("found == false in endLastModel");
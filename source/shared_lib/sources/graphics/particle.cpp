@@ -33,6 +33,83 @@ using namespace Shared::PlatformCommon;
 namespace Shared {
 	namespace Graphics {
 
+		// =====================================================
+		//	class ParticleSystemPool
+		// =====================================================
+
+		ParticleSystemPool::ParticleSystemPool() : mutex(CODE_AT_LINE) {
+		}
+
+		ParticleSystemPool &ParticleSystemPool::getInstance() {
+			static ParticleSystemPool *pool = new ParticleSystemPool();
+			return *pool;
+		}
+
+		void *ParticleSystemPool::allocateSystem(size_t size) {
+			MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+			std::map<size_t, vector<void *> >::iterator iterFind = freeSystems.find(size);
+			if (iterFind != freeSystems.end() && iterFind->second.empty() == false) {
+				void *system = iterFind->second.back();
+				iterFind->second.pop_back();
+				return system;
+			}
+			safeMutex.ReleaseLock();
+
+			return ::operator new(size);
+		}
+
+		void ParticleSystemPool::freeSystem(void *system, size_t size) {
+			if (system == NULL) {
+				return;
+			}
+			MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+			vector<void *> &systems = freeSystems[size];
+			if (systems.size() < maxPooledPerSize) {
+				systems.push_back(system);
+				return;
+			}
+			safeMutex.ReleaseLock();
+
+			::operator delete(system);
+		}
+
+		void ParticleSystemPool::takeParticles(std::vector<Particle> &particles, int particleCount) {
+			particles.clear();
+			if (particleCount > 0) {
+				MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+				std::map<int, vector<std::vector<Particle> > >::iterator iterFind = freeParticles.find(particleCount);
+				if (iterFind != freeParticles.end() && iterFind->second.empty() == false) {
+					particles.swap(iterFind->second.back());
+					iterFind->second.pop_back();
+					return;
+				}
+			}
+			particles.resize(particleCount);
+		}
+
+		void ParticleSystemPool::giveParticles(std::vector<Particle> &particles, int usedCount) {
+			if (particles.empty() == true) {
+				return;
+			}
+			// only the front was ever handed out, the rest is still as
+			// the constructor left it
+			usedCount = min(usedCount, (int) particles.size());
+			if (usedCount > 0) {
+				std::fill(particles.begin(), particles.begin() + usedCount, Particle());
+			}
+
+			MutexSafeWrapper safeMutex(&mutex, CODE_AT_LINE);
+			vector<std::vector<Particle> > &arrays = freeParticles[(int) particles.size()];
+			if (arrays.size() < maxPooledPerSize) {
+				arrays.push_back(std::vector<Particle>());
+				arrays.back().swap(particles);
+				return;
+			}
+			safeMutex.ReleaseLock();
+
+			particles.clear();
+		}
+
 		// =====================================================
 		//	class ParticleSystem
 		// =====================================================
@@ -102,12 +179,11 @@ namespace Shared {
 			//init particle vector
 			blendMode = bmOne;
 			//particles= new Particle[particleCount];
-			particles.clear();
-			//particles.reserve(particleCount);
-			particles.resize(particleCount);
+			ParticleSystemPool::getInstance().takeParticles(particles, particleCount);
 
 			state = sPlay;
 			aliveParticleCount = 0;
+			usedParticleCount = 0;
 			active = true;
 			visible = true;
 
@@ -146,12 +222,22 @@ namespace Shared {
 			}
 
 			//delete [] particles;
-			particles.clear();
+			ParticleSystemPool::getInstance().giveParticles(particles, usedParticleCount);
 
 			delete particleObserver;
 			particleObserver = NULL;
 		}
 
+#ifndef SL_LEAK_DUMP
+		void *ParticleSystem::operator new(size_t size) {
+			return ParticleSystemPool::getInstance().allocateSystem(size);
+		}
+
+		void ParticleSystem::operator delete(void *system, size_t size) {
+			ParticleSystemPool::getInstance().freeSystem(system, size);
+		}
+#endif
+
 		void ParticleSystem::callParticleOwnerEnd(ParticleSystem *particleSystem) {
 			if (this->particleOwner != NULL) {
 				this->particleOwner->end(particleSystem);
@@ -205,20 +291,7 @@ namespace Shared {
 			if (particleSystemStartDelay > 0) {
 				particleSystemStartDelay--;
 			} else if (state != sPause) {
-				for (int i = 0; i < aliveParticleCount; ++i) {
-					updateParticle(&particles[i]);
-
-					if (deathTest(&particles[i])) {
-
-						//kill the particle
-						killParticle(&particles[i]);
-
-						//maintain alive particles at front of the array
-						if (aliveParticleCount > 0) {
-							particles[i] = particles[aliveParticleCount];
-						}
-					}
-				}
+				updateParticles();
 
 				if (state != ParticleSystem::sFade) {
 					emissionState = emissionState + emissionRate;
@@ -467,8 +540,8 @@ namespace Shared {
 		//		particle.saveGame(particleSystemNode);
 		//	}
 
-			particles.clear();
-			particles.resize(particleCount);
+			ParticleSystemPool::getInstance().giveParticles(particles, usedParticleCount);
+			ParticleSystemPool::getInstance().takeParticles(particles, particleCount);
 
 			//	vector<XmlNode *> particleNodeList = particleSystemNode->getChildList("Particle");
 			//	for(unsigned int i = 0; i < particleNodeList.size(); ++i) {
@@ -494,6 +567,7 @@ namespace Shared {
 			visible = particleSystemNode->getAttribute("visible")->getIntValue() != 0;
 			//	int aliveParticleCount;
 			aliveParticleCount = particleSystemNode->getAttribute("aliveParticleCount")->getIntValue();
+			usedParticleCount = aliveParticleCount;
 			//	int particleCount;
 			particleCount = particleSystemNode->getAttribute("particleCount")->getIntValue();
 			//
@@ -585,6 +659,9 @@ namespace Shared {
 			//if any dead particles
 			if (aliveParticleCount < particleCount) {
 				++aliveParticleCount;
+				if (aliveParticleCount > usedParticleCount) {
+					usedParticleCount = aliveParticleCount;
+				}
 				return &particles[aliveParticleCount - 1];
 			}
 
@@ -623,6 +700,23 @@ namespace Shared {
 			return p->energy <= 0;
 		}
 
+		void ParticleSystem::updateParticles() {
+			for (int i = 0; i < aliveParticleCount; ++i) {
+				updateParticle(&particles[i]);
+
+				if (deathTest(&particles[i])) {
+
+					//kill the particle
+					killParticle(&particles[i]);
+
+					//maintain alive particles at front of the array
+					if (aliveParticleCount > 0) {
+						particles[i] = particles[aliveParticleCount];
+					}
+				}
+			}
+		}
+
 		void ParticleSystem::killParticle(Particle *p) {
 			aliveParticleCount--;
 		}
@@ -713,6 +807,10 @@ namespace Shared {
 
 		}
 
+		void FireParticleSystem::updateParticles() {
+			updateParticleArray(this);
+		}
+
 		string FireParticleSystem::toString() const {
 			string result = ParticleSystem::toString();
 
@@ -1327,6 +1425,10 @@ namespace Shared {
 			}
 		}
 
+		void UnitParticleSystem::updateParticles() {
+			updateParticleArray(this);
+		}
+
 		// ================= SET PARAMS ====================
 
 		void UnitParticleSystem::setWind(float windAngle, float windSpeed) {
@@ -1574,6 +1676,10 @@ namespace Shared {
 			return p->pos.y < 0;
 		}
 
+		void RainParticleSystem::updateParticles() {
+			updateParticleArray(this);
+		}
+
 		void RainParticleSystem::setRadius(float radius) {
 			this->radius = radius;
 		}
@@ -1653,6 +1759,10 @@ namespace Shared {
 			return p->pos.y < 0;
 		}
 
+		void SnowParticleSystem::updateParticles() {
+			updateParticleArray(this);
+		}
+
 		void SnowParticleSystem::setRadius(float radius) {
 			this->radius = radius;
 		}
@@ -1957,6 +2067,10 @@ namespace Shared {
 			p->energy--;
 		}
 
+		void ProjectileParticleSystem::updateParticles() {
+			updateParticleArray(this);
+		}
+
 		void ProjectileParticleSystem::setPath(Vec3f startPos, Vec3f endPos) {
 			startPos.x = truncateDecimal<float>(startPos.x, 6);
 			startPos.y = truncateDecimal<float>(startPos.y, 6);
@@ -2271,6 +2385,10 @@ namespace Shared {
 			p->size = truncateDecimal<float>(p->size, 6);
 		}
 
+		void SplashParticleSystem::updateParticles() {
+			updateParticleArray(this);
+		}
+
 		void SplashParticleSystem::saveGame(XmlNode *rootNode) {
 			std::map<string, string> mapTagReplacements;
 			XmlNode *splashParticleSystemNode = rootNode->addChild("SplashParticleSystem");
@@ -15,12 +15,16 @@
 #include <stdexcept>
 #include <cstdio>
 #include <cassert>
+#include <algorithm>
 
 #include "util.h"
 #include "math_util.h"
 #include "randomgen.h"
 #include "FileReader.h"
 #include "ImageReaders.h"
+#include "cooked_asset_cache.h"
+#include "mapped_file.h"
+#include "byte_order.h"
 #include <png.h>
 #include <jpeglib.h>
 #include <setjmp.h>
@@ -29,6 +33,7 @@
 #include "leak_dumper.h"
 
 using namespace Shared::Util;
+using namespace Shared::PlatformCommon;
 using namespace std;
 using namespace Shared::Graphics::Gl;
 
@@ -879,6 +884,45 @@ namespace Shared {
 		//	class Pixmap2D
 		// =====================================================
 
+		// The decoded pixels of an image kept in the cooked asset cache:
+		// width, height and components (4 bytes each, common endian),
+		// then the pixels
+		static const size_t cookedPixmapHeaderSize = 3 * sizeof(int32);
+
+		static bool loadCookedPixmap(const string &entryPath, Pixmap2D *pixmap) {
+			vector<char> data;
+			if (CookedAssetCache::read(entryPath, "PIXM", data) == false ||
+				data.size() < cookedPixmapHeaderSize) {
+				return false;
+			}
+			int32 header[3];
+			memcpy(header, &data.front(), cookedPixmapHeaderSize);
+			int32 w = Shared::PlatformByteOrder::fromCommonEndian(header[0]);
+			int32 h = Shared::PlatformByteOrder::fromCommonEndian(header[1]);
+			int32 components = Shared::PlatformByteOrder::fromCommonEndian(header[2]);
+			if (w <= 0 || h <= 0 || components <= 0 ||
+				data.size() - cookedPixmapHeaderSize != (size_t) w * h * components) {
+				return false;
+			}
+			pixmap->init(w, h, components);
+			memcpy(pixmap->getPixels(), &data.front() + cookedPixmapHeaderSize, pixmap->getPixelByteCount());
+			return true;
+		}
+
+		static void saveCookedPixmap(const string &entryPath, const Pixmap2D *pixmap) {
+			if (pixmap->getPixels() == NULL) {
+				return;
+			}
+			int32 header[3] = {
+				Shared::PlatformByteOrder::toCommonEndian((int32) pixmap->getW()),
+				Shared::PlatformByteOrder::toCommonEndian((int32) pixmap->getH()),
+				Shared::PlatformByteOrder::toCommonEndian((int32) pixmap->getComponents())
+			};
+			string data((const char *) header, cookedPixmapHeaderSize);
+			data.append((const char *) pixmap->getPixels(), pixmap->getPixelByteCount());
+			CookedAssetCache::write(entryPath, "PIXM", data.data(), data.size());
+		}
+
 		// ===================== PUBLIC ========================
 
 		Pixmap2D::Pixmap2D() {
@@ -998,9 +1042,28 @@ namespace Shared {
 		void Pixmap2D::load(const string &path) {
 			//printf("Loading Pixmap2D [%s]\n",path.c_str());
 
+			// The pixels decoded on an earlier run, for the requested
+			// components since the readers convert to them
+			string cookedEntry = "";
+			if (CookedAssetCache::getCookImages() == true && CookedAssetCache::isEnabledFor(path) == true) {
+				MappedFile sourceFile;
+				if (sourceFile.open(path) == true && sourceFile.getSize() > 0) {
+					cookedEntry = CookedAssetCache::getEntryPath("pixmap", sourceFile.getData(), sourceFile.getSize(), intToStr(components));
+					if (loadCookedPixmap(cookedEntry, this) == true) {
+						CalculatePixelsCRC(pixels, getPixelByteCount(), crc);
+						this->path = path;
+						return;
+					}
+				}
+			}
+
 			FileReader<Pixmap2D>::readPath(path, this);
 			CalculatePixelsCRC(pixels, getPixelByteCount(), crc);
 			this->path = path;
+
+			if (cookedEntry != "") {
+				saveCookedPixmap(cookedEntry, this);
+			}
 		}
 
 		void Pixmap2D::save(const string &path) {
@@ -1356,6 +1419,15 @@ namespace Shared {
 			CalculatePixelsCRC(pixels, getPixelByteCount(), crc);
 		}
 
+		void Pixmap2D::swap(Pixmap2D *otherPixmap) {
+			std::swap(h, otherPixmap->h);
+			std::swap(w, otherPixmap->w);
+			std::swap(components, otherPixmap->components);
+			std::swap(pixels, otherPixmap->pixels);
+			path.swap(otherPixmap->path);
+			std::swap(crc, otherPixmap->crc);
+		}
+
 		void Pixmap2D::subCopy(int x, int y, const Pixmap2D *sourcePixmap) {
 			assert(components == sourcePixmap->getComponents());
 
@@ -11,8 +11,10 @@
 
 #include "texture.h"
 #include "util.h"
+#include "conversion.h"
 #include <SDL.h>
 #include "platform_util.h"
+#include "preload_cache.h"
 #include "leak_dumper.h"
 
 using namespace Shared::Util;
@@ -218,6 +220,15 @@ namespace Shared {
 			return result;
 		}
 
+		Shared::PlatformCommon::PreloadCache<Pixmap2D> &Texture2D::getPreloadedPixmaps() {
+			static Shared::PlatformCommon::PreloadCache<Pixmap2D> preloadedPixmaps;
+			return preloadedPixmaps;
+		}
+
+		string Texture2D::getPreloadKey(const string &path, int components) {
+			return path + "_" + intToStr(components);
+		}
+
 		void Texture2D::load(const string &path) {
 			this->path = path;
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem, "In [%s::%s Line: %d] this->path = [%s]\n", __FILE__, __FUNCTION__, __LINE__, this->path.c_str());
@@ -225,7 +236,16 @@ namespace Shared {
 			if (pixmap.getComponents() == -1) {
 				pixmap.init(defaultComponents);
 			}
-			pixmap.load(path);
+			Pixmap2D *preloadedPixmap = NULL;
+			if (getPreloadedPixmaps().isEmpty() == false) {
+				preloadedPixmap = getPreloadedPixmaps().take(getPreloadKey(path, pixmap.getComponents()));
+			}
+			if (preloadedPixmap != NULL) {
+				pixmap.swap(preloadedPixmap);
+				delete preloadedPixmap;
+			} else {
+				pixmap.load(path);
+			}
 			this->path = path;
 		}
 
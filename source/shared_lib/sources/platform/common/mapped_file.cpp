@@ -0,0 +1,137 @@
+//
+//      mapped_file.cpp: read only view of a whole file mapped into memory
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#include "mapped_file.h"
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "platform_util.h"
+#include "leak_dumper.h"
+
+using namespace Shared::Platform;
+
+namespace Shared {
+	namespace PlatformCommon {
+
+		// =====================================================
+		//	class MappedFile
+		// =====================================================
+
+		MappedFile::MappedFile() {
+			data = NULL;
+			size = 0;
+#ifdef WIN32
+			fileHandle = INVALID_HANDLE_VALUE;
+			mappingHandle = NULL;
+#endif
+		}
+
+		MappedFile::~MappedFile() {
+			close();
+		}
+
+		bool MappedFile::open(const string &path) {
+			close();
+
+#ifdef WIN32
+			fileHandle = CreateFileW(utf8_decode(path).c_str(), GENERIC_READ, FILE_SHARE_READ,
+				NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (fileHandle == INVALID_HANDLE_VALUE) {
+				return false;
+			}
+			LARGE_INTEGER fileSize;
+			if (GetFileSizeEx(fileHandle, &fileSize) == FALSE) {
+				close();
+				return false;
+			}
+			size = (size_t) fileSize.QuadPart;
+			if (size == 0) {
+				return true;
+			}
+			mappingHandle = CreateFileMapping(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mappingHandle == NULL) {
+				close();
+				return false;
+			}
+			data = (const char *) MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+			if (data == NULL) {
+				close();
+				return false;
+			}
+#else
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) {
+				return false;
+			}
+			struct stat fileStat;
+			if (fstat(fd, &fileStat) != 0) {
+				::close(fd);
+				return false;
+			}
+			size = (size_t) fileStat.st_size;
+			if (size == 0) {
+				::close(fd);
+				return true;
+			}
+			void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			// the mapping keeps the file, the descriptor isn't needed anymore
+			::close(fd);
+			if (mapping == MAP_FAILED) {
+				size = 0;
+				return false;
+			}
+			madvise(mapping, size, MADV_SEQUENTIAL);
+			data = (const char *) mapping;
+#endif
+			return true;
+		}
+
+		void MappedFile::close() {
+#ifdef WIN32
+			if (data != NULL) {
+				UnmapViewOfFile(data);
+			}
+			if (mappingHandle != NULL) {
+				CloseHandle(mappingHandle);
+				mappingHandle = NULL;
+			}
+			if (fileHandle != INVALID_HANDLE_VALUE) {
+				CloseHandle(fileHandle);
+				fileHandle = INVALID_HANDLE_VALUE;
+			}
+#else
+			if (data != NULL) {
+				munmap((void *) data, size);
+			}
+#endif
+			data = NULL;
+			size = 0;
+		}
+
+	}
+} //end namespace
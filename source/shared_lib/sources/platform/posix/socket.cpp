@@ -45,12 +45,17 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <net/if.h>
 #include <netinet/tcp.h>
 #endif
 
+#if defined(__linux__)
+#include <sys/epoll.h>
+#endif
+
 
 #include <string.h>
 #include <sys/stat.h>
@@ -1416,6 +1421,64 @@ namespace Shared {
 			return static_cast<int>(bytesSent);
 		}
 
+		int Socket::send(const void *const buffers[], const int bufferSizes[], int bufferCount) {
+			if (bufferCount > maxSendBuffers) {
+				char szBuf[8096] = "";
+				snprintf(szBuf, 8096, "In [%s::%s Line: %d] bufferCount = %d, at most %d", __FILE__, __FUNCTION__, __LINE__, bufferCount, maxSendBuffers);
+				throw megaglest_runtime_error(szBuf);
+			}
+
+			int bytesSent = 0;
+#ifndef WIN32
+			// Hand all the parts to the kernel in one call, what doesn't fit
+			// in the socket buffer right now is sent below
+			if (isSocketValid() == true) {
+				struct iovec parts[maxSendBuffers];
+				for (int index = 0; index < bufferCount; ++index) {
+					parts[index].iov_base = const_cast<void *>(buffers[index]);
+					parts[index].iov_len = bufferSizes[index];
+				}
+				struct msghdr message;
+				memset(&message, 0, sizeof(message));
+				message.msg_iov = parts;
+				message.msg_iovlen = bufferCount;
+
+				MutexSafeWrapper safeMutex(dataSynchAccessorWrite, CODE_AT_LINE);
+				if (isSocketValid() == true) {
+#ifdef __APPLE__
+					ssize_t result = ::sendmsg(sock, &message, SO_NOSIGPIPE);
+#else
+					ssize_t result = ::sendmsg(sock, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
+					if (result > 0) {
+						bytesSent = static_cast<int>(result);
+					}
+				}
+				safeMutex.ReleaseLock();
+			}
+#endif
+
+			// The rest part by part, waiting and retrying like any send
+			int alreadySent = bytesSent;
+			for (int index = 0; index < bufferCount; ++index) {
+				if (alreadySent >= bufferSizes[index]) {
+					alreadySent -= bufferSizes[index];
+					continue;
+				}
+				int partSize = bufferSizes[index] - alreadySent;
+				int partSent = send(static_cast<const char *>(buffers[index]) + alreadySent, partSize);
+				if (partSent != partSize) {
+					return (partSent > 0 ? bytesSent + partSent : partSent);
+				}
+				bytesSent += partSent;
+				alreadySent = 0;
+			}
+
+			if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d] sock = %d, bufferCount = %d, bytesSent = %d\n", __FILE__, __FUNCTION__, __LINE__, sock, bufferCount, bytesSent);
+
+			return bytesSent;
+		}
+
 		int Socket::receive(void *data, int dataSize, bool tryReceiveUntilDataSizeMet) {
 			ssize_t bytesReceived = 0;
 
@@ -1537,6 +1600,109 @@ namespace Shared {
 			Restore();
 		}
 
+		// ===============================================
+		//	class SocketReactor
+		// ===============================================
+
+		SocketReactor::SocketReactor() {
+#if defined(__linux__)
+			pollId = epoll_create1(EPOLL_CLOEXEC);
+			if (pollId < 0) {
+				SystemFlags::OutputDebug(SystemFlags::debugError, "In [%s::%s Line: %d] epoll_create1 failed, error = %s\n", __FILE__, __FUNCTION__, __LINE__, Socket::getLastSocketErrorFormattedText().c_str());
+			}
+#else
+			pollId = -1;
+#endif
+		}
+
+		SocketReactor::~SocketReactor() {
+#if defined(__linux__)
+			if (pollId >= 0) {
+				::close(pollId);
+			}
+#endif
+			pollId = -1;
+		}
+
+		bool SocketReactor::isSupported() {
+#if defined(__linux__)
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		bool SocketReactor::addSocket(PLATFORM_SOCKET socket, int tag) {
+			if (isOpen() == false || Socket::isSocketValid(&socket) == false) {
+				return false;
+			}
+#if defined(__linux__)
+			struct epoll_event event;
+			memset(&event, 0, sizeof(event));
+			event.events = EPOLLIN | EPOLLRDHUP;
+			event.data.u64 = (uint64) socket;
+
+			// a closed socket drops out of the epoll set by itself, so a
+			// socket we still know about may have to be added again
+			int result = epoll_ctl(pollId, EPOLL_CTL_ADD, socket, &event);
+			if (result < 0 && errno == EEXIST) {
+				result = epoll_ctl(pollId, EPOLL_CTL_MOD, socket, &event);
+			}
+			if (result < 0) {
+				if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d] epoll_ctl add socket " PLATFORM_SOCKET_FORMAT_TYPE " failed, error = %s\n", __FILE__, __FUNCTION__, __LINE__, socket, Socket::getLastSocketErrorFormattedText().c_str());
+				return false;
+			}
+			socketTags[socket] = tag;
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		void SocketReactor::removeSocket(PLATFORM_SOCKET socket) {
+			std::map<PLATFORM_SOCKET, int>::iterator iterFind = socketTags.find(socket);
+			if (iterFind == socketTags.end()) {
+				return;
+			}
+			socketTags.erase(iterFind);
+#if defined(__linux__)
+			if (isOpen() == true) {
+				// fails harmlessly when the socket was already closed
+				struct epoll_event event;
+				memset(&event, 0, sizeof(event));
+				epoll_ctl(pollId, EPOLL_CTL_DEL, socket, &event);
+			}
+#endif
+		}
+
+		int SocketReactor::waitForData(std::vector<int> &readyTags, int waitMilliseconds) {
+			readyTags.clear();
+			if (isOpen() == false) {
+				return 0;
+			}
+#if defined(__linux__)
+			static const int maxEvents = 64;
+			struct epoll_event events[maxEvents];
+			int count = epoll_wait(pollId, events, maxEvents, waitMilliseconds);
+			if (count < 0) {
+				if (errno != EINTR) {
+					if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork, "In [%s::%s Line: %d] epoll_wait failed, error = %s\n", __FILE__, __FUNCTION__, __LINE__, Socket::getLastSocketErrorFormattedText().c_str());
+				}
+				return 0;
+			}
+			for (int index = 0; index < count; ++index) {
+				std::map<PLATFORM_SOCKET, int>::iterator iterFind =
+					socketTags.find((PLATFORM_SOCKET) events[index].data.u64);
+				if (iterFind != socketTags.end()) {
+					readyTags.push_back(iterFind->second);
+				}
+			}
+			return (int) readyTags.size();
+#else
+			return 0;
+#endif
+		}
+
 		int Socket::peek(void *data, int dataSize, bool mustGetData, int *pLastSocketError) {
 			Chrono chrono;
 			if (SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) chrono.start();
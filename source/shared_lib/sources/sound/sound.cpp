@@ -14,6 +14,7 @@
 #include <fstream>
 #include <stdexcept>
 #include "util.h"
+#include "preload_cache.h"
 #include "leak_dumper.h"
 
 using namespace Shared::Util;
@@ -71,7 +72,29 @@ namespace Shared {
 			}
 		}
 
+		Shared::PlatformCommon::PreloadCache<StaticSound> &StaticSound::getPreloaded() {
+			static Shared::PlatformCommon::PreloadCache<StaticSound> preloaded;
+			return preloaded;
+		}
+
 		void StaticSound::load(const string &path) {
+			if (GlobalStaticFlags::getIsNonGraphicalModeEnabled() == false &&
+				getPreloaded().isEmpty() == false) {
+				StaticSound *preloadedSound = getPreloaded().take(path);
+				if (preloadedSound != NULL) {
+					close();
+					fileName = path;
+					info = preloadedSound->info;
+					samples = preloadedSound->samples;
+					preloadedSound->samples = NULL;
+					delete preloadedSound;
+					return;
+				}
+			}
+			loadFile(path);
+		}
+
+		void StaticSound::loadFile(const string &path) {
 			close();
 
 			fileName = path;
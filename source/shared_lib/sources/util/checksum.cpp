@@ -77,6 +77,46 @@ namespace Shared {
 			0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 		};
 
+		// The crc_table above extended to slicing-by-8: table[k][n] is
+		// the crc of byte n followed by k zero bytes, so 8 bytes are taken
+		// with 8 lookups that don't depend on each other
+		class ChecksumTables {
+		public:
+			uint32 table[8][256];
+
+			ChecksumTables() {
+				for (int n = 0; n < 256; ++n) {
+					table[0][n] = crc_table[n];
+				}
+				for (int n = 0; n < 256; ++n) {
+					for (int k = 1; k < 8; ++k) {
+						uint32 previous = table[k - 1][n];
+						table[k][n] = (previous >> 8) ^ table[0][previous & 0xff];
+					}
+				}
+			}
+		};
+
+		static const uint32(*getChecksumTables())[256] {
+			static ChecksumTables tables;
+			return tables.table;
+		}
+
+		static inline uint32 crcWord(const uint32(*table)[256], uint32 crc, uint32 word) {
+			crc ^= word;
+			return table[3][crc & 0xff] ^ table[2][(crc >> 8) & 0xff] ^
+				table[1][(crc >> 16) & 0xff] ^ table[0][crc >> 24];
+		}
+
+		static inline uint32 crcDoubleWord(const uint32(*table)[256], uint32 crc,
+			uint32 low, uint32 high) {
+			crc ^= low;
+			return table[7][crc & 0xff] ^ table[6][(crc >> 8) & 0xff] ^
+				table[5][(crc >> 16) & 0xff] ^ table[4][crc >> 24] ^
+				table[3][high & 0xff] ^ table[2][(high >> 8) & 0xff] ^
+				table[1][(high >> 16) & 0xff] ^ table[0][high >> 24];
+		}
+
 		Checksum::Checksum() {
 			sum = 0;
 			r = 55665;
@@ -102,9 +142,17 @@ namespace Shared {
 
 		uint32 Checksum::addBytes(const void *_data, size_t _size) {
 			const unsigned char *rVal = reinterpret_cast<const unsigned char *>(_data);
+			const uint32(*table)[256] = getChecksumTables();
 			sum = ~sum;
+			// Words are assembled byte by byte so the result doesn't depend
+			// on the alignment or the byte order of the data
+			for (; _size >= 8; _size -= 8, rVal += 8) {
+				uint32 low = rVal[0] | (rVal[1] << 8) | (rVal[2] << 16) | ((uint32) rVal[3] << 24);
+				uint32 high = rVal[4] | (rVal[5] << 8) | (rVal[6] << 16) | ((uint32) rVal[7] << 24);
+				sum = crcDoubleWord(table, sum, low, high);
+			}
 			while (_size--) {
-				sum = (sum >> 8) ^ crc_table[*rVal++ ^ (sum & 0xff)];
+				sum = (sum >> 8) ^ table[0][*rVal++ ^ (sum & 0xff)];
 			}
 			sum = ~sum;
 
@@ -116,57 +164,28 @@ namespace Shared {
 			sum += value;
 		}
 
+		// The integers are added low byte first, as addByte would one at a time
 		uint32 Checksum::addInt(const int32 &value) {
-			int8 byte = (value >> 0) & 0xFF;
-			addByte(byte);
-			byte = (value >> 8) & 0xFF;
-			addByte(byte);
-			byte = (value >> 16) & 0xFF;
-			addByte(byte);
-			byte = (value >> 24) & 0xFF;
-			addByte(byte);
+			sum = ~crcWord(getChecksumTables(), ~sum, (uint32) value);
 
 			return sum;
 		}
 
 		uint32 Checksum::addUInt(const uint32 &value) {
-			int8 byte = (value >> 0) & 0xFF;
-			addByte(byte);
-			byte = (value >> 8) & 0xFF;
-			addByte(byte);
-			byte = (value >> 16) & 0xFF;
-			addByte(byte);
-			byte = (value >> 24) & 0xFF;
-			addByte(byte);
+			sum = ~crcWord(getChecksumTables(), ~sum, value);
 
 			return sum;
 		}
 
 		uint32 Checksum::addInt64(const int64 &value) {
-			int8 byte = (value >> 0) & 0xFF;
-			addByte(byte);
-			byte = (value >> 8) & 0xFF;
-			addByte(byte);
-			byte = (value >> 16) & 0xFF;
-			addByte(byte);
-			byte = (value >> 24) & 0xFF;
-			addByte(byte);
-			byte = (value >> 32) & 0xFF;
-			addByte(byte);
-			byte = (value >> 40) & 0xFF;
-			addByte(byte);
-			byte = (value >> 48) & 0xFF;
-			addByte(byte);
-			byte = (value >> 56) & 0xFF;
-			addByte(byte);
+			sum = ~crcDoubleWord(getChecksumTables(), ~sum, (uint32) value,
+				(uint32) ((uint64) value >> 32));
 
 			return sum;
 		}
 
 		void Checksum::addString(const string &value) {
-			for (unsigned int i = 0; i < value.size(); ++i) {
-				addByte(value[i]);
-			}
+			addBytes(value.data(), value.size());
 		}
 
 		void Checksum::addFile(const string &path) {
@@ -175,6 +194,10 @@ namespace Shared {
 			}
 		}
 
+		void Checksum::addFileList(const Checksum &other) {
+			fileList.insert(other.fileList.begin(), other.fileList.end());
+		}
+
 		bool Checksum::addFileToSum(const string &path) {
 
 			// OLD SLOW FILE I/O
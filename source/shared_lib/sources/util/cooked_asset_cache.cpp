@@ -0,0 +1,288 @@
+//
+//      cooked_asset_cache.cpp: parsed and decoded game files kept on disk
+//                              between runs
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#include "cooked_asset_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+#include "checksum.h"
+#include "conversion.h"
+#include "thread.h"
+#include "platform_common.h"
+#include "platform_util.h"
+#include "byte_order.h"
+#include "util.h"
+#include "leak_dumper.h"
+
+using namespace Shared::Platform;
+using namespace Shared::PlatformCommon;
+
+namespace Shared {
+	namespace Util {
+
+		static const char cookedMagic[] = "ZGCA";
+		static const size_t cookedMagicSize = 4;
+		static const size_t cookedKindSize = 4;
+		static const size_t cookedHeaderSize = cookedMagicSize + sizeof(uint32) + cookedKindSize;
+
+		// Threads writing the same entry each use their own temporary file
+		static Mutex cookedTempFileMutex(CODE_AT_LINE);
+		static uint32 cookedTempFileCount = 0;
+
+		// Models and images are loaded by several threads at once
+		static Mutex cookedStatsMutex(CODE_AT_LINE);
+
+		struct CookedEntryFile {
+			string path;
+			int64 size;
+			time_t lastUsed;
+
+			bool operator<(const CookedEntryFile &other) const {
+				return lastUsed < other.lastUsed;
+			}
+		};
+
+		static bool statCookedEntry(const string &entryPath, int64 &size, time_t &lastUsed) {
+#ifdef WIN32
+#if defined(__MINGW32__)
+			struct _stat stbuf;
+#else
+			struct _stat64i32 stbuf;
+#endif
+			if (_wstat(utf8_decode(entryPath).c_str(), &stbuf) == -1) {
+#else
+			struct stat stbuf;
+			if (stat(entryPath.c_str(), &stbuf) == -1) {
+#endif
+				return false;
+			}
+			size = stbuf.st_size;
+			lastUsed = stbuf.st_mtime;
+			return true;
+		}
+
+		static void touchCookedEntry(const string &entryPath) {
+#ifdef WIN32
+			_wutime(utf8_decode(entryPath).c_str(), NULL);
+#else
+			utime(entryPath.c_str(), NULL);
+#endif
+		}
+
+		// =====================================================
+		//	class CookedAssetCache
+		// =====================================================
+
+		string CookedAssetCache::path = "";
+		vector<string> CookedAssetCache::sourcePaths;
+		bool CookedAssetCache::cookImages = false;
+		CookedAssetCache::Stats CookedAssetCache::stats = { 0, 0, 0, 0, 0, 0, 0 };
+
+		void CookedAssetCache::setPath(const string &value, const vector<string> &sourcePaths, int64 maxBytes) {
+			path = value;
+			CookedAssetCache::sourcePaths.clear();
+			if (path != "") {
+				endPathWithSlash(path);
+				if (isdir(path.c_str()) == false) {
+					createDirectoryPaths(path);
+				}
+				for (unsigned int i = 0; i < sourcePaths.size(); ++i) {
+					string sourcePath = sourcePaths[i];
+					endPathWithSlash(sourcePath);
+					CookedAssetCache::sourcePaths.push_back(sourcePath);
+				}
+				if (maxBytes > 0) {
+					prune(maxBytes);
+				}
+			}
+		}
+
+		int CookedAssetCache::prune(int64 maxBytes) {
+			if (path == "") {
+				return 0;
+			}
+
+			vector<string> entryPaths = getFolderTreeContentsListRecursively(path, ".cooked");
+			vector<CookedEntryFile> entries;
+			int64 totalBytes = 0;
+			for (unsigned int i = 0; i < entryPaths.size(); ++i) {
+				CookedEntryFile entry;
+				entry.path = entryPaths[i];
+				if (statCookedEntry(entry.path, entry.size, entry.lastUsed) == true) {
+					totalBytes += entry.size;
+					entries.push_back(entry);
+				}
+			}
+			if (totalBytes <= maxBytes) {
+				return 0;
+			}
+
+			std::sort(entries.begin(), entries.end());
+			int removedCount = 0;
+			for (unsigned int i = 0; i < entries.size() && totalBytes > maxBytes; ++i) {
+				if (removeFile(entries[i].path) == true) {
+					totalBytes -= entries[i].size;
+					removedCount++;
+				}
+			}
+
+			if (SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem, "In [%s::%s Line: %d] removed %d cooked assets, " MG_I64_SPECIFIER " bytes are left\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, removedCount, totalBytes);
+			return removedCount;
+		}
+
+		bool CookedAssetCache::isEnabledFor(const string &sourceFile) {
+			if (path == "") {
+				return false;
+			}
+			for (unsigned int i = 0; i < sourcePaths.size(); ++i) {
+				if (StartsWith(sourceFile, sourcePaths[i]) == true) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		string CookedAssetCache::getEntryPath(const string &prefix, const char *sourceData, size_t sourceSize, const string &variant) {
+			Chrono chrono(true);
+			Checksum checksum;
+			checksum.addBytes(sourceData, sourceSize);
+			int64 checksumMicros = chrono.getMicros();
+
+			MutexSafeWrapper safeMutex(&cookedStatsMutex, CODE_AT_LINE);
+			stats.checksumMicros += checksumMicros;
+			safeMutex.ReleaseLock();
+
+			string result = path + prefix + "_" + uIntToStr(checksum.getSum()) + "_" + uIntToStr((uint32) sourceSize);
+			if (variant != "") {
+				result += "_" + variant;
+			}
+			return result + ".cooked";
+		}
+
+		bool CookedAssetCache::read(const string &entryPath, const char *kind, vector<char> &data) {
+			Chrono chrono(true);
+#ifdef WIN32
+			FILE *fp = _wfopen(utf8_decode(entryPath).c_str(), L"rb");
+#else
+			FILE *fp = fopen(entryPath.c_str(), "rb");
+#endif
+			if (fp == NULL) {
+				MutexSafeWrapper safeMutex(&cookedStatsMutex, CODE_AT_LINE);
+				stats.misses++;
+				return false;
+			}
+
+			bool result = false;
+			char header[cookedHeaderSize];
+			if (fread(header, cookedHeaderSize, 1, fp) == 1 &&
+				memcmp(header, cookedMagic, cookedMagicSize) == 0 &&
+				memcmp(header + cookedMagicSize + sizeof(uint32), kind, cookedKindSize) == 0) {
+				uint32 fileVersion = 0;
+				memcpy(&fileVersion, header + cookedMagicSize, sizeof(fileVersion));
+				fileVersion = Shared::PlatformByteOrder::fromCommonEndian(fileVersion);
+
+				if (fileVersion == version && fseek(fp, 0, SEEK_END) == 0) {
+					long fileSize = ftell(fp);
+					if (fileSize > (long) cookedHeaderSize && fseek(fp, (long) cookedHeaderSize, SEEK_SET) == 0) {
+						data.resize((size_t) fileSize - cookedHeaderSize);
+						result = fread(&data.front(), data.size(), 1, fp) == 1;
+					}
+				}
+			}
+			fclose(fp);
+			if (result == true) {
+				// the modification time is when the entry was last used
+				touchCookedEntry(entryPath);
+			}
+			int64 readMicros = chrono.getMicros();
+
+			MutexSafeWrapper safeMutex(&cookedStatsMutex, CODE_AT_LINE);
+			if (result == true) {
+				stats.hits++;
+			} else {
+				stats.misses++;
+			}
+			stats.readMicros += readMicros;
+			return result;
+		}
+
+		void CookedAssetCache::write(const string &entryPath, const char *kind, const char *data, size_t size) {
+			Chrono chrono(true);
+			MutexSafeWrapper safeMutex(&cookedTempFileMutex, CODE_AT_LINE);
+			string tempPath = entryPath + ".tmp" + uIntToStr(cookedTempFileCount++);
+			safeMutex.ReleaseLock();
+
+#ifdef WIN32
+			FILE *fp = _wfopen(utf8_decode(tempPath).c_str(), L"wb");
+#else
+			FILE *fp = fopen(tempPath.c_str(), "wb");
+#endif
+			if (fp == NULL) {
+				return;
+			}
+
+			char header[cookedHeaderSize];
+			memcpy(header, cookedMagic, cookedMagicSize);
+			uint32 fileVersion = Shared::PlatformByteOrder::toCommonEndian(version);
+			memcpy(header + cookedMagicSize, &fileVersion, sizeof(fileVersion));
+			memcpy(header + cookedMagicSize + sizeof(uint32), kind, cookedKindSize);
+
+			bool written = fwrite(header, 1, cookedHeaderSize, fp) == cookedHeaderSize &&
+				fwrite(data, 1, size, fp) == size;
+			if (fclose(fp) != 0 || written == false) {
+				removeFile(tempPath);
+				return;
+			}
+			// Readers only ever see a whole entry or none
+			if (renameFile(tempPath, entryPath) == false) {
+				removeFile(tempPath);
+				return;
+			}
+			int64 writeMicros = chrono.getMicros();
+
+			MutexSafeWrapper safeStatsMutex(&cookedStatsMutex, CODE_AT_LINE);
+			stats.writes++;
+			stats.writeMicros += writeMicros;
+			stats.writtenBytes += (int64) (cookedHeaderSize + size);
+		}
+
+		CookedAssetCache::Stats CookedAssetCache::getStats() {
+			MutexSafeWrapper safeMutex(&cookedStatsMutex, CODE_AT_LINE);
+			return stats;
+		}
+
+		void CookedAssetCache::resetStats() {
+			MutexSafeWrapper safeMutex(&cookedStatsMutex, CODE_AT_LINE);
+			memset(&stats, 0, sizeof(stats));
+		}
+
+	}
+} //end namespace
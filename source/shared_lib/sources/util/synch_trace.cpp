@@ -0,0 +1,151 @@
+//
+//      synch_trace.cpp: binary trace of the world synch events of the simulation
+//
+//      This file is part of ZetaGlest <https://github.com/ZetaGlest>
+//
+//      Copyright (C) 2018  The ZetaGlest team
+//
+//      ZetaGlest is a fork of MegaGlest <https://megaglest.org>
+//
+//      This program is free software: you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation, either version 3 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program.  If not, see <https://www.gnu.org/licenses/>
+
+#include "synch_trace.h"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include "byte_order.h"
+#include "platform_util.h"
+#include "util.h"
+#include "leak_dumper.h"
+
+using namespace std;
+
+namespace Shared {
+	namespace Util {
+
+		// =====================================================
+		//	class SynchTrace
+		// =====================================================
+
+		// File layout, all values 32 bit little endian:
+		//   "ZGST" version eventCount
+		//   eventCount times: code nameLength name
+		//   recordCount
+		//   recordCount times: frame unitId code arg0 arg1 arg2 arg3
+		static const char synchTraceMagic[] = "ZGST";
+		static const int32 synchTraceVersion = 1;
+
+		const int SynchTrace::capacity = 65536;
+
+		Mutex SynchTrace::mutex;
+		vector<SynchTraceRecord> SynchTrace::records;
+		int64 SynchTrace::recordCount = 0;
+		int SynchTrace::frame = 0;
+		bool SynchTrace::enabled = false;
+
+		void SynchTrace::setEnabled(bool value) {
+			MutexSafeWrapper safeMutex(&mutex);
+			if (value == true && records.empty() == true) {
+				records.resize(capacity);
+			}
+			enabled = value;
+		}
+
+		void SynchTrace::add(int unitId, const char *event, int arg0, int arg1, int arg2, int arg3) {
+			MutexSafeWrapper safeMutex(&mutex);
+			if (records.empty() == true) {
+				return;
+			}
+			SynchTraceRecord &record = records[recordCount % capacity];
+			record.frame = frame;
+			record.unitId = unitId;
+			record.event = event;
+			record.args[0] = arg0;
+			record.args[1] = arg1;
+			record.args[2] = arg2;
+			record.args[3] = arg3;
+			recordCount++;
+		}
+
+		void SynchTrace::clear() {
+			MutexSafeWrapper safeMutex(&mutex);
+			recordCount = 0;
+		}
+
+		int SynchTrace::getCount() {
+			MutexSafeWrapper safeMutex(&mutex);
+			return (int) (recordCount < capacity ? recordCount : capacity);
+		}
+
+		static void writeSynchTraceInt(FILE *fp, int32 value) {
+			value = Shared::PlatformByteOrder::toCommonEndian(value);
+			fwrite(&value, sizeof(value), 1, fp);
+		}
+
+		bool SynchTrace::save(const string &path) {
+			MutexSafeWrapper safeMutex(&mutex);
+
+#ifdef WIN32
+			FILE *fp = _wfopen(utf8_decode(path).c_str(), L"wb");
+#else
+			FILE *fp = fopen(path.c_str(), "wb");
+#endif
+			if (fp == NULL) {
+				return false;
+			}
+
+			int count = (int) (recordCount < capacity ? recordCount : capacity);
+			int64 first = recordCount - count;
+
+			// events are identified by their literal, number them in the order
+			// they first appear
+			std::map<const char *, int32> eventCodes;
+			vector<const char *> events;
+			for (int64 i = first; i < recordCount; ++i) {
+				const char *event = records[i % capacity].event;
+				if (eventCodes.find(event) == eventCodes.end()) {
+					eventCodes[event] = (int32) events.size();
+					events.push_back(event);
+				}
+			}
+
+			fwrite(synchTraceMagic, 1, 4, fp);
+			writeSynchTraceInt(fp, synchTraceVersion);
+			writeSynchTraceInt(fp, (int32) events.size());
+			for (unsigned int i = 0; i < events.size(); ++i) {
+				int32 length = (int32) strlen(events[i]);
+				writeSynchTraceInt(fp, (int32) i);
+				writeSynchTraceInt(fp, length);
+				fwrite(events[i], 1, length, fp);
+			}
+
+			writeSynchTraceInt(fp, count);
+			for (int64 i = first; i < recordCount; ++i) {
+				const SynchTraceRecord &record = records[i % capacity];
+				writeSynchTraceInt(fp, record.frame);
+				writeSynchTraceInt(fp, record.unitId);
+				writeSynchTraceInt(fp, eventCodes[record.event]);
+				for (int j = 0; j < SynchTraceRecord::maxArgs; ++j) {
+					writeSynchTraceInt(fp, record.args[j]);
+				}
+			}
+
+			bool result = (ferror(fp) == 0);
+			fclose(fp);
+			return result;
+		}
+
+	}
+} //end namespace
@@ -32,8 +32,11 @@
 #include "platform_common.h"
 #include "platform_util.h"
 #include "cache_manager.h"
+#include "preload_cache.h"
+#include "cooked_asset_cache.h"
 
 #include "rapidxml/rapidxml_print.hpp"
+#include "byte_order.h"
 #include "leak_dumper.h"
 
 #if defined(WANT_XERCES)
@@ -387,18 +390,44 @@ namespace Shared {
 
 				if (showPerfStats) printf("In [%s::%s Line: %d] took msecs: " MG_I64_SPECIFIER "\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, chrono.getMillis());
 
-				// This is required because rapidxml seems to choke when we load lua
-				// scenarios that have lua + xml style comments
-				replaceAllBetweenTokens(buffer, "<!--", "-->", "", true);
+				// Saved games may be written in the binary form
+				if (XmlIoBinary::isBinaryData(&buffer.front(), (size_t) file_size) == true) {
+					rootNode = XmlIoBinary::load(&buffer.front(), (size_t) file_size, path, mapTagReplacementValues, skipUpdatePathClimbingParts);
+				} else {
+					// The file as an earlier run parsed it, in the binary form
+					string cookedEntry = "";
+					if (CookedAssetCache::isEnabledFor(path) == true) {
+						cookedEntry = CookedAssetCache::getEntryPath("xml", &buffer.front(), (size_t) file_size);
+						vector<char> cooked;
+						if (CookedAssetCache::read(cookedEntry, "XMLT", cooked) == true) {
+							try {
+								rootNode = XmlIoBinary::load(&cooked.front(), cooked.size(), path, mapTagReplacementValues, skipUpdatePathClimbingParts);
+							} catch (const exception &) {
+								rootNode = NULL;
+							}
+						}
+					}
 
-				if (showPerfStats) printf("In [%s::%s Line: %d] took msecs: " MG_I64_SPECIFIER "\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, chrono.getMillis());
+					if (rootNode == NULL) {
+						// This is required because rapidxml seems to choke when we load lua
+						// scenarios that have lua + xml style comments
+						replaceAllBetweenTokens(buffer, "<!--", "-->", "", true);
 
-				xml_document<> doc;
-				doc.parse<parse_no_data_nodes | parse_validate_closing_tags>(&buffer.front());
+						if (showPerfStats) printf("In [%s::%s Line: %d] took msecs: " MG_I64_SPECIFIER "\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, chrono.getMillis());
 
-				if (showPerfStats) printf("In [%s::%s Line: %d] took msecs: " MG_I64_SPECIFIER "\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, chrono.getMillis());
+						xml_document<> doc;
+						doc.parse<parse_no_data_nodes | parse_validate_closing_tags>(&buffer.front());
+
+						if (showPerfStats) printf("In [%s::%s Line: %d] took msecs: " MG_I64_SPECIFIER "\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, chrono.getMillis());
+
+						rootNode = new XmlNode(doc.first_node(), mapTagReplacementValues, skipUpdatePathClimbingParts);
 
-				rootNode = new XmlNode(doc.first_node(), mapTagReplacementValues, skipUpdatePathClimbingParts);
+						if (cookedEntry != "") {
+							string cooked = XmlIoBinary::encode(doc.first_node());
+							CookedAssetCache::write(cookedEntry, "XMLT", cooked.data(), cooked.size());
+						}
+					}
+				}
 
 				if (showPerfStats) printf("In [%s::%s Line: %d] took msecs: " MG_I64_SPECIFIER "\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, chrono.getMillis());
 
@@ -498,6 +527,299 @@ namespace Shared {
 			}
 		}
 
+		// =====================================================
+		//	class XmlIoBinary
+		// =====================================================
+
+		static const char binaryXmlMagic[] = "ZGXB";
+		static const size_t binaryXmlMagicSize = 4;
+		static const size_t binaryXmlHeaderSize = binaryXmlMagicSize + sizeof(uint32);
+
+		static void binaryXmlWriteVarUInt(string &out, uint64 value) {
+			for (; value >= 0x80; value >>= 7) {
+				out += (char) ((value & 0x7F) | 0x80);
+			}
+			out += (char) value;
+		}
+
+		static void binaryXmlWriteString(string &out, std::map<string, uint32> &stringIndex,
+			vector<const string *> &stringTable, const string &value) {
+			std::pair<std::map<string, uint32>::iterator, bool> inserted =
+				stringIndex.insert(std::make_pair(value, (uint32) stringTable.size()));
+			if (inserted.second == true) {
+				stringTable.push_back(&inserted.first->first);
+			}
+			binaryXmlWriteVarUInt(out, inserted.first->second);
+		}
+
+		static void binaryXmlWriteNode(string &out, std::map<string, uint32> &stringIndex,
+			vector<const string *> &stringTable, const XmlNode *node) {
+			binaryXmlWriteString(out, stringIndex, stringTable, node->getName());
+			binaryXmlWriteString(out, stringIndex, stringTable, node->getText());
+
+			binaryXmlWriteVarUInt(out, node->getAttributeCount());
+			for (unsigned int i = 0; i < node->getAttributeCount(); ++i) {
+				XmlAttribute *attr = node->getAttribute(i);
+				binaryXmlWriteString(out, stringIndex, stringTable, attr->getName());
+				binaryXmlWriteString(out, stringIndex, stringTable, attr->getValue("", false));
+			}
+
+			binaryXmlWriteVarUInt(out, node->getChildCount());
+			for (unsigned int i = 0; i < node->getChildCount(); ++i) {
+				binaryXmlWriteNode(out, stringIndex, stringTable, node->getChild(i));
+			}
+		}
+
+		// The nodes as rapidxml parsed them, the values are written before
+		// the tag replacement that XmlNode applies so loading them gives
+		// what parsing the xml with any replacement values would
+		static void binaryXmlWriteRawNode(string &out, std::map<string, uint32> &stringIndex,
+			vector<const string *> &stringTable, xml_node<> *node) {
+			vector<xml_node<> *> children;
+			for (xml_node<> *currentNode = node->first_node();
+				currentNode; currentNode = currentNode->next_sibling()) {
+				if (currentNode->type() == node_element) {
+					children.push_back(currentNode);
+				}
+			}
+
+			binaryXmlWriteString(out, stringIndex, stringTable, node->name());
+			binaryXmlWriteString(out, stringIndex, stringTable, children.empty() == true ? node->value() : "");
+
+			vector<xml_attribute<> *> attributes;
+			for (xml_attribute<> *attr = node->first_attribute(); attr; attr = attr->next_attribute()) {
+				attributes.push_back(attr);
+			}
+			binaryXmlWriteVarUInt(out, attributes.size());
+			for (unsigned int i = 0; i < attributes.size(); ++i) {
+				binaryXmlWriteString(out, stringIndex, stringTable, attributes[i]->name());
+				binaryXmlWriteString(out, stringIndex, stringTable, attributes[i]->value());
+			}
+
+			binaryXmlWriteVarUInt(out, children.size());
+			for (unsigned int i = 0; i < children.size(); ++i) {
+				binaryXmlWriteRawNode(out, stringIndex, stringTable, children[i]);
+			}
+		}
+
+		static string binaryXmlWriteHeader(const vector<const string *> &stringTable) {
+			string header(binaryXmlMagic, binaryXmlMagicSize);
+			uint32 fileVersion = Shared::PlatformByteOrder::toCommonEndian(XmlIoBinary::version);
+			header.append((const char *) &fileVersion, sizeof(fileVersion));
+			binaryXmlWriteVarUInt(header, stringTable.size());
+			for (unsigned int i = 0; i < stringTable.size(); ++i) {
+				binaryXmlWriteVarUInt(header, stringTable[i]->size());
+				header += *stringTable[i];
+			}
+			return header;
+		}
+
+		class XmlIoBinary::Reader {
+		private:
+			const char *data;
+			size_t size;
+			size_t pos;
+			const string &path;
+			const std::map<string, string> &mapTagReplacementValues;
+			bool skipUpdatePathClimbingParts;
+			vector<string> stringTable;
+
+			void throwCorrupt() const {
+				throw megaglest_runtime_error("Binary XML file is corrupt: [" + path + "] at offset " + intToStr((int64) pos), true);
+			}
+
+			uint64 readVarUInt() {
+				uint64 value = 0;
+				for (int shift = 0; shift < 64; shift += 7) {
+					if (pos >= size) {
+						throwCorrupt();
+					}
+					unsigned char byte = (unsigned char) data[pos++];
+					value |= (uint64) (byte & 0x7F) << shift;
+					if ((byte & 0x80) == 0) {
+						return value;
+					}
+				}
+				throwCorrupt();
+				return 0;
+			}
+
+			const string &readString() {
+				uint64 index = readVarUInt();
+				if (index >= stringTable.size()) {
+					throwCorrupt();
+				}
+				return stringTable[(size_t) index];
+			}
+
+			// Every entry takes at least one byte so no count can be
+			// larger than what is left of the data
+			uint64 readCount() {
+				uint64 count = readVarUInt();
+				if (count > size - pos) {
+					throwCorrupt();
+				}
+				return count;
+			}
+
+			// Fills node, which the caller owns already so nothing
+			// leaks when the data turns out to be corrupt
+			void readNode(XmlNode *node, int depth) {
+				if (depth > XmlIoBinary::maxDepth) {
+					throwCorrupt();
+				}
+				node->name = readString();
+				node->text = readString();
+				if (node->text.empty() == false) {
+					Properties::applyTagsToValue(node->text, &mapTagReplacementValues, skipUpdatePathClimbingParts);
+				}
+
+				uint64 attributeCount = readCount();
+				node->attributes.reserve((size_t) attributeCount);
+				for (uint64 i = 0; i < attributeCount; ++i) {
+					const string &attributeName = readString();
+					const string &attributeValue = readString();
+					node->addAttribute(attributeName, attributeValue, mapTagReplacementValues);
+				}
+
+				uint64 childCount = readCount();
+				node->children.reserve((size_t) childCount);
+				for (uint64 i = 0; i < childCount; ++i) {
+					XmlNode *child = new XmlNode("");
+					node->children.push_back(child);
+					readNode(child, depth + 1);
+				}
+			}
+
+		public:
+			Reader(const char *data, size_t size, const string &path,
+				const std::map<string, string> &mapTagReplacementValues, bool skipUpdatePathClimbingParts) :
+				data(data), size(size), pos(0), path(path),
+				mapTagReplacementValues(mapTagReplacementValues),
+				skipUpdatePathClimbingParts(skipUpdatePathClimbingParts) {
+			}
+
+			XmlNode *read() {
+				if (XmlIoBinary::isBinaryData(data, size) == false) {
+					throw megaglest_runtime_error("Not a binary XML file: [" + path + "]", true);
+				}
+				uint32 fileVersion = 0;
+				memcpy(&fileVersion, data + binaryXmlMagicSize, sizeof(fileVersion));
+				fileVersion = Shared::PlatformByteOrder::fromCommonEndian(fileVersion);
+				if (fileVersion != XmlIoBinary::version) {
+					throw megaglest_runtime_error("Unsupported binary XML version " + uIntToStr(fileVersion) + " in file: [" + path + "]", true);
+				}
+				pos = binaryXmlHeaderSize;
+
+				uint64 stringCount = readCount();
+				stringTable.reserve((size_t) stringCount);
+				for (uint64 i = 0; i < stringCount; ++i) {
+					uint64 length = readVarUInt();
+					if (length > size - pos) {
+						throwCorrupt();
+					}
+					stringTable.push_back(string(data + pos, (size_t) length));
+					pos += (size_t) length;
+				}
+
+				XmlNode *rootNode = new XmlNode("");
+				try {
+					readNode(rootNode, 0);
+					if (pos != size) {
+						throwCorrupt();
+					}
+				} catch (...) {
+					delete rootNode;
+					throw;
+				}
+				return rootNode;
+			}
+		};
+
+		bool XmlIoBinary::isBinaryData(const char *data, size_t size) {
+			return data != NULL && size >= binaryXmlHeaderSize &&
+				memcmp(data, binaryXmlMagic, binaryXmlMagicSize) == 0;
+		}
+
+		bool XmlIoBinary::isBinaryFile(const string &path) {
+#if defined(WIN32) && !defined(__MINGW32__)
+			FILE *fp = _wfopen(utf8_decode(path).c_str(), L"rb");
+#else
+			FILE *fp = fopen(path.c_str(), "rb");
+#endif
+			if (fp == NULL) {
+				return false;
+			}
+			char header[binaryXmlHeaderSize];
+			size_t readBytes = fread(header, 1, binaryXmlHeaderSize, fp);
+			fclose(fp);
+			return isBinaryData(header, readBytes);
+		}
+
+		XmlNode *XmlIoBinary::load(const char *data, size_t size, const string &path,
+			const std::map<string, string> &mapTagReplacementValues, bool skipUpdatePathClimbingParts) {
+			Reader reader(data, size, path, mapTagReplacementValues, skipUpdatePathClimbingParts);
+			return reader.read();
+		}
+
+		XmlNode *XmlIoBinary::load(const string &path, const std::map<string, string> &mapTagReplacementValues,
+			bool skipUpdatePathClimbingParts) {
+#if defined(WIN32) && !defined(__MINGW32__)
+			FILE *fp = _wfopen(utf8_decode(path).c_str(), L"rb");
+#else
+			FILE *fp = fopen(path.c_str(), "rb");
+#endif
+			if (fp == NULL) {
+				throw megaglest_runtime_error("Can not open file: [" + path + "]", true);
+			}
+			vector<char> buffer;
+			char readBuffer[16384];
+			for (size_t readBytes = 0; (readBytes = fread(readBuffer, 1, sizeof(readBuffer), fp)) > 0;) {
+				buffer.insert(buffer.end(), readBuffer, readBuffer + readBytes);
+			}
+			fclose(fp);
+
+			if (buffer.empty() == true) {
+				throw megaglest_runtime_error("Invalid file size for file: [" + path + "] size = 0");
+			}
+			return load(&buffer.front(), buffer.size(), path, mapTagReplacementValues, skipUpdatePathClimbingParts);
+		}
+
+		void XmlIoBinary::save(const string &path, const XmlNode *node) {
+			if (node == NULL) {
+				throw megaglest_runtime_error("node == NULL during save!");
+			}
+
+			std::map<string, uint32> stringIndex;
+			vector<const string *> stringTable;
+			string body;
+			binaryXmlWriteNode(body, stringIndex, stringTable, node);
+
+			string header = binaryXmlWriteHeader(stringTable);
+
+#if defined(WIN32) && !defined(__MINGW32__)
+			FILE *fp = _wfopen(utf8_decode(path).c_str(), L"wb");
+#else
+			FILE *fp = fopen(path.c_str(), "wb");
+#endif
+			if (fp == NULL) {
+				throw megaglest_runtime_error("Can not open file: [" + path + "]");
+			}
+			bool written = fwrite(header.data(), 1, header.size(), fp) == header.size() &&
+				fwrite(body.data(), 1, body.size(), fp) == body.size();
+			if (fclose(fp) != 0 || written == false) {
+				throw megaglest_runtime_error("Error writing file: [" + path + "]");
+			}
+		}
+
+		string XmlIoBinary::encode(xml_node<> *node) {
+			std::map<string, uint32> stringIndex;
+			vector<const string *> stringTable;
+			string body;
+			binaryXmlWriteRawNode(body, stringIndex, stringTable, node);
+			return binaryXmlWriteHeader(stringTable) + body;
+		}
+
 		// =====================================================
 		//	class XmlTree
 		// =====================================================
@@ -519,6 +841,21 @@ namespace Shared {
 			this->engine_type = engine_type;
 			this->skipStackCheck = false;
 			this->skipUpdatePathClimbingParts = false;
+			this->skipPreloaded = false;
+		}
+
+		PreloadCache<XmlTree> &XmlTree::getPreloaded() {
+			static PreloadCache<XmlTree> preloaded;
+			return preloaded;
+		}
+
+		string XmlTree::getPreloadKey(const string &path, const std::map<string, string> &mapTagReplacementValues) {
+			string result = path;
+			for (std::map<string, string>::const_iterator iterMap = mapTagReplacementValues.begin();
+				iterMap != mapTagReplacementValues.end(); ++iterMap) {
+				result += "\n" + iterMap->first + "=" + iterMap->second;
+			}
+			return result;
 		}
 
 		void XmlTree::init(const string &name) {
@@ -534,9 +871,29 @@ namespace Shared {
 			this->skipUpdatePathClimbingParts = value;
 		}
 
+		void XmlTree::setSkipPreloaded(bool value) {
+			this->skipPreloaded = value;
+		}
+
 		void XmlTree::load(const string &path, const std::map<string, string> &mapTagReplacementValues, bool noValidation, bool skipStackCheck, bool skipStackTrace) {
 			if (SystemFlags::VERBOSE_MODE_ENABLED) printf("In [%s::%s Line: %d] about to load [%s] skipStackCheck = %d\n", extractFileFromDirectoryPath(__FILE__).c_str(), __FUNCTION__, __LINE__, path.c_str(), skipStackCheck);
 
+			if (this->skipPreloaded == false && this->skipUpdatePathClimbingParts == false &&
+				this->engine_type == XML_RAPIDXML_ENGINE && getPreloaded().isEmpty() == false) {
+				XmlTree *preloadedTree = getPreloaded().take(getPreloadKey(path, mapTagReplacementValues));
+				if (preloadedTree != NULL) {
+					clearRootNode();
+					// The worker parsed it off the load stack, so there is
+					// nothing to take off it later either
+					this->skipStackCheck = true;
+					this->rootNode = preloadedTree->rootNode;
+					this->loadPath = path;
+					preloadedTree->rootNode = NULL;
+					delete preloadedTree;
+					return;
+				}
+			}
+
 			clearRootNode();
 
 			this->skipStackCheck = skipStackCheck;
@@ -560,7 +917,7 @@ namespace Shared {
 			loadPath = path;
 
 #if defined(WANT_XERCES)
-			if (this->engine_type == XML_XERCES_ENGINE) {
+			if (this->engine_type == XML_XERCES_ENGINE && XmlIoBinary::isBinaryFile(path) == false) {
 				this->rootNode = XmlIo::getInstance().load(path, mapTagReplacementValues, noValidation, skipStackTrace);
 			} else
 #endif
@@ -583,6 +940,10 @@ namespace Shared {
 			}
 		}
 
+		void XmlTree::saveBinary(const string &path) {
+			XmlIoBinary::save(path, rootNode);
+		}
+
 		void XmlTree::clearRootNode() {
 			if (this->skipStackCheck == false) {
 				LoadStack &loadStack = CacheManager::getCachedItem<LoadStack>(loadStackCacheName);
@@ -1007,6 +1368,12 @@ namespace Shared {
 			this->name = name;
 			this->value = value;
 
+			// Without replacements only the path tags apply and they all
+			// start with one of these, which the numbers and names a game
+			// saves hardly ever contain
+			if (mapTagReplacementValues.empty() == true && value.find_first_of("$%{~") == string::npos) {
+				return;
+			}
 			usesCommondata = ((value.find("$COMMONDATAPATH") != string::npos) || (value.find("%%COMMONDATAPATH%%") != string::npos));
 			skipRestrictionCheck = Properties::applyTagsToValue(this->value, &this->mapTagReplacementValues);
 		}
@@ -0,0 +1,113 @@
+// ==============================================================
+//	This file is part of ZetaGlest Benchmarks
+//
+//	Copyright (C) 2018  The ZetaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 3 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "benchmarks.h"
+#include <cstdio>
+#include <cstring>
+
+//
+// Timings of engine code that needs no running game, kept out of the game
+// binary and out of the unit tests. The benchmarks that play or decode a
+// game stay game options (--benchmark-replay, --benchmark-command-list and
+// --benchmark-network-messages), the game code only links into the game.
+//
+struct Benchmark {
+	const char *name;
+	const char *values;
+	const char *description;
+	int (*run)(const vector<string> &args);
+};
+
+static const Benchmark benchmarks[] = {
+	{ "server-sockets", "[clients]",
+		"Compare the latency and cpu use of one thread per client socket and of\n"
+		"\tthe socket reactor, with simulated clients over loopback (linux only).\n"
+		"\t8 clients if omitted.",
+		benchmarkServerSockets },
+	{ "saved-game", "file",
+		"Compare the size and the save and load times of a saved game written as\n"
+		"\txml and in the binary form, after the time building its node tree takes\n"
+		"\ton the game loop. file is a saved game in either form.",
+		benchmarkSavedGame },
+	{ "models", "path",
+		"Compare the time taken to load g3d models read through stdio and mapped\n"
+		"\tinto memory, textures are not loaded. path is a g3d file or a folder\n"
+		"\tsearched for them.",
+		benchmarkModels },
+	{ "client-lag", "[latency] [jitter]",
+		"Compare how often a network client has to stop and wait for the server\n"
+		"\twith and without adaptive pacing, in a simulated game with delayed\n"
+		"\tcommand lists. latency is in milliseconds, 100 if omitted, jitter the\n"
+		"\tmost random extra delay in milliseconds, 50 if omitted.\n"
+		"\tSimulateClientLag and SimulateClientLagJitter in the ini delay a real\n"
+		"\tclient the same way.",
+		benchmarkClientLag },
+	{ "cooked-assets", "path",
+		"Compare the time taken to load xml and image files with the cooked\n"
+		"\tasset cache off, cold (parsing or decoding and writing the entries)\n"
+		"\tand warm (reading them back), with what the checksums, reads and\n"
+		"\twrites of the cache took. path is a file or a folder searched for\n"
+		"\txml, png, tga, bmp and jpg files.",
+		benchmarkCookedAssets },
+	{ "lerp", "[vertices] [meshes]",
+		"Compare the one float at a time and the vectorised frame lerp of the\n"
+		"\tmesh animation. 2000 vertices and 400 meshes if omitted.",
+		benchmarkLerp },
+	{ "particles", "[systems] [particles]",
+		"Time the update of full unit particle systems, and deleting and making\n"
+		"\tthem again from the pool. 50 systems of 1000 particles if omitted.",
+		benchmarkParticles },
+	{ "pathfinder", "[map] [searches]",
+		"Time the A* search of the path finder in nodes per second, with its heap\n"
+		"\topen list and with the std::map lists it used to have, and check both\n"
+		"\tfind the very same paths (exits with 1 if not). map is a gbm or mgm\n"
+		"\tfile, a generated 256x256 map if omitted or empty, 2000 searches\n"
+		"\tbetween random free cells if omitted.",
+		benchmarkPathFinder },
+	{ "path-workers", "[threads] [searches]",
+		"Time frames of precache searches on the path finder's worker pool with\n"
+		"\t0 to threads pool threads, average and slowest frame, and check the\n"
+		"\tthread count changes no path (exits with 1 if it does). 4 threads and\n"
+		"\t200 searches a frame if omitted.",
+		benchmarkPathWorkers },
+	{ "passability", "[frames] [units]",
+		"Move, kill and build units on a generated map, check after every frame\n"
+		"\tthat the passability cache matches the cells (exits with 1 if not), and\n"
+		"\ttime its update and the free cell checks of the path finder with and\n"
+		"\twithout it. 200 frames and 2000 units if omitted.",
+		benchmarkPassability },
+};
+static const int benchmarkCount = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+static void printUsage(const char *argv0) {
+	printf("\nusage: %s benchmark [values]\n\n", argv0);
+	for(int i = 0; i < benchmarkCount; ++i) {
+		printf("%s %s\n\t%s\n\n", benchmarks[i].name, benchmarks[i].values, benchmarks[i].description);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if(argc < 2) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	for(int i = 0; i < benchmarkCount; ++i) {
+		if(strcmp(argv[1], benchmarks[i].name) == 0) {
+			vector<string> args(argv + 2, argv + argc);
+			return benchmarks[i].run(args);
+		}
+	}
+
+	printf("\nUnknown benchmark [%s]\n", argv[1]);
+	printUsage(argv[0]);
+	return 1;
+}
@@ -0,0 +1,36 @@
+// ==============================================================
+//	This file is part of ZetaGlest Benchmarks
+//
+//	Copyright (C) 2018  The ZetaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 3 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _ZETAGLEST_BENCHMARKS_H_
+#define _ZETAGLEST_BENCHMARKS_H_
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+//
+// Each benchmark gets the values given after its name on the command line,
+// prints its timings and returns the exit code
+//
+int benchmarkServerSockets(const vector<string> &args);
+int benchmarkSavedGame(const vector<string> &args);
+int benchmarkModels(const vector<string> &args);
+int benchmarkClientLag(const vector<string> &args);
+int benchmarkCookedAssets(const vector<string> &args);
+int benchmarkLerp(const vector<string> &args);
+int benchmarkParticles(const vector<string> &args);
+int benchmarkPathFinder(const vector<string> &args);
+int benchmarkPathWorkers(const vector<string> &args);
+int benchmarkPassability(const vector<string> &args);
+
+#endif
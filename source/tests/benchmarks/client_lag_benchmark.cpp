@@ -0,0 +1,55 @@
+// ==============================================================
+//	This file is part of ZetaGlest Benchmarks
+//
+//	Copyright (C) 2018  The ZetaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 3 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "benchmarks.h"
+#include <cstdio>
+#include "client_frame_scheduler.h"
+#include "conversion.h"
+
+using namespace Glest::Game;
+using namespace Shared::Util;
+
+int benchmarkClientLag(const vector<string> &args) {
+	int latencyMillis = 100;
+	int jitterMillis = 50;
+	if(args.size() >= 1 && args[0].empty() == false) {
+		latencyMillis = strToInt(args[0]);
+	}
+	if(args.size() >= 2 && args[1].empty() == false) {
+		jitterMillis = strToInt(args[1]);
+	}
+	if(latencyMillis < 0 || jitterMillis < 0) {
+		printf("\nInvalid latency or jitter [%d,%d]\n\n", latencyMillis, jitterMillis);
+		return 1;
+	}
+
+	const int seconds = 300;
+	const char *policyNames[] = { "blocking", "adaptive" };
+
+	printf("Client lag: %d ms latency, up to %d ms jitter, %d seconds of game\n\n",
+		latencyMillis, jitterMillis, seconds);
+	printf("%-10s %8s %10s %12s %8s %8s %8s\n", "policy", "stalls",
+		"stall ms", "longest ms", "dropped", "added", "lead");
+	for(int policy = 0; policy < 2; ++policy) {
+		ClientLagSimulation simulation;
+		simulation.run(latencyMillis, jitterMillis, policy == 1, seconds, 1);
+		printf("%-10s %8d %10lld %12lld %8d %8d %8.1f\n", policyNames[policy],
+			simulation.stalls, (long long)simulation.stallMillis,
+			(long long)simulation.longestStallMillis,
+			simulation.droppedUpdates, simulation.addedUpdates,
+			simulation.averageLead);
+		if(policy == 1) {
+			printf("\nMeasured jitter %d ms, target lead %d frames\n",
+				simulation.jitterMillis, simulation.targetLeadFrames);
+		}
+	}
+	return 0;
+}
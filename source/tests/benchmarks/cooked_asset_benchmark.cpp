@@ -0,0 +1,156 @@
+// ==============================================================
+//	This file is part of ZetaGlest Benchmarks
+//
+//	Copyright (C) 2018  The ZetaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 3 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "benchmarks.h"
+#include <cstdio>
+#include <map>
+#include "xml_parser.h"
+#include "properties.h"
+#include "pixmap.h"
+#include "util.h"
+#include "cooked_asset_cache.h"
+#include "platform_common.h"
+#include "platform_util.h"
+
+using namespace Shared::Xml;
+using namespace Shared::Util;
+using namespace Shared::Graphics;
+using namespace Shared::PlatformCommon;
+
+static int64 loadXmlFiles(const vector<string> &xmlFiles, const std::map<string,string> &mapTagReplacementValues) {
+	Chrono chrono(true);
+	for(unsigned int i = 0; i < xmlFiles.size(); ++i) {
+		XmlTree xmlTree(XML_RAPIDXML_ENGINE);
+		xmlTree.load(xmlFiles[i], mapTagReplacementValues, true);
+	}
+	return chrono.getMicros();
+}
+
+// RGBA like most textures the renderer loads
+static int64 loadImageFiles(const vector<string> &imageFiles) {
+	Chrono chrono(true);
+	for(unsigned int i = 0; i < imageFiles.size(); ++i) {
+		Pixmap2D pixmap(4);
+		pixmap.load(imageFiles[i]);
+	}
+	return chrono.getMicros();
+}
+
+static void findFiles(const string &path, const char **extensions, int extensionCount, vector<string> &files) {
+	for(int i = 0; i < extensionCount; ++i) {
+		if(isdir(path.c_str()) == true) {
+			vector<string> found = getFolderTreeContentsListRecursively(path, extensions[i]);
+			files.insert(files.end(), found.begin(), found.end());
+		}
+		else if(EndsWith(toLower(path), extensions[i]) == true) {
+			files.push_back(path);
+		}
+	}
+}
+
+int benchmarkCookedAssets(const vector<string> &args) {
+	if(args.empty() == true || args[0].empty() == true) {
+		printf("\nMissing asset file or folder\n\n");
+		return 1;
+	}
+	string assetPath = args[0];
+	if(isdir(assetPath.c_str()) == false && fileExists(assetPath) == false) {
+		printf("No file or folder [%s]\n", assetPath.c_str());
+		return 1;
+	}
+	vector<string> sourcePaths;
+	sourcePaths.push_back(isdir(assetPath.c_str()) == true ? assetPath : extractDirectoryPathFromFile(assetPath));
+
+	const char *xmlExtensions[] = { ".xml" };
+	const char *imageExtensions[] = { ".png", ".tga", ".bmp", ".jpg" };
+	vector<string> xmlFiles;
+	vector<string> imageFiles;
+	findFiles(assetPath, xmlExtensions, 1, xmlFiles);
+	findFiles(assetPath, imageExtensions, 4, imageFiles);
+	if(xmlFiles.empty() == true && imageFiles.empty() == true) {
+		printf("No xml or image files found in [%s]\n", assetPath.c_str());
+		return 1;
+	}
+
+	const int passes = 5;
+	const string cachePath = "cooked_asset_benchmark_cache/";
+	if(isdir(cachePath.c_str()) == true) {
+		removeFolder(cachePath);
+	}
+
+	int result = 0;
+	try {
+		std::map<string,string> mapExtraTagReplacementValues;
+		std::map<string,string> mapTagReplacementValues = Properties::getTagReplacementValues(&mapExtraTagReplacementValues);
+
+		printf("Cooked assets [%s]: %d xml and %d image files, average of %d passes\n", assetPath.c_str(),
+			(int)xmlFiles.size(), (int)imageFiles.size(), passes);
+
+		// uncached: the cache is off, cold: every pass starts from an empty
+		// cache so it parses or decodes and writes the entries, warm: it
+		// reads them back
+		const char *kindNames[2] = { "xml", "images" };
+		const char *modeNames[3] = { "uncached", "cold", "warm" };
+		for(int kind = 0; kind < 2; ++kind) {
+			const vector<string> &files = (kind == 0 ? xmlFiles : imageFiles);
+			if(files.empty() == true) {
+				continue;
+			}
+			CookedAssetCache::setCookImages(kind == 1);
+
+			int64 loadMicros[3] = { 0, 0, 0 };
+			CookedAssetCache::Stats stats[3];
+			for(int mode = 0; mode < 3; ++mode) {
+				CookedAssetCache::resetStats();
+				for(int pass = 0; pass < passes; ++pass) {
+					if(mode == 0) {
+						CookedAssetCache::setPath("", sourcePaths);
+					}
+					else if(mode == 1) {
+						if(isdir(cachePath.c_str()) == true) {
+							removeFolder(cachePath);
+						}
+						CookedAssetCache::setPath(cachePath, sourcePaths);
+					}
+					loadMicros[mode] += (kind == 0 ? loadXmlFiles(files, mapTagReplacementValues) : loadImageFiles(files));
+				}
+				stats[mode] = CookedAssetCache::getStats();
+			}
+			CookedAssetCache::setPath("", sourcePaths);
+			if(isdir(cachePath.c_str()) == true) {
+				removeFolder(cachePath);
+			}
+
+			printf("\n%-9s %9s %11s %9s %9s %6s %6s %13s\n", kindNames[kind], "load ms", "checksum ms", "read ms", "write ms", "hits", "misses", "bytes written");
+			for(int mode = 0; mode < 3; ++mode) {
+				printf("%-9s %9.1f %11.1f %9.1f %9.1f %6u %6u %13lld\n", modeNames[mode],
+					loadMicros[mode] / 1000.0 / passes,
+					stats[mode].checksumMicros / 1000.0 / passes,
+					stats[mode].readMicros / 1000.0 / passes,
+					stats[mode].writeMicros / 1000.0 / passes,
+					stats[mode].hits / passes,
+					stats[mode].misses / passes,
+					(long long)(stats[mode].writtenBytes / passes));
+			}
+		}
+	}
+	catch(const std::exception &ex) {
+		printf("Error benchmarking cooked assets [%s]: %s\n", assetPath.c_str(), ex.what());
+		result = 1;
+	}
+
+	CookedAssetCache::setCookImages(false);
+	CookedAssetCache::setPath("", sourcePaths);
+	if(isdir(cachePath.c_str()) == true) {
+		removeFolder(cachePath);
+	}
+	return result;
+}
@@ -0,0 +1,78 @@
+// ==============================================================
+//	This file is part of ZetaGlest Benchmarks
+//
+//	Copyright (C) 2018  The ZetaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 3 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "benchmarks.h"
+#include <cstdio>
+#include <cstdlib>
+#include "interpolation.h"
+#include "platform_common.h"
+
+using namespace Shared::Graphics;
+using namespace Shared::PlatformCommon;
+
+static void fillFrame(vector<Vec3f> &frame, unsigned int seed) {
+	for(unsigned int i = 0; i < frame.size(); ++i) {
+		unsigned int value = (i + 1) * 2654435761u + seed * 40503u;
+		frame[i] = Vec3f((float)(value % 2000) / 100.0f - 10.0f,
+			(float)((value >> 8) % 2000) / 100.0f - 10.0f,
+			(float)((value >> 16) % 2000) / 100.0f - 10.0f);
+	}
+}
+
+int benchmarkLerp(const vector<string> &args) {
+	// about what a few hundred units on screen lerp each frame
+	int vertexCount = 2000;
+	int meshCount = 400;
+	if(args.size() >= 1) {
+		vertexCount = atoi(args[0].c_str());
+	}
+	if(args.size() >= 2) {
+		meshCount = atoi(args[1].c_str());
+	}
+	if(vertexCount <= 0 || meshCount <= 0) {
+		printf("\nInvalid vertex or mesh count\n\n");
+		return 1;
+	}
+
+	const int passes = 5;
+	vector<Vec3f> prev(vertexCount), next(vertexCount), result(vertexCount);
+	fillFrame(prev, 5);
+	fillFrame(next, 6);
+
+	const char *kernelNames[2] = { "scalar", "vectorised" };
+	int64 lerpMicros[2] = { 0, 0 };
+	float check[2] = { 0.0f, 0.0f };
+	for(int pass = 0; pass < passes; ++pass) {
+		for(int kernel = 0; kernel < 2; ++kernel) {
+			Chrono chrono(true);
+			for(int i = 0; i < meshCount; ++i) {
+				float t = (float)i / meshCount;
+				if(kernel == 0) {
+					InterpolationData::lerpFramesScalar(&prev[0], &next[0], t, &result[0], vertexCount);
+				}
+				else {
+					InterpolationData::lerpFrames(&prev[0], &next[0], t, &result[0], vertexCount);
+				}
+			}
+			lerpMicros[kernel] += chrono.getMicros();
+			check[kernel] = result[vertexCount / 2].x;
+		}
+	}
+
+	printf("Lerp of %d meshes of %d vertices, average of %d passes\n\n", meshCount, vertexCount, passes);
+	printf("%-11s %10s\n", "kernel", "us");
+	for(int kernel = 0; kernel < 2; ++kernel) {
+		printf("%-11s %10.1f\n", kernelNames[kernel], lerpMicros[kernel] / (double)passes);
+	}
+	// keeps the loops from being optimised away
+	printf("\nlast value %f %f\n", check[0], check[1]);
+	return 0;
+}
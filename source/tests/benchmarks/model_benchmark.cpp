@@ -0,0 +1,91 @@
+// ==============================================================
+//	This file is part of ZetaGlest Benchmarks
+//
+//	Copyright (C) 2018  The ZetaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 3 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "benchmarks.h"
+#include <cstdio>
+#include "model.h"
+#include "graphics_factory_gl.h"
+#include "platform_common.h"
+#include "platform_util.h"
+
+using namespace Shared::Graphics;
+using namespace Shared::Graphics::Gl;
+using namespace Shared::PlatformCommon;
+
+int benchmarkModels(const vector<string> &args) {
+	if(args.empty() == true || args[0].empty() == true) {
+		printf("\nMissing model file or folder\n\n");
+		return 1;
+	}
+	string modelPath = args[0];
+	vector<string> models;
+	if(isdir(modelPath.c_str()) == true) {
+		models = getFolderTreeContentsListRecursively(modelPath, ".g3d");
+	}
+	else if(fileExists(modelPath) == true) {
+		models.push_back(modelPath);
+	}
+	if(models.empty() == true) {
+		printf("No g3d models found in [%s]\n", modelPath.c_str());
+		return 1;
+	}
+
+	const int passes = 5;
+	const char *modeNames[2] = { "stdio", "mapped" };
+	int64 loadMicros[2] = { 0, 0 };
+	int64 meshBytes = 0;
+	int meshCount = 0;
+	int failedCount = 0;
+	GraphicsFactoryGl graphicsFactory;
+	// alternate the modes so both see the same warm page cache
+	for(int pass = 0; pass < passes; ++pass) {
+		for(int mode = 0; mode < 2; ++mode) {
+			Model::setMappedFileLoading(mode == 1);
+			for(unsigned int i = 0; i < models.size(); ++i) {
+				Model *model = NULL;
+				Chrono chrono(true);
+				try {
+					model = graphicsFactory.newModel(models[i], NULL, false, NULL, NULL);
+				}
+				catch(const std::exception &ex) {
+					if(pass == 0 && mode == 0) {
+						printf("ERROR loading model [%s] message [%s]\n", models[i].c_str(), ex.what());
+						failedCount++;
+					}
+				}
+				loadMicros[mode] += chrono.getMicros();
+
+				if(model != NULL && pass == 0 && mode == 0) {
+					for(uint32 j = 0; j < model->getMeshCount(); ++j) {
+						const Mesh *mesh = model->getMesh(j);
+						meshBytes += (int64)mesh->getFrameCount() * mesh->getVertexCount() * 2 * sizeof(Vec3f)
+							+ (int64)mesh->getVertexCount() * sizeof(Vec2f)
+							+ (int64)mesh->getIndexCount() * sizeof(uint32);
+						meshCount++;
+					}
+				}
+				delete model;
+			}
+		}
+	}
+	Model::setMappedFileLoading(true);
+
+	printf("Models [%s]: %d files, %d failed, %d meshes, %.1f MB of mesh data, average of %d passes\n\n",
+		modelPath.c_str(), (int)models.size(), failedCount, meshCount,
+		meshBytes / (1024.0 * 1024.0), passes);
+	printf("%-8s %10s %12s\n", "reader", "load ms", "ms per model");
+	for(int mode = 0; mode < 2; ++mode) {
+		printf("%-8s %10.1f %12.3f\n", modeNames[mode],
+			loadMicros[mode] / 1000.0 / passes,
+			loadMicros[mode] / 1000.0 / passes / models.size());
+	}
+	return failedCount > 0 ? 1 : 0;
+}
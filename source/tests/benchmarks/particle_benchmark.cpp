@@ -0,0 +1,75 @@
+// ==============================================================
+//	This file is part of ZetaGlest Benchmarks
+//
+//	Copyright (C) 2018  The ZetaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 3 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "benchmarks.h"
+#include <cstdio>
+#include <cstdlib>
+#include "particle.h"
+#include "platform_common.h"
+
+using namespace Shared::Graphics;
+using namespace Shared::PlatformCommon;
+
+int benchmarkParticles(const vector<string> &args) {
+	// about what a big battle has alive at once
+	int systemCount = 50;
+	int particleCount = 1000;
+	if(args.size() >= 1) {
+		systemCount = atoi(args[0].c_str());
+	}
+	if(args.size() >= 2) {
+		particleCount = atoi(args[1].c_str());
+	}
+	if(systemCount <= 0 || particleCount <= 0) {
+		printf("\nInvalid system or particle count\n\n");
+		return 1;
+	}
+
+	const int frameCount = 100;
+	vector<UnitParticleSystem *> systems;
+	int aliveCount = 0;
+	for(int i = 0; i < systemCount; ++i) {
+		UnitParticleSystem *ps = new UnitParticleSystem(particleCount);
+		// every particle lives through the timed frames
+		ps->setMaxParticleEnergy(frameCount * 10);
+		ps->setVarParticleEnergy(0);
+		ps->setEmissionRate((float)particleCount);
+		ps->update();
+		ps->setEmissionRate(0.0f);
+		aliveCount += ps->getAliveParticleCount();
+		systems.push_back(ps);
+	}
+
+	Chrono chrono(true);
+	for(int frame = 0; frame < frameCount; ++frame) {
+		for(unsigned int i = 0; i < systems.size(); ++i) {
+			systems[i]->update();
+		}
+	}
+	int64 updateMicros = chrono.getMicros();
+
+	// the pool hands back the memory of the deleted systems
+	chrono.start();
+	for(unsigned int i = 0; i < systems.size(); ++i) {
+		delete systems[i];
+		systems[i] = new UnitParticleSystem(particleCount);
+	}
+	int64 recreateMicros = chrono.getMicros();
+
+	for(unsigned int i = 0; i < systems.size(); ++i) {
+		delete systems[i];
+	}
+
+	printf("Update of %d live particles in %d systems, %d frames\n\n", aliveCount, systemCount, frameCount);
+	printf("update a frame:     %10lld us\n", (long long int)(updateMicros / frameCount));
+	printf("recreating systems: %10lld us\n", (long long int)recreateMicros);
+	return 0;
+}
@@ -0,0 +1,291 @@
+// ==============================================================
+//	This file is part of ZetaGlest Benchmarks
+//
+//	Copyright (C) 2018  The ZetaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 3 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "benchmarks.h"
+#include <cstdio>
+#include <cstdlib>
+#include "passability_cache.h"
+#include "randomgen.h"
+#include "platform_common.h"
+
+using namespace Glest::Game;
+using namespace Shared::PlatformCommon;
+using Shared::Util::RandomGen;
+
+static const int landField = 0;
+static const int airField = 1;
+static const int fieldCount = 2;
+
+class BenchmarkUnit {
+public:
+	Vec2i pos;
+	int size;
+	int field;
+	bool mobile;
+};
+
+// =====================================================
+//	class BenchmarkCells
+//
+///	Walls and trees blocking land units, and the cells taken by
+///	the units of each field
+// =====================================================
+
+class BenchmarkCells {
+private:
+	int w;
+	int h;
+	vector<bool> blocked;
+	vector<int> units[fieldCount];
+
+public:
+	BenchmarkCells(int w, int h) : w(w), h(h), blocked(w * h, false) {
+		for(int field = 0; field < fieldCount; ++field) {
+			units[field].assign(w * h, -1);
+		}
+	}
+
+	int getW() const {
+		return w;
+	}
+	int getH() const {
+		return h;
+	}
+	void setBlocked(int x, int y) {
+		blocked[y * w + x] = true;
+	}
+	inline bool isFreeCell(const Vec2i &pos, int field) const {
+		return pos.x >= 0 && pos.y >= 0 && pos.x < w && pos.y < h &&
+			(field != landField || blocked[pos.y * w + pos.x] == false) &&
+			units[field][pos.y * w + pos.x] < 0;
+	}
+	// what Map::isFreeCells checks, every cell of the block
+	inline bool isFreeCells(const Vec2i &pos, int size, int field) const {
+		for(int y = pos.y; y < pos.y + size; ++y) {
+			for(int x = pos.x; x < pos.x + size; ++x) {
+				if(isFreeCell(Vec2i(x, y), field) == false) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+	void setUnit(const BenchmarkUnit &unit, int id) {
+		for(int y = unit.pos.y; y < unit.pos.y + unit.size; ++y) {
+			for(int x = unit.pos.x; x < unit.pos.x + unit.size; ++x) {
+				units[unit.field][y * w + x] = id;
+			}
+		}
+	}
+};
+
+// the same moves, deaths and buildings as Map::putUnitCells and
+// Map::clearUnitCells, each invalidating the cache for the unit's cells
+class BenchmarkWorld {
+public:
+	BenchmarkCells cells;
+	PassabilityCache cache;
+	vector<BenchmarkUnit> units;
+	RandomGen random;
+
+	BenchmarkWorld(int size) : cells(size, size) {
+		random.init(11);
+		for(int wall = 0; wall < 40; ++wall) {
+			int x = random.randRange(0, size - 1);
+			int y = random.randRange(0, size - 1);
+			int length = random.randRange(10, 60);
+			bool horizontal = random.randRange(0, 1) == 0;
+			for(int i = 0; i < length; ++i) {
+				int cx = horizontal ? x + i : x;
+				int cy = horizontal ? y : y + i;
+				if(cx < size && cy < size) {
+					cells.setBlocked(cx, cy);
+				}
+			}
+		}
+		for(int clump = 0; clump < 150; ++clump) {
+			int x = random.randRange(0, size - 8);
+			int y = random.randRange(0, size - 8);
+			for(int i = 0; i < 20; ++i) {
+				cells.setBlocked(x + random.randRange(0, 7), y + random.randRange(0, 7));
+			}
+		}
+		cache.init(size, size, fieldCount);
+		cache.update(cells);
+	}
+
+	void putUnit(const BenchmarkUnit &unit) {
+		units.push_back(unit);
+		cells.setUnit(unit, (int)units.size() - 1);
+		cache.invalidate(unit.pos, unit.size);
+	}
+
+	// a free spot for a new unit or building, false if none was found
+	bool addUnit(int size, int field, bool mobile) {
+		for(int tries = 0; tries < 20; ++tries) {
+			BenchmarkUnit unit;
+			unit.pos = Vec2i(random.randRange(0, cells.getW() - size), random.randRange(0, cells.getH() - size));
+			unit.size = size;
+			unit.field = field;
+			unit.mobile = mobile;
+			if(cells.isFreeCells(unit.pos, size, field) == true) {
+				putUnit(unit);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void removeUnit(int index) {
+		BenchmarkUnit unit = units[index];
+		cells.setUnit(unit, -1);
+		cache.invalidate(unit.pos, unit.size);
+		units[index] = units.back();
+		units.pop_back();
+		if(index < (int)units.size()) {
+			cells.setUnit(units[index], index);
+		}
+	}
+
+	void moveUnit(int index) {
+		BenchmarkUnit &unit = units[index];
+		Vec2i step(random.randRange(-1, 1), random.randRange(-1, 1));
+		cells.setUnit(unit, -1);
+		if(cells.isFreeCells(unit.pos + step, unit.size, unit.field) == true) {
+			cache.invalidate(unit.pos, unit.size);
+			unit.pos += step;
+			cache.invalidate(unit.pos, unit.size);
+		}
+		cells.setUnit(unit, index);
+	}
+
+	// one frame of the game: units walk, a few die, buildings go up and
+	// come down, then the cache is refreshed once as World::updateAllUnits does
+	void updateFrame(int unitCount) {
+		for(unsigned int i = 0; i < units.size(); ++i) {
+			if(units[i].mobile == true) {
+				moveUnit(i);
+			}
+		}
+		for(int i = 0; i < 5 && units.empty() == false; ++i) {
+			removeUnit(random.randRange(0, (int)units.size() - 1));
+		}
+		for(int i = 0; (int)units.size() < unitCount && i < 10; ++i) {
+			if(random.randRange(0, 3) == 0) {
+				addUnit(random.randRange(2, PassabilityCache::sizes), landField, false);
+			}
+			else {
+				int field = random.randRange(0, 4) == 0 ? airField : landField;
+				addUnit(random.randRange(1, 2), field, true);
+			}
+		}
+	}
+
+	// every bit against the cells, 0 when the cache is right
+	int countMismatches() const {
+		int mismatchCount = 0;
+		for(int y = 0; y < cells.getH(); ++y) {
+			for(int x = 0; x < cells.getW(); ++x) {
+				for(int field = 0; field < fieldCount; ++field) {
+					for(int size = 1; size <= PassabilityCache::sizes; ++size) {
+						Vec2i pos(x, y);
+						if(cache.isFree(pos, size, field) != cells.isFreeCells(pos, size, field)) {
+							if(mismatchCount < 10) {
+								printf("MISMATCH at [%s] size %d field %d: cached %d cells %d\n", pos.getString().c_str(),
+									size, field, cache.isFree(pos, size, field), cells.isFreeCells(pos, size, field));
+							}
+							mismatchCount++;
+						}
+					}
+				}
+			}
+		}
+		return mismatchCount;
+	}
+};
+
+int benchmarkPassability(const vector<string> &args) {
+	int frameCount = 200;
+	int unitCount = 2000;
+	if(args.size() >= 1) {
+		frameCount = atoi(args[0].c_str());
+	}
+	if(args.size() >= 2) {
+		unitCount = atoi(args[1].c_str());
+	}
+	if(frameCount <= 0 || unitCount <= 0) {
+		printf("\nInvalid frame or unit count\n\n");
+		return 1;
+	}
+
+	const int mapSize = 256;
+	BenchmarkWorld world(mapSize);
+	for(int i = 0; i < unitCount; ++i) {
+		if(i % 10 == 0) {
+			world.addUnit(world.random.randRange(0, 1) == 0 ? 2 : PassabilityCache::sizes, landField, false);
+		}
+		else {
+			world.addUnit(1 + i % 2, i % 5 == 0 ? airField : landField, true);
+		}
+	}
+
+	// the cache is checked after every frame
+	world.cache.update(world.cells);
+	int64 updateMicros = 0;
+	int mismatchCount = world.countMismatches();
+	for(int frame = 0; frame < frameCount; ++frame) {
+		world.updateFrame(unitCount);
+		Chrono chrono(true);
+		world.cache.update(world.cells);
+		updateMicros += chrono.getMicros();
+		mismatchCount += world.countMismatches();
+	}
+
+	// the free cell checks processNode makes through Map::aproxCanMoveSoon,
+	// with the cache first and cell by cell only
+	const int queryCount = 1000000;
+	vector<Vec2i> queries(queryCount);
+	for(int i = 0; i < queryCount; ++i) {
+		queries[i] = Vec2i(world.random.randRange(0, mapSize - 1), world.random.randRange(0, mapSize - 1));
+	}
+	printf("%d frames, %d units and buildings on a %dx%d map\n\n", frameCount, (int)world.units.size(), mapSize, mapSize);
+	printf("cache update a frame: %8.1f us\n\n", updateMicros / (double)frameCount);
+	printf("%-5s %12s %12s %8s\n", "size", "cached ns", "cells ns", "free");
+	for(int size = 1; size <= PassabilityCache::sizes; ++size) {
+		// both counts are compared so neither loop can be optimised away
+		int cachedFreeCount = 0;
+		Chrono chrono(true);
+		for(int i = 0; i < queryCount; ++i) {
+			if(world.cache.isFree(queries[i], size, landField) == true ||
+				world.cells.isFreeCells(queries[i], size, landField) == true) {
+				cachedFreeCount++;
+			}
+		}
+		int64 cachedMicros = chrono.getMicros();
+		int freeCount = 0;
+		chrono.start();
+		for(int i = 0; i < queryCount; ++i) {
+			if(world.cells.isFreeCells(queries[i], size, landField) == true) {
+				freeCount++;
+			}
+		}
+		int64 cellsMicros = chrono.getMicros();
+		printf("%-5d %12.1f %12.1f %7.1f%%\n", size, cachedMicros * 1000.0 / queryCount,
+			cellsMicros * 1000.0 / queryCount, freeCount * 100.0 / queryCount);
+		if(cachedFreeCount != freeCount) {
+			mismatchCount++;
+		}
+	}
+	printf("\nThe cell by cell check here reads one array, the game's also goes\n"
+		"through Cell, SurfaceCell and the unit's team, so it gains more there.\n");
+	printf("\n%d stale or missing cache bits\n", mismatchCount);
+	return mismatchCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,529 @@
+// ==============================================================
+//	This file is part of ZetaGlest Benchmarks
+//
+//	Copyright (C) 2018  The ZetaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 3 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "benchmarks.h"
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include "path_search.h"
+#include "path_job_pool.h"
+#include "map_preview.h"
+#include "platform_common.h"
+
+using namespace Glest::Game;
+using namespace Shared::PlatformCommon;
+using Shared::Map::MapPreview;
+using Shared::Graphics::truncateDecimal;
+
+// the node pool and node limit of a normal search of the game
+static const int nodePoolSize = 900;
+static const int maxNodeCount = 2000;
+
+// =====================================================
+//	class BenchmarkCells
+//
+///	Land passability of a map at the cell scale of the game (a
+///	surface cell is 2x2 cells), one cell units, everything explored
+// =====================================================
+
+class BenchmarkCells {
+private:
+	int w;
+	int h;
+	vector<bool> blocked;
+
+public:
+	BenchmarkCells(int w, int h) : w(w), h(h), blocked(w * h, false) {
+	}
+
+	int getW() const {
+		return w;
+	}
+	int getH() const {
+		return h;
+	}
+	void setBlocked(int x, int y) {
+		blocked[y * w + x] = true;
+	}
+	inline bool isFree(const Vec2i &pos) const {
+		return pos.x >= 0 && pos.y >= 0 && pos.x < w && pos.y < h &&
+			blocked[pos.y * w + pos.x] == false;
+	}
+
+	// what Map::aproxCanMoveSoon checks for a one cell unit: the cell and,
+	// for a diagonal step, both cells it cuts the corner of
+	inline bool canMoveSoon(const Vec2i &pos1, const Vec2i &pos2) const {
+		if(isFree(pos2) == false) {
+			return false;
+		}
+		if(pos1.x != pos2.x && pos1.y != pos2.y) {
+			return isFree(Vec2i(pos1.x, pos2.y)) && isFree(Vec2i(pos2.x, pos1.y));
+		}
+		return true;
+	}
+	inline bool isExplored(const Vec2i &pos) const {
+		return true;
+	}
+	inline int getTraceId() const {
+		return -1;
+	}
+};
+
+static BenchmarkCells *loadCells(const string &mapFile) {
+	MapPreview mapPreview;
+	mapPreview.loadFromFile(mapFile);
+
+	BenchmarkCells *cells = new BenchmarkCells(mapPreview.getW() * 2, mapPreview.getH() * 2);
+	// the game's deep water, where land units can't go
+	float deepWater = mapPreview.getWaterLevel() - 0.01f - 1.5f;
+	for(int y = 0; y < mapPreview.getH(); ++y) {
+		for(int x = 0; x < mapPreview.getW(); ++x) {
+			if(mapPreview.getObject(x, y) != 0 || mapPreview.getResource(x, y) != 0 ||
+				mapPreview.getHeight(x, y) < deepWater) {
+				cells->setBlocked(x * 2, y * 2);
+				cells->setBlocked(x * 2 + 1, y * 2);
+				cells->setBlocked(x * 2, y * 2 + 1);
+				cells->setBlocked(x * 2 + 1, y * 2 + 1);
+			}
+		}
+	}
+	return cells;
+}
+
+// a 256x256 map with walls and clumps of trees, when no map is given
+static BenchmarkCells *generateCells() {
+	const int size = 256;
+	BenchmarkCells *cells = new BenchmarkCells(size, size);
+	RandomGen random;
+	random.init(7);
+	for(int wall = 0; wall < 40; ++wall) {
+		int x = random.randRange(0, size - 1);
+		int y = random.randRange(0, size - 1);
+		int length = random.randRange(10, 60);
+		bool horizontal = random.randRange(0, 1) == 0;
+		for(int i = 0; i < length; ++i) {
+			int cx = horizontal ? x + i : x;
+			int cy = horizontal ? y : y + i;
+			if(cx < size && cy < size) {
+				cells->setBlocked(cx, cy);
+			}
+		}
+	}
+	for(int clump = 0; clump < 150; ++clump) {
+		int x = random.randRange(0, size - 8);
+		int y = random.randRange(0, size - 8);
+		for(int i = 0; i < 20; ++i) {
+			cells->setBlocked(x + random.randRange(0, 7), y + random.randRange(0, 7));
+		}
+	}
+	return cells;
+}
+
+// =====================================================
+//	class MapListSearch
+//
+///	The open and closed lists the path finder had before the
+///	heap, std::map buckets keyed by heuristic, kept to check the
+///	heap finds the very same paths
+// =====================================================
+
+class MapListSearch {
+public:
+	typedef PathSearchState::Nodes Nodes;
+
+	std::map<Vec2i, bool> openPosList;
+	std::map<float, Nodes> openNodesList;
+	std::map<float, Nodes> closedNodesList;
+	vector<PathSearchNode> nodePool;
+	int nodePoolCount;
+	RandomGen random;
+
+	MapListSearch() : nodePool(nodePoolSize), nodePoolCount(0) {
+	}
+
+	void resetSearch() {
+		nodePoolCount = 0;
+		openPosList.clear();
+		openNodesList.clear();
+		closedNodesList.clear();
+	}
+
+	PathSearchNode *newNode() {
+		if(nodePoolCount < (int)nodePool.size() && nodePoolCount < maxNodeCount) {
+			PathSearchNode *node = &nodePool[nodePoolCount];
+			node->clear();
+			nodePoolCount++;
+			return node;
+		}
+		return NULL;
+	}
+
+	void openNode(PathSearchNode *node) {
+		openNodesList[node->heuristic].push_back(node);
+		openPosList[node->pos] = true;
+	}
+
+	PathSearchNode *minHeuristicFastLookup() {
+		PathSearchNode *result = openNodesList.begin()->second.front();
+		openNodesList.begin()->second.erase(openNodesList.begin()->second.begin());
+		if(openNodesList.begin()->second.empty()) {
+			openNodesList.erase(openNodesList.begin());
+		}
+		return result;
+	}
+
+	PathSearchNode *getClosedBestNode() {
+		return closedNodesList.empty() ? NULL : closedNodesList.begin()->second.front();
+	}
+
+	void processNode(const BenchmarkCells &cells, PathSearchNode *node, const Vec2i &finalPos,
+		int x, int y, bool &nodeLimitReached) {
+		Vec2i sucPos = node->pos + Vec2i(x, y);
+		if(openPosList.find(sucPos) == openPosList.end() && cells.canMoveSoon(node->pos, sucPos)) {
+			PathSearchNode *sucNode = newNode();
+			if(sucNode != NULL) {
+				sucNode->pos = sucPos;
+				sucNode->heuristic = PathSearch::heuristic(sucNode->pos, finalPos);
+				sucNode->prev = node;
+				sucNode->next = NULL;
+				sucNode->exploredCell = cells.isExplored(sucPos);
+				openNode(sucNode);
+			}
+			else {
+				nodeLimitReached = true;
+			}
+		}
+	}
+
+	void search(const BenchmarkCells &cells, const Vec2i &finalPos, bool &nodeLimitReached,
+		int &whileLoopCount, bool &pathFound, PathSearchNode *&node) {
+		while(nodeLimitReached == false) {
+			whileLoopCount++;
+			if(openNodesList.empty() == true) {
+				pathFound = false;
+				break;
+			}
+			node = minHeuristicFastLookup();
+			if(node->pos == finalPos || node->exploredCell == false) {
+				pathFound = true;
+				break;
+			}
+
+			closedNodesList[node->heuristic].push_back(node);
+			openPosList[node->pos] = true;
+
+			int tryDirection = random.randRange(1, 4);
+			if(tryDirection == 4) {
+				for(int i = 1; i >= -1 && nodeLimitReached == false; --i) {
+					for(int j = -1; j <= 1 && nodeLimitReached == false; ++j) {
+						processNode(cells, node, finalPos, i, j, nodeLimitReached);
+					}
+				}
+			}
+			else if(tryDirection == 3) {
+				for(int i = -1; i <= 1 && nodeLimitReached == false; ++i) {
+					for(int j = 1; j >= -1 && nodeLimitReached == false; --j) {
+						processNode(cells, node, finalPos, i, j, nodeLimitReached);
+					}
+				}
+			}
+			else if(tryDirection == 2) {
+				for(int i = -1; i <= 1 && nodeLimitReached == false; ++i) {
+					for(int j = -1; j <= 1 && nodeLimitReached == false; ++j) {
+						processNode(cells, node, finalPos, i, j, nodeLimitReached);
+					}
+				}
+			}
+			else {
+				for(int i = 1; i >= -1 && nodeLimitReached == false; --i) {
+					for(int j = 1; j >= -1 && nodeLimitReached == false; --j) {
+						processNode(cells, node, finalPos, i, j, nodeLimitReached);
+					}
+				}
+			}
+		}
+	}
+};
+
+class SearchResult {
+public:
+	bool pathFound;
+	bool nodeLimitReached;
+	int whileLoopCount;
+	vector<Vec2i> path;
+};
+
+// the path aStar() takes from the last node, or from the best closed node
+// when the node limit was reached
+static void getPath(PathSearchNode *lastNode, PathSearchNode *closedBestNode, SearchResult &result) {
+	if(result.nodeLimitReached == true && closedBestNode != NULL && lastNode != NULL &&
+		truncateDecimal<float>(closedBestNode->heuristic, 6) < lastNode->heuristic) {
+		lastNode = closedBestNode;
+	}
+	result.path.clear();
+	for(PathSearchNode *node = lastNode; node != NULL; node = node->prev) {
+		result.path.push_back(node->pos);
+	}
+}
+
+static void runHeapSearch(const BenchmarkCells &cells, PathSearchState &state,
+	const std::pair<Vec2i, Vec2i> &search, SearchResult &result) {
+	state.resetSearch(cells.getW(), cells.getH());
+	PathSearchNode *firstNode = PathSearch::newNode(state, maxNodeCount);
+	firstNode->pos = search.first;
+	firstNode->heuristic = PathSearch::heuristic(search.first, search.second);
+	firstNode->exploredCell = true;
+	PathSearch::pushOpenNode(firstNode, state);
+
+	PathSearchNode *node = NULL;
+	result.pathFound = true;
+	result.nodeLimitReached = false;
+	result.whileLoopCount = 0;
+	PathSearch::search(cells, state, search.second, maxNodeCount,
+		result.nodeLimitReached, result.whileLoopCount, result.pathFound, node);
+	getPath(node, state.closedBestNode, result);
+}
+
+static int64 runHeapSearches(const BenchmarkCells &cells, const vector<std::pair<Vec2i, Vec2i> > &searches,
+	vector<SearchResult> &results) {
+	PathSearchState state;
+	state.nodePool.resize(nodePoolSize);
+	state.random.init(1);
+
+	Chrono chrono(true);
+	for(unsigned int i = 0; i < searches.size(); ++i) {
+		runHeapSearch(cells, state, searches[i], results[i]);
+	}
+	return chrono.getMicros();
+}
+
+static int64 runMapListSearches(const BenchmarkCells &cells, const vector<std::pair<Vec2i, Vec2i> > &searches,
+	vector<SearchResult> &results) {
+	MapListSearch mapListSearch;
+	mapListSearch.random.init(1);
+
+	Chrono chrono(true);
+	for(unsigned int i = 0; i < searches.size(); ++i) {
+		SearchResult &result = results[i];
+		mapListSearch.resetSearch();
+		PathSearchNode *firstNode = mapListSearch.newNode();
+		firstNode->pos = searches[i].first;
+		firstNode->heuristic = PathSearch::heuristic(searches[i].first, searches[i].second);
+		firstNode->exploredCell = true;
+		mapListSearch.openNode(firstNode);
+
+		PathSearchNode *node = NULL;
+		result.pathFound = true;
+		result.nodeLimitReached = false;
+		result.whileLoopCount = 0;
+		mapListSearch.search(cells, searches[i].second, result.nodeLimitReached,
+			result.whileLoopCount, result.pathFound, node);
+		getPath(node, mapListSearch.getClosedBestNode(), result);
+	}
+	return chrono.getMicros();
+}
+
+// random start and target cells, both free
+static void makeSearches(const BenchmarkCells &cells, int searchCount, vector<std::pair<Vec2i, Vec2i> > &searches) {
+	RandomGen random;
+	random.init(3);
+	for(int tries = 0; (int)searches.size() < searchCount && tries < searchCount * 100; ++tries) {
+		Vec2i start(random.randRange(0, cells.getW() - 1), random.randRange(0, cells.getH() - 1));
+		Vec2i target(random.randRange(0, cells.getW() - 1), random.randRange(0, cells.getH() - 1));
+		if(start != target && cells.isFree(start) && cells.isFree(target)) {
+			searches.push_back(std::make_pair(start, target));
+		}
+	}
+}
+
+int benchmarkPathFinder(const vector<string> &args) {
+	int searchCount = 2000;
+	string mapFile;
+	if(args.size() >= 1) {
+		mapFile = args[0];
+	}
+	if(args.size() >= 2) {
+		searchCount = atoi(args[1].c_str());
+	}
+	if(searchCount <= 0) {
+		printf("\nInvalid search count\n\n");
+		return 1;
+	}
+
+	BenchmarkCells *cells = NULL;
+	try {
+		cells = (mapFile.empty() == true ? generateCells() : loadCells(mapFile));
+	}
+	catch(const std::exception &ex) {
+		printf("Error loading map [%s]: %s\n", mapFile.c_str(), ex.what());
+		return 1;
+	}
+
+	vector<std::pair<Vec2i, Vec2i> > searches;
+	makeSearches(*cells, searchCount, searches);
+	if(searches.empty() == true) {
+		printf("No free cells in [%s]\n", mapFile.c_str());
+		delete cells;
+		return 1;
+	}
+
+	vector<SearchResult> heapResults(searches.size());
+	vector<SearchResult> mapListResults(searches.size());
+	int64 heapMicros = runHeapSearches(*cells, searches, heapResults);
+	int64 mapListMicros = runMapListSearches(*cells, searches, mapListResults);
+
+	int64 nodeCount = 0;
+	int limitCount = 0;
+	int mismatchCount = 0;
+	for(unsigned int i = 0; i < searches.size(); ++i) {
+		const SearchResult &heap = heapResults[i];
+		const SearchResult &mapList = mapListResults[i];
+		nodeCount += heap.whileLoopCount;
+		if(heap.nodeLimitReached == true) {
+			limitCount++;
+		}
+		if(heap.pathFound != mapList.pathFound || heap.nodeLimitReached != mapList.nodeLimitReached ||
+			heap.whileLoopCount != mapList.whileLoopCount || heap.path != mapList.path) {
+			if(mismatchCount < 10) {
+				printf("MISMATCH search %u from [%s] to [%s]: heap %d nodes %d steps, map lists %d nodes %d steps\n",
+					i, searches[i].first.getString().c_str(), searches[i].second.getString().c_str(),
+					heap.whileLoopCount, (int)heap.path.size(), mapList.whileLoopCount, (int)mapList.path.size());
+			}
+			mismatchCount++;
+		}
+	}
+
+	printf("%d searches on a %dx%d map [%s], %d hit the node limit\n\n", (int)searches.size(),
+		cells->getW(), cells->getH(), mapFile.empty() == true ? "generated" : mapFile.c_str(), limitCount);
+	printf("%-10s %10s %14s\n", "lists", "ms", "nodes/sec");
+	printf("%-10s %10.1f %14.0f\n", "heap", heapMicros / 1000.0, heapMicros > 0 ? nodeCount * 1000000.0 / heapMicros : 0.0);
+	printf("%-10s %10.1f %14.0f\n", "map lists", mapListMicros / 1000.0, mapListMicros > 0 ? nodeCount * 1000000.0 / mapListMicros : 0.0);
+	printf("\n%d of %d paths differ\n", mismatchCount, (int)searches.size());
+
+	delete cells;
+	return mismatchCount == 0 ? 0 : 1;
+}
+
+// =====================================================
+//	class BenchmarkPathJobRunner
+//
+///	The precache searches of a frame on the path finder's worker
+///	pool, seeded per job like PathFinder::runPathJob
+// =====================================================
+
+class BenchmarkPathJobRunner : public PathJobRunner {
+private:
+	const BenchmarkCells &cells;
+	vector<PathSearchState *> states;
+
+public:
+	const std::pair<Vec2i, Vec2i> *searches;
+	SearchResult *results;
+	int frameIndex;
+
+	BenchmarkPathJobRunner(const BenchmarkCells &cells, int workerCount) : cells(cells) {
+		for(int i = 0; i < workerCount; ++i) {
+			states.push_back(new PathSearchState());
+			states.back()->nodePool.resize(nodePoolSize);
+		}
+		searches = NULL;
+		results = NULL;
+		frameIndex = 0;
+	}
+	virtual ~BenchmarkPathJobRunner() {
+		for(unsigned int i = 0; i < states.size(); ++i) {
+			delete states[i];
+		}
+	}
+
+	virtual void runPathJob(int jobIndex, int workerIndex) {
+		PathSearchState &state = *states[workerIndex];
+		uint32 seed = (uint32)frameIndex * 10007u + (uint32)jobIndex;
+		state.random.init((int)(seed % 0x7FFFFFFF));
+		runHeapSearch(cells, state, searches[jobIndex], results[jobIndex]);
+	}
+};
+
+int benchmarkPathWorkers(const vector<string> &args) {
+	int maxThreadCount = 4;
+	int jobCount = 200;
+	if(args.size() >= 1) {
+		maxThreadCount = atoi(args[0].c_str());
+	}
+	if(args.size() >= 2) {
+		jobCount = atoi(args[1].c_str());
+	}
+	if(maxThreadCount < 0 || jobCount <= 0) {
+		printf("\nInvalid thread or job count\n\n");
+		return 1;
+	}
+
+	const int frameCount = 100;
+	BenchmarkCells *cells = generateCells();
+	vector<std::pair<Vec2i, Vec2i> > searches;
+	makeSearches(*cells, frameCount * jobCount, searches);
+	if((int)searches.size() < frameCount * jobCount) {
+		printf("Not enough free cells for %d searches\n", frameCount * jobCount);
+		delete cells;
+		return 1;
+	}
+
+	vector<SearchResult> firstResults;
+	int mismatchCount = 0;
+	printf("%d frames of %d precache searches on a generated %dx%d map\n\n", frameCount, jobCount, cells->getW(), cells->getH());
+	printf("%-8s %12s %12s %12s\n", "threads", "frame ms", "slowest ms", "speedup");
+	double singleFrameMillis = 0;
+	for(int threadCount = 0; threadCount <= maxThreadCount; ++threadCount) {
+		BenchmarkPathJobRunner runner(*cells, threadCount + 1);
+		PathJobPool pool(&runner);
+		pool.start(threadCount);
+
+		vector<SearchResult> results(searches.size());
+		int64 totalMicros = 0;
+		int64 slowestMicros = 0;
+		for(int frame = 0; frame < frameCount; ++frame) {
+			runner.frameIndex = frame;
+			runner.searches = &searches[frame * jobCount];
+			runner.results = &results[frame * jobCount];
+			Chrono chrono(true);
+			pool.run(jobCount, true);
+			int64 frameMicros = chrono.getMicros();
+			totalMicros += frameMicros;
+			slowestMicros = std::max(slowestMicros, frameMicros);
+		}
+		pool.stop();
+
+		// the worker count must not change any path
+		if(threadCount == 0) {
+			firstResults = results;
+		}
+		else {
+			for(unsigned int i = 0; i < results.size(); ++i) {
+				if(results[i].path != firstResults[i].path ||
+					results[i].whileLoopCount != firstResults[i].whileLoopCount) {
+					mismatchCount++;
+				}
+			}
+		}
+
+		double frameMillis = totalMicros / 1000.0 / frameCount;
+		if(threadCount == 0) {
+			singleFrameMillis = frameMillis;
+		}
+		printf("%-8d %12.2f %12.2f %11.2fx\n", threadCount, frameMillis, slowestMicros / 1000.0,
+			frameMillis > 0 ? singleFrameMillis / frameMillis : 0.0);
+	}
+	printf("\nThe calling thread runs jobs too, 0 threads is the serial update.\n");
+	printf("%d paths changed with the thread count\n", mismatchCount);
+
+	delete cells;
+	return mismatchCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+// ==============================================================
+//	This file is part of ZetaGlest Benchmarks
+//
+//	Copyright (C) 2018  The ZetaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 3 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "benchmarks.h"
+#include <cstdio>
+#include <map>
+#include "xml_parser.h"
+#include "properties.h"
+#include "platform_common.h"
+#include "platform_util.h"
+
+using namespace Shared::Xml;
+using namespace Shared::Util;
+using namespace Shared::PlatformCommon;
+
+// The addChild and addAttribute calls the saveGame methods make, all of
+// them on the game loop before the tree goes to the writer thread
+static void copyNode(const XmlNode *source, XmlNode *node, const std::map<string,string> &mapTagReplacements) {
+	for(unsigned int i = 0; i < source->getAttributeCount(); ++i) {
+		const XmlAttribute *attribute = source->getAttribute(i);
+		node->addAttribute(attribute->getName(), attribute->getValue("", false), mapTagReplacements);
+	}
+	for(unsigned int i = 0; i < source->getChildCount(); ++i) {
+		const XmlNode *child = source->getChild(i);
+		copyNode(child, node->addChild(child->getName(), child->getText()), mapTagReplacements);
+	}
+}
+
+int benchmarkSavedGame(const vector<string> &args) {
+	if(args.empty() == true || args[0].empty() == true) {
+		printf("\nMissing saved game file\n\n");
+		return 1;
+	}
+	string savedGameFile = args[0];
+	if(fileExists(savedGameFile) == false) {
+		printf("Saved game file [%s] was NOT FOUND\n", savedGameFile.c_str());
+		return 1;
+	}
+
+	const int passes = 5;
+	string xmlFile = savedGameFile + ".benchmark.xml";
+	string binaryFile = savedGameFile + ".benchmark.bin";
+	int result = 0;
+	try {
+		std::map<string,string> mapExtraTagReplacementValues;
+		std::map<string,string> mapTagReplacementValues = Properties::getTagReplacementValues(&mapExtraTagReplacementValues);
+
+		XmlTree xmlTree(XML_RAPIDXML_ENGINE);
+		xmlTree.load(savedGameFile, mapTagReplacementValues, true);
+		const XmlNode *rootNode = xmlTree.getRootNode();
+		if(rootNode->hasChild("zetaglest-saved-game") == true) {
+			rootNode = rootNode->getChild("zetaglest-saved-game");
+		}
+		const XmlNode *worldNode = rootNode->getChild("Game")->getChild("World");
+		int unitCount = 0;
+		for(unsigned int i = 0; i < worldNode->getChildCount(); ++i) {
+			const XmlNode *factionNode = worldNode->getChild(i);
+			if(factionNode->getName() == "Faction") {
+				unitCount += (int)factionNode->getChildList("Unit").size();
+			}
+		}
+
+		const char *formatNames[2] = { "xml", "binary" };
+		const string *formatFiles[2] = { &xmlFile, &binaryFile };
+		int64 saveMicros[2] = { 0, 0 };
+		int64 loadMicros[2] = { 0, 0 };
+		int64 buildMicros = 0;
+		for(int pass = 0; pass < passes; ++pass) {
+			{
+				// the tree is values already, as a game's would be
+				std::map<string,string> mapTagReplacements;
+				XmlTree xmlTreeBuild(XML_RAPIDXML_ENGINE);
+				xmlTreeBuild.init(rootNode->getName());
+				Chrono chrono(true);
+				copyNode(rootNode, xmlTreeBuild.getRootNode(), mapTagReplacements);
+				buildMicros += chrono.getMicros();
+			}
+			for(int format = 0; format < 2; ++format) {
+				Chrono chrono(true);
+				if(format == 0) {
+					xmlTree.save(xmlFile);
+				}
+				else {
+					xmlTree.saveBinary(binaryFile);
+				}
+				saveMicros[format] += chrono.getMicros();
+
+				XmlTree xmlTreeLoad(XML_RAPIDXML_ENGINE);
+				chrono.start();
+				xmlTreeLoad.load(*formatFiles[format], mapTagReplacementValues, true);
+				loadMicros[format] += chrono.getMicros();
+			}
+		}
+
+		printf("Saved game [%s]: %d units, average of %d passes\n\n", savedGameFile.c_str(), unitCount, passes);
+		printf("building the tree on the game loop: %.1f ms\n", buildMicros / 1000.0 / passes);
+		printf("saving it is done by the writer thread\n\n");
+		printf("%-8s %12s %10s %10s\n", "format", "bytes", "save ms", "load ms");
+		for(int format = 0; format < 2; ++format) {
+			printf("%-8s %12lld %10.1f %10.1f\n", formatNames[format],
+				(long long)getFileSize(*formatFiles[format]),
+				saveMicros[format] / 1000.0 / passes,
+				loadMicros[format] / 1000.0 / passes);
+		}
+	}
+	catch(const std::exception &ex) {
+		printf("Error benchmarking saved game [%s]: %s\n", savedGameFile.c_str(), ex.what());
+		result = 1;
+	}
+
+	removeFile(xmlFile);
+	removeFile(binaryFile);
+	return result;
+}
@@ -0,0 +1,263 @@
+// ==============================================================
+//	This file is part of ZetaGlest Benchmarks
+//
+//	Copyright (C) 2018  The ZetaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 3 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "benchmarks.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <time.h>
+#include <sys/resource.h>
+#include "socket.h"
+#include "base_thread.h"
+#include "conversion.h"
+#include "platform_util.h"
+#include "game_constants.h"
+
+using namespace Shared::Platform;
+using namespace Shared::PlatformCommon;
+using namespace Shared::Util;
+using std::max;
+using Glest::Game::GameConstants;
+
+//
+// Simulated client traffic, each message carries the time it was sent
+//
+static const int messageSize = 16;
+
+static int64 nowMicros() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+class SocketReceiver : public BaseThread {
+protected:
+	vector<Socket *> sockets;
+
+	void receiveMessages(Socket *socket) {
+		char data[messageSize];
+		for(; Socket::hasDataToRead(socket->getSocketId()) == true;) {
+			if(socket->receive(data, messageSize, true) != messageSize) {
+				break;
+			}
+			int64 sent = 0;
+			memcpy(&sent, data, sizeof(sent));
+			int64 latency = nowMicros() - sent;
+			messageCount++;
+			totalLatency += latency;
+			maxLatency = max(maxLatency, latency);
+		}
+	}
+
+public:
+	int64 messageCount;
+	int64 totalLatency;
+	int64 maxLatency;
+	int64 wakeups;
+
+	explicit SocketReceiver(const vector<Socket *> &sockets) : BaseThread(), sockets(sockets) {
+		messageCount = 0;
+		totalLatency = 0;
+		maxLatency = 0;
+		wakeups = 0;
+	}
+};
+
+// One thread per socket, as ConnectionSlotThread does in game
+class SelectReceiver : public SocketReceiver {
+public:
+	explicit SelectReceiver(const vector<Socket *> &sockets) : SocketReceiver(sockets) {
+	}
+
+	virtual void execute() {
+		RunningStatusSafeWrapper runningStatus(this);
+		for(; getQuitStatus() == false;) {
+			if(Socket::hasDataToReadWithWait(sockets[0]->getSocketId(), 150000) == true) {
+				wakeups++;
+				receiveMessages(sockets[0]);
+			}
+		}
+	}
+};
+
+// All sockets in one thread, as ConnectionSlotReactorThread does
+class ReactorReceiver : public SocketReceiver {
+protected:
+	SocketReactor reactor;
+
+public:
+	explicit ReactorReceiver(const vector<Socket *> &sockets) : SocketReceiver(sockets) {
+		for(unsigned int index = 0; index < sockets.size(); ++index) {
+			reactor.addSocket(sockets[index]->getSocketId(), index);
+		}
+	}
+
+	virtual void execute() {
+		RunningStatusSafeWrapper runningStatus(this);
+		vector<int> readySockets;
+		for(; getQuitStatus() == false;) {
+			if(reactor.waitForData(readySockets, 150) > 0) {
+				wakeups++;
+				for(unsigned int index = 0; index < readySockets.size(); ++index) {
+					receiveMessages(sockets[readySockets[index]]);
+				}
+			}
+		}
+	}
+};
+
+static void runMode(const char *name, bool useReactor, vector<ClientSocket *> &clients, vector<Socket *> &serverSockets) {
+	const int sendIntervalMilliseconds = 20;
+	const int runMilliseconds = 5000;
+
+	vector<SocketReceiver *> receivers;
+	if(useReactor == true) {
+		receivers.push_back(new ReactorReceiver(serverSockets));
+	}
+	else {
+		for(unsigned int index = 0; index < serverSockets.size(); ++index) {
+			vector<Socket *> slotSocket(1, serverSockets[index]);
+			receivers.push_back(new SelectReceiver(slotSocket));
+		}
+	}
+	for(unsigned int index = 0; index < receivers.size(); ++index) {
+		receivers[index]->start();
+	}
+
+	struct rusage usageStart;
+	getrusage(RUSAGE_SELF, &usageStart);
+	int64 start = nowMicros();
+
+	char data[messageSize];
+	memset(data, 0, messageSize);
+	for(; nowMicros() - start < runMilliseconds * 1000;) {
+		for(unsigned int index = 0; index < clients.size(); ++index) {
+			int64 sent = nowMicros();
+			memcpy(data, &sent, sizeof(sent));
+			clients[index]->send(data, messageSize);
+		}
+		sleep(sendIntervalMilliseconds);
+	}
+	// let the last messages arrive
+	sleep(200);
+
+	struct rusage usageEnd;
+	getrusage(RUSAGE_SELF, &usageEnd);
+	int64 elapsed = nowMicros() - start;
+
+	int64 messageCount = 0;
+	int64 totalLatency = 0;
+	int64 maxLatency = 0;
+	int64 wakeups = 0;
+	for(unsigned int index = 0; index < receivers.size(); ++index) {
+		receivers[index]->shutdownAndWait();
+		messageCount += receivers[index]->messageCount;
+		totalLatency += receivers[index]->totalLatency;
+		maxLatency = max(maxLatency, receivers[index]->maxLatency);
+		wakeups += receivers[index]->wakeups;
+		delete receivers[index];
+	}
+
+	int64 cpuMicros =
+		(int64)(usageEnd.ru_utime.tv_sec - usageStart.ru_utime.tv_sec) * 1000000 +
+		(usageEnd.ru_utime.tv_usec - usageStart.ru_utime.tv_usec) +
+		(int64)(usageEnd.ru_stime.tv_sec - usageStart.ru_stime.tv_sec) * 1000000 +
+		(usageEnd.ru_stime.tv_usec - usageStart.ru_stime.tv_usec);
+
+	printf("%-18s %8d %10lld %12.1f %12lld %10lld %8.2f%%\n", name,
+		(int)(useReactor == true ? 1 : serverSockets.size()),
+		(long long)messageCount,
+		(messageCount > 0 ? (double)totalLatency / (double)messageCount : 0.0),
+		(long long)maxLatency, (long long)wakeups,
+		(elapsed > 0 ? 100.0 * (double)cpuMicros / (double)elapsed : 0.0));
+}
+
+// Connects clientCount client sockets to a server over loopback,
+// serverSockets gets the server's end of each
+static void connectClients(int clientCount, vector<ClientSocket *> &clients, vector<Socket *> &serverSockets) {
+	ServerSocket serverSocket(true);
+	serverSocket.setBindSpecificAddress("127.0.0.1");
+	serverSocket.bind(0);
+	serverSocket.listen(clientCount);
+
+	sockaddr_in boundAddress;
+	socklen_t boundAddressLength = sizeof(boundAddress);
+	getsockname(serverSocket.getSocketId(), reinterpret_cast<sockaddr *>(&boundAddress), &boundAddressLength);
+	int port = ntohs(boundAddress.sin_port);
+
+	for(int index = 0; index < clientCount; ++index) {
+		ClientSocket *client = new ClientSocket();
+		clients.push_back(client);
+		client->connect(Ip("127.0.0.1"), port);
+
+		Socket *accepted = NULL;
+		for(int attempt = 0; accepted == NULL && attempt < 100; ++attempt) {
+			accepted = serverSocket.accept(false);
+			if(accepted == NULL) {
+				sleep(10);
+			}
+		}
+		if(accepted == NULL) {
+			throw megaglest_runtime_error("Could not accept simulated client " + intToStr(index));
+		}
+		serverSockets.push_back(accepted);
+	}
+}
+
+int benchmarkServerSockets(const vector<string> &args) {
+	int clientCount = 8;
+	if(args.empty() == false) {
+		clientCount = strToInt(args[0]);
+	}
+	if(clientCount < 1 || clientCount > GameConstants::maxPlayers) {
+		printf("\nInvalid client count [%d], must be 1 to %d\n\n", clientCount, GameConstants::maxPlayers);
+		return 1;
+	}
+
+	vector<ClientSocket *> clients;
+	vector<Socket *> serverSockets;
+	int result = 0;
+	try {
+		connectClients(clientCount, clients, serverSockets);
+
+		printf("%d simulated clients over loopback, one %d byte message each every 20 ms\n\n",
+			clientCount, messageSize);
+		printf("%-18s %8s %10s %12s %12s %10s %9s\n", "mode", "threads",
+			"messages", "avg lat us", "max lat us", "wakeups", "cpu");
+		runMode("thread per slot", false, clients, serverSockets);
+		if(SocketReactor::isSupported() == true) {
+			runMode("socket reactor", true, clients, serverSockets);
+		}
+	}
+	catch(const std::exception &ex) {
+		printf("Error running socket benchmark: %s\n", ex.what());
+		result = 1;
+	}
+
+	for(unsigned int index = 0; index < serverSockets.size(); ++index) {
+		delete serverSockets[index];
+	}
+	for(unsigned int index = 0; index < clients.size(); ++index) {
+		delete clients[index];
+	}
+	return result;
+}
+
+#else
+
+int benchmarkServerSockets(const vector<string> &args) {
+	printf("\nThe server sockets benchmark is only available on linux\n\n");
+	return 1;
+}
+
+#endif
@@ -0,0 +1,257 @@
+// ==============================================================
+//	This file is part of ZetaGlest Unit Tests
+//
+//	Copyright (C) 2018  The ZetaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 3 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "interpolation.h"
+#include "model.h"
+#include "opengl.h"
+#include <vector>
+#include <cmath>
+
+using namespace Shared::Graphics;
+
+//
+// Tests for the frame lerp of the mesh animation, the vectorised kernel must
+// give what the one float at a time loop gives, and the interpolated frames
+// a mesh caches must be found, replaced and shared the way it expects
+//
+class InterpolationTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( InterpolationTest );
+
+	CPPUNIT_TEST( test_lerpFrames_matches_scalar );
+	CPPUNIT_TEST( test_lerpFrames_endpoints );
+	CPPUNIT_TEST( test_cache_hit );
+	CPPUNIT_TEST( test_cache_miss );
+	CPPUNIT_TEST( test_cache_eviction );
+	CPPUNIT_TEST( test_cache_vertices_and_normals_share_entry );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+	static void fillFrame(std::vector<Vec3f> &frame, unsigned int seed) {
+		for(unsigned int i = 0; i < frame.size(); ++i) {
+			unsigned int value = (i + 1) * 2654435761u + seed * 40503u;
+			frame[i] = Vec3f((float)(value % 2000) / 100.0f - 10.0f,
+				(float)((value >> 8) % 2000) / 100.0f - 10.0f,
+				(float)((value >> 16) % 2000) / 100.0f - 10.0f);
+		}
+	}
+
+	static bool isClose(float a, float b) {
+		// a build using fused multiply adds may round the scalar loop
+		// differently in the last bit
+		return std::fabs(a - b) <= 1e-5f * (1.0f + std::fabs(a));
+	}
+
+	static const unsigned int meshFrameCount = 4;
+	static const unsigned int meshVertexCount = 7;
+
+	int cacheSize;
+	int cacheSteps;
+	Mesh *mesh;
+
+	// 4 frames of 7 vertices, with 16 cache steps a cycle has 64 so the t
+	// of these tests are exact
+	static Mesh *newMesh() {
+		const unsigned int count = meshFrameCount * meshVertexCount;
+		std::vector<Vec3f> frames(count);
+		Vec3f *vertices = new Vec3f[count];
+		Vec3f *normals = new Vec3f[count];
+		fillFrame(frames, 7);
+		std::copy(frames.begin(), frames.end(), vertices);
+		fillFrame(frames, 8);
+		std::copy(frames.begin(), frames.end(), normals);
+
+		Mesh *mesh = new Mesh();
+		mesh->setFrameCount(meshFrameCount);
+		mesh->setVertices(vertices, meshVertexCount);
+		mesh->setNormals(normals, meshVertexCount);
+		mesh->buildInterpolationData();
+		return mesh;
+	}
+
+	static bool isFrame(const Vec3f *result, const Vec3f *frames, unsigned int prevFrame, float localT) {
+		unsigned int nextFrame = (prevFrame + 1) % meshFrameCount;
+		std::vector<Vec3f> expected(meshVertexCount);
+		InterpolationData::lerpFramesScalar(frames + prevFrame * meshVertexCount,
+			frames + nextFrame * meshVertexCount, localT, &expected[0], meshVertexCount);
+		for(unsigned int i = 0; i < meshVertexCount; ++i) {
+			if(isClose(expected[i].x, result[i].x) == false ||
+				isClose(expected[i].y, result[i].y) == false ||
+				isClose(expected[i].z, result[i].z) == false) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Written over a cached frame, still there afterwards only when the
+	// frame was taken from the cache rather than lerped again
+	static void markFrame(const Vec3f *frame) {
+		const_cast<Vec3f *>(frame)[0] = Vec3f(1234.0f);
+	}
+	static bool isMarked(const Vec3f *frame) {
+		return frame[0] == Vec3f(1234.0f);
+	}
+
+	const Vec3f *getVertices() const {
+		return mesh->getInterpolationData()->getVertices();
+	}
+	const Vec3f *getNormals() const {
+		return mesh->getInterpolationData()->getNormals();
+	}
+
+public:
+
+	void setUp() {
+		cacheSize = InterpolationData::getCacheSize();
+		cacheSteps = InterpolationData::getCacheSteps();
+		InterpolationData::setEnableInterpolation(true);
+		InterpolationData::setCacheSteps(16);
+		// there is no gl context to ask, and no buffers are built
+		Shared::Graphics::Gl::setVBOSupported(false);
+		mesh = newMesh();
+	}
+
+	void tearDown() {
+		delete mesh;
+		mesh = NULL;
+		InterpolationData::setEnableInterpolation(true);
+		InterpolationData::setCacheSize(cacheSize);
+		InterpolationData::setCacheSteps(cacheSteps);
+	}
+
+	void test_lerpFrames_matches_scalar() {
+		const float values[] = { 0.0f, 0.125f, 0.37f, 0.5f, 0.999f, 1.0f };
+
+		// every count up to a few vector widths, so every tail is covered
+		for(unsigned int count = 0; count <= 21; ++count) {
+			std::vector<Vec3f> prev(count + 1), next(count + 1);
+			fillFrame(prev, 1);
+			fillFrame(next, 2);
+
+			for(unsigned int i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+				std::vector<Vec3f> expected(count + 1), result(count + 1);
+				InterpolationData::lerpFramesScalar(&prev[0], &next[0], values[i], &expected[0], count);
+				InterpolationData::lerpFrames(&prev[0], &next[0], values[i], &result[0], count);
+				for(unsigned int j = 0; j < count; ++j) {
+					CPPUNIT_ASSERT( isClose(expected[j].x, result[j].x) );
+					CPPUNIT_ASSERT( isClose(expected[j].y, result[j].y) );
+					CPPUNIT_ASSERT( isClose(expected[j].z, result[j].z) );
+				}
+				// nothing past count is written
+				CPPUNIT_ASSERT( result[count] == Vec3f(0.0f) );
+			}
+		}
+	}
+
+	void test_lerpFrames_endpoints() {
+		std::vector<Vec3f> prev(13), next(13), result(13);
+		fillFrame(prev, 3);
+		fillFrame(next, 4);
+
+		InterpolationData::lerpFrames(&prev[0], &next[0], 0.0f, &result[0], 13);
+		for(unsigned int j = 0; j < result.size(); ++j) {
+			CPPUNIT_ASSERT( result[j] == prev[j] );
+		}
+	}
+
+	void test_cache_hit() {
+		InterpolationData::setCacheSize(4);
+
+		mesh->updateInterpolationData(0.3125f, true);
+		const Vec3f *vertices = getVertices();
+		CPPUNIT_ASSERT( isFrame(vertices, mesh->getVertices(), 1, 0.25f) );
+		markFrame(vertices);
+
+		// rounds to the same step
+		mesh->updateInterpolationData(0.3130f, true);
+		CPPUNIT_ASSERT_EQUAL( vertices, getVertices() );
+		CPPUNIT_ASSERT( isMarked(getVertices()) == true );
+	}
+
+	void test_cache_miss() {
+		InterpolationData::setCacheSize(4);
+
+		mesh->updateInterpolationData(0.3125f, true);
+		const Vec3f *first = getVertices();
+		markFrame(first);
+
+		mesh->updateInterpolationData(0.5625f, true);
+		CPPUNIT_ASSERT( first != getVertices() );
+		CPPUNIT_ASSERT( isFrame(getVertices(), mesh->getVertices(), 2, 0.25f) );
+
+		// a cycle and a single play of the same t are different frames
+		mesh->updateInterpolationData(0.5625f, false);
+		CPPUNIT_ASSERT( isFrame(getVertices(), mesh->getVertices(), 1, 0.6875f) );
+
+		// the first is still cached
+		mesh->updateInterpolationData(0.3125f, true);
+		CPPUNIT_ASSERT_EQUAL( first, getVertices() );
+		CPPUNIT_ASSERT( isMarked(getVertices()) == true );
+	}
+
+	void test_cache_eviction() {
+		InterpolationData::setCacheSize(2);
+
+		mesh->updateInterpolationData(0.125f, true);
+		const Vec3f *a = getVertices();
+		markFrame(a);
+		mesh->updateInterpolationData(0.3125f, true);
+		const Vec3f *b = getVertices();
+		markFrame(b);
+
+		// using a makes b the least recently used
+		mesh->updateInterpolationData(0.125f, true);
+		CPPUNIT_ASSERT( isMarked(getVertices()) == true );
+
+		// a third frame replaces b in its buffer
+		mesh->updateInterpolationData(0.875f, true);
+		CPPUNIT_ASSERT_EQUAL( b, getVertices() );
+		CPPUNIT_ASSERT( isFrame(getVertices(), mesh->getVertices(), 3, 0.5f) );
+
+		mesh->updateInterpolationData(0.125f, true);
+		CPPUNIT_ASSERT_EQUAL( a, getVertices() );
+		CPPUNIT_ASSERT( isMarked(getVertices()) == true );
+
+		// b is lerped again
+		mesh->updateInterpolationData(0.3125f, true);
+		CPPUNIT_ASSERT_EQUAL( b, getVertices() );
+		CPPUNIT_ASSERT( isFrame(getVertices(), mesh->getVertices(), 1, 0.25f) );
+	}
+
+	void test_cache_vertices_and_normals_share_entry() {
+		InterpolationData::setCacheSize(1);
+
+		mesh->updateInterpolationData(0.125f, true);
+		const Vec3f *vertices = getVertices();
+		const Vec3f *normals = getNormals();
+		CPPUNIT_ASSERT( isFrame(vertices, mesh->getVertices(), 0, 0.5f) );
+		CPPUNIT_ASSERT( isFrame(normals, mesh->getNormals(), 0, 0.5f) );
+
+		// the vertices alone (as for shadows) keep the normals of the entry
+		markFrame(normals);
+		mesh->updateInterpolationVertices(0.125f, true);
+		CPPUNIT_ASSERT_EQUAL( vertices, getVertices() );
+		CPPUNIT_ASSERT( isMarked(getNormals()) == true );
+
+		// one entry holds both, the next frame reuses both buffers
+		mesh->updateInterpolationData(0.5625f, true);
+		CPPUNIT_ASSERT_EQUAL( vertices, getVertices() );
+		CPPUNIT_ASSERT_EQUAL( normals, getNormals() );
+		CPPUNIT_ASSERT( isFrame(getVertices(), mesh->getVertices(), 2, 0.25f) );
+		CPPUNIT_ASSERT( isFrame(getNormals(), mesh->getNormals(), 2, 0.25f) );
+	}
+};
+
+// Test Suite Registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( InterpolationTest );
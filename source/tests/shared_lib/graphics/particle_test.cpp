@@ -0,0 +1,127 @@
+// ==============================================================
+//	This file is part of ZetaGlest Unit Tests
+//
+//	Copyright (C) 2018  The ZetaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 3 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "particle.h"
+#include <algorithm>
+
+using namespace Shared::Graphics;
+
+//
+// Tests for the particle systems, the pool must hand back clean memory and
+// the update without virtual calls must move the particles as the one with
+// them does
+//
+
+// A unit particle system updated by the loop of the base class, which calls
+// updateParticle() and deathTest() through the vtable for every particle
+class VirtualLoopParticleSystem : public UnitParticleSystem {
+public:
+	explicit VirtualLoopParticleSystem(int particleCount) : UnitParticleSystem(particleCount) {
+	}
+
+protected:
+	virtual void updateParticles() {
+		ParticleSystem::updateParticles();
+	}
+};
+
+class ParticleTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( ParticleTest );
+
+	CPPUNIT_TEST( test_pool_reuses_systems );
+	CPPUNIT_TEST( test_update_matches_virtual_loop );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+	static void setUpSystem(UnitParticleSystem *ps) {
+		ps->setPos(Vec3f(5.0f, 6.0f, 7.0f));
+		ps->setSpeed(0.5f);
+		ps->setGravity(0.1f);
+		ps->setWind(30.0f, 0.2f);
+		ps->setMaxParticleEnergy(20);
+		// particles die at different frames, so the dead are replaced from
+		// the back of the array while it is walked
+		ps->setVarParticleEnergy(10);
+		ps->setEmissionRate(7.5f);
+	}
+
+public:
+
+	void test_pool_reuses_systems() {
+		const int particleCount = 100;
+
+		UnitParticleSystem *first = new UnitParticleSystem(particleCount);
+		first->setPos(Vec3f(5.0f, 6.0f, 7.0f));
+		first->update();
+		CPPUNIT_ASSERT( first->getAliveParticleCount() > 0 );
+		const Particle *firstParticles = first->getParticle(0);
+		void *firstAddress = first;
+		delete first;
+
+		UnitParticleSystem *second = new UnitParticleSystem(particleCount);
+#ifndef SL_LEAK_DUMP
+		CPPUNIT_ASSERT_EQUAL( firstAddress, (void *)second );
+#endif
+		CPPUNIT_ASSERT_EQUAL( firstParticles, second->getParticle(0) );
+		CPPUNIT_ASSERT_EQUAL( 0, second->getAliveParticleCount() );
+
+		// what the first system wrote is gone
+		for(int i = 0; i < particleCount; ++i) {
+			const Particle *particle = second->getParticle(i);
+			CPPUNIT_ASSERT_EQUAL( 0, particle->getEnergy() );
+			CPPUNIT_ASSERT( particle->getPos() == Vec3f(0.0f) );
+			CPPUNIT_ASSERT( particle->getSpeed() == Vec3f(0.0f) );
+			CPPUNIT_ASSERT_EQUAL( 0.0f, particle->getSize() );
+		}
+		delete second;
+	}
+
+	void test_update_matches_virtual_loop() {
+		const int particleCount = 200;
+		const int frameCount = 60;
+
+		UnitParticleSystem *direct = new UnitParticleSystem(particleCount);
+		UnitParticleSystem *virtualLoop = new VirtualLoopParticleSystem(particleCount);
+		setUpSystem(direct);
+		setUpSystem(virtualLoop);
+
+		int maxAliveCount = 0;
+		for(int frame = 0; frame < frameCount; ++frame) {
+			direct->update();
+			virtualLoop->update();
+
+			CPPUNIT_ASSERT_EQUAL( virtualLoop->getAliveParticleCount(), direct->getAliveParticleCount() );
+			for(int i = 0; i < direct->getAliveParticleCount(); ++i) {
+				const Particle *expected = virtualLoop->getParticle(i);
+				const Particle *particle = direct->getParticle(i);
+				CPPUNIT_ASSERT( particle->getPos() == expected->getPos() );
+				CPPUNIT_ASSERT( particle->getLastPos() == expected->getLastPos() );
+				CPPUNIT_ASSERT( particle->getSpeed() == expected->getSpeed() );
+				CPPUNIT_ASSERT( particle->getAccel() == expected->getAccel() );
+				CPPUNIT_ASSERT( particle->getColor() == expected->getColor() );
+				CPPUNIT_ASSERT_EQUAL( expected->getSize(), particle->getSize() );
+				CPPUNIT_ASSERT_EQUAL( expected->getEnergy(), particle->getEnergy() );
+			}
+			maxAliveCount = std::max(maxAliveCount, direct->getAliveParticleCount());
+		}
+		// the test means nothing if no particle lived
+		CPPUNIT_ASSERT( maxAliveCount > 0 );
+
+		delete direct;
+		delete virtualLoop;
+	}
+};
+
+// Test Suite Registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( ParticleTest );
@@ -0,0 +1,90 @@
+// ==============================================================
+//	This file is part of ZetaGlest Unit Tests
+//
+//	Copyright (C) 2018  The ZetaGlest team
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 3 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "checksum.h"
+#include <vector>
+
+using namespace Shared::Util;
+
+//
+// Tests for the checksum, the word at a time paths must give what adding
+// the same bytes one by one gives, the network synch checks compare them
+//
+class ChecksumTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( ChecksumTest );
+
+	CPPUNIT_TEST( test_knownValue );
+	CPPUNIT_TEST( test_addBytes_matches_addByte );
+	CPPUNIT_TEST( test_integers_match_addByte );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+public:
+
+	void test_knownValue() {
+		Checksum checksum;
+		checksum.addString("123456789");
+		CPPUNIT_ASSERT_EQUAL( (uint32)0xCBF43926, checksum.getSum() );
+	}
+
+	void test_addBytes_matches_addByte() {
+		std::vector<char> data(80);
+		for(unsigned int i = 0; i < data.size(); ++i) {
+			data[i] = (char)(i * 37 + 11);
+		}
+
+		// every length and a few offsets, so the 8 byte steps start
+		// unaligned and leave every possible tail
+		for(unsigned int offset = 0; offset < 4; ++offset) {
+			for(unsigned int length = 0; offset + length <= data.size(); ++length) {
+				Checksum bytewise;
+				for(unsigned int i = 0; i < length; ++i) {
+					bytewise.addByte(data[offset + i]);
+				}
+				Checksum checksum;
+				checksum.addBytes(&data[offset], length);
+				CPPUNIT_ASSERT_EQUAL( bytewise.getSum(), checksum.getSum() );
+			}
+		}
+	}
+
+	void test_integers_match_addByte() {
+		const int64 values[] = { 0, 1, -1, 0x7FFFFFFF, -0x7FFFFFFF - 1,
+			0x123456789ABCDEFLL, -0x123456789ABCDEFLL };
+
+		for(unsigned int i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+			Checksum bytewise;
+			for(int byteIndex = 0; byteIndex < 4; ++byteIndex) {
+				bytewise.addByte((char)(values[i] >> (8 * byteIndex)));
+			}
+			Checksum checksum;
+			checksum.addInt((int32)values[i]);
+			CPPUNIT_ASSERT_EQUAL( bytewise.getSum(), checksum.getSum() );
+			checksum.addUInt((uint32)values[i]);
+			for(int byteIndex = 0; byteIndex < 4; ++byteIndex) {
+				bytewise.addByte((char)(values[i] >> (8 * byteIndex)));
+			}
+			CPPUNIT_ASSERT_EQUAL( bytewise.getSum(), checksum.getSum() );
+
+			checksum.addInt64(values[i]);
+			for(int byteIndex = 0; byteIndex < 8; ++byteIndex) {
+				bytewise.addByte((char)(values[i] >> (8 * byteIndex)));
+			}
+			CPPUNIT_ASSERT_EQUAL( bytewise.getSum(), checksum.getSum() );
+		}
+	}
+};
+
+// Test Suite Registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( ChecksumTest );
@@ -12,8 +12,12 @@
 #include <cppunit/extensions/HelperMacros.h>
 #include <memory>
 #include <fstream>
+#include <iterator>
 #include "xml_parser.h"
 #include "platform_util.h"
+#include "platform_common.h"
+#include "cooked_asset_cache.h"
+#include "byte_order.h"
 
 #if defined(WANT_XERCES)
 
@@ -171,6 +175,7 @@ class XmlIoRapidTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST_EXCEPTION( test_load_file_malformed_content,  megaglest_runtime_error );
 	CPPUNIT_TEST_EXCEPTION( test_save_file_null_node,  megaglest_runtime_error );
 	CPPUNIT_TEST(test_save_file_valid_node );
+	CPPUNIT_TEST( test_load_file_cooked );
 
 	CPPUNIT_TEST_SUITE_END();
 	// End of Fixture registration
@@ -230,6 +235,219 @@ public:
 
 		delete rootNode;
 	}
+
+	// The cooked copy keeps the values from before the tag replacement, so
+	// loading it must give what parsing the file gives
+	void test_load_file_cooked() {
+		const string test_filename = "./xml_test_cooked.xml";
+		const string cooked_path = "xml_test_cooked_cache/";
+		{
+			std::ofstream xmlFile(test_filename.c_str());
+			xmlFile << "<?xml version=\"1.0\"?>" << std::endl
+					<< "<unit>" << std::endl
+					<< "<image path=\"{TECHTREEPATH}/images/unit.bmp\"/>" << std::endl
+					<< "<sound path=\"$COMMONDATAPATH/sounds/unit.wav\"/>" << std::endl
+					<< "<!-- a comment -->" << std::endl
+					<< "<name>{TECHTREEPATH}</name>" << std::endl
+					<< "</unit>" << std::endl;
+		}
+		SafeRemoveTestFile deleteFile(test_filename);
+
+		std::ifstream sourceFile(test_filename.c_str(), std::ios::binary);
+		string source((std::istreambuf_iterator<char>(sourceFile)), std::istreambuf_iterator<char>());
+		sourceFile.close();
+
+		Shared::Util::CookedAssetCache::setPath(cooked_path, vector<string>(1, "."));
+		string cookedEntry = Shared::Util::CookedAssetCache::getEntryPath("xml", source.data(), source.size());
+		SafeRemoveTestFile deleteEntry(cookedEntry);
+
+		std::map<string,string> mapTagReplacementValues;
+		mapTagReplacementValues["{TECHTREEPATH}"] = "techs/test";
+
+		XmlNode *parsedNode = XmlIoRapid::getInstance().load(test_filename, mapTagReplacementValues);
+		CPPUNIT_ASSERT( Shared::PlatformCommon::fileExists(cookedEntry) );
+		XmlNode *cookedNode = XmlIoRapid::getInstance().load(test_filename, mapTagReplacementValues);
+
+		Shared::Util::CookedAssetCache::setPath("", vector<string>());
+		Shared::PlatformCommon::removeFolder(cooked_path);
+
+		CPPUNIT_ASSERT_EQUAL( parsedNode->getChildCount(), cookedNode->getChildCount() );
+		CPPUNIT_ASSERT_EQUAL( string("techs/test/images/unit.bmp"),
+			cookedNode->getChild("image")->getAttribute("path")->getRestrictedValue() );
+		CPPUNIT_ASSERT_EQUAL( parsedNode->getChild("sound")->getAttribute("path")->getRestrictedValue("units/"),
+			cookedNode->getChild("sound")->getAttribute("path")->getRestrictedValue("units/") );
+		CPPUNIT_ASSERT_EQUAL( parsedNode->getChild("name")->getText(), cookedNode->getChild("name")->getText() );
+
+		delete parsedNode;
+		delete cookedNode;
+	}
+};
+
+//
+// Tests for XmlIoBinary
+//
+class XmlIoBinaryTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( XmlIoBinaryTest );
+
+	CPPUNIT_TEST( test_save_load_round_trip );
+	CPPUNIT_TEST( test_encode_load_round_trip );
+	CPPUNIT_TEST( test_load_truncated );
+	CPPUNIT_TEST_EXCEPTION( test_load_bad_magic,  megaglest_runtime_error );
+	CPPUNIT_TEST_EXCEPTION( test_load_bad_version,  megaglest_runtime_error );
+	CPPUNIT_TEST_EXCEPTION( test_load_string_index_out_of_range,  megaglest_runtime_error );
+	CPPUNIT_TEST_EXCEPTION( test_load_trailing_bytes,  megaglest_runtime_error );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+private:
+
+	static string readTestFile(const string &filename) {
+		std::ifstream file(filename.c_str(), std::ios::binary);
+		return string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	}
+
+	static string encodeXml(const string &xml) {
+		vector<char> buffer(xml.begin(), xml.end());
+		buffer.push_back(0);
+		xml_document<> doc;
+		doc.parse<parse_no_data_nodes | parse_validate_closing_tags>(&buffer.front());
+		return XmlIoBinary::encode(doc.first_node());
+	}
+
+	static XmlNode *loadBinary(const string &data) {
+		return XmlIoBinary::load(data.data(), data.size(), "xml_test_binary", std::map<string,string>());
+	}
+
+	// The format header followed by a string table of "root"
+	static string binaryHeader() {
+		string data("ZGXB");
+		Shared::Platform::uint32 version = Shared::PlatformByteOrder::toCommonEndian(XmlIoBinary::version);
+		data.append((const char *)&version, sizeof(version));
+		data += (char)1;
+		data += (char)4;
+		data += "root";
+		return data;
+	}
+
+	static void assertSameNode(const XmlNode *expected, const XmlNode *node) {
+		CPPUNIT_ASSERT_EQUAL( expected->getName(), node->getName() );
+		CPPUNIT_ASSERT_EQUAL( expected->getText(), node->getText() );
+		CPPUNIT_ASSERT_EQUAL( expected->getAttributeCount(), node->getAttributeCount() );
+		for(unsigned int i = 0; i < expected->getAttributeCount(); ++i) {
+			CPPUNIT_ASSERT_EQUAL( expected->getAttribute(i)->getName(), node->getAttribute(i)->getName() );
+			CPPUNIT_ASSERT_EQUAL( expected->getAttribute(i)->getValue("", false), node->getAttribute(i)->getValue("", false) );
+		}
+		CPPUNIT_ASSERT_EQUAL( expected->getChildCount(), node->getChildCount() );
+		for(unsigned int i = 0; i < expected->getChildCount(); ++i) {
+			assertSameNode(expected->getChild(i), node->getChild(i));
+		}
+	}
+
+	static const char *testXml() {
+		return "<game version=\"1\">"
+				"<unit id=\"1\" name=\"worker\"><pos value=\"10,12\"/></unit>"
+				"<unit id=\"2\" name=\"worker\"><pos value=\"11,12\"/></unit>"
+				"<note>some text</note>"
+				"</game>";
+	}
+
+public:
+
+	void test_save_load_round_trip() {
+		const string test_filename = "xml_test_binary_save.bin";
+		SafeRemoveTestFile deleteFile(test_filename);
+
+		XmlTree xmlTree;
+		xmlTree.init("game");
+		XmlNode *rootNode = xmlTree.getRootNode();
+		rootNode->addAttribute("version", "1", std::map<string,string>());
+		const char *unitIds[] = { "1", "2", "3" };
+		for(int i = 0; i < 3; ++i) {
+			// the repeated names and values share one string table entry
+			XmlNode *unitNode = rootNode->addChild("unit");
+			unitNode->addAttribute("id", unitIds[i], std::map<string,string>());
+			unitNode->addAttribute("name", "worker", std::map<string,string>());
+			unitNode->addChild("pos")->addAttribute("value", "10,12", std::map<string,string>());
+		}
+		rootNode->addChild("note", "some text");
+		rootNode->addChild("empty");
+
+		xmlTree.saveBinary(test_filename);
+		CPPUNIT_ASSERT( XmlIoBinary::isBinaryFile(test_filename) == true );
+
+		XmlTree loadedTree;
+		loadedTree.load(test_filename, std::map<string,string>());
+		assertSameNode(rootNode, loadedTree.getRootNode());
+	}
+
+	void test_encode_load_round_trip() {
+		string xml = testXml();
+		vector<char> buffer(xml.begin(), xml.end());
+		buffer.push_back(0);
+		xml_document<> doc;
+		doc.parse<parse_no_data_nodes | parse_validate_closing_tags>(&buffer.front());
+		XmlNode parsedNode(doc.first_node(), std::map<string,string>());
+
+		string data = encodeXml(xml);
+		CPPUNIT_ASSERT( XmlIoBinary::isBinaryData(data.data(), data.size()) == true );
+
+		XmlNode *loadedNode = loadBinary(data);
+		assertSameNode(&parsedNode, loadedNode);
+		delete loadedNode;
+	}
+
+	void test_load_truncated() {
+		string data = encodeXml(testXml());
+		// every cut, from within the header to the last byte, is refused
+		for(size_t size = 0; size < data.size(); ++size) {
+			bool thrown = false;
+			try {
+				XmlNode *node = loadBinary(data.substr(0, size));
+				delete node;
+			}
+			catch(const megaglest_runtime_error &) {
+				thrown = true;
+			}
+			CPPUNIT_ASSERT( thrown == true );
+		}
+	}
+
+	void test_load_bad_magic() {
+		string data = encodeXml(testXml());
+		data[0] = 'X';
+		delete loadBinary(data);
+	}
+
+	void test_load_bad_version() {
+		string data = encodeXml(testXml());
+		Shared::Platform::uint32 version = Shared::PlatformByteOrder::toCommonEndian(XmlIoBinary::version + 1);
+		data.replace(4, sizeof(version), (const char *)&version, sizeof(version));
+		delete loadBinary(data);
+	}
+
+	void test_load_string_index_out_of_range() {
+		string data = binaryHeader();
+		// the name of the node is string 0, its text the missing string 1
+		data += (char)0;
+		data += (char)1;
+		data += (char)0;
+		data += (char)0;
+		delete loadBinary(data);
+	}
+
+	void test_load_trailing_bytes() {
+		string data = binaryHeader();
+		data += (char)0;
+		data += (char)0;
+		data += (char)0;
+		data += (char)0;
+		// loads without the extra byte
+		delete loadBinary(data);
+		data += (char)0;
+		delete loadBinary(data);
+	}
 };
 
 //
@@ -335,6 +553,7 @@ class XmlNodeTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST( test_valid_named_node );
 	CPPUNIT_TEST( test_child_nodes );
 	CPPUNIT_TEST( test_node_attributes );
+	CPPUNIT_TEST( test_node_attribute_tags );
 
 	CPPUNIT_TEST_SUITE_END();
 	// End of Fixture registration
@@ -471,6 +690,20 @@ public:
 		CPPUNIT_ASSERT_EQUAL( true, node.hasAttribute("some-attribute") );
 	}
 
+	// values without tags are kept as given, the rest still get their
+	// replacements and path cleanup
+	void test_node_attribute_tags() {
+		XmlNode node("testNode");
+		std::map<string,string> mapTagReplacementValues;
+
+		CPPUNIT_ASSERT_EQUAL( string("-123.5"), node.addAttribute("number", "-123.5", mapTagReplacementValues)->getValue() );
+		CPPUNIT_ASSERT_EQUAL( string("a//b"), node.addAttribute("plain", "a//b", mapTagReplacementValues)->getValue() );
+		CPPUNIT_ASSERT_EQUAL( string("{APPLICATIONPATH}/b"), node.addAttribute("path", "{APPLICATIONPATH}//b", mapTagReplacementValues)->getValue() );
+
+		mapTagReplacementValues["KEY"] = "value";
+		CPPUNIT_ASSERT_EQUAL( string("value-1"), node.addAttribute("replaced", "KEY-1", mapTagReplacementValues)->getValue() );
+	}
+
 };
 
 #if defined(WANT_XERCES)
@@ -623,6 +856,7 @@ public:
 // Test Suite Registrations
 
 CPPUNIT_TEST_SUITE_REGISTRATION( XmlIoRapidTest );
+CPPUNIT_TEST_SUITE_REGISTRATION( XmlIoBinaryTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( XmlTreeTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( XmlNodeTest );
 
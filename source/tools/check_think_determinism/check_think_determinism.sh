@@ -0,0 +1,30 @@
+#!/bin/sh
+
+# utility for zetaglest
+# play a replay headless twice, once with the unit think step on the main
+# thread and once on the faction threads, and check that the world checksum
+# of every frame is the same in both runs. Exits with 1 when they differ.
+# With DebugWorldSynch=true in glestuser.ini both runs also check that the
+# units the think step found around a unit only lack those created later in
+# the same frame, which are acquired one frame late.
+# license: GPL v3
+
+##########################################
+
+if [ $# -lt 1 ] || [ $# -gt 2 ]; then
+	echo ""
+	echo "usage: $0 replay-file [zetaglest-binary]"
+	echo ""
+	echo "  replay-file  the .replay file written next to a saved game with"
+	echo "               SaveCommandsForReplay enabled"
+	echo ""
+	exit 1
+fi
+
+REPLAY="${1%.replay}.replay"
+ZETAGLEST="${2:-zetaglest}"
+
+rm -f "$REPLAY.serial.crc" "$REPLAY.threaded.crc"
+
+"$ZETAGLEST" --benchmark-replay="$REPLAY=csv=serial" > /dev/null || exit 1
+"$ZETAGLEST" --benchmark-replay="$REPLAY=csv=threaded" || exit 1
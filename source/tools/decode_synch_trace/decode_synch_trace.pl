@@ -0,0 +1,97 @@
+#!/usr/bin/perl -w
+
+# utility for zetaglest
+# decode the binary world synch trace (synchTrace.bin in the logs folder)
+# written by builds with USE_SYNCH_TRACE into text. Decode the traces of two
+# players with -s and diff them to find the first frame that went out of synch.
+# license: GPL v3
+
+##########################################
+
+use strict;
+use Getopt::Std;
+
+our %opts;
+getopts('su:f:', \%opts);
+
+if ( $#ARGV != 0 ) {
+	die "\nusage: $0 [-s] [-u unitId] [-f fromFrame[:toFrame]] synch-trace-file\n\n" .
+		"  -s  sort by frame and unit, events of threaded path finding are\n" .
+		"      recorded in thread order otherwise\n" .
+		"  -u  only the events of this unit, -1 for events without unit\n" .
+		"  -f  only the events of these frames\n\n";
+}
+
+my ($fromFrame, $toFrame);
+if ( defined $opts{f} ) {
+	($fromFrame, $toFrame) = split(/:/, $opts{f});
+}
+
+open (TRACE, "< $ARGV[0]") || die "can't read synch trace: $ARGV[0] ERROR: $!\n";
+binmode TRACE;
+
+sub readBytes {
+	my ($count) = @_;
+	my $data = '';
+	my $read = read(TRACE, $data, $count);
+	if ( !defined $read || $read != $count ) {
+		die "truncated synch trace: $ARGV[0]\n";
+	}
+	return $data;
+}
+
+sub readInts {
+	my ($count) = @_;
+	# 32 bit signed little endian
+	return unpack("l<$count", readBytes(4 * $count));
+}
+
+if ( readBytes(4) ne 'ZGST' ) {
+	die "not a synch trace: $ARGV[0]\n";
+}
+my ($version) = readInts(1);
+if ( $version != 1 ) {
+	die "unsupported synch trace version: $version\n";
+}
+
+# event names, by convention name(arg0,arg1,...)
+my (%eventNames, %eventArgs);
+my ($eventCount) = readInts(1);
+for ( my $i = 0; $i < $eventCount; $i++ ) {
+	my ($code, $length) = readInts(2);
+	my $event = readBytes($length);
+	if ( $event =~ /^(.*)\(([^\)]*)\)$/ ) {
+		$eventNames{$code} = $1;
+		@{$eventArgs{$code}} = split(/,/, $2);
+	} else {
+		$eventNames{$code} = $event;
+		@{$eventArgs{$code}} = ();
+	}
+}
+
+my @records;
+my ($recordCount) = readInts(1);
+for ( my $i = 0; $i < $recordCount; $i++ ) {
+	my @record = readInts(7);
+	my ($frame, $unitId) = @record;
+	next if ( defined $opts{u} && $unitId != $opts{u} );
+	next if ( defined $fromFrame && $fromFrame ne '' && $frame < $fromFrame );
+	next if ( defined $toFrame && $toFrame ne '' && $frame > $toFrame );
+	push(@records, \@record);
+}
+close(TRACE);
+
+if ( defined $opts{s} ) {
+	# perl sort is stable, the events of one unit keep their order
+	@records = sort { $a->[0] <=> $b->[0] || $a->[1] <=> $b->[1] } @records;
+}
+
+foreach my $record (@records) {
+	my ($frame, $unitId, $code, @args) = @$record;
+	my $line = "frame $frame unit $unitId $eventNames{$code}";
+	my @argNames = @{$eventArgs{$code}};
+	for ( my $i = 0; $i <= $#argNames; $i++ ) {
+		$line .= " $argNames[$i]=$args[$i]";
+	}
+	print "$line\n";
+}